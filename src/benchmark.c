@@ -0,0 +1,454 @@
+/* Copyright (C) 2026 Greenbone AG
+ *
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file benchmark.c
+ * @brief The Greenbone Vulnerability Manager benchmark program.
+ *
+ * Loads a synthetic dataset (reports x results, plus NVTs) into a database
+ * and measures the wall time of the hot paths: the CREATE_REPORT import,
+ * result iteration as done by GET_RESULTS, report iteration as done by
+ * GET_REPORTS, NVT iteration as done by GET_NVTS, and report counting.
+ *
+ * Each measurement is printed to stdout as a line of JSON, so that runs can
+ * be recorded and compared across versions.  The program needs a migrated
+ * database with at least one Admin user, and must not run against a
+ * production database: the dataset is created through the regular tables
+ * and only removed again when --keep is not given.
+ */
+
+#include "manage.h"
+#include "manage_sql.h"
+#include "sql.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#undef G_LOG_DOMAIN
+/**
+ * @brief GLib log domain.
+ */
+#define G_LOG_DOMAIN "md   main"
+
+/**
+ * @brief Prefix of the OIDs of the synthetic NVTs.
+ */
+#define BENCHMARK_OID_PREFIX "1.3.6.1.4.1.25623.1.99."
+
+/**
+ * @brief Get the monotonic time, in milliseconds.
+ *
+ * @return Monotonic time in milliseconds.
+ */
+static double
+benchmark_now ()
+{
+  return g_get_monotonic_time () / 1000.0;
+}
+
+/**
+ * @brief Print one measurement as a line of JSON.
+ *
+ * @param[in]  name     Name of the measurement.
+ * @param[in]  wall_ms  Wall time in milliseconds.
+ * @param[in]  rows     Number of rows the measurement covered.
+ */
+static void
+benchmark_emit (const char *name, double wall_ms, long long int rows)
+{
+  struct rusage usage;
+
+  memset (&usage, 0, sizeof (usage));
+  getrusage (RUSAGE_SELF, &usage);
+  printf ("{\"benchmark\": \"%s\", \"wall_ms\": %0.1f, \"rows\": %lli,"
+          " \"max_rss_kib\": %li}\n",
+          name, wall_ms, rows, usage.ru_maxrss);
+  fflush (stdout);
+}
+
+/**
+ * @brief Load synthetic NVTs.
+ *
+ * @param[in]  nvts  Number of NVTs.
+ */
+static void
+benchmark_load_nvts (int nvts)
+{
+  sql ("INSERT INTO nvts"
+       " (uuid, oid, name, family, cvss_base, category, qod, qod_type,"
+       "  creation_time, modification_time)"
+       " SELECT '" BENCHMARK_OID_PREFIX "' || n,"
+       "        '" BENCHMARK_OID_PREFIX "' || n,"
+       "        'Benchmark NVT ' || n,"
+       "        'Benchmark',"
+       "        '5.0',"
+       "        3,"
+       "        75,"
+       "        'remote_banner',"
+       "        m_now (),"
+       "        m_now ()"
+       " FROM generate_series (1, %i) AS n"
+       " ON CONFLICT (oid) DO NOTHING;",
+       nvts);
+}
+
+/**
+ * @brief Import one report of synthetic results through create_report.
+ *
+ * Spools the results the way the CREATE_REPORT parser does, runs the real
+ * import, then waits for the forked importer to finish by polling the
+ * result count of the report.
+ *
+ * @param[in]  task_id  UUID of the container task.
+ * @param[in]  results  Number of results in the report.
+ * @param[in]  nvts     Number of synthetic NVTs to spread the results over.
+ *
+ * @return Freshly allocated UUID of the report, or NULL on error.
+ */
+static char *
+benchmark_import_report (const char *task_id, int results, int nvts)
+{
+  FILE *spool;
+  array_t *host_starts, *host_ends, *details;
+  char *report_id;
+  int index, ret;
+  report_t report;
+
+  spool = tmpfile ();
+  if (spool == NULL)
+    {
+      g_warning ("%s: tmpfile: %s", __func__, strerror (errno));
+      return NULL;
+    }
+
+  for (index = 0; index < results; index++)
+    {
+      gchar *host, *oid, *description;
+
+      host = g_strdup_printf ("192.0.2.%i", index % 255 + 1);
+      oid = g_strdup_printf (BENCHMARK_OID_PREFIX "%i", index % nvts + 1);
+      description = g_strdup_printf ("Benchmark result %i.  Synthetic"
+                                     " description text of typical length"
+                                     " for a scanner finding, including a"
+                                     " port and a protocol.",
+                                     index);
+      if (create_report_spool_result (spool, host, "benchmark.example.com",
+                                      "443/tcp", oid, "High", description,
+                                      "2026-01-01T00:00:00Z", "5.0", "75",
+                                      "remote_banner"))
+        {
+          g_free (host);
+          g_free (oid);
+          g_free (description);
+          fclose (spool);
+          return NULL;
+        }
+      g_free (host);
+      g_free (oid);
+      g_free (description);
+    }
+
+  host_starts = make_array ();
+  host_ends = make_array ();
+  details = make_array ();
+  array_terminate (host_starts);
+  array_terminate (host_ends);
+  array_terminate (details);
+
+  report_id = NULL;
+  ret = create_report (spool, results, task_id, "0", NULL, NULL,
+                       host_starts, host_ends, details, &report_id);
+  fclose (spool);
+  g_ptr_array_free (host_starts, TRUE);
+  g_ptr_array_free (host_ends, TRUE);
+  g_ptr_array_free (details, TRUE);
+
+  if (ret)
+    {
+      g_warning ("%s: create_report failed: %i", __func__, ret);
+      return NULL;
+    }
+
+  /* The import runs in a forked child, so wait until all the results of the
+   * report are in place. */
+
+  if (find_report_with_permission (report_id, &report, NULL) || report == 0)
+    {
+      g_warning ("%s: failed to find imported report", __func__);
+      free (report_id);
+      return NULL;
+    }
+
+  while (sql_int ("SELECT count (*) FROM results WHERE report = %llu;",
+                  report)
+         < results)
+    gvm_usleep (10000);
+
+  return report_id;
+}
+
+/**
+ * @brief Remove the synthetic dataset again.
+ *
+ * @param[in]  task_id     UUID of the container task.
+ * @param[in]  report_ids  UUIDs of the imported reports.
+ */
+static void
+benchmark_cleanup (const char *task_id, GPtrArray *report_ids)
+{
+  guint index;
+
+  for (index = 0; index < report_ids->len; index++)
+    if (delete_report (g_ptr_array_index (report_ids, index), 0))
+      g_warning ("%s: failed to delete report %s", __func__,
+                 (char *) g_ptr_array_index (report_ids, index));
+  if (request_delete_task_uuid (task_id, 1))
+    g_warning ("%s: failed to delete task %s", __func__, task_id);
+  sql ("DELETE FROM nvts WHERE oid LIKE '" BENCHMARK_OID_PREFIX "%%';");
+}
+
+/**
+ * @brief Run the benchmarks.
+ *
+ * @param[in]  argc  Argument count.
+ * @param[in]  argv  Argument vector.
+ *
+ * @return EXIT_SUCCESS on success, else EXIT_FAILURE.
+ */
+int
+main (int argc, char **argv)
+{
+  db_conn_info_t database = { NULL, NULL, NULL, NULL };
+  GError *error;
+  GOptionContext *option_context;
+  static gchar *db_name = NULL;
+  static gchar *db_host = NULL;
+  static gchar *db_port = NULL;
+  static gchar *db_user = NULL;
+  static gint reports = 10;
+  static gint results = 1000;
+  static gint nvts = 100;
+  static gboolean keep = FALSE;
+  static GOptionEntry option_entries[]
+    = {
+        { "database", 'd', 0, G_OPTION_ARG_STRING, &db_name,
+          "Use <name> as database name.", "<name>" },
+        { "db-host", '\0', 0, G_OPTION_ARG_STRING, &db_host,
+          "Use <host> as database host or socket directory.", "<host>" },
+        { "db-port", '\0', 0, G_OPTION_ARG_STRING, &db_port,
+          "Use <number> as database port.", "<number>" },
+        { "db-user", '\0', 0, G_OPTION_ARG_STRING, &db_user,
+          "Use <name> as database user.", "<name>" },
+        { "reports", '\0', 0, G_OPTION_ARG_INT, &reports,
+          "Number of synthetic reports.  Default: 10.", "<number>" },
+        { "results", '\0', 0, G_OPTION_ARG_INT, &results,
+          "Number of results per report.  Default: 1000.", "<number>" },
+        { "nvts", '\0', 0, G_OPTION_ARG_INT, &nvts,
+          "Number of synthetic NVTs.  Default: 100.", "<number>" },
+        { "keep", '\0', 0, G_OPTION_ARG_NONE, &keep,
+          "Keep the synthetic dataset instead of removing it.", NULL },
+        { NULL }
+      };
+  char *owner_uuid, *task_id;
+  GPtrArray *report_ids;
+  task_t task;
+  double start;
+  long long int row_count;
+  int index;
+  iterator_t rows;
+  get_data_t get;
+
+  error = NULL;
+  option_context
+    = g_option_context_new ("- Benchmark the Manager's hot database paths");
+  g_option_context_add_main_entries (option_context, option_entries, NULL);
+  if (g_option_context_parse (option_context, &argc, &argv, &error))
+    g_option_context_free (option_context);
+  else
+    {
+      g_option_context_free (option_context);
+      fprintf (stderr, "%s\n\n", error->message);
+      g_error_free (error);
+      return EXIT_FAILURE;
+    }
+
+  if (reports <= 0 || results <= 0 || nvts <= 0)
+    {
+      fprintf (stderr, "Counts must be positive.\n");
+      return EXIT_FAILURE;
+    }
+
+  database.name = db_name;
+  database.host = db_host;
+  database.port = db_port;
+  database.user = db_user;
+
+  if (manage_option_setup (NULL, &database))
+    return EXIT_FAILURE;
+
+  /* Run as the first Admin, because the paths under test apply the regular
+   * permission checks. */
+
+  owner_uuid = sql_string ("SELECT uuid FROM users"
+                           " WHERE id IN (SELECT \"user\" FROM role_users"
+                           "              WHERE role = (SELECT id FROM roles"
+                           "                            WHERE uuid"
+                           "                                  = '"
+                           ROLE_UUID_ADMIN "'))"
+                           " ORDER BY id LIMIT 1;");
+  if (owner_uuid == NULL)
+    {
+      fprintf (stderr, "No Admin user found.\n");
+      manage_option_cleanup ();
+      return EXIT_FAILURE;
+    }
+  current_credentials.uuid = owner_uuid;
+  manage_session_init (owner_uuid);
+
+  /* Load the synthetic NVTs and the container task. */
+
+  start = benchmark_now ();
+  benchmark_load_nvts (nvts);
+  benchmark_emit ("load-nvts", benchmark_now () - start, nvts);
+
+  task = make_task (g_strdup ("Benchmark container"), g_strdup (""), 0, 0);
+  task_uuid (task, &task_id);
+
+  /* CREATE_REPORT import. */
+
+  report_ids = g_ptr_array_new_with_free_func (free);
+  start = benchmark_now ();
+  for (index = 0; index < reports; index++)
+    {
+      char *report_id;
+
+      report_id = benchmark_import_report (task_id, results, nvts);
+      if (report_id == NULL)
+        {
+          fprintf (stderr, "Report import failed.\n");
+          g_ptr_array_free (report_ids, TRUE);
+          manage_option_cleanup ();
+          return EXIT_FAILURE;
+        }
+      g_ptr_array_add (report_ids, report_id);
+    }
+  benchmark_emit ("create-report-import", benchmark_now () - start,
+                  (long long int) reports * results);
+
+  /* Report counting, cold then cached. */
+
+  for (index = 0; index < 2; index++)
+    {
+      int report_index;
+
+      start = benchmark_now ();
+      for (report_index = 0; report_index < reports; report_index++)
+        {
+          int holes, infos, logs, warnings, false_positives;
+          double severity;
+
+          if (report_counts (g_ptr_array_index (report_ids, report_index),
+                             &holes, &infos, &logs, &warnings,
+                             &false_positives, &severity, 0, MIN_QOD_DEFAULT))
+            {
+              fprintf (stderr, "Report counting failed.\n");
+              g_ptr_array_free (report_ids, TRUE);
+              manage_option_cleanup ();
+              return EXIT_FAILURE;
+            }
+        }
+      benchmark_emit (index == 0 ? "report-counts" : "report-counts-cached",
+                      benchmark_now () - start,
+                      (long long int) reports * results);
+    }
+
+  /* GET_RESULTS style iteration over everything. */
+
+  memset (&get, '\0', sizeof (get));
+  get.type = g_strdup ("result");
+  get.filter = g_strdup ("rows=-1");
+  start = benchmark_now ();
+  row_count = 0;
+  if (init_result_get_iterator (&rows, &get, 0, NULL, NULL))
+    {
+      fprintf (stderr, "Result iteration failed.\n");
+      g_ptr_array_free (report_ids, TRUE);
+      manage_option_cleanup ();
+      return EXIT_FAILURE;
+    }
+  while (next (&rows))
+    row_count++;
+  cleanup_iterator (&rows);
+  benchmark_emit ("get-results", benchmark_now () - start, row_count);
+  g_free (get.type);
+  g_free (get.filter);
+
+  /* GET_REPORTS style iteration. */
+
+  memset (&get, '\0', sizeof (get));
+  get.type = g_strdup ("report");
+  get.filter = g_strdup ("rows=-1");
+  start = benchmark_now ();
+  row_count = 0;
+  if (init_report_iterator (&rows, &get))
+    {
+      fprintf (stderr, "Report iteration failed.\n");
+      g_ptr_array_free (report_ids, TRUE);
+      manage_option_cleanup ();
+      return EXIT_FAILURE;
+    }
+  while (next (&rows))
+    row_count++;
+  cleanup_iterator (&rows);
+  benchmark_emit ("get-reports", benchmark_now () - start, row_count);
+  g_free (get.type);
+  g_free (get.filter);
+
+  /* GET_NVTS style iteration. */
+
+  start = benchmark_now ();
+  row_count = 0;
+  init_nvt_iterator (&rows, (nvt_t) 0, (config_t) 0, NULL, NULL, 1, NULL);
+  while (next (&rows))
+    row_count++;
+  cleanup_iterator (&rows);
+  benchmark_emit ("get-nvts", benchmark_now () - start, row_count);
+
+  /* Clean up. */
+
+  if (keep == FALSE)
+    {
+      start = benchmark_now ();
+      benchmark_cleanup (task_id, report_ids);
+      benchmark_emit ("cleanup", benchmark_now () - start,
+                      (long long int) reports * results);
+    }
+
+  g_ptr_array_free (report_ids, TRUE);
+  free (task_id);
+  current_credentials.uuid = NULL;
+  free (owner_uuid);
+
+  manage_option_cleanup ();
+  return EXIT_SUCCESS;
+}
@@ -59,6 +59,13 @@
  * command element.  To implement a new start element handler, be sure to just
  * copy an existing case and keep its structure.
  *
+ * The strings in \ref command_data are allocated and freed field by field
+ * because their ownership is interwoven with the manage layer: several
+ * commands hand arrays and strings over for the manage layer to free.  So
+ * new commands that want their parsed data released in one go should use
+ * the entity tree style of gmp_tickets.c instead, where the whole command
+ * is parsed into a context that is freed wholesale at command end.
+ *
  * Attributes are easier to implement than elements.
  * E.g.
  * @code
@@ -95,6 +102,8 @@
 #include "gmp_report_formats.h"
 #include "gmp_tickets.h"
 #include "gmp_tls_certificates.h"
+#include "gmpd.h"
+#include "ipc.h"
 #include "manage.h"
 #include "manage_acl.h"
 #include "manage_port_lists.h"
@@ -726,7 +735,9 @@ typedef struct
   char *result_detection_source_oid; ///< source_oid of detection in result.
   char *result_detection_location; ///< location of detection in result.
   array_t *result_detection;      ///< Detections for current result
-  array_t *results;               ///< All results.
+  FILE *results_spool;            ///< Spool of results, in COPY text format.
+  int results_count;              ///< Number of results in the spool.
+  int results_error;              ///< Whether spooling a result failed.
   char *scan_end;                 ///< End time for a scan.
   char *scan_start;               ///< Start time for a scan.
   char *task_id;                  ///< ID of container task.
@@ -798,29 +809,8 @@ create_report_data_reset (create_report_data_t *data)
   free (data->result_nvt_oid);
   free (data->result_port);
   free (data->result_threat);
-  if (data->results)
-    {
-      guint index = data->results->len;
-      while (index--)
-        {
-          create_report_result_t *result;
-          result = (create_report_result_t*) g_ptr_array_index (data->results,
-                                                                index);
-          if (result)
-            {
-              free (result->host);
-              free (result->hostname);
-              free (result->description);
-              free (result->nvt_oid);
-              free (result->port);
-              free (result->qod);
-              free (result->qod_type);
-              free (result->scan_nvt_version);
-              free (result->severity);
-            }
-        }
-      array_free (data->results);
-    }
+  if (data->results_spool)
+    fclose (data->results_spool);
   free (data->scan_end);
   free (data->scan_start);
   free (data->task_id);
@@ -4018,18 +4008,11 @@ static run_wizard_data_t *run_wizard_data
  = (run_wizard_data_t*) &(command_data.wizard);
 
 /**
- * @brief Buffer of output to the client.
- */
-char to_client[TO_CLIENT_BUFFER_SIZE];
-
-/**
- * @brief The start of the data in the \ref to_client buffer.
- */
-buffer_size_t to_client_start = 0;
-/**
- * @brief The end of the data in the \ref to_client buffer.
+ * @brief Whether the client asked for response compression in GET_VERSION.
+ *
+ * Acted on by the daemon layer, which owns the client connection.
  */
-buffer_size_t to_client_end = 0;
+int gmp_request_compression = 0;
 
 /**
  * @brief Client input parsing context.
@@ -4368,6 +4351,7 @@ typedef enum
   CLIENT_GET_NVTS,
   CLIENT_GET_NVT_FAMILIES,
   CLIENT_GET_OVERRIDES,
+  CLIENT_GET_PERFORMANCE_COUNTERS,
   CLIENT_GET_PERMISSIONS,
   CLIENT_GET_PORT_LISTS,
   CLIENT_GET_PREFERENCES,
@@ -4581,6 +4565,65 @@ typedef enum
  */
 static client_state_t client_state = CLIENT_TOP;
 
+/**
+ * @brief Name of the command being timed for the performance counters.
+ *
+ * NULL when no command is in flight.
+ */
+static gchar *perf_command = NULL;
+
+/**
+ * @brief Monotonic time the command being timed started, in microseconds.
+ */
+static gint64 perf_command_start_time = 0;
+
+/**
+ * @brief Value of \ref sql_rows_stepped when the timed command started.
+ */
+static unsigned long long int perf_command_rows = 0;
+
+/**
+ * @brief Value of \ref sql_statements_sent when the timed command started.
+ */
+static unsigned long long int perf_command_queries = 0;
+
+/**
+ * @brief Value of \ref gmpd_client_bytes_sent when the timed command started.
+ */
+static unsigned long long int perf_command_bytes = 0;
+
+/**
+ * @brief Start timing a command for the performance counters.
+ *
+ * @param[in]  element_name  Name of the command element.
+ */
+static void
+perf_command_begin (const gchar *element_name)
+{
+  perf_command = g_ascii_strup (element_name, -1);
+  perf_command_start_time = g_get_monotonic_time ();
+  perf_command_rows = sql_rows_stepped;
+  perf_command_queries = sql_statements_sent;
+  perf_command_bytes = gmpd_client_bytes_sent ();
+  sql_set_statement_context (perf_command);
+}
+
+/**
+ * @brief Finish timing a command and add it to the performance counters.
+ */
+static void
+perf_command_end ()
+{
+  perf_counters_add (perf_command,
+                     g_get_monotonic_time () - perf_command_start_time,
+                     sql_rows_stepped - perf_command_rows,
+                     sql_statements_sent - perf_command_queries,
+                     gmpd_client_bytes_sent () - perf_command_bytes);
+  sql_set_statement_context (NULL);
+  g_free (perf_command);
+  perf_command = NULL;
+}
+
 /**
  * @brief Set the client state.
  *
@@ -4591,6 +4634,11 @@ set_client_state (client_state_t state)
 {
   client_state = state;
   g_debug ("   client state set: %i", client_state);
+
+  /* Commands always end by returning to one of the resting states, so this
+   * is the single place where a command completes. */
+  if ((state == CLIENT_AUTHENTIC || state == CLIENT_TOP) && perf_command)
+    perf_command_end ();
 }
 
 
@@ -4704,13 +4752,40 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
 
   g_debug ("   XML  start: %s (%i)", element_name, client_state);
 
+  if (gmp_parser->read_over == 0
+      && (client_state == CLIENT_TOP || client_state == CLIENT_AUTHENTIC)
+      && perf_command == NULL)
+    /* An element in a resting state opens a command. */
+    perf_command_begin (element_name);
+
+  if (gmp_parser->read_over == 0
+      && (client_state == CLIENT_TOP || client_state == CLIENT_AUTHENTIC))
+    {
+      /* Only the reads of the read only GET commands may go to a DB read
+       * replica, everything else has to see the primary. */
+      sql_replica_mode (g_ascii_strncasecmp (element_name, "GET_", 4) == 0);
+
+      /* Likewise only the GET commands may serve UUID lookups from the
+       * cache, a command that may change the database empties it. */
+      find_resource_cache_mode (g_ascii_strncasecmp (element_name, "GET_", 4)
+                                == 0);
+    }
+
   if (gmp_parser->read_over)
     gmp_parser->read_over++;
   else switch (client_state)
     {
       case CLIENT_TOP:
         if (strcasecmp ("GET_VERSION", element_name) == 0)
-          set_client_state (CLIENT_GET_VERSION);
+          {
+            const gchar* attribute;
+
+            if (find_attribute (attribute_names, attribute_values,
+                                "compression", &attribute)
+                && (strcasecmp (attribute, "zstd") == 0))
+              gmp_request_compression = 1;
+            set_client_state (CLIENT_GET_VERSION);
+          }
         else if (strcasecmp ("AUTHENTICATE", element_name) == 0)
           set_client_state (CLIENT_AUTHENTICATE);
         else
@@ -5458,6 +5533,8 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
               get_port_lists_data->targets = 0;
             set_client_state (CLIENT_GET_PORT_LISTS);
           }
+        else if (strcasecmp ("GET_PERFORMANCE_COUNTERS", element_name) == 0)
+          set_client_state (CLIENT_GET_PERFORMANCE_COUNTERS);
         else if (strcasecmp ("GET_PERMISSIONS", element_name) == 0)
           {
             get_data_parse_attributes (&get_permissions_data->get, "permission",
@@ -5800,7 +5877,15 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
             set_client_state (CLIENT_GET_INFO);
           }
         else if (strcasecmp ("GET_VERSION", element_name) == 0)
-          set_client_state (CLIENT_GET_VERSION_AUTHENTIC);
+          {
+            const gchar* attribute;
+
+            if (find_attribute (attribute_names, attribute_values,
+                                "compression", &attribute)
+                && (strcasecmp (attribute, "zstd") == 0))
+              gmp_request_compression = 1;
+            set_client_state (CLIENT_GET_VERSION_AUTHENTIC);
+          }
         else if (strcasecmp ("GET_VULNS", element_name) == 0)
           {
             get_data_parse_attributes (&get_vulns_data->get, "vuln",
@@ -7187,7 +7272,12 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
                 create_report_data->details = make_array ();
                 create_report_data->host_ends = make_array ();
                 create_report_data->host_starts = make_array ();
-                create_report_data->results = make_array ();
+                create_report_data->results_spool = tmpfile ();
+                if (create_report_data->results_spool == NULL)
+                  {
+                    g_warning ("%s: tmpfile: %s", __func__, strerror (errno));
+                    create_report_data->results_error = 1;
+                  }
                 create_report_data->result_detection = make_array ();
                 set_client_state (CLIENT_CREATE_REPORT_RR);
               }
@@ -7206,7 +7296,12 @@ gmp_xml_handle_start_element (/* unused */ GMarkupParseContext* context,
             create_report_data->details = make_array ();
             create_report_data->host_ends = make_array ();
             create_report_data->host_starts = make_array ();
-            create_report_data->results = make_array ();
+            create_report_data->results_spool = tmpfile ();
+            if (create_report_data->results_spool == NULL)
+              {
+                g_warning ("%s: tmpfile: %s", __func__, strerror (errno));
+                create_report_data->results_error = 1;
+              }
             create_report_data->result_detection = make_array ();
             set_client_state (CLIENT_CREATE_REPORT_RR);
           }
@@ -8940,9 +9035,6 @@ buffer_result_notes_xml (GString *buffer, result_t result, task_t task,
       /* Most recent first. */
       get.filter = "sort-reverse=created owner=any permission=any";
 
-      if (note_count (&get, 0, result, task) == 0)
-        return;
-
       init_note_iterator (&notes,
                           &get,
                           0,
@@ -8956,7 +9048,7 @@ buffer_result_notes_xml (GString *buffer, result_t result, task_t task,
                         0,
                         NULL);
 
-      if (lean == 0 || strlen (temp_buffer->str))
+      if (strlen (temp_buffer->str))
         {
           g_string_append (buffer, "<notes>");
           g_string_append (buffer, temp_buffer->str);
@@ -8991,9 +9083,6 @@ buffer_result_overrides_xml (GString *buffer, result_t result, task_t task,
       /* Most recent first. */
       get.filter = "sort-reverse=created owner=any permission=any";
 
-      if (override_count (&get, 0, result, task) == 0)
-        return;
-
       init_override_iterator (&overrides,
                               &get,
                               0,
@@ -9006,7 +9095,7 @@ buffer_result_overrides_xml (GString *buffer, result_t result, task_t task,
                             include_overrides_details,
                             0,
                             NULL);
-      if (lean == 0 || strlen (temp_buffer->str))
+      if (strlen (temp_buffer->str))
         {
           g_string_append (buffer, "<overrides>");
           g_string_append (buffer, temp_buffer->str);
@@ -9570,7 +9659,8 @@ buffer_results_xml (GString *buffer, iterator_t *results, task_t task,
       free (result_task_name);
     }
 
-  if (include_tags)
+  if (include_tags
+      && (use_delta_fields || result_iterator_may_have_tags (results)))
     {
       if (resource_tag_exists ("result", result, 1))
         {
@@ -9704,9 +9794,10 @@ buffer_results_xml (GString *buffer, iterator_t *results, task_t task,
 
   buffer_xml_append_printf (buffer, "</qod>");
 
-  g_string_append_printf (buffer,
-                          "<description>%s</description>",
-                          descr ? nl_descr_escaped : "");
+  g_string_append (buffer, "<description>");
+  if (descr)
+    g_string_append (buffer, nl_descr_escaped);
+  g_string_append (buffer, "</description>");
 
   if (include_overrides && lean)
     {
@@ -11051,6 +11142,66 @@ buffer_aggregate_xml (GString *xml, iterator_t* aggregate, const gchar* type,
     set_client_state (CLIENT_AUTHENTIC);                                    \
     break
 
+/**
+ * @brief Lifetime in seconds of a cached aggregate response.
+ *
+ * Dashboards re-request identical aggregates on every refresh, so repeat
+ * requests within the lifetime are served from the cache.  A response can
+ * be stale by up to this many seconds.
+ */
+#define AGGREGATE_CACHE_LIFETIME 30
+
+/**
+ * @brief Describe a GET_AGGREGATES request for the aggregate cache.
+ *
+ * The description covers the user and every request parameter, so equal
+ * descriptions produce equal responses while the underlying data is
+ * unchanged.
+ *
+ * @return Newly allocated description.
+ */
+static gchar *
+get_aggregates_cache_key ()
+{
+  GString *key;
+  GList *point;
+
+  key = g_string_new ("aggregate");
+  g_string_append_printf (key,
+                          "\1%s\1%s\1%i\1%i\1%s\1%s\1%s\1%s\1%s\1%s\1%i\1%i",
+                          current_credentials.uuid,
+                          get_aggregates_data->type,
+                          get_aggregates_data->get.trash,
+                          get_aggregates_data->get.ignore_pagination,
+                          get_aggregates_data->get.filt_id
+                           ? get_aggregates_data->get.filt_id : "",
+                          get_aggregates_data->get.filter
+                           ? get_aggregates_data->get.filter : "",
+                          get_aggregates_data->get.filter_replacement
+                           ? get_aggregates_data->get.filter_replacement : "",
+                          get_aggregates_data->group_column
+                           ? get_aggregates_data->group_column : "",
+                          get_aggregates_data->subgroup_column
+                           ? get_aggregates_data->subgroup_column : "",
+                          get_aggregates_data->mode
+                           ? get_aggregates_data->mode : "",
+                          get_aggregates_data->first_group,
+                          get_aggregates_data->max_groups);
+  for (point = get_aggregates_data->data_columns; point; point = point->next)
+    g_string_append_printf (key, "\2%s", (gchar*) point->data);
+  for (point = get_aggregates_data->text_columns; point; point = point->next)
+    g_string_append_printf (key, "\3%s", (gchar*) point->data);
+  for (point = get_aggregates_data->sort_data; point; point = point->next)
+    {
+      sort_data_t *sort = point->data;
+      g_string_append_printf (key, "\4%s\5%s\6%i",
+                              sort->field ? sort->field : "",
+                              sort->stat ? sort->stat : "",
+                              sort->order);
+    }
+  return g_string_free (key, FALSE);
+}
+
 /**
  * @brief Handle end of GET_AGGREGATES element.
  *
@@ -11071,7 +11222,7 @@ handle_get_aggregates (gmp_parser_t *gmp_parser, GError **error)
   char *group_column_type, *subgroup_column_type;
   int ret, index;
   GString *xml;
-  gchar *sort_field, *filter;
+  gchar *sort_field, *filter, *cache_key, *cached;
   int first, sort_order;
   GString *type_many;
 
@@ -11108,6 +11259,18 @@ handle_get_aggregates (gmp_parser_t *gmp_parser, GError **error)
       return;
     }
 
+  cache_key = get_aggregates_cache_key ();
+  cached = aggregate_cache_check (cache_key);
+  if (cached)
+    {
+      g_free (cache_key);
+      SEND_TO_CLIENT_OR_FAIL (cached);
+      g_free (cached);
+      get_aggregates_data_reset (get_aggregates_data);
+      set_client_state (CLIENT_AUTHENTIC);
+      return;
+    }
+
   group_column = get_aggregates_data->group_column;
   subgroup_column = get_aggregates_data->subgroup_column;
 
@@ -11216,6 +11379,7 @@ handle_get_aggregates (gmp_parser_t *gmp_parser, GError **error)
         sort_data_free (g_array_index (sort_data, sort_data_t*, index));
       g_array_free (sort_data, TRUE);
       g_array_free (c_sums, TRUE);
+      g_free (cache_key);
       return;
     }
 
@@ -11298,6 +11462,9 @@ handle_get_aggregates (gmp_parser_t *gmp_parser, GError **error)
   g_array_free (sort_data, TRUE);
   g_array_free (c_sums, TRUE);
 
+  aggregate_cache_add (cache_key, xml->str, AGGREGATE_CACHE_LIFETIME);
+  g_free (cache_key);
+
   SEND_TO_CLIENT_OR_FAIL (xml->str);
 
   cleanup_iterator (&aggregate);
@@ -11619,8 +11786,22 @@ handle_get_alerts (gmp_parser_t *gmp_parser, GError **error)
           SEND_TO_CLIENT_OR_FAIL ("</tasks>");
         }
 
-      SENDF_TO_CLIENT_OR_FAIL ("<active>%i</active>"
+      SENDF_TO_CLIENT_OR_FAIL ("<deliveries>"
+                               "<queued>%i</queued>"
+                               "<running>%i</running>"
+                               "<failed>%i</failed>"
+                               "</deliveries>"
+                               "<active>%i</active>"
                                "</alert>",
+                               alert_delivery_count
+                                (get_iterator_resource (&alerts),
+                                 ALERT_DELIVERY_QUEUED),
+                               alert_delivery_count
+                                (get_iterator_resource (&alerts),
+                                 ALERT_DELIVERY_RUNNING),
+                               alert_delivery_count
+                                (get_iterator_resource (&alerts),
+                                 ALERT_DELIVERY_FAILED),
                                alert_iterator_active (&alerts));
       count++;
     }
@@ -12545,12 +12726,18 @@ feed_type_name (int feed_type)
  * @brief Gets the status and timestamp of a feed lockfile.
  *
  * @param[in]  lockfile_name  Path to the lockfile.
+ * @param[in]  shared         Whether to probe with a shared lock.  A shared
+ *                            probe only detects holders of an exclusive
+ *                            lock, like external sync scripts on the main
+ *                            feed lock file, not the shared locks that
+ *                            per-feed syncs hold on it.
  * @param[out] timestamp      Optional output o timestamp string.
  *
  * @return 0 lockfile was not locked, 1 lockfile was locked.
  */
 static int
-get_feed_lock_status (const char *lockfile_name, gchar **timestamp)
+get_feed_lock_status (const char *lockfile_name, int shared,
+                      gchar **timestamp)
 {
   mode_t old_umask;
   int lockfile;
@@ -12574,7 +12761,8 @@ get_feed_lock_status (const char *lockfile_name, gchar **timestamp)
   else
     {
       umask (old_umask);
-      if (flock (lockfile, LOCK_EX | LOCK_NB))  /* Exclusive, Non blocking. */
+      if (flock (lockfile, (shared ? LOCK_SH : LOCK_EX) | LOCK_NB))
+        /* Non blocking. */
         {
           if (errno == EWOULDBLOCK)
             {
@@ -12904,7 +13092,7 @@ static void
 get_feed (gmp_parser_t *gmp_parser, GError **error, int feed_type)
 {
   gchar *feed_name, *feed_description, *feed_version;
-  const char *lockfile_name;
+  gchar *type_lockfile_name;
   gchar *timestamp;
 
   if (feed_type == NVT_FEED)
@@ -12927,9 +13115,13 @@ get_feed (gmp_parser_t *gmp_parser, GError **error, int feed_type)
     feed_version,
     feed_description);
 
-  lockfile_name = get_feed_lock_path ();
+  /* A sync of this feed type holds the type's own lock file, while an
+   * external sync script holds the main feed lock file exclusively. */
+
+  type_lockfile_name = feed_type_lock_path (feed_type);
 
-  if (get_feed_lock_status (lockfile_name, &timestamp))
+  if (get_feed_lock_status (type_lockfile_name, 0, &timestamp)
+      || get_feed_lock_status (get_feed_lock_path (), 1, &timestamp))
     {
       SENDF_TO_CLIENT_OR_FAIL ("<currently_syncing>"
                                "<timestamp>%s</timestamp>"
@@ -12937,6 +13129,7 @@ get_feed (gmp_parser_t *gmp_parser, GError **error, int feed_type)
                                timestamp);
       g_free (timestamp);
     }
+  g_free (type_lockfile_name);
 
   g_free (feed_name);
   g_free (feed_version);
@@ -13658,7 +13851,7 @@ handle_get_info (gmp_parser_t *gmp_parser, GError **error)
       SENDF_TO_CLIENT_OR_FAIL ("<update_time>%s</update_time>",
                                update_time);
 
-      result = g_string_new ("");
+      result = buffer_acquire ();
 
       /* Information depending on type */
 
@@ -13890,7 +14083,7 @@ handle_get_info (gmp_parser_t *gmp_parser, GError **error)
       g_string_append_printf (result, "</%s></info>", get_info_data->type);
       SEND_TO_CLIENT_OR_FAIL (result->str);
       count++;
-      g_string_free (result, TRUE);
+      buffer_release (result);
     }
 
   cleanup_iterator (&info);
@@ -14003,7 +14196,7 @@ handle_get_notes (gmp_parser_t *gmp_parser, GError **error)
 
       SEND_GET_START ("note");
 
-      buffer = g_string_new ("");
+      buffer = buffer_acquire ();
 
       while (1)
         {
@@ -14022,7 +14215,7 @@ handle_get_notes (gmp_parser_t *gmp_parser, GError **error)
         }
 
       SEND_TO_CLIENT_OR_FAIL (buffer->str);
-      g_string_free (buffer, TRUE);
+      buffer_release (buffer);
 
       cleanup_iterator (&notes);
       filtered = get_notes_data->get.id
@@ -14410,7 +14603,7 @@ handle_get_overrides (gmp_parser_t *gmp_parser, GError **error)
 
       SEND_GET_START ("override");
 
-      buffer = g_string_new ("");
+      buffer = buffer_acquire ();
 
       while (1)
         {
@@ -14430,7 +14623,7 @@ handle_get_overrides (gmp_parser_t *gmp_parser, GError **error)
         }
 
       SEND_TO_CLIENT_OR_FAIL (buffer->str);
-      g_string_free (buffer, TRUE);
+      buffer_release (buffer);
 
       cleanup_iterator (&overrides);
       filtered = get_overrides_data->get.id
@@ -14444,6 +14637,67 @@ handle_get_overrides (gmp_parser_t *gmp_parser, GError **error)
   set_client_state (CLIENT_AUTHENTIC);
 }
 
+/**
+ * @brief Handle end of GET_PERFORMANCE_COUNTERS element.
+ *
+ * @param[in]  gmp_parser   GMP parser.
+ * @param[in]  error        Error parameter.
+ */
+static void
+handle_get_performance_counters (gmp_parser_t *gmp_parser, GError **error)
+{
+  int index, ret;
+
+  if (acl_user_may ("get_performance_counters") == 0)
+    {
+      SEND_TO_CLIENT_OR_FAIL
+       (XML_ERROR_SYNTAX ("get_performance_counters",
+                          "Permission denied"));
+      set_client_state (CLIENT_AUTHENTIC);
+      return;
+    }
+
+  SEND_TO_CLIENT_OR_FAIL ("<get_performance_counters_response"
+                          " status=\"" STATUS_OK "\""
+                          " status_text=\"" STATUS_OK_TEXT "\">");
+  for (index = 0; ; index++)
+    {
+      const char *command;
+      unsigned long long int count, wall_us, wall_us_max, rows, queries;
+      unsigned long long int bytes_out, deadlocks;
+
+      ret = perf_counters_get (index, &command, &count, &wall_us,
+                               &wall_us_max, &rows, &queries, &bytes_out,
+                               &deadlocks);
+      if (ret == -1)
+        break;
+      if (ret)
+        continue;
+      SENDF_TO_CLIENT_OR_FAIL
+       ("<counter>"
+        "<command>%s</command>"
+        "<count>%llu</count>"
+        "<wall_microseconds>%llu</wall_microseconds>"
+        "<wall_microseconds_max>%llu</wall_microseconds_max>"
+        "<rows>%llu</rows>"
+        "<sql_statements>%llu</sql_statements>"
+        "<bytes_sent>%llu</bytes_sent>"
+        "<deadlocks>%llu</deadlocks>"
+        "</counter>",
+        command,
+        count,
+        wall_us,
+        wall_us_max,
+        rows,
+        queries,
+        bytes_out,
+        deadlocks);
+    }
+  SEND_TO_CLIENT_OR_FAIL ("</get_performance_counters_response>");
+
+  set_client_state (CLIENT_AUTHENTIC);
+}
+
 /**
  * @brief Handle end of GET_PERMISSIONS element.
  *
@@ -16398,9 +16652,9 @@ handle_get_resource_names (gmp_parser_t *gmp_parser, GError **error)
   while (next (&resource))
     {
       GString *result;
-      result = g_string_new ("");
-      
-      if(g_strcmp0 ("tls_certificate", get_resource_names_data->type) == 0) 
+      result = buffer_acquire ();
+
+      if(g_strcmp0 ("tls_certificate", get_resource_names_data->type) == 0)
         {
             buffer_xml_append_printf (result,
                                       "<resource id=\"%s\">"
@@ -16440,7 +16694,7 @@ handle_get_resource_names (gmp_parser_t *gmp_parser, GError **error)
 
       g_string_append_printf (result, "</resource>");
       SEND_TO_CLIENT_OR_FAIL (result->str);
-      g_string_free (result, TRUE);
+      buffer_release (result);
     }
 
   SEND_TO_CLIENT_OR_FAIL ("</get_resource_names_response>");
@@ -18369,6 +18623,12 @@ handle_get_tasks (gmp_parser_t *gmp_parser, GError **error)
   SENDF_TO_CLIENT_OR_FAIL ("<apply_overrides>%i</apply_overrides>",
                            apply_overrides);
 
+  if ((get_tasks_data->get.trash == 0)
+      && (get_tasks_data->schedules_only == 0))
+    /* Load the cached counts of every task's noteworthy reports in one
+     * query, for the report_counts calls below. */
+    report_counts_prefetch (apply_overrides, min_qod);
+
   while (1)
     {
       task_t index;
@@ -19141,6 +19401,7 @@ handle_get_version (gmp_parser_t *gmp_parser, GError **error)
                           " status=\"" STATUS_OK "\""
                           " status_text=\"" STATUS_OK_TEXT "\">"
                           "<version>" GMP_VERSION "</version>"
+                          GMP_COMPRESSION_CAPABILITY
                           "</get_version_response>");
   if (client_state == CLIENT_GET_VERSION_AUTHENTIC)
     set_client_state (CLIENT_AUTHENTIC);
@@ -19579,16 +19840,14 @@ extern char client_address[];
  * create_report_data->result_detection_location
  * create_report_data->result_detection
  *
- * to create a create_report_data->result and add it into
- * create_report_data->results
+ * to spool a result into create_report_data->results_spool and free the
+ * collected fields, so that memory use stays constant however large the
+ * uploaded report is.
  *
  */
 static void
 gmp_xml_handle_result ()
 {
-  create_report_result_t *result;
-
-  assert (create_report_data->results);
 
   if (create_report_data->result_scan_nvt_version == NULL)
     create_report_data->result_scan_nvt_version = strdup ("");
@@ -19626,8 +19885,6 @@ gmp_xml_handle_result ()
         }
     }
 
-  result = g_malloc (sizeof (create_report_result_t));
-  result->description = create_report_data->result_description;
   // sometimes host has newlines in it, so we 0 terminate first newline
   // According to
   // https://www.freebsd.org/cgi/man.cgi?query=strcspn&sektion=3
@@ -19636,16 +19893,7 @@ gmp_xml_handle_result ()
   if (create_report_data->result_host)
     create_report_data
       ->result_host[strcspn (create_report_data->result_host, "\n")] = 0;
-  result->host = create_report_data->result_host;
-  result->hostname = create_report_data->result_hostname;
-  result->nvt_oid = create_report_data->result_nvt_oid;
-  result->scan_nvt_version = create_report_data->result_scan_nvt_version;
-  result->port = create_report_data->result_port;
-  result->qod = create_report_data->result_qod;
-  result->qod_type = create_report_data->result_qod_type;
-  result->severity = create_report_data->result_severity;
-  result->threat = create_report_data->result_threat;
-  if (result->host)
+  if (create_report_data->result_host)
     {
       for (unsigned int i = 0; i < create_report_data->result_detection->len;
            i++)
@@ -19661,10 +19909,10 @@ gmp_xml_handle_result ()
           // - oid as source_name
           // - detected_at as name
           detail = g_malloc (sizeof (host_detail_t));
-          detail->ip = g_strdup (result->host);
+          detail->ip = g_strdup (create_report_data->result_host);
           detail->name = g_strdup ("detected_at");
           detail->source_desc = g_strdup ("create_report_import");
-          detail->source_name = g_strdup (result->nvt_oid);
+          detail->source_name = g_strdup (create_report_data->result_nvt_oid);
           detail->source_type = g_strdup ("create_report_import");
           detail->value = g_strdup (detection->location);
           array_add (create_report_data->details, detail);
@@ -19672,10 +19920,10 @@ gmp_xml_handle_result ()
           // - oid as source_name
           // - detected_by as name
           detail = g_malloc (sizeof (host_detail_t));
-          detail->ip = g_strdup (result->host);
+          detail->ip = g_strdup (create_report_data->result_host);
           detail->name = g_strconcat ("detected_by@", detection->location, NULL);
           detail->source_desc = g_strdup ("create_report_import");
-          detail->source_name = g_strdup (result->nvt_oid);
+          detail->source_name = g_strdup (create_report_data->result_nvt_oid);
           detail->source_type = g_strdup ("create_report_import");
           detail->value = g_strdup (detection->source_oid);
           array_add (create_report_data->details, detail);
@@ -19686,7 +19934,36 @@ gmp_xml_handle_result ()
           g_free (detection);
         }
     }
-  array_add (create_report_data->results, result);
+
+  if (create_report_data->results_spool
+      && create_report_spool_result (create_report_data->results_spool,
+                                     create_report_data->result_host,
+                                     create_report_data->result_hostname,
+                                     create_report_data->result_port,
+                                     create_report_data->result_nvt_oid,
+                                     create_report_data->result_threat,
+                                     create_report_data->result_description,
+                                     create_report_data
+                                      ->result_scan_nvt_version,
+                                     create_report_data->result_severity,
+                                     create_report_data->result_qod,
+                                     create_report_data->result_qod_type))
+    {
+      g_warning ("%s: failed to spool result", __func__);
+      create_report_data->results_error = 1;
+    }
+  create_report_data->results_count++;
+
+  free (create_report_data->result_description);
+  free (create_report_data->result_host);
+  free (create_report_data->result_hostname);
+  free (create_report_data->result_nvt_oid);
+  free (create_report_data->result_port);
+  free (create_report_data->result_qod);
+  free (create_report_data->result_qod_type);
+  free (create_report_data->result_scan_nvt_version);
+  free (create_report_data->result_severity);
+  free (create_report_data->result_threat);
 
   create_report_data->result_description = NULL;
   create_report_data->result_host = NULL;
@@ -20417,6 +20694,10 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
         handle_get_overrides (gmp_parser, error);
         break;
 
+      case CLIENT_GET_PERFORMANCE_COUNTERS:
+        handle_get_performance_counters (gmp_parser, error);
+        break;
+
       case CLIENT_GET_PERMISSIONS:
         handle_get_permissions (gmp_parser, error);
         break;
@@ -22309,12 +22590,14 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
         {
           char *uuid;
 
-          array_terminate (create_report_data->results);
           array_terminate (create_report_data->host_ends);
           array_terminate (create_report_data->host_starts);
           array_terminate (create_report_data->details);
 
-          if (create_report_data->results == NULL)
+          if (create_report_data->results_error)
+            SEND_TO_CLIENT_OR_FAIL
+             (XML_INTERNAL_ERROR ("create_report"));
+          else if (create_report_data->results_spool == NULL)
             SEND_TO_CLIENT_OR_FAIL
              (XML_ERROR_SYNTAX ("create_report",
                                 "A REPORT element is required"));
@@ -22324,7 +22607,8 @@ gmp_xml_handle_end_element (/* unused */ GMarkupParseContext* context,
              (XML_ERROR_SYNTAX ("create_report",
                                 "Type must be 'scan'"));
           else switch (create_report
-                        (create_report_data->results,
+                        (create_report_data->results_spool,
+                         create_report_data->results_count,
                          create_report_data->task_id,
                          create_report_data->in_assets,
                          create_report_data->scan_start,
@@ -33,7 +33,7 @@
 #include <sys/types.h>
 
 /**
- * @brief The size of the \ref to_client data buffer, in bytes.
+ * @brief Amount of queued client output at which to try flushing, in bytes.
  */
 #define TO_CLIENT_BUFFER_SIZE 26214400
 
@@ -47,6 +47,15 @@
  */
 #define TRUNCATE_TEXT_SUFFIX "[...]\n(text truncated)"
 
+/**
+ * @brief Compression capability announced in the GET_VERSION response.
+ */
+#ifdef HAS_LIBZSTD
+#define GMP_COMPRESSION_CAPABILITY "<compression>zstd</compression>"
+#else
+#define GMP_COMPRESSION_CAPABILITY ""
+#endif
+
 int
 init_gmp (GSList *, const db_conn_info_t *, int, int, int, int,
           manage_connection_forker_t, int);
@@ -58,9 +67,6 @@ init_gmp_process (const db_conn_info_t *, int (*) (const char *, void *),
 int
 process_gmp_client_input ();
 
-/** @todo As described in gmp.c, probably should be replaced by gmp_parser_t. */
-extern char to_client[];
-extern buffer_size_t to_client_start;
-extern buffer_size_t to_client_end;
+extern int gmp_request_compression;
 
 #endif /* not _GVMD_MANAGE_H */
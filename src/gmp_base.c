@@ -41,6 +41,11 @@
 /**
  * @brief Find an attribute in a parser callback list of attributes.
  *
+ * The returned value is borrowed from the parser and is only valid for
+ * the duration of the callback, so this is the accessor for read only
+ * uses like comparisons.  Handlers that keep the value beyond the
+ * callback must copy it, usually with \ref append_attribute.
+ *
  * @param[in]   attribute_names   List of names.
  * @param[in]   attribute_values  List of values.
  * @param[in]   attribute_name    Name of sought attribute.
@@ -112,6 +117,71 @@ buffer_xml_append_printf (GString *buffer, const char *format, ...)
   g_free (msg);
 }
 
+/* Response buffers. */
+
+/**
+ * @brief Maximum number of response buffers kept for reuse.
+ */
+#define BUFFER_POOL_MAX 4
+
+/**
+ * @brief Maximum allocation a buffer may have to be kept for reuse, in bytes.
+ *
+ * Buffers that grew beyond this are freed on release, so that one huge
+ * response does not pin the memory for the life of the session.
+ */
+#define BUFFER_POOL_KEEP_MAX 16777216
+
+/**
+ * @brief Pool of response buffers kept for reuse.
+ *
+ * Per session, because each GMP client session runs in its own process.
+ */
+static GString *buffer_pool[BUFFER_POOL_MAX];
+
+/**
+ * @brief Number of buffers in buffer_pool.
+ */
+static int buffer_pool_size = 0;
+
+/**
+ * @brief Get an empty response buffer, reusing a released one if possible.
+ *
+ * A reused buffer keeps the allocation of the largest response it has
+ * carried, so buffers that the GET handlers grow row by row reach their
+ * working size once per session instead of realloc'ing from scratch on
+ * every command.
+ *
+ * @return Buffer.  Release with \ref buffer_release.
+ */
+GString *
+buffer_acquire ()
+{
+  if (buffer_pool_size)
+    return buffer_pool[--buffer_pool_size];
+  return g_string_sized_new (1024);
+}
+
+/**
+ * @brief Release a response buffer, keeping it for reuse when possible.
+ *
+ * @param[in]  buffer  Buffer from \ref buffer_acquire.  May be NULL.
+ */
+void
+buffer_release (GString *buffer)
+{
+  if (buffer == NULL)
+    return;
+  if (buffer_pool_size < BUFFER_POOL_MAX
+      && buffer->allocated_len <= BUFFER_POOL_KEEP_MAX)
+    {
+      g_string_truncate (buffer, 0);
+      buffer_pool[buffer_pool_size++] = buffer;
+      return;
+    }
+  g_string_free (buffer, TRUE);
+}
+
 
 /* Communication. */
 
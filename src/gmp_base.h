@@ -43,6 +43,12 @@ append_attribute (const gchar **, const gchar **, const char *, gchar **);
 void
 buffer_xml_append_printf (GString *, const char *, ...);
 
+GString *
+buffer_acquire ();
+
+void
+buffer_release (GString *);
+
 gboolean
 send_to_client (const char *, int (*) (const char *, void *), void *);
 
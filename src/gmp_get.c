@@ -65,6 +65,11 @@ get_data_parse_attributes (get_data_t *data, const gchar *type,
   append_attribute (attribute_names, attribute_values, "filt_id",
                     &data->filt_id);
 
+  /* Keyset pagination.  The token for the next page is the id of the last
+   * resource on the current page. */
+  append_attribute (attribute_names, attribute_values, "continuation",
+                    &data->continuation);
+
   if (find_attribute (attribute_names, attribute_values,
                       "trash", &attribute))
     data->trash = strcmp (attribute, "0");
@@ -37,14 +37,20 @@
 #include <assert.h>
 #include <dirent.h>
 #include <errno.h>
+#include <stdint.h>
 #include <string.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#ifdef HAS_LIBZSTD
+#include <zstd.h>
+#endif
+
 #include <gvm/util/serverutils.h>
 
 #if FROM_BUFFER_SIZE > SSIZE_MAX
@@ -82,6 +88,154 @@ buffer_size_t from_client_end = 0;
  */
 static int close_connection = 0;
 
+/**
+ * @brief Queue of output chunks waiting to be written to the client.
+ */
+static GQueue to_client_queue = G_QUEUE_INIT;
+
+/**
+ * @brief Offset of the first unwritten byte in the head chunk of
+ *        \ref to_client_queue.
+ */
+static size_t to_client_offset = 0;
+
+/**
+ * @brief Total number of unwritten bytes in \ref to_client_queue.
+ */
+static size_t to_client_size = 0;
+
+/**
+ * @brief Maximum number of chunks to pass to writev in one call.
+ */
+#define TO_CLIENT_MAX_IOV 64
+
+/**
+ * @brief Total number of response bytes queued for the client.
+ *
+ * Counted before any compression, for the performance counters.
+ */
+static unsigned long long int client_bytes_queued = 0;
+
+/**
+ * @brief Get the total number of response bytes queued for the client.
+ *
+ * @return Number of bytes.
+ */
+unsigned long long int
+gmpd_client_bytes_sent ()
+{
+  return client_bytes_queued;
+}
+
+/**
+ * @brief Account for bytes written to the client, freeing written chunks.
+ *
+ * @param[in]  count  Number of bytes written from the head of the queue.
+ */
+static void
+to_client_written (size_t count)
+{
+  to_client_size -= count;
+  while (count)
+    {
+      GString *chunk;
+      size_t remaining;
+
+      chunk = g_queue_peek_head (&to_client_queue);
+      remaining = chunk->len - to_client_offset;
+      if (count < remaining)
+        {
+          to_client_offset += count;
+          return;
+        }
+      count -= remaining;
+      to_client_offset = 0;
+      g_string_free (g_queue_pop_head (&to_client_queue), TRUE);
+    }
+}
+
+/**
+ * @brief Free any remaining output chunks.
+ */
+static void
+to_client_clear ()
+{
+  while (g_queue_is_empty (&to_client_queue) == FALSE)
+    g_string_free (g_queue_pop_head (&to_client_queue), TRUE);
+  to_client_offset = 0;
+  to_client_size = 0;
+}
+
+#ifdef HAS_LIBZSTD
+/**
+ * @brief Compression stream for client output, when negotiated.
+ */
+static ZSTD_CStream *compress_stream = NULL;
+
+/**
+ * @brief Compress a message for the client.
+ *
+ * The stream is flushed after the message, so the client can decode each
+ * response as soon as it arrives.
+ *
+ * @param[in]  msg     The message.
+ * @param[in]  length  Length of msg in bytes.
+ *
+ * @return Freshly allocated compressed chunk, or NULL on error.
+ */
+static GString *
+compress_chunk (const char *msg, size_t length)
+{
+  GString *chunk;
+  ZSTD_inBuffer in;
+  size_t remaining;
+
+  in.src = msg;
+  in.size = length;
+  in.pos = 0;
+
+  chunk = g_string_sized_new (ZSTD_compressBound (length));
+  do
+    {
+      ZSTD_outBuffer out;
+      size_t previous_len;
+
+      previous_len = chunk->len;
+      g_string_set_size (chunk, previous_len + ZSTD_CStreamOutSize ());
+      out.dst = chunk->str + previous_len;
+      out.size = chunk->len - previous_len;
+      out.pos = 0;
+      remaining = ZSTD_compressStream2 (compress_stream, &out, &in,
+                                        ZSTD_e_flush);
+      if (ZSTD_isError (remaining))
+        {
+          g_warning ("%s: failed to compress for client: %s",
+                     __func__, ZSTD_getErrorName (remaining));
+          g_string_free (chunk, TRUE);
+          return NULL;
+        }
+      g_string_set_size (chunk, previous_len + out.pos);
+    }
+  while (remaining || (in.pos < in.size));
+
+  return chunk;
+}
+
+/**
+ * @brief Free the compression stream, if any.
+ */
+static void
+compress_stream_clear ()
+{
+  if (compress_stream)
+    {
+      ZSTD_freeCStream (compress_stream);
+      compress_stream = NULL;
+    }
+  gmp_request_compression = 0;
+}
+#endif /* HAS_LIBZSTD */
+
 /**
  * @brief Initialise the GMP library for the GMP daemon.
  *
@@ -121,6 +275,10 @@ init_gmpd_process (const db_conn_info_t *database, gchar **disable)
 {
   from_client_start = 0;
   from_client_end = 0;
+  to_client_clear ();
+#ifdef HAS_LIBZSTD
+  compress_stream_clear ();
+#endif
   init_gmp_process (database, NULL, NULL, disable);
 }
 
@@ -144,7 +302,7 @@ read_from_client_unix (int client_socket)
       if (count < 0)
         {
           if (errno == EAGAIN)
-            /* Got everything available, return to `select'. */
+            /* Got everything available, return to `epoll'. */
             return 0;
           if (errno == EINTR)
             /* Interrupted, try read again. */
@@ -194,7 +352,7 @@ read_from_client_tls (gnutls_session_t* client_session)
       if (count < 0)
         {
           if (count == GNUTLS_E_AGAIN)
-            /* Got everything available, return to `select'. */
+            /* Got everything available, return to `epoll'. */
             return 0;
           if (count == GNUTLS_E_INTERRUPTED)
             /* Interrupted, try read again. */
@@ -257,7 +415,7 @@ read_from_client (gvm_connection_t *client_connection)
 
 /** @todo Move to openvas-libraries? */
 /**
- * @brief Write as much as possible from \ref to_client to the client.
+ * @brief Write as much as possible from \ref to_client_queue to the client.
  *
  * @param[in]  client_session  The client session.
  *
@@ -266,12 +424,15 @@ read_from_client (gvm_connection_t *client_connection)
 static int
 write_to_client_tls (gnutls_session_t* client_session)
 {
-  while (to_client_start < to_client_end)
+  while (to_client_size)
     {
+      GString *chunk;
       ssize_t count;
+
+      chunk = g_queue_peek_head (&to_client_queue);
       count = gnutls_record_send (*client_session,
-                                  to_client + to_client_start,
-                                  to_client_end - to_client_start);
+                                  chunk->str + to_client_offset,
+                                  chunk->len - to_client_offset);
       if (count < 0)
         {
           if (count == GNUTLS_E_AGAIN)
@@ -288,18 +449,20 @@ write_to_client_tls (gnutls_session_t* client_session)
                      gnutls_strerror ((int) count));
           return -1;
         }
-      to_client_start += count;
+      to_client_written (count);
       g_debug ("=> client  %u bytes", (unsigned int) count);
     }
   g_debug ("=> client  done");
-  to_client_start = to_client_end = 0;
 
   /* Wrote everything. */
   return 0;
 }
 
 /**
- * @brief Write as much as possible from \ref to_client to the client.
+ * @brief Write as much as possible from \ref to_client_queue to the client.
+ *
+ * The queued chunks are passed to writev directly, so the output needs no
+ * gathering into an intermediate buffer.
  *
  * @param[in]  client_socket  The client socket.
  *
@@ -308,12 +471,30 @@ write_to_client_tls (gnutls_session_t* client_session)
 static int
 write_to_client_unix (int client_socket)
 {
-  while (to_client_start < to_client_end)
+  while (to_client_size)
     {
+      struct iovec iov[TO_CLIENT_MAX_IOV];
+      GList *link;
+      GString *chunk;
+      int iov_count;
       ssize_t count;
-      count = write (client_socket,
-                     to_client + to_client_start,
-                     to_client_end - to_client_start);
+
+      link = to_client_queue.head;
+      chunk = link->data;
+      iov[0].iov_base = chunk->str + to_client_offset;
+      iov[0].iov_len = chunk->len - to_client_offset;
+      iov_count = 1;
+      for (link = link->next;
+           link && (iov_count < TO_CLIENT_MAX_IOV);
+           link = link->next)
+        {
+          chunk = link->data;
+          iov[iov_count].iov_base = chunk->str;
+          iov[iov_count].iov_len = chunk->len;
+          iov_count++;
+        }
+
+      count = writev (client_socket, iov, iov_count);
       if (count < 0)
         {
           if (errno == EAGAIN)
@@ -327,11 +508,10 @@ write_to_client_unix (int client_socket)
                      strerror (errno));
           return -1;
         }
-      to_client_start += count;
+      to_client_written (count);
       g_debug ("=> client  %u bytes", (unsigned int) count);
     }
   g_debug ("=> client  done");
-  to_client_start = to_client_end = 0;
 
   /* Wrote everything. */
   return 0;
@@ -355,7 +535,7 @@ write_to_client (gvm_connection_t *client_connection)
 /**
  * @brief Send a response message to the client.
  *
- * Queue a message in \ref to_client.
+ * Queue a message in \ref to_client_queue.
  *
  * @param[in]  msg                   The message, a string.
  * @param[in]  write_to_client_data  Argument to \p write_to_client.
@@ -365,73 +545,59 @@ write_to_client (gvm_connection_t *client_connection)
 static gboolean
 gmpd_send_to_client (const char* msg, void* write_to_client_data)
 {
-  assert (to_client_end <= TO_CLIENT_BUFFER_SIZE);
+  size_t length;
+
   assert (msg);
 
-  while (((buffer_size_t) TO_CLIENT_BUFFER_SIZE) - to_client_end
-         < strlen (msg))
-    {
-      buffer_size_t length;
+  length = strlen (msg);
+  if (length == 0)
+    return FALSE;
 
-      /* Too little space in to_client buffer for message. */
+  client_bytes_queued += length;
 
-      switch (write_to_client (write_to_client_data))
+  if (to_client_size >= TO_CLIENT_BUFFER_SIZE)
+    {
+      /* Plenty queued already, so try to flush some of it to the client
+       * before queueing more.  The queue grows anyway if the client is
+       * slow to read, so the GMP layer never has to retry a message. */
+      if (write_to_client (write_to_client_data) == -1)
         {
-          case  0:      /* Wrote everything in to_client. */
-            break;
-          case -1:      /* Error. */
-            g_debug ("   %s full (%i < %zu); client write failed",
-                    __func__,
-                    ((buffer_size_t) TO_CLIENT_BUFFER_SIZE) - to_client_end,
-                    strlen (msg));
-            return TRUE;
-          case -2:      /* Wrote as much as client was willing to accept. */
-            break;
-          default:      /* Programming error. */
-            assert (0);
+          g_debug ("   %s: client write failed with %zu bytes queued",
+                   __func__, to_client_size);
+          return TRUE;
         }
+    }
 
-      length = ((buffer_size_t) TO_CLIENT_BUFFER_SIZE) - to_client_end;
+#ifdef HAS_LIBZSTD
+  if (gmp_request_compression && (compress_stream == NULL))
+    /* The client asked for compression in GET_VERSION.  The response to
+     * that command was queued before the flag was set, so it goes to the
+     * client uncompressed and everything queued from here on is
+     * compressed. */
+    compress_stream = ZSTD_createCStream ();
 
-      if (length > strlen (msg))
-        break;
+  if (compress_stream)
+    {
+      GString *chunk;
 
-      /* length can be 0 if write_to_client returns -2. */
+      chunk = compress_chunk (msg, length);
+      if (chunk == NULL)
+        return TRUE;
+      g_queue_push_tail (&to_client_queue, chunk);
+      to_client_size += chunk->len;
+      g_debug ("-> client: %s", msg);
 
-      if (length > 0)
-        {
-          memmove (to_client + to_client_end, msg, length);
-          g_debug ("-> client: %.*s", (int) length, msg);
-          to_client_end += length;
-          msg += length;
-        }
+      return FALSE;
     }
+#endif
 
-  if (strlen (msg))
-    {
-      assert (strlen (msg)
-              <= (((buffer_size_t) TO_CLIENT_BUFFER_SIZE) - to_client_end));
-      memmove (to_client + to_client_end, msg, strlen (msg));
-      g_debug ("-> client: %s", msg);
-      to_client_end += strlen (msg);
-    }
+  g_queue_push_tail (&to_client_queue, g_string_new_len (msg, length));
+  to_client_size += length;
+  g_debug ("-> client: %s", msg);
 
   return FALSE;
 }
 
-/**
- * @brief Get nfds value.
- *
- * @param[in]  socket  Highest socket number.
- *
- * @return nfds value for select.
- */
-static int
-get_nfds (int socket)
-{
-  return 1 + socket;
-}
-
 /**
  * @brief Serve the Greenbone Management Protocol (GMP).
  *
@@ -460,7 +626,9 @@ int
 serve_gmp (gvm_connection_t *client_connection, const db_conn_info_t *database,
            gchar **disable)
 {
-  int nfds, rc;
+  int epoll_fd, rc;
+  struct epoll_event event;
+  uint32_t ready;
 
   g_debug ("   Serving GMP");
 
@@ -476,7 +644,7 @@ serve_gmp (gvm_connection_t *client_connection, const db_conn_info_t *database,
   /** @todo Confirm and clarify complications, especially last one. */
   /* Loop handling input from the sockets.
    *
-   * That is, select on all the socket fds and then, as necessary
+   * That is, wait on the socket fd and then, as necessary
    *   - read from the client into buffer from_client
    *   - write to the client from buffer to_client.
    *
@@ -484,90 +652,116 @@ serve_gmp (gvm_connection_t *client_connection, const db_conn_info_t *database,
    * from the client call process_gmp_client_input, which parses GMP
    * commands and may write to to_client.
    *
+   * The readiness is edge triggered, so the kernel is only asked again
+   * after reading hit the end of the available input or writing filled the
+   * socket buffer.  The helpers already behave that way: read_from_client
+   * drains the socket into from_client and write_to_client writes as much
+   * as the client accepts.
+   *
    * There are a few complications here
-   *   - the program must read from or write to an fd returned by select
-   *     before selecting on the fd again,
-   *   - the program need only select on the fds for writing if there is
-   *     something to write,
-   *   - similarly, the program need only select on the fds for reading
-   *     if there is buffer space available,
-   *   - the buffer from_client can become full during reading
-   *   - a read from the client can be stalled by the to_client buffer
-   *     filling up (in which case process_gmp_client_input will try to
-   *     write the to_client buffer itself),
+   *   - the program need only write to the fd if there is something to
+   *     write,
+   *   - similarly, the program need only read from the fd if there is
+   *     buffer space available,
+   *   - the buffer from_client can become full during reading.
+   *
+   * Clients may pipeline commands: parsing continues through everything
+   * buffered in from_client while earlier responses are still draining,
+   * because the to_client queue grows as needed.  Responses leave the
+   * queue in the order the commands arrived, so a scripted batch pays
+   * for the server work, not a round trip per command.
    */
 
-  nfds = get_nfds (client_connection->socket);
-  while (1)
+  epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  if (epoll_fd == -1)
     {
-      int ret;
-      fd_set readfds, writefds;
-
-      /* Setup for select. */
+      g_warning ("%s: epoll_create1 failed: %s", __func__, strerror (errno));
+      rc = -1;
+      goto client_free;
+    }
+  memset (&event, 0, sizeof (event));
+  event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+  event.data.fd = client_connection->socket;
+  if (epoll_ctl (epoll_fd, EPOLL_CTL_ADD, client_connection->socket, &event))
+    {
+      g_warning ("%s: epoll_ctl failed: %s", __func__, strerror (errno));
+      rc = -1;
+      goto client_free;
+    }
 
-      /** @todo nfds must only include a socket if it's in >= one set. */
+  /* Assume readiness until the first EAGAIN, because edges from before the
+   * add are not guaranteed to be reported. */
+  ready = EPOLLIN | EPOLLOUT;
 
-      FD_ZERO (&readfds);
-      FD_ZERO (&writefds);
+  while (1)
+    {
+      int ret, want_read, want_write;
 
       /** @todo Shutdown on failure (for example, if a read fails). */
 
       /* See whether to read from the client.  */
-      if ((close_connection == 0)
-          && (from_client_end < from_buffer_size))
-        FD_SET (client_connection->socket, &readfds);
+      want_read = (close_connection == 0)
+                  && (from_client_end < from_buffer_size);
 
       /* See whether to write to the client.  */
-      if (to_client_start < to_client_end)
-        FD_SET (client_connection->socket, &writefds);
-      else if (close_connection)
+      want_write = (to_client_size > 0);
+      if (want_write == 0 && close_connection)
         goto client_free;
 
-      /* Select, then handle result.  Due to GNUTLS internal buffering
-       * we test for pending records first and emulate a select call
-       * in that case.  Note, that GNUTLS guarantees that writes are
-       * not buffered.  Note also that GNUTLS versions < 3 did not
-       * exhibit a problem in Scanner due to a different buffering
+      /* Due to GNUTLS internal buffering records can be pending although
+       * the socket shows no readiness.  Note, that GNUTLS guarantees that
+       * writes are not buffered.  Note also that GNUTLS versions < 3 did
+       * not exhibit a problem in Scanner due to a different buffering
        * strategy.  */
-      ret = 0;
       if (client_connection->socket > 0
           && client_connection->tls
-          && FD_ISSET (client_connection->socket, &readfds)
+          && want_read
           && gnutls_record_check_pending (client_connection->session))
-        {
-          FD_ZERO (&readfds);
-          FD_ZERO (&writefds);
-          ret++;
-          FD_SET (client_connection->socket, &readfds);
-        }
+        ready |= EPOLLIN;
 
-      if (!ret)
-        ret = select (nfds, &readfds, &writefds, NULL, NULL);
-      if ((ret < 0 && errno == EINTR) || ret == 0)
-        continue;
-      if (ret < 0)
+      /* Wait only when nothing that is wanted is already ready. */
+      if ((want_read && (ready & EPOLLIN)) == 0
+          && (want_write && (ready & EPOLLOUT)) == 0)
         {
-          g_warning ("%s: child select failed: %s", __func__,
-                     strerror (errno));
-          rc = -1;
-          goto client_free;
+          struct epoll_event triggered;
+
+          ret = epoll_wait (epoll_fd, &triggered, 1, -1);
+          if (ret < 0 && errno == EINTR)
+            continue;
+          if (ret < 0)
+            {
+              g_warning ("%s: child epoll_wait failed: %s", __func__,
+                         strerror (errno));
+              rc = -1;
+              goto client_free;
+            }
+          if (ret == 0)
+            continue;
+          ready |= triggered.events;
+          if (triggered.events & (EPOLLERR | EPOLLHUP))
+            /* Let the read and write handlers see the error. */
+            ready |= EPOLLIN | EPOLLOUT;
+          continue;
         }
 
       /* Read any data from the client. */
       if (client_connection->socket > 0
-          && FD_ISSET (client_connection->socket, &readfds))
+          && want_read
+          && (ready & EPOLLIN))
         {
           buffer_size_t initial_start = from_client_end;
 
           switch (read_from_client (client_connection))
             {
               case  0:       /* Read everything. */
+                /* The socket is drained, so wait for the next edge. */
+                ready &= ~EPOLLIN;
                 break;
               case -1:       /* Error. */
                 rc = -1;
                 goto client_free;
               case -2:       /* from_client buffer full. */
-                /* There may be more to read. */
+                /* There may be more to read, so keep the readiness. */
                 break;
               case -3:       /* End of file. */
                 g_debug ("   EOF reading from client");
@@ -613,9 +807,13 @@ serve_gmp (gvm_connection_t *client_connection, const db_conn_info_t *database,
             }
         }
 
-      /* Write any data to the client. */
+      /* Write any data to the client.  Check the queue size directly, so
+       * that responses queued while processing the input above start
+       * draining in the same pass, without waiting for another socket
+       * event. */
       if (client_connection->socket > 0
-          && FD_ISSET (client_connection->socket, &writefds))
+          && (to_client_size > 0)
+          && (ready & EPOLLOUT))
         {
           /* Write as much as possible to the client. */
 
@@ -629,6 +827,8 @@ serve_gmp (gvm_connection_t *client_connection, const db_conn_info_t *database,
                 rc = -1;
                 goto client_free;
               case -2:      /* Wrote as much as client was willing to accept. */
+                /* The socket buffer is full, so wait for the next edge. */
+                ready &= ~EPOLLOUT;
                 break;
               default:      /* Programming error. */
                 assert (0);
@@ -637,6 +837,12 @@ serve_gmp (gvm_connection_t *client_connection, const db_conn_info_t *database,
     } /* while (1) */
 
 client_free:
+  if (epoll_fd != -1)
+    close (epoll_fd);
+  to_client_clear ();
+#ifdef HAS_LIBZSTD
+  compress_stream_clear ();
+#endif
   gvm_connection_free (client_connection);
   return rc;
 }
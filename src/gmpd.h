@@ -54,4 +54,7 @@ init_gmpd_process (const db_conn_info_t *, gchar **);
 int
 serve_gmp (gvm_connection_t *, const db_conn_info_t *, gchar **);
 
+unsigned long long int
+gmpd_client_bytes_sent ();
+
 #endif /* not _GVMD_GMPD_H */
@@ -81,11 +81,13 @@
 #include <netinet/ip.h>
 #include <pwd.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
 #include <sys/un.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -108,6 +110,7 @@
 #include "manage_sql_secinfo.h"
 #include "manage_authentication.h"
 #include "gmpd.h"
+#include "sql.h"
 #include "utils.h"
 
 #ifdef GIT_REV_AVAILABLE
@@ -191,6 +194,11 @@
  */
 #define DEFAULT_BROKER_ADDRESS "localhost:1883"
 
+/**
+ * @brief Default maximum replication lag of the DB read replica in seconds.
+ */
+#define DEFAULT_DB_REPLICA_LAG_LIMIT 60
+
 /**
  * @brief Maximum number of frames in backtrace.
  *
@@ -235,10 +243,19 @@ static gnutls_session_t client_session;
  */
 static gnutls_certificate_credentials_t client_credentials;
 
+/**
+ * @brief Key for encrypting TLS session tickets.
+ *
+ * Generated once in the main process, so that every forked child encrypts
+ * tickets with the same key and a client can resume its session on any
+ * later connection, skipping the asymmetric crypto of a full handshake.
+ */
+static gnutls_datum_t session_ticket_key = { NULL, 0 };
+
 /**
  * @brief Database connection info.
  */
-static db_conn_info_t database = { NULL, NULL, NULL, NULL };
+static db_conn_info_t database = { NULL, NULL, NULL, NULL, NULL, NULL };
 
 /**
  * @brief Is this process parent or child?
@@ -289,6 +306,26 @@ static gchar *priorities_option = "NORMAL";
  */
 static gchar *dh_params_option = NULL;
 
+/**
+ * @brief Number of pre-forked GMP worker processes.  0 for a fork per client.
+ */
+static int worker_pool_size = 0;
+
+/**
+ * @brief PIDs of the pre-forked GMP workers, when worker_pool_size is set.
+ */
+static pid_t *worker_pool_pids = NULL;
+
+/**
+ * @brief Manager socket served by each pre-forked GMP worker.
+ */
+static int *worker_pool_sockets = NULL;
+
+/**
+ * @brief Total number of pre-forked GMP workers, across all sockets.
+ */
+static int worker_pool_count = 0;
+
 /**
  * @brief Whether an NVT update is in progress.
  */
@@ -299,6 +336,21 @@ static int update_in_progress = 0;
  */
 static int feed_version_check_in_progress = 0;
 
+/**
+ * @brief Whether a report retention purge is in progress.
+ */
+static int report_purge_in_progress = 0;
+
+/**
+ * @brief Whether an alert delivery queue run is in progress.
+ */
+static int alert_deliveries_in_progress = 0;
+
+/**
+ * @brief Whether a deferred startup check run is in progress.
+ */
+static int startup_checks_in_progress = 0;
+
 /**
  * @brief Logging parameters, as passed to setup_log_handlers.
  */
@@ -322,6 +374,26 @@ set_gnutls_priority (gnutls_session_t *session, const char *priority)
     g_warning ("Invalid GnuTLS priority: %s", errp);
 }
 
+/**
+ * @brief Enable session ticket resumption on a client session.
+ *
+ * Does nothing when generating the ticket key failed at startup.
+ *
+ * @param[in]   session     Session on which to enable tickets.
+ */
+static void
+enable_session_tickets (gnutls_session_t session)
+{
+  int ret;
+
+  if (session_ticket_key.data == NULL)
+    return;
+  ret = gnutls_session_ticket_enable_server (session, &session_ticket_key);
+  if (ret != GNUTLS_E_SUCCESS)
+    g_warning ("%s: failed to enable session tickets: %s",
+               __func__, gnutls_strerror (ret));
+}
+
 /**
  * @brief Lock gvm-helping for an option.
  *
@@ -495,7 +567,7 @@ serve_client (int server_socket, gvm_connection_t *client_connection)
     }
 
   /* The socket must have O_NONBLOCK set, in case an "asynchronous network
-   * error" removes the data between `select' and `read'. */
+   * error" removes the data between `epoll' and `read'. */
   if (fcntl (client_connection->socket, F_SETFL, O_NONBLOCK) == -1)
     {
       g_warning ("%s: failed to set real client socket flag: %s",
@@ -571,7 +643,7 @@ accept_and_maybe_fork (int server_socket, sigset_t *sigmask_current)
       if (errno == EINTR)
         continue;
       if (errno == EAGAIN || errno == EWOULDBLOCK)
-        /* The connection is gone, return to select. */
+        /* The connection is gone, return to epoll. */
         return;
       g_critical ("%s: failed to accept client connection: %s",
                   __func__,
@@ -603,7 +675,7 @@ accept_and_maybe_fork (int server_socket, sigset_t *sigmask_current)
 
           setproctitle ("Serving client");
 
-          /* Restore the sigmask that was blanked for pselect. */
+          /* Restore the sigmask that was blanked for epoll_pwait. */
           pthread_sigmask (SIG_SETMASK, sigmask_current, NULL);
 
           memset (&action, '\0', sizeof (action));
@@ -621,7 +693,7 @@ accept_and_maybe_fork (int server_socket, sigset_t *sigmask_current)
             }
 
           /* The socket must have O_NONBLOCK set, in case an "asynchronous
-           * network error" removes the data between `select' and `read'.
+           * network error" removes the data between `epoll' and `read'.
            */
           if (fcntl (client_socket, F_SETFL, O_NONBLOCK) == -1)
             {
@@ -645,19 +717,265 @@ accept_and_maybe_fork (int server_socket, sigset_t *sigmask_current)
           exit (ret);
         }
       case -1:
-        /* Parent when error, return to select. */
+        /* Parent when error, return to epoll. */
         g_warning ("%s: failed to fork child: %s",
                    __func__,
                    strerror (errno));
         close (client_socket);
         break;
       default:
-        /* Parent.  Return to select. */
+        /* Parent.  Return to epoll. */
         close (client_socket);
         break;
     }
 }
 
+
+/* Pre-forked worker pool. */
+
+/**
+ * @brief Serve clients from a pre-forked worker, until termination.
+ *
+ * Accept clients on the Manager socket in turn, serving each with
+ * \ref serve_client.  The database connection opened before the first
+ * client is kept for the lifetime of the worker, so connection setup
+ * cost is paid once per worker instead of once per client session.
+ *
+ * Never returns: exits the process on termination or error.
+ *
+ * @param[in]  server_socket    Manager socket.
+ * @param[in]  sigmask_current  Sigmask to restore after the fork.
+ */
+static void
+worker_pool_serve (int server_socket, sigset_t *sigmask_current)
+{
+  struct sigaction action;
+  struct epoll_event event;
+  int epoll_fd;
+
+  init_sentry ();
+  is_parent = 0;
+
+  setproctitle ("Worker: Waiting for client");
+
+  /* Restore the sigmask that was blanked for epoll_pwait. */
+  pthread_sigmask (SIG_SETMASK, sigmask_current, NULL);
+
+  /* As with accept_and_maybe_fork, use the default handlers for SIGCHLD
+   * because the worker calls 'system' and 'g_spawn_sync' in many places. */
+  memset (&action, '\0', sizeof (action));
+  sigemptyset (&action.sa_mask);
+  action.sa_handler = SIG_DFL;
+  if (sigaction (SIGCHLD, &action, NULL) == -1)
+    {
+      g_critical ("%s: failed to set worker SIGCHLD handler: %s",
+                  __func__,
+                  strerror (errno));
+      gvm_close_sentry ();
+      exit (EXIT_FAILURE);
+    }
+
+  /* Reopen the database (required after fork) and pay the connection setup
+   * cost now, before the first client arrives. */
+  cleanup_manage_process (FALSE);
+  init_gmpd_process (&database, disabled_commands);
+
+  /* The Manager socket is non-blocking and shared with the other workers,
+   * so wait for a connection before trying to accept.  Level triggered, so
+   * a connection that another worker wins is simply waited for again. */
+  epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  if (epoll_fd == -1)
+    {
+      g_critical ("%s: failed to create worker epoll: %s",
+                  __func__,
+                  strerror (errno));
+      gvm_close_sentry ();
+      exit (EXIT_FAILURE);
+    }
+  memset (&event, 0, sizeof (event));
+  event.events = EPOLLIN;
+  event.data.fd = server_socket;
+  if (epoll_ctl (epoll_fd, EPOLL_CTL_ADD, server_socket, &event))
+    {
+      g_critical ("%s: failed to watch Manager socket: %s",
+                  __func__,
+                  strerror (errno));
+      gvm_close_sentry ();
+      exit (EXIT_FAILURE);
+    }
+
+  while (termination_signal == 0)
+    {
+      int ret, client_socket;
+      struct sockaddr_storage addr;
+      socklen_t addrlen = sizeof (addr);
+      gvm_connection_t client_connection;
+
+      ret = epoll_wait (epoll_fd, &event, 1, -1);
+      if (ret == -1)
+        {
+          if (errno == EINTR)
+            continue;
+          g_critical ("%s: worker epoll failed: %s",
+                      __func__,
+                      strerror (errno));
+          gvm_close_sentry ();
+          exit (EXIT_FAILURE);
+        }
+
+      client_socket = accept (server_socket, (struct sockaddr *) &addr,
+                              &addrlen);
+      if (client_socket == -1)
+        {
+          if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+            /* Another worker got the connection, return to epoll. */
+            continue;
+          g_critical ("%s: failed to accept client connection: %s",
+                      __func__,
+                      strerror (errno));
+          gvm_close_sentry ();
+          exit (EXIT_FAILURE);
+        }
+      sockaddr_as_str (&addr, client_address);
+
+      /* The socket must have O_NONBLOCK set, in case an "asynchronous
+       * network error" removes the data between `epoll' and `read'. */
+      if (fcntl (client_socket, F_SETFL, O_NONBLOCK) == -1)
+        {
+          g_warning ("%s: failed to set client socket flag: %s",
+                     __func__,
+                     strerror (errno));
+          shutdown (client_socket, SHUT_RDWR);
+          close (client_socket);
+          continue;
+        }
+
+      /* For TLS, create a new session, because the previous client may have
+       * left the old one mid-handshake. */
+      if (use_tls)
+        {
+          if (gvm_server_new (GNUTLS_SERVER,
+                              CACERT,
+                              SCANNERCERT,
+                              SCANNERKEY,
+                              &client_session,
+                              &client_credentials))
+            {
+              g_critical ("%s: client server initialisation failed",
+                          __func__);
+              gvm_close_sentry ();
+              exit (EXIT_FAILURE);
+            }
+          set_gnutls_priority (&client_session, priorities_option);
+          if (dh_params_option
+              && set_gnutls_dhparams (client_credentials, dh_params_option))
+            g_warning ("Couldn't set DH parameters from %s",
+                       dh_params_option);
+          enable_session_tickets (client_session);
+        }
+
+      setproctitle ("Worker: Serving client");
+
+      memset (&client_connection, 0, sizeof (client_connection));
+      client_connection.tls = use_tls;
+      client_connection.socket = client_socket;
+      client_connection.session = client_session;
+      client_connection.credentials = client_credentials;
+      serve_client (server_socket, &client_connection);
+
+      setproctitle ("Worker: Waiting for client");
+    }
+
+  gvm_close_sentry ();
+  exit (EXIT_SUCCESS);
+}
+
+/**
+ * @brief Fork a single worker for the pre-forked pool.
+ *
+ * @param[in]  server_socket    Manager socket.
+ * @param[in]  sigmask_current  Sigmask to restore in the worker.
+ *
+ * @return PID of worker on success in parent, -1 on error.  Does not return
+ *         in the worker.
+ */
+static pid_t
+worker_pool_fork (int server_socket, sigset_t *sigmask_current)
+{
+  pid_t pid;
+
+  pid = fork_with_handlers ();
+  switch (pid)
+    {
+      case 0:
+        /* Worker. */
+        worker_pool_serve (server_socket, sigmask_current);
+        /* Never reached. */
+        exit (EXIT_FAILURE);
+      case -1:
+        g_warning ("%s: failed to fork worker: %s",
+                   __func__,
+                   strerror (errno));
+        return -1;
+      default:
+        return pid;
+    }
+}
+
+/**
+ * @brief Start the pre-forked worker pool.
+ *
+ * @param[in]  server_socket    Manager socket.
+ * @param[in]  sigmask_current  Sigmask to restore in the workers.
+ */
+static void
+worker_pool_start (int server_socket, sigset_t *sigmask_current)
+{
+  int index;
+
+  g_info ("Starting %i pre-forked GMP workers", worker_pool_size);
+
+  worker_pool_pids = g_realloc (worker_pool_pids,
+                                (worker_pool_count + worker_pool_size)
+                                * sizeof (pid_t));
+  worker_pool_sockets = g_realloc (worker_pool_sockets,
+                                   (worker_pool_count + worker_pool_size)
+                                   * sizeof (int));
+  for (index = 0; index < worker_pool_size; index++)
+    {
+      worker_pool_pids[worker_pool_count] = worker_pool_fork (server_socket,
+                                                              sigmask_current);
+      worker_pool_sockets[worker_pool_count] = server_socket;
+      worker_pool_count++;
+    }
+}
+
+/**
+ * @brief Replace any pool workers that have exited.
+ *
+ * The SIGCHLD handler reaps the workers, so just check whether each
+ * worker is still running, forking a replacement if not.
+ *
+ * @param[in]  sigmask_current  Sigmask to restore in new workers.
+ */
+static void
+worker_pool_maintain (sigset_t *sigmask_current)
+{
+  int index;
+
+  for (index = 0; index < worker_pool_count; index++)
+    if ((worker_pool_pids[index] == -1)
+        || (kill (worker_pool_pids[index], 0)
+            && (errno == ESRCH)))
+      {
+        if (worker_pool_pids[index] != -1)
+          g_debug ("%s: replacing worker %i",
+                   __func__, worker_pool_pids[index]);
+        worker_pool_pids[index] = worker_pool_fork (worker_pool_sockets[index],
+                                                    sigmask_current);
+      }
+}
+
 
 /* Connection forker for scheduler. */
 
@@ -710,7 +1028,7 @@ fork_connection_internal (gvm_connection_t *client_connection,
    * commands.  The caller must exit this process.
    */
 
-  /* Restore the sigmask that was blanked for pselect. */
+  /* Restore the sigmask that was blanked for epoll_pwait. */
   if (sigmask_normal)
     pthread_sigmask (SIG_SETMASK, sigmask_normal, NULL);
 
@@ -756,7 +1074,7 @@ fork_connection_internal (gvm_connection_t *client_connection,
           }
 
         /* The socket must have O_NONBLOCK set, in case an "asynchronous
-         * network error" removes the data between `select' and `read'.
+         * network error" removes the data between `epoll' and `read'.
          */
         if (fcntl (parent_client_socket, F_SETFL, O_NONBLOCK) == -1)
           {
@@ -804,6 +1122,7 @@ fork_connection_internal (gvm_connection_t *client_connection,
             if (dh_params_option
                 && set_gnutls_dhparams (client_credentials, dh_params_option))
               g_warning ("Couldn't set DH parameters from %s", dh_params_option);
+            enable_session_tickets (client_session);
           }
 
         /* Serve client. */
@@ -1079,6 +1398,18 @@ handle_sigchld (/* unused */ int given_signal, siginfo_t *info, void *ucontext)
       if (feed_version_check_in_progress == pid)
         /* This was a version check child, so allow version checks again */
         feed_version_check_in_progress = 0;
+
+      if (report_purge_in_progress == pid)
+        /* This was a retention purge child, so allow purges again. */
+        report_purge_in_progress = 0;
+
+      if (alert_deliveries_in_progress == pid)
+        /* This was an alert delivery child, so allow delivery runs again. */
+        alert_deliveries_in_progress = 0;
+
+      if (startup_checks_in_progress == pid)
+        /* This was the deferred startup check child. */
+        startup_checks_in_progress = 0;
     }
 }
 
@@ -1384,6 +1715,278 @@ fork_feed_sync ()
     }
 }
 
+/**
+ * @brief Number of seconds between report retention purges.
+ */
+#define REPORT_PURGE_PERIOD 3600
+
+/**
+ * @brief Fork a child to delete reports that exceed the retention period.
+ *
+ * @return 0 success, 1 purge already in progress, -1 error.  Child does not
+ *         return.
+ */
+static int
+fork_report_purge ()
+{
+  int pid;
+  sigset_t sigmask_all, sigmask_current;
+
+  if (report_purge_in_progress)
+    {
+      g_debug ("%s: Report purge skipped because one is already in progress",
+               __func__);
+      return 1;
+    }
+
+  report_purge_in_progress = 1;
+
+  /* Block SIGCHLD until parent records the value of the child PID. */
+  if (sigemptyset (&sigmask_all))
+    {
+      g_critical ("%s: Error emptying signal set", __func__);
+      return -1;
+    }
+  if (pthread_sigmask (SIG_BLOCK, &sigmask_all, &sigmask_current))
+    {
+      g_critical ("%s: Error setting signal mask", __func__);
+      return -1;
+    }
+
+  pid = fork_with_handlers ();
+  switch (pid)
+    {
+      case 0:
+        /* Child.   */
+
+        init_sentry ();
+        setproctitle ("Purging expired reports");
+
+        /* Clean up the process. */
+
+        pthread_sigmask (SIG_SETMASK, &sigmask_current, NULL);
+        cleanup_manage_process (FALSE);
+        if (manager_socket > -1)
+          {
+            close (manager_socket);
+            manager_socket = -1;
+          }
+        if (manager_socket_2 > -1)
+          {
+            close (manager_socket_2);
+            manager_socket_2 = -1;
+          }
+
+        /* Delete the expired reports. */
+
+        manage_purge_expired_reports ();
+
+        /* Exit. */
+
+        cleanup_manage_process (FALSE);
+        gvm_close_sentry ();
+        exit (EXIT_SUCCESS);
+
+        break;
+
+      case -1:
+        /* Parent when error. */
+        g_warning ("%s: fork: %s", __func__, strerror (errno));
+        report_purge_in_progress = 0;
+        if (pthread_sigmask (SIG_SETMASK, &sigmask_current, NULL))
+          g_warning ("%s: Error resetting signal mask", __func__);
+        return -1;
+
+      default:
+        /* Parent.  Unblock signals and continue. */
+        g_debug ("%s: %i forked %i", __func__, getpid (), pid);
+        report_purge_in_progress = pid;
+        if (pthread_sigmask (SIG_SETMASK, &sigmask_current, NULL))
+          g_warning ("%s: Error resetting signal mask", __func__);
+        return 0;
+    }
+}
+
+/**
+ * @brief Fork a child to run the alert deliveries that are due.
+ *
+ * @return 0 success, 1 delivery run already in progress, -1 error.  Child
+ *         does not return.
+ */
+static int
+fork_alert_deliveries ()
+{
+  int pid;
+  sigset_t sigmask_all, sigmask_current;
+
+  if (alert_deliveries_in_progress)
+    {
+      g_debug ("%s: Alert delivery run skipped because one is already"
+               " in progress",
+               __func__);
+      return 1;
+    }
+
+  alert_deliveries_in_progress = 1;
+
+  /* Block SIGCHLD until parent records the value of the child PID. */
+  if (sigemptyset (&sigmask_all))
+    {
+      g_critical ("%s: Error emptying signal set", __func__);
+      return -1;
+    }
+  if (pthread_sigmask (SIG_BLOCK, &sigmask_all, &sigmask_current))
+    {
+      g_critical ("%s: Error setting signal mask", __func__);
+      return -1;
+    }
+
+  pid = fork_with_handlers ();
+  switch (pid)
+    {
+      case 0:
+        /* Child.   */
+
+        init_sentry ();
+        setproctitle ("Running alert deliveries");
+
+        /* Clean up the process. */
+
+        pthread_sigmask (SIG_SETMASK, &sigmask_current, NULL);
+        cleanup_manage_process (FALSE);
+        if (manager_socket > -1)
+          {
+            close (manager_socket);
+            manager_socket = -1;
+          }
+        if (manager_socket_2 > -1)
+          {
+            close (manager_socket_2);
+            manager_socket_2 = -1;
+          }
+
+        /* Run the deliveries. */
+
+        manage_alert_deliveries ();
+
+        /* Exit. */
+
+        cleanup_manage_process (FALSE);
+        gvm_close_sentry ();
+        exit (EXIT_SUCCESS);
+
+        break;
+
+      case -1:
+        /* Parent when error. */
+        g_warning ("%s: fork: %s", __func__, strerror (errno));
+        alert_deliveries_in_progress = 0;
+        if (pthread_sigmask (SIG_SETMASK, &sigmask_current, NULL))
+          g_warning ("%s: Error resetting signal mask", __func__);
+        return -1;
+
+      default:
+        /* Parent.  Unblock signals and continue. */
+        g_debug ("%s: %i forked %i", __func__, getpid (), pid);
+        alert_deliveries_in_progress = pid;
+        if (pthread_sigmask (SIG_SETMASK, &sigmask_current, NULL))
+          g_warning ("%s: Error resetting signal mask", __func__);
+        return 0;
+    }
+}
+
+/**
+ * @brief Fork a child to run the startup checks that init_manage deferred.
+ *
+ * Called once, when init_manage skipped the startup database checks because
+ * the previous run passed for the same gvmd, database and feed versions.
+ * The child repeats the full checks while the parent is already serving.
+ *
+ * @return 0 success, 1 checks already in progress, -1 error.  Child does not
+ *         return.
+ */
+static int
+fork_startup_checks ()
+{
+  int pid;
+  sigset_t sigmask_all, sigmask_current;
+
+  if (startup_checks_in_progress)
+    {
+      g_debug ("%s: Startup checks skipped because they are already"
+               " in progress",
+               __func__);
+      return 1;
+    }
+
+  startup_checks_in_progress = 1;
+
+  /* Block SIGCHLD until parent records the value of the child PID. */
+  if (sigemptyset (&sigmask_all))
+    {
+      g_critical ("%s: Error emptying signal set", __func__);
+      return -1;
+    }
+  if (pthread_sigmask (SIG_BLOCK, &sigmask_all, &sigmask_current))
+    {
+      g_critical ("%s: Error setting signal mask", __func__);
+      return -1;
+    }
+
+  pid = fork_with_handlers ();
+  switch (pid)
+    {
+      case 0:
+        /* Child.   */
+
+        init_sentry ();
+        setproctitle ("Running deferred startup checks");
+
+        /* Clean up the process. */
+
+        pthread_sigmask (SIG_SETMASK, &sigmask_current, NULL);
+        cleanup_manage_process (FALSE);
+        if (manager_socket > -1)
+          {
+            close (manager_socket);
+            manager_socket = -1;
+          }
+        if (manager_socket_2 > -1)
+          {
+            close (manager_socket_2);
+            manager_socket_2 = -1;
+          }
+
+        /* Run the checks. */
+
+        manage_deferred_startup_checks ();
+
+        /* Exit. */
+
+        cleanup_manage_process (FALSE);
+        gvm_close_sentry ();
+        exit (EXIT_SUCCESS);
+
+        break;
+
+      case -1:
+        /* Parent when error. */
+        g_warning ("%s: fork: %s", __func__, strerror (errno));
+        startup_checks_in_progress = 0;
+        if (pthread_sigmask (SIG_SETMASK, &sigmask_current, NULL))
+          g_warning ("%s: Error resetting signal mask", __func__);
+        return -1;
+
+      default:
+        /* Parent.  Unblock signals and continue. */
+        g_debug ("%s: %i forked %i", __func__, getpid (), pid);
+        startup_checks_in_progress = pid;
+        if (pthread_sigmask (SIG_SETMASK, &sigmask_current, NULL))
+          g_warning ("%s: Error resetting signal mask", __func__);
+        return 0;
+    }
+}
+
 /**
  * @brief Serve incoming connections, scheduling periodically.
  *
@@ -1395,12 +1998,16 @@ fork_feed_sync ()
 static void
 serve_and_schedule ()
 {
-  time_t last_schedule_time, last_sync_time;
+  time_t last_schedule_time, last_sync_time, last_purge_time;
   sigset_t sigmask_all;
   static sigset_t sigmask_current;
+  struct epoll_event event;
+  struct itimerspec tick;
+  int epoll_fd, schedule_timer;
 
   last_schedule_time = 0;
   last_sync_time = 0;
+  last_purge_time = 0;
 
   if (sigfillset (&sigmask_all))
     {
@@ -1415,24 +2022,89 @@ serve_and_schedule ()
       exit (EXIT_FAILURE);
     }
   sigmask_normal = &sigmask_current;
-  while (1)
-    {
-      int ret, nfds;
-      fd_set readfds, exceptfds;
-      struct timespec timeout;
 
-      FD_ZERO (&readfds);
-      FD_SET (manager_socket, &readfds);
+  if (manage_startup_checks_deferred ())
+    /* init_manage skipped the startup checks, so run them now, in a child,
+     * while this process serves. */
+    fork_startup_checks ();
+
+  /* In worker pool mode the workers accept the connections, so the
+   * loop below only has to handle scheduling and keeping the pool
+   * populated. */
+  if (worker_pool_size > 0)
+    {
+      worker_pool_start (manager_socket, sigmask_normal);
       if (manager_socket_2 > -1)
-        FD_SET (manager_socket_2, &readfds);
-      FD_ZERO (&exceptfds);
-      FD_SET (manager_socket, &exceptfds);
+        worker_pool_start (manager_socket_2, sigmask_normal);
+    }
+
+  /* Wait on an epoll set: the Manager sockets for incoming connections,
+   * unless the workers accept those, and a timer that expires every
+   * SCHEDULE_PERIOD so that the scheduling below always runs on time. */
+  epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  if (epoll_fd == -1)
+    {
+      g_critical ("%s: failed to create epoll: %s",
+                  __func__, strerror (errno));
+      gvm_close_sentry ();
+      exit (EXIT_FAILURE);
+    }
+  schedule_timer = timerfd_create (CLOCK_MONOTONIC,
+                                   TFD_NONBLOCK | TFD_CLOEXEC);
+  if (schedule_timer == -1)
+    {
+      g_critical ("%s: failed to create schedule timer: %s",
+                  __func__, strerror (errno));
+      gvm_close_sentry ();
+      exit (EXIT_FAILURE);
+    }
+  tick.it_value.tv_sec = SCHEDULE_PERIOD;
+  tick.it_value.tv_nsec = 0;
+  tick.it_interval = tick.it_value;
+  if (timerfd_settime (schedule_timer, 0, &tick, NULL))
+    {
+      g_critical ("%s: failed to arm schedule timer: %s",
+                  __func__, strerror (errno));
+      gvm_close_sentry ();
+      exit (EXIT_FAILURE);
+    }
+  memset (&event, 0, sizeof (event));
+  event.events = EPOLLIN;
+  event.data.fd = schedule_timer;
+  if (epoll_ctl (epoll_fd, EPOLL_CTL_ADD, schedule_timer, &event))
+    {
+      g_critical ("%s: failed to watch schedule timer: %s",
+                  __func__, strerror (errno));
+      gvm_close_sentry ();
+      exit (EXIT_FAILURE);
+    }
+  if (worker_pool_size == 0)
+    {
+      event.data.fd = manager_socket;
+      if (epoll_ctl (epoll_fd, EPOLL_CTL_ADD, manager_socket, &event))
+        {
+          g_critical ("%s: failed to watch Manager socket: %s",
+                      __func__, strerror (errno));
+          gvm_close_sentry ();
+          exit (EXIT_FAILURE);
+        }
       if (manager_socket_2 > -1)
-        FD_SET (manager_socket_2, &exceptfds);
-      if (manager_socket >= manager_socket_2)
-        nfds = manager_socket + 1;
-      else
-        nfds = manager_socket_2 + 1;
+        {
+          event.data.fd = manager_socket_2;
+          if (epoll_ctl (epoll_fd, EPOLL_CTL_ADD, manager_socket_2, &event))
+            {
+              g_critical ("%s: failed to watch Manager socket (2): %s",
+                          __func__, strerror (errno));
+              gvm_close_sentry ();
+              exit (EXIT_FAILURE);
+            }
+        }
+    }
+
+  while (1)
+    {
+      int ret, index;
+      struct epoll_event events[3];
 
       if (termination_signal)
         {
@@ -1468,44 +2140,56 @@ serve_and_schedule ()
           last_sync_time = time (NULL);
         }
 
-      timeout.tv_sec = SCHEDULE_PERIOD;
-      timeout.tv_nsec = 0;
-      ret = pselect (nfds, &readfds, NULL, &exceptfds, &timeout,
-                     sigmask_normal);
+      if ((time (NULL) - last_purge_time) >= REPORT_PURGE_PERIOD)
+        {
+          fork_report_purge ();
+          last_purge_time = time (NULL);
+        }
+
+      if (alert_deliveries_in_progress == 0
+          && manage_alert_deliveries_due ())
+        fork_alert_deliveries ();
+
+      ret = epoll_pwait (epoll_fd, events, 3, -1, sigmask_normal);
 
       if (ret == -1)
         {
-          /* Error occurred while selecting socket. */
+          /* Error occurred while waiting on the epoll. */
           if (errno == EINTR)
             continue;
-          g_critical ("%s: select failed: %s",
+          g_critical ("%s: epoll failed: %s",
                       __func__,
                       strerror (errno));
           gvm_close_sentry ();
           exit (EXIT_FAILURE);
         }
 
-      if (ret > 0)
+      for (index = 0; index < ret; index++)
         {
-          /* Have an incoming connection. */
-          if (FD_ISSET (manager_socket, &exceptfds))
+          uint64_t expirations;
+
+          if (events[index].data.fd == schedule_timer)
             {
-              g_critical ("%s: exception in select", __func__);
-              gvm_close_sentry ();
-              exit (EXIT_FAILURE);
+              /* Drain the timer so it only triggers again on the next
+               * tick.  The scheduling below does the actual work. */
+              while (read (schedule_timer, &expirations,
+                           sizeof (expirations))
+                     > 0);
+              continue;
             }
-          if ((manager_socket_2 > -1) && FD_ISSET (manager_socket_2, &exceptfds))
+          if (events[index].events & (EPOLLERR | EPOLLHUP))
             {
-              g_critical ("%s: exception in select (2)", __func__);
+              g_critical ("%s: error on Manager socket", __func__);
               gvm_close_sentry ();
               exit (EXIT_FAILURE);
             }
-          if (FD_ISSET (manager_socket, &readfds))
-            accept_and_maybe_fork (manager_socket, sigmask_normal);
-          if ((manager_socket_2 > -1) && FD_ISSET (manager_socket_2, &readfds))
-            accept_and_maybe_fork (manager_socket_2, sigmask_normal);
+          /* Have an incoming connection. */
+          accept_and_maybe_fork (events[index].data.fd, sigmask_normal);
         }
 
+      if (worker_pool_pids)
+        worker_pool_maintain (sigmask_normal);
+
       if ((time (NULL) - last_schedule_time) >= SCHEDULE_PERIOD)
         switch (manage_schedule (fork_connection_for_scheduler,
                                  scheduling_enabled, sigmask_normal))
@@ -1685,7 +2369,7 @@ manager_listen (const char *address_str_unix, const char *address_str_tls,
     return 0;
 
   /* The socket must have O_NONBLOCK set, in case an "asynchronous network
-   * error" removes the connection between `select' and `accept'. */
+   * error" removes the connection between `epoll' and `accept'. */
   if (fcntl (*soc, F_SETFL, O_NONBLOCK) == -1)
     {
       g_warning ("Failed to set manager socket flag: %s", strerror (errno));
@@ -1832,6 +2516,7 @@ gvmd (int argc, char** argv, char *env[])
   static gboolean check_alerts = FALSE;
   static gboolean create_encryption_key = FALSE;
   static gboolean migrate_database = FALSE;
+  static gboolean migrate_dry_run = FALSE;
   static gboolean encrypt_all_credentials = FALSE;
   static gboolean decrypt_all_credentials = FALSE;
   static gboolean disable_password_policy = FALSE;
@@ -1866,10 +2551,12 @@ gvmd (int argc, char** argv, char *env[])
   static int scanner_connection_retry = SCANNER_CONNECTION_RETRY_DEFAULT;
   static int schedule_timeout = SCHEDULE_TIMEOUT_DEFAULT;
   static int secinfo_commit_size = SECINFO_COMMIT_SIZE_DEFAULT;
+  static int secinfo_parallel_workers = SECINFO_PARALLEL_WORKERS_DEFAULT;
   static gchar *delete_scanner = NULL;
   static gchar *verify_scanner = NULL;
   static gchar *priorities = "NORMAL";
   static gchar *dh_params = NULL;
+  static gboolean lazy_nvt_cache = FALSE;
   static gboolean ldap_debug = FALSE;
   static gchar *listen_owner = NULL;
   static gchar *listen_group = NULL;
@@ -1897,8 +2584,12 @@ gvmd (int argc, char** argv, char *env[])
   static gchar *feed_lock_path = NULL;
   static int feed_lock_timeout = 0;
   static int max_concurrent_scan_updates = 0;
+  static int db_pool_size = 0;
+  static int db_replica_lag_limit = DEFAULT_DB_REPLICA_LAG_LIMIT;
   static int mem_wait_retries = 30;
   static int min_mem_feed_update = 0;
+  static int min_mem_scan_start = 0;
+  static int slow_statement_ms = SQL_SLOW_STATEMENT_MS_DEFAULT;
   static int vt_ref_insert_size = VT_REF_INSERT_SIZE_DEFAULT;
   static int vt_sev_insert_size = VT_SEV_INSERT_SIZE_DEFAULT;
   static gchar *vt_verification_collation = NULL;
@@ -1957,6 +2648,29 @@ gvmd (int argc, char** argv, char *env[])
           &(database.port),
           "Use <port> as database port or socket extension for PostgreSQL.",
           "<port>" },
+        { "db-pool-size", '\0', 0, G_OPTION_ARG_INT,
+          &db_pool_size,
+          "Keep up to <number> idle database connections open for reuse"
+          " within a process, instead of reconnecting on every open."
+          " Default: 0 (no pooling).",
+          "<number>" },
+        { "db-replica-host", '\0', 0, G_OPTION_ARG_STRING,
+          &(database.replica_host),
+          "Use <host> as a read replica of the database.  Read only GMP"
+          " commands then run their reads on the replica as long as it"
+          " keeps up with the primary.",
+          "<host>" },
+        { "db-replica-lag-limit", '\0', 0, G_OPTION_ARG_INT,
+          &db_replica_lag_limit,
+          "Keep reads on the primary while the read replica is more than"
+          " <number> seconds behind.  Defaults to "
+          G_STRINGIFY (DEFAULT_DB_REPLICA_LAG_LIMIT) " seconds.",
+          "<number>" },
+        { "db-replica-port", '\0', 0, G_OPTION_ARG_STRING,
+          &(database.replica_port),
+          "Use <port> as port of the database read replica.  Defaults to"
+          " the database port.",
+          "<port>" },
         { "db-user", '\0', 0, G_OPTION_ARG_STRING,
           &(database.user),
           "Use <user> as database user.",
@@ -2051,6 +2765,11 @@ gvmd (int argc, char** argv, char *env[])
           &inheritor,
           "Have <username> inherit from deleted user.",
           "<username>" },
+        { "lazy-nvt-cache", '\0', 0, G_OPTION_ARG_NONE,
+          &lazy_nvt_cache,
+          "Load NVT information from the database on demand instead of"
+          " loading the full NVT cache at startup.",
+          NULL },
         { "ldap-debug", '\0', 0, G_OPTION_ARG_NONE,
           &ldap_debug,
           "Enable debugging of LDAP authentication",
@@ -2106,11 +2825,21 @@ gvmd (int argc, char** argv, char *env[])
           &migrate_database,
           "Migrate the database and exit.",
           NULL },
+        { "migrate-dry-run", '\0', 0, G_OPTION_ARG_NONE,
+          &migrate_dry_run,
+          "List pending database migrations with table size estimates,"
+          " and exit.",
+          NULL },
         { "min-mem-feed-update", '\0', 0, G_OPTION_ARG_INT,
           &min_mem_feed_update,
           "Minimum memory in MiB for feed updates. Default: 0."
           " Feed updates are skipped if less physical memory is available.",
           "<number>" },
+        { "min-mem-scan-start", '\0', 0, G_OPTION_ARG_INT,
+          &min_mem_scan_start,
+          "Minimum memory in MiB for starting scheduled scans. Default: 0."
+          " Scan starts are deferred if less physical memory is available.",
+          "<number>" },
         { "modify-scanner", '\0', 0, G_OPTION_ARG_STRING,
           &modify_scanner,
           "Modify scanner <scanner-uuid> and exit.",
@@ -2130,8 +2859,10 @@ gvmd (int argc, char** argv, char *env[])
           " cleanup-port-names, cleanup-report-formats, cleanup-result-encoding,"
           " cleanup-result-nvts, cleanup-result-severities,"
           " cleanup-schedule-times, cleanup-sequences,"
-          " cleanup-tls-certificate-encoding, migrate-relay-sensors,"
-          " rebuild-report-cache or update-report-cache.",
+          " cleanup-tls-certificate-encoding, cluster-results,"
+          " migrate-relay-sensors, rebuild-report-cache,"
+          " rebuild-result-indexes, refresh-statistics"
+          " or update-report-cache.",
           "<name>" },
         { "osp-vt-update", '\0', 0, G_OPTION_ARG_STRING,
           &osp_vt_update,
@@ -2234,11 +2965,21 @@ gvmd (int argc, char** argv, char *env[])
           "During CERT and SCAP sync, commit updates to the database every"
           " <number> items, 0 for unlimited, default: "
           G_STRINGIFY (SECINFO_COMMIT_SIZE_DEFAULT), "<number>" },
+        { "secinfo-parallel-workers", '\0', 0, G_OPTION_ARG_INT,
+          &secinfo_parallel_workers,
+          "During SCAP sync, split the CVE feed files across <number> worker"
+          " processes, default: "
+          G_STRINGIFY (SECINFO_PARALLEL_WORKERS_DEFAULT), "<number>" },
         { "set-encryption-key", '\0', 0, G_OPTION_ARG_STRING,
           &set_encryption_key,
           "Set the encryption key with the given UID as the new default"
           " and exit.",
           "<uid>" },
+        { "slow-statement-ms", '\0', 0, G_OPTION_ARG_INT,
+          &slow_statement_ms,
+          "Log SQL statements that take longer than <number> milliseconds,"
+          " with their plan.  0 to disable, default: "
+          G_STRINGIFY (SQL_SLOW_STATEMENT_MS_DEFAULT), "<number>" },
         { "unix-socket", 'c', 0, G_OPTION_ARG_STRING,
           &manager_address_string_unix,
           "Listen on UNIX socket at <filename>.",
@@ -2279,6 +3020,13 @@ gvmd (int argc, char** argv, char *env[])
           " empty to choose automatically. Should be 'ucs_default' if DB uses"
           " UTF-8 or 'C' for single-byte encodings.",
           "<collation>" },
+        { "worker-pool-size", '\0', 0, G_OPTION_ARG_INT,
+          &worker_pool_size,
+          "Serve clients with a pool of <number> pre-forked workers which"
+          " each keep a database connection open between sessions, instead"
+          " of forking a process per connection. Default: 0 (fork per"
+          " connection).",
+          "<number>" },
         { NULL }
       };
 
@@ -2366,10 +3114,17 @@ gvmd (int argc, char** argv, char *env[])
 
   set_secinfo_commit_size (secinfo_commit_size);
 
+  set_secinfo_parallel_workers (secinfo_parallel_workers);
+
+  set_lazy_nvt_cache (lazy_nvt_cache);
+
   set_vt_ref_insert_size (vt_ref_insert_size);
 
   set_vt_sev_insert_size (vt_sev_insert_size);
 
+  /* Set the slow statement threshold */
+  sql_slow_statement_ms = slow_statement_ms;
+
   /* Set VT verification collation override */
   set_vt_verification_collation (vt_verification_collation);
 
@@ -2459,8 +3214,17 @@ gvmd (int argc, char** argv, char *env[])
   /* Set maximum number of concurrent scan updates */
   set_max_concurrent_scan_updates (max_concurrent_scan_updates);
 
+  /* Set the size of the database connection pool */
+  set_db_connection_pool_size (db_pool_size);
+
+  /* Set the lag limit of the database read replica */
+  set_db_replica_lag_limit (db_replica_lag_limit);
+
   /* Initialize Inter-Process Communication */
   init_semaphore_set ();
+  init_auth_verdict_cache ();
+  init_perf_counters ();
+  init_aggregate_cache ();
 
   /* Enable GNUTLS debugging if requested via env variable.  */
   {
@@ -2478,6 +3242,8 @@ gvmd (int argc, char** argv, char *env[])
   /* Set minimum memory for feed updates */
   set_min_mem_feed_update (min_mem_feed_update);
 
+  set_min_mem_scan_start (min_mem_scan_start);
+
   /* Set relay mapper */
   if (relay_mapper)
     {
@@ -2574,6 +3340,37 @@ gvmd (int argc, char** argv, char *env[])
         return EXIT_FAILURE;
     }
 
+  if (migrate_dry_run)
+    {
+      /* List the pending migrations without running any.  Read only, so no
+       * need for the migrating lock. */
+
+      setproctitle ("Checking database migrations");
+
+      switch (manage_migrate_dry_run (log_config, &database))
+        {
+          case 0:
+            return EXIT_SUCCESS;
+          case 1:
+            g_info ("%s: databases are already at the supported version",
+                    __func__);
+            return EXIT_SUCCESS;
+          case 2:
+            g_warning ("%s: database migration too hard",
+                       __func__);
+            return EXIT_FAILURE;
+          case -1:
+            g_critical ("%s: database migration check failed",
+                        __func__);
+            return EXIT_FAILURE;
+          default:
+            assert (0);
+            g_critical ("%s: strange return from manage_migrate_dry_run",
+                        __func__);
+            return EXIT_FAILURE;
+        }
+    }
+
   if (migrate_database)
     {
       lockfile_t lockfile_migrating;
@@ -3326,6 +4123,14 @@ gvmd (int argc, char** argv, char *env[])
       dh_params_option = dh_params;
       if (dh_params && set_gnutls_dhparams (client_credentials, dh_params))
         g_warning ("Couldn't set DH parameters from %s", dh_params);
+      if (gnutls_session_ticket_key_generate (&session_ticket_key))
+        {
+          g_warning ("%s: failed to generate session ticket key,"
+                     " session resumption disabled",
+                     __func__);
+          session_ticket_key.data = NULL;
+        }
+      enable_session_tickets (client_session);
     }
 
   if (disable_encrypted_credentials)
@@ -29,7 +29,11 @@
 #define _GNU_SOURCE
 
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/sem.h>
+#include <time.h>
 
 #include "ipc.h"
 #include "manage.h"
@@ -91,7 +95,8 @@ init_semaphore_set ()
       return -1;
     }
 
-  semaphore_set = semget (semaphore_set_key, 1, 0660 | IPC_CREAT);
+  semaphore_set = semget (semaphore_set_key, 1 + SEMAPHORE_SCANNER_SLOTS,
+                          0660 | IPC_CREAT);
   if (semaphore_set < 0)
     {
       g_warning ("%s: error getting semaphore set: %s",
@@ -112,6 +117,18 @@ init_semaphore_set ()
       return -1;
     }
 
+  /* Each scanner slot gets its own scan update capacity, so a saturated
+   * scanner does not throttle the updates of tasks on other scanners. */
+  for (int slot = 0; slot < SEMAPHORE_SCANNER_SLOTS; slot++)
+    {
+      if (semctl (semaphore_set, 1 + slot, SETVAL, sem_value) == -1)
+        {
+          g_warning ("%s: error initializing scanner slot semaphore %i: %s",
+                     __func__, slot, strerror (errno));
+          return -1;
+        }
+    }
+
   return 0;
 }
 
@@ -163,3 +180,644 @@ semaphore_op (semaphore_index_t semaphore_index,
 
   return 0;
 }
+
+/**
+ * @brief Performs a semaphore operation on the slot of a scanner.
+ *
+ * Scanners are mapped onto the fixed number of scanner slot semaphores
+ * by their row id, so scanners only share a slot when there are more
+ * than SEMAPHORE_SCANNER_SLOTS of them.
+ *
+ * @param[in]  scanner    Row id of the scanner.
+ * @param[in]  op_value   The operation value
+ * @param[in]  timeout    Timeout in seconds, 0 for unlimited
+ *
+ * @return 0 success, 1 timed out, -1 error
+ */
+int
+semaphore_scanner_op (long long int scanner,
+                      short int op_value,
+                      time_t timeout)
+{
+  return semaphore_op (1 + (scanner % SEMAPHORE_SCANNER_SLOTS),
+                       op_value,
+                       timeout);
+}
+
+
+/* Authentication verdict cache. */
+
+/**
+ * @brief Number of slots in the authentication verdict cache.
+ */
+#define AUTH_VERDICT_CACHE_SLOTS 256
+
+/**
+ * @brief A slot of the authentication verdict cache.
+ */
+struct auth_verdict_slot
+{
+  char name_digest[65];   ///< HMAC of the username, as hex.
+  char cred_digest[65];   ///< HMAC of method, username and password, as hex.
+  time_t expiry;          ///< Time the verdict expires, 0 for never set.
+};
+
+/**
+ * @brief Authentication verdict cache, shared between forked processes.
+ */
+static struct auth_verdict_slot *auth_verdict_slots = NULL;
+
+/**
+ * @brief HMAC key of the authentication verdict cache.
+ *
+ * Generated freshly at startup and inherited copy-on-write by the forked
+ * connection processes.  The key never enters the shared mapping or the
+ * db, so the cached digests are useless without access to a gvmd process
+ * image, and all verdicts expire with the daemon.
+ */
+static unsigned char auth_verdict_key[32];
+
+/**
+ * @brief Initializes the authentication verdict cache.
+ *
+ * Must be called before the connection processes are forked.
+ *
+ * @return 0 success, -1 error
+ */
+int
+init_auth_verdict_cache ()
+{
+  FILE *urandom;
+
+  auth_verdict_slots = mmap (NULL,
+                             AUTH_VERDICT_CACHE_SLOTS
+                              * sizeof (struct auth_verdict_slot),
+                             PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS,
+                             -1,
+                             0);
+  if (auth_verdict_slots == MAP_FAILED)
+    {
+      g_warning ("%s: error mapping verdict cache: %s",
+                 __func__, strerror (errno));
+      auth_verdict_slots = NULL;
+      return -1;
+    }
+
+  urandom = fopen ("/dev/urandom", "rb");
+  if (urandom == NULL
+      || fread (auth_verdict_key, 1, sizeof (auth_verdict_key), urandom)
+         != sizeof (auth_verdict_key))
+    {
+      g_warning ("%s: error reading verdict cache key from /dev/urandom",
+                 __func__);
+      if (urandom)
+        fclose (urandom);
+      munmap (auth_verdict_slots,
+              AUTH_VERDICT_CACHE_SLOTS * sizeof (struct auth_verdict_slot));
+      auth_verdict_slots = NULL;
+      return -1;
+    }
+  fclose (urandom);
+
+  return 0;
+}
+
+/**
+ * @brief Get the digest of a username, as hex.
+ *
+ * @param[in]  username  Username.
+ *
+ * @return Newly allocated digest.
+ */
+static gchar *
+auth_verdict_name_digest (const char *username)
+{
+  return g_compute_hmac_for_string (G_CHECKSUM_SHA256,
+                                    auth_verdict_key,
+                                    sizeof (auth_verdict_key),
+                                    username,
+                                    -1);
+}
+
+/**
+ * @brief Get the digest of a set of credentials, as hex.
+ *
+ * @param[in]  username  Username.
+ * @param[in]  password  Password.
+ * @param[in]  method    Authentication method.
+ *
+ * @return Newly allocated digest.
+ */
+static gchar *
+auth_verdict_cred_digest (const char *username, const char *password,
+                          int method)
+{
+  gchar *input, *digest;
+
+  input = g_strdup_printf ("%i\1%s\1%s", method, username, password);
+  digest = g_compute_hmac_for_string (G_CHECKSUM_SHA256,
+                                      auth_verdict_key,
+                                      sizeof (auth_verdict_key),
+                                      input,
+                                      -1);
+  memset (input, 0, strlen (input));
+  g_free (input);
+
+  return digest;
+}
+
+/**
+ * @brief Get the cache slot of a username.
+ *
+ * The cache is direct mapped by the username digest, so each username
+ * has a single slot and removal by username is possible.
+ *
+ * @param[in]  name_digest  Digest of the username.
+ *
+ * @return The slot.
+ */
+static struct auth_verdict_slot *
+auth_verdict_slot (const gchar *name_digest)
+{
+  return auth_verdict_slots
+         + (g_str_hash (name_digest) % AUTH_VERDICT_CACHE_SLOTS);
+}
+
+/**
+ * @brief Check the verdict cache for a set of credentials.
+ *
+ * @param[in]  username  Username.
+ * @param[in]  password  Password.
+ * @param[in]  method    Authentication method.
+ *
+ * @return 0 if the credentials were verified recently, else -1.
+ */
+int
+auth_verdict_cache_check (const char *username, const char *password,
+                          int method)
+{
+  struct auth_verdict_slot *slot;
+  gchar *name_digest, *cred_digest;
+  int ret;
+
+  if (auth_verdict_slots == NULL)
+    return -1;
+
+  name_digest = auth_verdict_name_digest (username);
+  slot = auth_verdict_slot (name_digest);
+  g_free (name_digest);
+
+  ret = -1;
+  if (slot->expiry >= time (NULL))
+    {
+      cred_digest = auth_verdict_cred_digest (username, password, method);
+      if (strncmp (slot->cred_digest, cred_digest, 64) == 0)
+        ret = 0;
+      g_free (cred_digest);
+    }
+
+  return ret;
+}
+
+/**
+ * @brief Add a successful verdict for a set of credentials to the cache.
+ *
+ * @param[in]  username  Username.
+ * @param[in]  password  Password.
+ * @param[in]  method    Authentication method.
+ * @param[in]  lifetime  Seconds before the verdict expires.
+ */
+void
+auth_verdict_cache_add (const char *username, const char *password,
+                        int method, time_t lifetime)
+{
+  struct auth_verdict_slot *slot;
+  gchar *name_digest, *cred_digest;
+
+  if (auth_verdict_slots == NULL)
+    return;
+
+  name_digest = auth_verdict_name_digest (username);
+  cred_digest = auth_verdict_cred_digest (username, password, method);
+  slot = auth_verdict_slot (name_digest);
+
+  /* Expire the slot while writing, so that a concurrent reader cannot
+   * match a half written entry.  A digest mixed from two writers cannot
+   * match any credentials without the HMAC key, so concurrent writes
+   * only cost a cache miss. */
+  slot->expiry = 0;
+  __sync_synchronize ();
+  memcpy (slot->name_digest, name_digest, 65);
+  memcpy (slot->cred_digest, cred_digest, 65);
+  __sync_synchronize ();
+  slot->expiry = time (NULL) + lifetime;
+
+  g_free (name_digest);
+  g_free (cred_digest);
+}
+
+/**
+ * @brief Remove any cached verdict of a user.
+ *
+ * @param[in]  username  Username.
+ */
+void
+auth_verdict_cache_remove (const char *username)
+{
+  struct auth_verdict_slot *slot;
+  gchar *name_digest;
+
+  if (auth_verdict_slots == NULL || username == NULL)
+    return;
+
+  name_digest = auth_verdict_name_digest (username);
+  slot = auth_verdict_slot (name_digest);
+  if (strncmp (slot->name_digest, name_digest, 64) == 0)
+    slot->expiry = 0;
+  g_free (name_digest);
+}
+
+
+/* Performance counters. */
+
+/**
+ * @brief Number of slots in the performance counter table.
+ */
+#define PERF_COUNTER_SLOTS 128
+
+/**
+ * @brief Size of the command name in a performance counter slot.
+ */
+#define PERF_COUNTER_NAME_SIZE 41
+
+/**
+ * @brief States of a performance counter slot.
+ */
+enum perf_counter_state
+{
+  PERF_COUNTER_FREE = 0,     ///< Slot is unused.
+  PERF_COUNTER_CLAIMED = 1,  ///< A process is writing the command name.
+  PERF_COUNTER_READY = 2     ///< Slot is initialised.
+};
+
+/**
+ * @brief A slot of the performance counter table.
+ *
+ * The counters only ever increase, and are added to atomically, so readers
+ * can snapshot them without locking.  A snapshot may mix values from just
+ * before and just after a command completed, which is fine for monitoring.
+ */
+struct perf_counter_slot
+{
+  char command[PERF_COUNTER_NAME_SIZE]; ///< GMP command name.
+  volatile int state;           ///< A perf_counter_state value.
+  unsigned long long int count;        ///< Times the command completed.
+  unsigned long long int wall_us;      ///< Total wall time, in microseconds.
+  unsigned long long int wall_us_max;  ///< Longest single command.
+  unsigned long long int rows;         ///< SQL rows stepped over.
+  unsigned long long int queries;      ///< SQL statements sent.
+  unsigned long long int bytes_out;    ///< Bytes queued for the client.
+  unsigned long long int deadlocks;    ///< SQL deadlocks hit.
+};
+
+/**
+ * @brief Performance counter table, shared between forked processes.
+ */
+static struct perf_counter_slot *perf_counter_slots = NULL;
+
+/**
+ * @brief Initializes the performance counter table.
+ *
+ * Must be called before the connection processes are forked.
+ *
+ * @return 0 success, -1 error
+ */
+int
+init_perf_counters ()
+{
+  perf_counter_slots = mmap (NULL,
+                             PERF_COUNTER_SLOTS
+                              * sizeof (struct perf_counter_slot),
+                             PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS,
+                             -1,
+                             0);
+  if (perf_counter_slots == MAP_FAILED)
+    {
+      g_warning ("%s: error mapping counter table: %s",
+                 __func__, strerror (errno));
+      perf_counter_slots = NULL;
+      return -1;
+    }
+
+  return 0;
+}
+
+/**
+ * @brief Get the counter slot of a command, claiming one if needed.
+ *
+ * The slots are open addressed by the hash of the command name.  A free
+ * slot is claimed with a compare and swap, so each command gets a single
+ * slot even when forked processes meet it for the first time concurrently.
+ *
+ * @param[in]  command  GMP command name.
+ *
+ * @return The slot, or NULL if the table is full or not mapped.
+ */
+static struct perf_counter_slot *
+perf_counter_slot (const char *command)
+{
+  guint hash;
+  int probe;
+
+  if (perf_counter_slots == NULL)
+    return NULL;
+
+  hash = g_str_hash (command);
+  for (probe = 0; probe < PERF_COUNTER_SLOTS; probe++)
+    {
+      struct perf_counter_slot *slot;
+
+      slot = perf_counter_slots + ((hash + probe) % PERF_COUNTER_SLOTS);
+      if (slot->state == PERF_COUNTER_FREE
+          && __sync_bool_compare_and_swap (&slot->state,
+                                           PERF_COUNTER_FREE,
+                                           PERF_COUNTER_CLAIMED))
+        {
+          strncpy (slot->command, command, PERF_COUNTER_NAME_SIZE - 1);
+          __sync_synchronize ();
+          slot->state = PERF_COUNTER_READY;
+          return slot;
+        }
+
+      /* The claim only covers the copy of the name, so waiting for the
+       * claimer is a matter of a few instructions. */
+      while (slot->state == PERF_COUNTER_CLAIMED)
+        __sync_synchronize ();
+
+      if (strncmp (slot->command, command, PERF_COUNTER_NAME_SIZE - 1) == 0)
+        return slot;
+    }
+
+  return NULL;
+}
+
+/**
+ * @brief Add a completed command to the performance counters.
+ *
+ * @param[in]  command    GMP command name.
+ * @param[in]  wall_us    Wall time of the command, in microseconds.
+ * @param[in]  rows       SQL rows stepped over during the command.
+ * @param[in]  queries    SQL statements sent during the command.
+ * @param[in]  bytes_out  Bytes queued for the client during the command.
+ */
+void
+perf_counters_add (const char *command, unsigned long long int wall_us,
+                   unsigned long long int rows,
+                   unsigned long long int queries,
+                   unsigned long long int bytes_out)
+{
+  struct perf_counter_slot *slot;
+  unsigned long long int max;
+
+  slot = perf_counter_slot (command);
+  if (slot == NULL)
+    return;
+
+  __sync_fetch_and_add (&slot->count, 1);
+  __sync_fetch_and_add (&slot->wall_us, wall_us);
+  __sync_fetch_and_add (&slot->rows, rows);
+  __sync_fetch_and_add (&slot->queries, queries);
+  __sync_fetch_and_add (&slot->bytes_out, bytes_out);
+
+  while ((max = slot->wall_us_max) < wall_us)
+    if (__sync_bool_compare_and_swap (&slot->wall_us_max, max, wall_us))
+      break;
+}
+
+/**
+ * @brief Count a deadlock against a performance counter slot.
+ *
+ * The name is either a GMP command or a statement class, so contention
+ * shows up both under the command that suffered it and under the kind of
+ * statement that was involved.
+ *
+ * @param[in]  name  Name of the slot.
+ */
+void
+perf_counters_deadlock (const char *name)
+{
+  struct perf_counter_slot *slot;
+
+  slot = perf_counter_slot (name);
+  if (slot == NULL)
+    return;
+
+  __sync_fetch_and_add (&slot->deadlocks, 1);
+}
+
+/**
+ * @brief Get the values of a performance counter slot.
+ *
+ * @param[in]   index      Index of the slot.
+ * @param[out]  command    GMP command name.  Points into the shared table.
+ * @param[out]  count      Times the command completed.
+ * @param[out]  wall_us    Total wall time, in microseconds.
+ * @param[out]  wall_us_max  Longest single command, in microseconds.
+ * @param[out]  rows       SQL rows stepped over.
+ * @param[out]  queries    SQL statements sent.
+ * @param[out]  bytes_out  Bytes queued for the client.
+ * @param[out]  deadlocks  SQL deadlocks hit.
+ *
+ * @return 0 success, 1 slot is unused, -1 no more slots.
+ */
+int
+perf_counters_get (int index, const char **command,
+                   unsigned long long int *count,
+                   unsigned long long int *wall_us,
+                   unsigned long long int *wall_us_max,
+                   unsigned long long int *rows,
+                   unsigned long long int *queries,
+                   unsigned long long int *bytes_out,
+                   unsigned long long int *deadlocks)
+{
+  struct perf_counter_slot *slot;
+
+  if (perf_counter_slots == NULL
+      || index < 0
+      || index >= PERF_COUNTER_SLOTS)
+    return -1;
+
+  slot = perf_counter_slots + index;
+  if (slot->state != PERF_COUNTER_READY)
+    return 1;
+
+  *command = slot->command;
+  *count = slot->count;
+  *wall_us = slot->wall_us;
+  *wall_us_max = slot->wall_us_max;
+  *rows = slot->rows;
+  *queries = slot->queries;
+  *bytes_out = slot->bytes_out;
+  *deadlocks = slot->deadlocks;
+
+  return 0;
+}
+
+
+/* Aggregate cache. */
+
+/**
+ * @brief Number of slots in the aggregate cache.
+ */
+#define AGGREGATE_CACHE_SLOTS 64
+
+/**
+ * @brief Maximum size of a cached aggregate response, including the NULL.
+ *
+ * Larger responses simply skip the cache.
+ */
+#define AGGREGATE_CACHE_XML_SIZE 16384
+
+/**
+ * @brief A slot of the aggregate cache.
+ */
+struct aggregate_cache_slot
+{
+  char key_digest[65];   ///< SHA256 of the request description, as hex.
+  time_t expiry;         ///< Time the entry expires, 0 for never set.
+  char xml[AGGREGATE_CACHE_XML_SIZE];  ///< The cached response.
+};
+
+/**
+ * @brief Aggregate cache, shared between forked processes.
+ */
+static struct aggregate_cache_slot *aggregate_cache_slots = NULL;
+
+/**
+ * @brief Initializes the aggregate cache.
+ *
+ * Must be called before the connection processes are forked.
+ *
+ * @return 0 success, -1 error
+ */
+int
+init_aggregate_cache ()
+{
+  aggregate_cache_slots = mmap (NULL,
+                                AGGREGATE_CACHE_SLOTS
+                                 * sizeof (struct aggregate_cache_slot),
+                                PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_ANONYMOUS,
+                                -1,
+                                0);
+  if (aggregate_cache_slots == MAP_FAILED)
+    {
+      g_warning ("%s: error mapping aggregate cache: %s",
+                 __func__, strerror (errno));
+      aggregate_cache_slots = NULL;
+      return -1;
+    }
+
+  return 0;
+}
+
+/**
+ * @brief Get the cache slot of a request description.
+ *
+ * The cache is direct mapped by the digest, so a newer aggregate simply
+ * replaces an older one that falls on the same slot.
+ *
+ * @param[in]  key_digest  Digest of the request description.
+ *
+ * @return The slot.
+ */
+static struct aggregate_cache_slot *
+aggregate_cache_slot (const gchar *key_digest)
+{
+  return aggregate_cache_slots
+         + (g_str_hash (key_digest) % AGGREGATE_CACHE_SLOTS);
+}
+
+/**
+ * @brief Check the aggregate cache for a request description.
+ *
+ * @param[in]  key  Request description, which must include the user.
+ *
+ * @return Newly allocated copy of the cached response, or NULL.
+ */
+gchar *
+aggregate_cache_check (const char *key)
+{
+  struct aggregate_cache_slot *slot;
+  gchar *key_digest, *xml;
+  time_t expiry;
+
+  if (aggregate_cache_slots == NULL)
+    return NULL;
+
+  key_digest = g_compute_checksum_for_string (G_CHECKSUM_SHA256, key, -1);
+  slot = aggregate_cache_slot (key_digest);
+
+  expiry = slot->expiry;
+  if (expiry < time (NULL)
+      || strncmp (slot->key_digest, key_digest, 64))
+    {
+      g_free (key_digest);
+      return NULL;
+    }
+
+  xml = g_strndup (slot->xml, AGGREGATE_CACHE_XML_SIZE - 1);
+
+  /* Reread the slot header after copying.  If a writer raced the copy it
+   * either zeroed the expiry or replaced the digest, so a consistent
+   * header means a consistent copy. */
+  __sync_synchronize ();
+  if (slot->expiry != expiry
+      || strncmp (slot->key_digest, key_digest, 64))
+    {
+      g_free (xml);
+      xml = NULL;
+    }
+
+  g_free (key_digest);
+  return xml;
+}
+
+/**
+ * @brief Add an aggregate response to the cache.
+ *
+ * @param[in]  key       Request description, which must include the user.
+ * @param[in]  xml       The response.
+ * @param[in]  lifetime  Seconds before the entry expires.
+ */
+void
+aggregate_cache_add (const char *key, const char *xml, time_t lifetime)
+{
+  struct aggregate_cache_slot *slot;
+  gchar *key_digest;
+  size_t length;
+
+  if (aggregate_cache_slots == NULL)
+    return;
+
+  length = strlen (xml);
+  if (length >= AGGREGATE_CACHE_XML_SIZE)
+    /* Too big for a slot, let later requests rebuild it. */
+    return;
+
+  key_digest = g_compute_checksum_for_string (G_CHECKSUM_SHA256, key, -1);
+  slot = aggregate_cache_slot (key_digest);
+
+  /* Expire the slot while writing, so that a concurrent reader cannot
+   * match a half written entry. */
+  slot->expiry = 0;
+  __sync_synchronize ();
+  memcpy (slot->key_digest, key_digest, 65);
+  memcpy (slot->xml, xml, length + 1);
+  __sync_synchronize ();
+  slot->expiry = time (NULL) + lifetime;
+
+  g_free (key_digest);
+}
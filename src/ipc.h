@@ -24,14 +24,63 @@
 #ifndef _GVMD_IPC_H
 #define _GVMD_IPC_H
 
+#include <glib.h>
+#include <time.h>
+
 typedef enum {
   SEMAPHORE_SCAN_UPDATE = 0
 } semaphore_index_t;
 
+/**
+ * @brief Number of per-scanner scan update semaphores in the gvmd set.
+ */
+#define SEMAPHORE_SCANNER_SLOTS 16
+
 int
 init_semaphore_set ();
 
 int
 semaphore_op (semaphore_index_t, short int, time_t);
 
+int
+semaphore_scanner_op (long long int, short int, time_t);
+
+int
+init_auth_verdict_cache ();
+
+int
+auth_verdict_cache_check (const char *, const char *, int);
+
+void
+auth_verdict_cache_add (const char *, const char *, int, time_t);
+
+void
+auth_verdict_cache_remove (const char *);
+
+int
+init_perf_counters ();
+
+void
+perf_counters_add (const char *, unsigned long long int,
+                   unsigned long long int, unsigned long long int,
+                   unsigned long long int);
+
+void
+perf_counters_deadlock (const char *);
+
+int
+perf_counters_get (int, const char **, unsigned long long int *,
+                   unsigned long long int *, unsigned long long int *,
+                   unsigned long long int *, unsigned long long int *,
+                   unsigned long long int *, unsigned long long int *);
+
+int
+init_aggregate_cache ();
+
+gchar *
+aggregate_cache_check (const char *);
+
+void
+aggregate_cache_add (const char *, const char *, time_t);
+
 #endif /* not _GVMD_IPC_H */
@@ -43,6 +43,33 @@ typedef long long int resource_t;
  */
 typedef struct sql_stmt sql_stmt_t;
 
+/**
+ * @brief Decode types for iterator columns.
+ *
+ * Columns default to ITERATOR_COLUMN_UNTYPED, which converts the column
+ * on every access.  Declaring another type makes next decode the column
+ * once per row, so accessors that are called several times per row reuse
+ * the stored value.
+ */
+typedef enum
+{
+  ITERATOR_COLUMN_UNTYPED = 0, ///< Convert on each access (the default).
+  ITERATOR_COLUMN_INT64,       ///< Decode once per row as long long int.
+  ITERATOR_COLUMN_DOUBLE,      ///< Decode once per row as double.
+  ITERATOR_COLUMN_TEXT         ///< Fetch once per row as text.
+} iterator_column_type_t;
+
+/**
+ * @brief A column value decoded by next.
+ */
+typedef union
+{
+  long long int value_int64; ///< Value for ITERATOR_COLUMN_INT64.
+  double value_double;       ///< Value for ITERATOR_COLUMN_DOUBLE.
+  const char *value_text;    ///< Value for ITERATOR_COLUMN_TEXT.  Valid
+                             ///< until the iterator is advanced.
+} iterator_value_t;
+
 /**
  * @brief A generic SQL iterator structure.
  */
@@ -51,6 +78,9 @@ struct iterator
   sql_stmt_t *stmt;          ///< SQL statement.
   gboolean done;             ///< End flag.
   lsc_crypt_ctx_t crypt_ctx; ///< Encryption context.
+  iterator_column_type_t *column_types; ///< Declared column types, or NULL.
+  int column_types_size;     ///< Length of column_types and row.
+  iterator_value_t *row;     ///< Columns decoded by next.
 };
 
 /**
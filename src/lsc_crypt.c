@@ -49,6 +49,14 @@
  */
 #define MAX_VALUE_LENGTH  (128 * 1024)
 
+/**
+ * @brief The maximum number of decryption results cached per context
+ *
+ * Each cached result keeps the plaintext of one credential in memory,
+ * so the cache is kept small.
+ */
+#define DECRYPT_CACHE_SIZE 64
+
 
 #ifndef GPG_ERR_AMBIGUOUS
 /**
@@ -72,6 +80,18 @@ struct namelist_s
   char name[1];            ///< The name.
 };
 
+/**
+ * @brief  A cached decryption result.
+ */
+struct decrypt_cache_s
+{
+  struct decrypt_cache_s *next; ///< Next element in list
+  char *cipherstring;          ///< The base64 ciphertext this came from.
+  char *plaintext;             ///< The decrypted plaintext.
+  size_t plaintextlen;         ///< Length of plaintext.
+  struct namelist_s *namelist; ///< Info describing PLAINTEXT.
+};
+
 /**
  * @brief The context object for encryption operations
  *
@@ -82,9 +102,8 @@ struct lsc_crypt_ctx_s
 {
   gpgme_ctx_t encctx;          ///< Encryption context.
   gpgme_key_t enckey;          ///< The key to be used for encryption.
-  char *plaintext;             ///< Text to be encrypted.
-  size_t plaintextlen;         ///< Length of text.
-  struct namelist_s *namelist; ///< Info describing PLAINTEXT.
+  struct decrypt_cache_s *cache; ///< Decryption results, most recent first.
+  int cache_count;             ///< Number of elements in CACHE.
   gchar *enckey_uid;           ///< Encryption key UID to use.
 };
 
@@ -586,13 +605,41 @@ lsc_crypt_release (lsc_crypt_ctx_t ctx)
 }
 
 
+/**
+ * @brief Scrub and release a cached decryption result
+ *
+ * The plaintext and any copied values hold credentials in the clear,
+ * thus they are wiped before the memory is released.
+ *
+ * @param[in]  cache  The cache entry.
+ */
+static void
+decrypt_cache_free (struct decrypt_cache_s *cache)
+{
+  while (cache->namelist)
+    {
+      struct namelist_s *nl = cache->namelist->next;
+      if (cache->namelist->value)
+        memset (cache->namelist->value, 0, strlen (cache->namelist->value));
+      g_free (cache->namelist->value);
+      g_free (cache->namelist);
+      cache->namelist = nl;
+    }
+  if (cache->plaintext)
+    memset (cache->plaintext, 0, cache->plaintextlen);
+  g_free (cache->plaintext);
+  g_free (cache->cipherstring);
+  g_free (cache);
+}
+
 /**
  * @brief Flush an LSC encryption context
  *
  * This function is used to flush the context.  The flushing
- * invalidates returned strings and internal caches.  Basically this
- * is the same as releasing and creating the context but it is
- * optimized to keep some internal state.
+ * invalidates returned strings, and scrubs and drops the cached
+ * decryption results.  Basically this is the same as releasing and
+ * creating the context but it is optimized to keep some internal
+ * state.
  *
  * @param[in]  ctx  The context or NULL
  */
@@ -601,15 +648,13 @@ lsc_crypt_flush (lsc_crypt_ctx_t ctx)
 {
   if (!ctx)
     return;
-  while (ctx->namelist)
+  while (ctx->cache)
     {
-      struct namelist_s *nl = ctx->namelist->next;
-      g_free (ctx->namelist->value);
-      g_free (ctx->namelist);
-      ctx->namelist = nl;
+      struct decrypt_cache_s *next = ctx->cache->next;
+      decrypt_cache_free (ctx->cache);
+      ctx->cache = next;
     }
-  g_free (ctx->plaintext);
-  ctx->plaintext = NULL;
+  ctx->cache_count = 0;
 }
 
 /**
@@ -784,20 +829,21 @@ lsc_crypt_encrypt (lsc_crypt_ctx_t ctx, const char *first_name, ...)
  * @brief Return an encrypted value in the clear.
  *
  * This function returns the encrypted value in the clear.  The
- * clear value may also be NULL , if no value is available.  If a
- * decryption has not yet been done, the passed \a ciphertext value is
- * first decrypted.  Thus a changed value of ciphertext may not have
- * an effect.  To force a decryption a call to \ref lsc_crypt_flush is
- * required.
+ * clear value may also be NULL , if no value is available.  The
+ * decryption result of each ciphertext is cached in the context, so
+ * repeated reads of the same credential decrypt only once.  The cache
+ * is bounded; when it is full the least recently used result is
+ * scrubbed and dropped.
  *
  * @param[in]  ctx  The context
  * @param[in]  ciphertext  The base64 encoded ciphertext.
  * @param[in]  name  Name of the value to get.
  *
  * @return A const pointer to a string object.  This pointer is valid
- *         as long as the context is valid and \ref lsc_crypt_flush
- *         has not been called.  If no value is available NULL is
- *         returned.
+ *         as long as the context is valid, \ref lsc_crypt_flush has
+ *         not been called, and the result has not been dropped from
+ *         the cache by \ref DECRYPT_CACHE_SIZE more recent
+ *         decryptions.  If no value is available NULL is returned.
  */
 const char *
 lsc_crypt_decrypt (lsc_crypt_ctx_t ctx, const char *ciphertext,
@@ -809,6 +855,7 @@ lsc_crypt_decrypt (lsc_crypt_ctx_t ctx, const char *ciphertext,
   uint32_t n;
   int found;
   struct namelist_s *nl;
+  struct decrypt_cache_s *cache, **prev;
 
   if (!ctx || !name || !*name)
     return NULL;
@@ -823,29 +870,62 @@ lsc_crypt_decrypt (lsc_crypt_ctx_t ctx, const char *ciphertext,
       return NULL;
     }
 
-  if (!ctx->plaintext)
+  if (!ciphertext)
+    return NULL;
+
+  /* Find the cached decryption of this ciphertext, moving it to the
+     front of the list.  */
+  for (prev = &ctx->cache; (cache = *prev); prev = &cache->next)
+    if (!strcmp (cache->cipherstring, ciphertext))
+      {
+        *prev = cache->next;
+        cache->next = ctx->cache;
+        ctx->cache = cache;
+        break;
+      }
+
+  if (!cache)
     {
-      if (!ciphertext)
-        return NULL;
-      ctx->plaintext = do_decrypt (ctx, ciphertext, &ctx->plaintextlen);
-      if (!ctx->plaintext)
+      char *plaintext;
+      size_t plaintextlen;
+
+      plaintext = do_decrypt (ctx, ciphertext, &plaintextlen);
+      if (!plaintext)
         return NULL;
+
+      /* Make room, scrubbing the least recently used result.  */
+      if (ctx->cache_count >= DECRYPT_CACHE_SIZE)
+        {
+          for (prev = &ctx->cache; (*prev)->next; prev = &(*prev)->next)
+            ;
+          decrypt_cache_free (*prev);
+          *prev = NULL;
+          ctx->cache_count--;
+        }
+
+      cache = g_malloc0 (sizeof *cache);
+      cache->cipherstring = g_strdup (ciphertext);
+      cache->plaintext = plaintext;
+      cache->plaintextlen = plaintextlen;
+      cache->next = ctx->cache;
+      ctx->cache = cache;
+      ctx->cache_count++;
     }
 
   /* Try to return it from the cache.  */
-  for (nl = ctx->namelist; nl; nl = nl->next)
+  for (nl = cache->namelist; nl; nl = nl->next)
     if (!strcmp (nl->name, name))
       {
         return nl->value
                 ? nl->value
-                : (nl->valoff ? (ctx->plaintext + nl->valoff) : NULL);
+                : (nl->valoff ? (cache->plaintext + nl->valoff) : NULL);
       }
 
   /* Cache miss: Parse the data, cache the result, and return it.  */
   /* Fixme: Cache a not found status.  */
   namelen = strlen (name);
-  p   = ctx->plaintext;
-  len = ctx->plaintextlen;
+  p   = cache->plaintext;
+  len = cache->plaintextlen;
   found = 0;
   while (len)
     {
@@ -885,7 +965,7 @@ lsc_crypt_decrypt (lsc_crypt_ctx_t ctx, const char *ciphertext,
                  byte of that name's length is 0.  Thus we don't need
                  to take a copy because that length byte acts as the
                  string terminator.  */
-              nl->valoff = (p - ctx->plaintext);
+              nl->valoff = (p - cache->plaintext);
               nl->value  = NULL;
             }
           else
@@ -897,9 +977,9 @@ lsc_crypt_decrypt (lsc_crypt_ctx_t ctx, const char *ciphertext,
               memcpy (nl->value, p, n);
               nl->value[n] = 0;
             }
-          nl->next = ctx->namelist;
-          ctx->namelist = nl;
-          return nl->value? nl->value : (ctx->plaintext + nl->valoff);
+          nl->next = cache->namelist;
+          cache->namelist = nl;
+          return nl->value? nl->value : (cache->plaintext + nl->valoff);
         }
       p += n; len -= n;
     }
@@ -909,7 +989,7 @@ lsc_crypt_decrypt (lsc_crypt_ctx_t ctx, const char *ciphertext,
  failed:
   g_warning ("%s: decrypted credential data block is inconsistent;"
              " %zu bytes remaining at offset %zu",
-             G_STRFUNC, len, (size_t)(p - ctx->plaintext));
+             G_STRFUNC, len, (size_t)(p - cache->plaintext));
  not_found:
   /* Cache a NULL value.  */
   nl = g_malloc (sizeof *nl + namelen);
@@ -922,8 +1002,8 @@ lsc_crypt_decrypt (lsc_crypt_ctx_t ctx, const char *ciphertext,
 #endif
   nl->valoff = 0;
   nl->value  = NULL;
-  nl->next = ctx->namelist;
-  ctx->namelist = nl;
+  nl->next = cache->namelist;
+  cache->namelist = nl;
   return NULL;
 }
 
@@ -932,11 +1012,9 @@ lsc_crypt_decrypt (lsc_crypt_ctx_t ctx, const char *ciphertext,
  * @brief Return an encrypted password in the clear.
  *
  * This function returns the encrypted password in the clear.  The
- * clear value may also be NULL , if no password is available.  If a
- * decryption has not yet been done, the passed \a ciphertext value is
- * first decrypted.  Thus a changed value of ciphertext may not have
- * an effect.  To force a decryption a call to \ref lsc_crypt_flush is
- * required.
+ * clear value may also be NULL , if no password is available.  The
+ * decryption result is cached in the context; see \ref
+ * lsc_crypt_decrypt.
  *
  * @param[in]  ctx  The context
  * @param[in]  ciphertext  The base64 encoded ciphertext.
@@ -956,11 +1034,9 @@ lsc_crypt_get_password (lsc_crypt_ctx_t ctx, const char *ciphertext)
  * @brief Return an encrypted private key in the clear.
  *
  * This function returns the encrypted private key in the clear.  The
- * clear value may also be NULL , if no private key is available.  If a
- * decryption has not yet been done, the passed \a ciphertext value is
- * first decrypted.  Thus a changed value of ciphertext may not have
- * an effect.  To force a decryption a call to \ref lsc_crypt_flush is
- * required.
+ * clear value may also be NULL , if no private key is available.  The
+ * decryption result is cached in the context; see \ref
+ * lsc_crypt_decrypt.
  *
  * @param[in]  ctx  The context
  * @param[in]  ciphertext  The base64 encoded ciphertext.
@@ -203,6 +203,16 @@ static int mem_wait_retries = 0;
  */
 static int min_mem_feed_update = 0;
 
+/**
+ * @brief Minimum available memory in MiB for starting a scheduled scan.
+ */
+static int min_mem_scan_start = 0;
+
+/**
+ * @brief Number of scheduled scan starts deferred because memory was low.
+ */
+static int scan_start_deferrals = 0;
+
 /**
  * @brief Path to the relay mapper executable, NULL to disable relays.
  */
@@ -690,6 +700,63 @@ truncate_text (gchar *string, size_t max_len, gboolean xml, const char *suffix)
     }
 }
 
+/**
+ * @brief Append text to a buffer, XML escaping it on the way.
+ *
+ * Spans that are free of XML metacharacters are copied in bulk, using
+ * strcspn which libc vectorises where the hardware allows.  This avoids
+ * the per character loop and per string allocation of
+ * g_markup_escape_text, which dominates when buffering the results of
+ * large reports.
+ *
+ * @param[in]  buffer  Buffer to append the escaped text to.
+ * @param[in]  string  The string to escape.
+ * @param[in]  length  The length of string in bytes, or -1 for the entire
+ *                     string.
+ */
+void
+xml_escape_text_append (GString *buffer, const char *string, gssize length)
+{
+  const char *pos, *end;
+
+  if (string == NULL)
+    return;
+
+  pos = string;
+  end = (length < 0) ? string + strlen (string) : string + length;
+  while (pos < end)
+    {
+      size_t span;
+
+      span = strcspn (pos, "&<>'\"");
+      if (span > (size_t) (end - pos))
+        span = end - pos;
+      g_string_append_len (buffer, pos, span);
+      pos += span;
+      if (pos >= end)
+        break;
+      switch (*pos)
+        {
+          case '&':
+            g_string_append (buffer, "&amp;");
+            break;
+          case '<':
+            g_string_append (buffer, "&lt;");
+            break;
+          case '>':
+            g_string_append (buffer, "&gt;");
+            break;
+          case '\'':
+            g_string_append (buffer, "&apos;");
+            break;
+          case '"':
+            g_string_append (buffer, "&quot;");
+            break;
+        }
+      pos++;
+    }
+}
+
 /**
  * @brief XML escapes text truncating to a maximum length with a suffix.
  *
@@ -706,12 +773,13 @@ gchar *
 xml_escape_text_truncated (const char *string, size_t max_len,
                            const char *suffix)
 {
-  gchar *escaped;
+  GString *escaped;
   gssize orig_len;
 
   orig_len = strlen (string);
+  escaped = g_string_sized_new (orig_len < max_len ? orig_len : max_len);
   if (orig_len <= max_len)
-    escaped = g_markup_escape_text (string, -1);
+    xml_escape_text_append (escaped, string, orig_len);
   else
     {
       gchar *offset_next;
@@ -720,11 +788,11 @@ xml_escape_text_truncated (const char *string, size_t max_len,
       offset_next = g_utf8_find_next_char (string + max_len,
                                            string + orig_len);
       offset = offset_next - string;
-      escaped = g_markup_escape_text (string, offset);
+      xml_escape_text_append (escaped, string, offset);
     }
 
-  truncate_text (escaped, max_len, TRUE, suffix);
-  return escaped;
+  truncate_text (escaped->str, max_len, TRUE, suffix);
+  return g_string_free (escaped, FALSE);
 }
 
 /**
@@ -1880,7 +1948,7 @@ osp_scan_semaphore_update_end (int add_result_on_error,
   if (max_concurrent_scan_updates == 0)
     return 0;
 
-  if (semaphore_op (SEMAPHORE_SCAN_UPDATE, +1, 0))
+  if (semaphore_scanner_op (task_scanner (task), +1, 0))
     {
       g_warning ("%s: error signaling scan update semaphore",
                 __func__);
@@ -1944,7 +2012,7 @@ handle_osp_scan (task_t task, report_t report, const char *scan_id)
 
       if (max_concurrent_scan_updates)
         {
-          sem_op_ret = semaphore_op (SEMAPHORE_SCAN_UPDATE, -1, 5);
+          sem_op_ret = semaphore_scanner_op (scanner, -1, 5);
           if (sem_op_ret == 1)
             continue;
           else if (sem_op_ret)
@@ -1964,10 +2032,12 @@ handle_osp_scan (task_t task, report_t report, const char *scan_id)
             }
         }
 
-      /* Get only the progress, without results and details. */
+      /* Get the scan progress and any results that arrived since the
+       * last poll.  The scanner pops the results it sends, so each fetch
+       * only carries results that have not been fetched before. */
+      char *report_xml = NULL;
       progress = get_osp_scan_report (scan_id, host, port, ca_pub, key_pub,
-                                      key_priv, 0, 0, NULL);
-
+                                      key_priv, 1, 1, &report_xml);
       if (progress < 0 || progress > 100)
         {
           if (retry > 0 && progress == -1)
@@ -1975,7 +2045,6 @@ handle_osp_scan (task_t task, report_t report, const char *scan_id)
               retry--;
               g_warning ("Connection lost with the scanner at %s. "
                          "Trying again in 1 second.", host);
-              gvm_sleep (1);
               if (osp_scan_semaphore_update_end (TRUE, task, report))
                 {
                   delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
@@ -1983,14 +2052,17 @@ handle_osp_scan (task_t task, report_t report, const char *scan_id)
                   rc = -3;
                   break;
                 }
+              gvm_sleep (1);
               continue;
             }
           else if (progress == -2)
             {
+              g_free (report_xml);
               osp_scan_semaphore_update_end (FALSE, task, report);
               rc = -2;
               break;
             }
+          g_free (report_xml);
           result_t result = make_osp_result
                              (task, "", "", "",
                               threat_message_type ("Error"),
@@ -2005,125 +2077,84 @@ handle_osp_scan (task_t task, report_t report, const char *scan_id)
         }
       else
         {
-          /* Get the full OSP report. */
-          char *report_xml = NULL;
-          progress = get_osp_scan_report (scan_id, host, port, ca_pub, key_pub,
-                                          key_priv, 1, 1, &report_xml);
-          if (progress < 0 || progress > 100)
+          set_report_slave_progress (report, progress);
+          parse_osp_report (task, report, report_xml);
+          g_free (report_xml);
+
+          osp_scan_status = get_osp_scan_status (scan_id, host, port,
+                                                 ca_pub, key_pub, key_priv);
+
+          if (osp_scan_status == OSP_SCAN_STATUS_QUEUED)
+            {
+              if (queued_status_updated == FALSE)
+                {
+                  set_task_run_status (task, TASK_STATUS_QUEUED);
+                  set_report_scan_run_status (global_current_report,
+                                              TASK_STATUS_QUEUED);
+                  queued_status_updated = TRUE;
+                }
+            }
+          else if (osp_scan_status == OSP_SCAN_STATUS_INTERRUPTED)
+            {
+              result_t result = make_osp_result
+                (task, "", "", "",
+                 threat_message_type ("Error"),
+                 "Task interrupted unexpectedly", "", "",
+                 QOD_DEFAULT, NULL, NULL);
+              report_add_result (report, result);
+              delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
+                               key_priv);
+              osp_scan_semaphore_update_end (FALSE, task, report);
+              rc = -3;
+              break;
+            }
+          else if (progress >= 0 && progress < 100
+              && osp_scan_status == OSP_SCAN_STATUS_STOPPED)
             {
-              if (retry > 0 && progress == -1)
+              if (retry > 0)
                 {
                   retry--;
                   g_warning ("Connection lost with the scanner at %s. "
                              "Trying again in 1 second.", host);
                   if (osp_scan_semaphore_update_end (TRUE, task, report))
                     {
-                      delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
-                                       key_priv);
+                      delete_osp_scan (scan_id, host, port, ca_pub,
+                                       key_pub, key_priv);
                       rc = -3;
                       break;
                     }
                   gvm_sleep (1);
                   continue;
                 }
-              else if (progress == -2)
-                {
-                  osp_scan_semaphore_update_end (FALSE, task, report);
-                  rc = -2;
-                  break;
-                }
-              g_free (report_xml);
+
               result_t result = make_osp_result
-                                 (task, "", "", "",
-                                  threat_message_type ("Error"),
-                                  "Erroneous scan progress value", "", "",
-                                  QOD_DEFAULT, NULL, NULL);
+                (task, "", "", "",
+                 threat_message_type ("Error"),
+                 "Scan stopped unexpectedly by the server", "", "",
+                 QOD_DEFAULT, NULL, NULL);
               report_add_result (report, result);
+              delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
+                               key_priv);
               osp_scan_semaphore_update_end (FALSE, task, report);
               rc = -1;
               break;
             }
-          else
+          else if (progress == 100
+                   && osp_scan_status == OSP_SCAN_STATUS_FINISHED)
             {
-              set_report_slave_progress (report, progress);
-              parse_osp_report (task, report, report_xml);
-              g_free (report_xml);
-
-              osp_scan_status = get_osp_scan_status (scan_id, host, port,
-                                                     ca_pub, key_pub, key_priv);
-
-              if (osp_scan_status == OSP_SCAN_STATUS_QUEUED)
-                {
-                  if (queued_status_updated == FALSE)
-                    {
-                      set_task_run_status (task, TASK_STATUS_QUEUED);
-                      set_report_scan_run_status (global_current_report,
-                                                  TASK_STATUS_QUEUED);
-                      queued_status_updated = TRUE;
-                    }
-                }
-              else if (osp_scan_status == OSP_SCAN_STATUS_INTERRUPTED)
-                {
-                  result_t result = make_osp_result
-                    (task, "", "", "",
-                     threat_message_type ("Error"),
-                     "Task interrupted unexpectedly", "", "",
-                     QOD_DEFAULT, NULL, NULL);
-                  report_add_result (report, result);
-                  delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
-                                   key_priv);
-                  osp_scan_semaphore_update_end (FALSE, task, report);
-                  rc = -3;
-                  break;
-                }
-              else if (progress >= 0 && progress < 100
-                  && osp_scan_status == OSP_SCAN_STATUS_STOPPED)
-                {
-                  if (retry > 0)
-                    {
-                      retry--;
-                      g_warning ("Connection lost with the scanner at %s. "
-                                 "Trying again in 1 second.", host);
-                      if (osp_scan_semaphore_update_end (TRUE, task, report))
-                        {
-                          delete_osp_scan (scan_id, host, port, ca_pub,
-                                           key_pub, key_priv);
-                          rc = -3;
-                          break;
-                        }
-                      gvm_sleep (1);
-                      continue;
-                    }
-
-                  result_t result = make_osp_result
-                    (task, "", "", "",
-                     threat_message_type ("Error"),
-                     "Scan stopped unexpectedly by the server", "", "",
-                     QOD_DEFAULT, NULL, NULL);
-                  report_add_result (report, result);
-                  delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
-                                   key_priv);
-                  osp_scan_semaphore_update_end (FALSE, task, report);
-                  rc = -1;
-                  break;
-                }
-              else if (progress == 100
-                       && osp_scan_status == OSP_SCAN_STATUS_FINISHED)
-                {
-                  delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
-                                   key_priv);
-                  osp_scan_semaphore_update_end (FALSE, task, report);
-                  rc = 0;
-                  break;
-                }
-              else if (osp_scan_status == OSP_SCAN_STATUS_RUNNING
-                       && started == FALSE)
-                {
-                  set_task_run_status (task, TASK_STATUS_RUNNING);
-                  set_report_scan_run_status (global_current_report,
-                                              TASK_STATUS_RUNNING);
-                  started = TRUE;
-                }
+              delete_osp_scan (scan_id, host, port, ca_pub, key_pub,
+                               key_priv);
+              osp_scan_semaphore_update_end (FALSE, task, report);
+              rc = 0;
+              break;
+            }
+          else if (osp_scan_status == OSP_SCAN_STATUS_RUNNING
+                   && started == FALSE)
+            {
+              set_task_run_status (task, TASK_STATUS_RUNNING);
+              set_report_scan_run_status (global_current_report,
+                                          TASK_STATUS_RUNNING);
+              started = TRUE;
             }
         }
 
@@ -2999,27 +3030,29 @@ fork_osp_scan_handler (task_t task, target_t target, int from,
   g_free (report_id);
   if (rc == 0)
     {
+      scanner_t scanner = task_scanner (task);
+
       set_task_run_status (task, TASK_STATUS_PROCESSING);
       set_report_scan_run_status (global_current_report,
                                   TASK_STATUS_PROCESSING);
 
       if (max_concurrent_scan_updates)
-        semaphore_op (SEMAPHORE_SCAN_UPDATE, -1, 0);
+        semaphore_scanner_op (scanner, -1, 0);
       hosts_set_identifiers (global_current_report);
       if (max_concurrent_scan_updates)
-        semaphore_op (SEMAPHORE_SCAN_UPDATE, +1, 0);
+        semaphore_scanner_op (scanner, +1, 0);
 
       if (max_concurrent_scan_updates)
-        semaphore_op (SEMAPHORE_SCAN_UPDATE, -1, 0);
+        semaphore_scanner_op (scanner, -1, 0);
       hosts_set_max_severity (global_current_report, NULL, NULL);
       if (max_concurrent_scan_updates)
-        semaphore_op (SEMAPHORE_SCAN_UPDATE, +1, 0);
+        semaphore_scanner_op (scanner, +1, 0);
 
       if (max_concurrent_scan_updates)
-        semaphore_op (SEMAPHORE_SCAN_UPDATE, -1, 0);
+        semaphore_scanner_op (scanner, -1, 0);
       hosts_set_details (global_current_report);
       if (max_concurrent_scan_updates)
-        semaphore_op (SEMAPHORE_SCAN_UPDATE, +1, 0);
+        semaphore_scanner_op (scanner, +1, 0);
 
       set_task_run_status (task, TASK_STATUS_DONE);
       set_report_scan_run_status (global_current_report, TASK_STATUS_DONE);
@@ -3383,6 +3416,251 @@ cve_scan_report_host_json (task_t task,
   cleanup_iterator (&host_details_cpe);
 }
 
+/**
+ * @brief Collect a host of a CVE "scan" for set based matching.
+ *
+ * Resolves the newest asset report host of the target host and records
+ * it in the cve_scan_hosts table for cve_scan_bulk.  Hosts without an
+ * asset report host are simply skipped, like in the per host scan.
+ *
+ * @param[in]  gvm_host  Host.
+ *
+ * @return 0 success, 1 failed to get nthlast report for the host.
+ */
+static int
+cve_scan_collect_host (gvm_host_t *gvm_host)
+{
+  report_host_t report_host;
+  gchar *ip, *host;
+
+  host = gvm_host_value_str (gvm_host);
+
+  ip = report_host_ip (host);
+  if (ip == NULL)
+    ip = g_strdup (host);
+  g_free (host);
+
+  /* Get the last report host that applies to the host IP address. */
+
+  if (host_nthlast_report_host (ip, &report_host, 1))
+    {
+      g_warning ("%s: Failed to get nthlast report", __func__);
+      g_free (ip);
+      return 1;
+    }
+
+  if (report_host)
+    {
+      gchar *quoted_ip;
+
+      quoted_ip = sql_quote (ip);
+      sql ("INSERT INTO cve_scan_hosts (ip, report_host)"
+           " VALUES ('%s', %llu);",
+           quoted_ip, report_host);
+      g_free (quoted_ip);
+    }
+
+  g_free (ip);
+  return 0;
+}
+
+/**
+ * @brief Perform a CVE "scan" on all collected hosts in one pass.
+ *
+ * Joins the detected products of every host in cve_scan_hosts against
+ * the flattened affected_products table at once and bulk inserts the
+ * host details and results, instead of matching host by host and CPE by
+ * CPE.  The report hosts, details, result descriptions and result rows
+ * are the same ones the per host scan produces.
+ *
+ * @param[in]  task        Task.
+ * @param[in]  report      The report to add the hosts, results and details to.
+ * @param[in]  start_time  Start time of the scan.
+ */
+static void
+cve_scan_bulk (task_t task, report_t report, int start_time)
+{
+  iterator_t rows;
+  GArray *results;
+  int index;
+  const char *copied_details[] = { "hostname", "best_os_cpe", "best_os_txt" };
+
+  /* Match every host's products against the CVEs in a single pass. */
+
+  sql ("CREATE TEMPORARY TABLE cve_scan_matches AS"
+       " SELECT cve_scan_hosts.ip AS ip,"
+       "        cve_scan_hosts.report_host AS report_host,"
+       "        cpes.name AS app,"
+       "        cves.name AS cve,"
+       "        max (cves.severity) AS severity,"
+       "        max (cves.description) AS description,"
+       "        cves.id AS cve_id"
+       " FROM cve_scan_hosts, report_host_details, scap.cpes,"
+       "      scap.affected_products, scap.cves"
+       " WHERE report_host_details.report_host = cve_scan_hosts.report_host"
+       " AND report_host_details.name = 'App'"
+       " AND LOWER (cpes.name) = LOWER (report_host_details.value)"
+       " AND cpes.id = affected_products.cpe"
+       " AND cves.id = affected_products.cve"
+       " GROUP BY cves.id, cve_scan_hosts.ip, cve_scan_hosts.report_host,"
+       "          cpes.name, cves.name;");
+
+  sql ("ALTER TABLE cve_scan_matches ADD COLUMN locations text;");
+  sql ("UPDATE cve_scan_matches"
+       " SET locations = (SELECT string_agg (DISTINCT value, ', ')"
+       "                  FROM report_host_details"
+       "                  WHERE report_host = cve_scan_matches.report_host"
+       "                  AND name = cve_scan_matches.app"
+       "                  AND source_type = 'nvt'"
+       "                  AND source_name"
+       "                      IN (SELECT source_name"
+       "                          FROM report_host_details"
+       "                          WHERE report_host"
+       "                                = cve_scan_matches.report_host"
+       "                          AND source_type = 'nvt'"
+       "                          AND name = 'App'"
+       "                          AND value = cve_scan_matches.app));");
+
+  /* Add a report host for every host with a match. */
+
+  sql ("INSERT INTO report_hosts"
+       " (report, host, start_time, end_time, current_port, max_port)"
+       " SELECT DISTINCT %llu, ip, %i, 0, 0, 0"
+       " FROM cve_scan_matches;",
+       report, start_time);
+
+  /* Add the host details of every match. */
+
+  sql ("INSERT INTO report_host_details"
+       " (report_host, source_type, source_name, source_description, name,"
+       "  value, hash_value)"
+       " SELECT report_hosts.id, 'cve', cve_scan_matches.cve, 'CVE Scanner',"
+       "        'App', cve_scan_matches.app, ''"
+       " FROM cve_scan_matches, report_hosts"
+       " WHERE report_hosts.report = %llu"
+       " AND report_hosts.host = cve_scan_matches.ip;",
+       report);
+
+  sql ("INSERT INTO report_host_details"
+       " (report_host, source_type, source_name, source_description, name,"
+       "  value, hash_value)"
+       " SELECT report_hosts.id, 'cve', cve_scan_matches.cve, 'CVE Scanner',"
+       "        cve_scan_matches.app, cve_scan_matches.locations, ''"
+       " FROM cve_scan_matches, report_hosts"
+       " WHERE cve_scan_matches.locations IS NOT NULL"
+       " AND report_hosts.report = %llu"
+       " AND report_hosts.host = cve_scan_matches.ip;",
+       report);
+
+  sql ("INSERT INTO report_host_details"
+       " (report_host, source_type, source_name, source_description, name,"
+       "  value, hash_value)"
+       " SELECT report_hosts.id, 'cve', cve_scan_matches.cve, 'CVE Scanner',"
+       "        'detected_at', cve_scan_matches.locations, ''"
+       " FROM cve_scan_matches, report_hosts"
+       " WHERE cve_scan_matches.locations IS NOT NULL"
+       " AND report_hosts.report = %llu"
+       " AND report_hosts.host = cve_scan_matches.ip;",
+       report);
+
+  sql ("INSERT INTO report_host_details"
+       " (report_host, source_type, source_name, source_description, name,"
+       "  value, hash_value)"
+       " SELECT report_hosts.id, 'cve', cve_scan_matches.cve, 'CVE Scanner',"
+       /*      Detected by itself. */
+       "        'detected_by', cve_scan_matches.cve, ''"
+       " FROM cve_scan_matches, report_hosts"
+       " WHERE cve_scan_matches.locations IS NOT NULL"
+       " AND report_hosts.report = %llu"
+       " AND report_hosts.host = cve_scan_matches.ip;",
+       report);
+
+  /* Make the results. */
+
+  sql ("INSERT INTO result_nvts (nvt)"
+       " SELECT DISTINCT cve FROM cve_scan_matches"
+       " ON CONFLICT DO NOTHING;");
+
+  results = g_array_new (TRUE, TRUE, sizeof (result_t));
+  init_iterator (&rows,
+                 "INSERT INTO results"
+                 " (owner, date, task, host, port, nvt, nvt_version,"
+                 "  severity, type, description, uuid, qod, qod_type, path,"
+                 "  result_nvt)"
+                 " SELECT NULL, m_now (), %llu, ip, '', cve,"
+                 "        (SELECT iso_time (modification_time)"
+                 "         FROM scap.cves"
+                 "         WHERE uuid = cve_scan_matches.cve),"
+                 "        severity, severity_to_type (severity),"
+                 "        'The host carries the product: ' || app || E'\\n'"
+                 "        || 'It is vulnerable according to: ' || cve"
+                 "        || E'.\\n'"
+                 "        || CASE WHEN locations IS NULL OR locations = ''"
+                 "           THEN ''"
+                 "           ELSE 'The product was found at: ' || locations"
+                 "                || E'.\\n'"
+                 "           END"
+                 "        || E'\\n' || description,"
+                 "        make_uuid (), %i, '', '',"
+                 "        (SELECT id FROM result_nvts"
+                 "         WHERE nvt = cve_scan_matches.cve)"
+                 " FROM cve_scan_matches"
+                 " ORDER BY cve_id ASC"
+                 " RETURNING id;",
+                 task,
+                 QOD_DEFAULT);
+  while (next (&rows))
+    {
+      result_t result;
+
+      result = iterator_int64 (&rows, 0);
+      g_array_append_val (results, result);
+    }
+  cleanup_iterator (&rows);
+  report_add_results_array (report, results);
+  g_array_free (results, TRUE);
+
+  /* Complete the report hosts. */
+
+  for (index = 0; index < 3; index++)
+    sql ("INSERT INTO report_host_details"
+         " (report_host, source_type, source_name, source_description, name,"
+         "  value, hash_value)"
+         " SELECT report_hosts.id, 'cve', '', 'CVE Scanner', detail.name,"
+         "        detail.value, ''"
+         " FROM (SELECT DISTINCT ip, report_host FROM cve_scan_matches)"
+         "      AS hosts,"
+         "      report_hosts,"
+         "      LATERAL (SELECT name, value FROM report_host_details"
+         "               WHERE report_host = hosts.report_host"
+         "               AND name = '%s'"
+         "               ORDER BY id DESC LIMIT 1) AS detail"
+         " WHERE report_hosts.report = %llu"
+         " AND report_hosts.host = hosts.ip;",
+         copied_details[index],
+         report);
+
+  sql ("INSERT INTO report_host_details"
+       " (report_host, source_type, source_name, source_description, name,"
+       "  value, hash_value)"
+       " SELECT report_hosts.id, 'cve', '', 'CVE Scanner', 'CVE Scan', '1',"
+       "        ''"
+       " FROM report_hosts"
+       " WHERE report_hosts.report = %llu"
+       " AND report_hosts.host IN (SELECT ip FROM cve_scan_matches);",
+       report);
+
+  sql ("UPDATE report_hosts SET end_time = m_now ()"
+       " WHERE report = %llu"
+       " AND host IN (SELECT ip FROM cve_scan_matches);",
+       report);
+
+  if (sql_int ("SELECT count (*) FROM cve_scan_matches;"))
+    update_report_modification_time (report);
+
+  sql ("DROP TABLE cve_scan_matches;");
+}
+
 /**
  * @brief Perform a CVE "scan" on a host.
  *
@@ -3686,17 +3964,46 @@ fork_cve_scan_handler (task_t task, target_t target)
     }
   free (exclude_hosts);
 
-  while ((gvm_host = gvm_hosts_next (gvm_hosts)))
-    if (cve_scan_host (task, global_current_report, gvm_host))
-      {
-        set_task_interrupted (task,
-                              "Failed to get nthlast report."
-                              "  Interrupting scan.");
-        set_report_scan_run_status (global_current_report, TASK_STATUS_INTERRUPTED);
-        gvm_hosts_free (gvm_hosts);
-        gvm_close_sentry ();
-        exit (1);
-      }
+  if (sql_int64_0 ("SELECT count(1) FROM information_schema.tables"
+                   " WHERE table_schema = 'scap'"
+                   " AND table_name = 'cpe_match_nodes';") > 0)
+    {
+      // Use new JSON CVE scan
+      while ((gvm_host = gvm_hosts_next (gvm_hosts)))
+        if (cve_scan_host (task, global_current_report, gvm_host))
+          {
+            set_task_interrupted (task,
+                                  "Failed to get nthlast report."
+                                  "  Interrupting scan.");
+            set_report_scan_run_status (global_current_report, TASK_STATUS_INTERRUPTED);
+            gvm_hosts_free (gvm_hosts);
+            gvm_close_sentry ();
+            exit (1);
+          }
+    }
+  else
+    {
+      /* Use XML CVE scan, matching all the hosts in one pass. */
+
+      sql ("CREATE TEMPORARY TABLE cve_scan_hosts"
+           " (ip text, report_host bigint);");
+
+      while ((gvm_host = gvm_hosts_next (gvm_hosts)))
+        if (cve_scan_collect_host (gvm_host))
+          {
+            set_task_interrupted (task,
+                                  "Failed to get nthlast report."
+                                  "  Interrupting scan.");
+            set_report_scan_run_status (global_current_report, TASK_STATUS_INTERRUPTED);
+            gvm_hosts_free (gvm_hosts);
+            gvm_close_sentry ();
+            exit (1);
+          }
+
+      cve_scan_bulk (task, global_current_report, time (NULL));
+
+      sql ("DROP TABLE cve_scan_hosts;");
+    }
   gvm_hosts_free (gvm_hosts);
 
   /* Set the end states. */
@@ -5140,225 +5447,324 @@ scheduled_task_free (scheduled_task_t *scheduled_task)
 }
 
 /**
- * @brief Start a task, for the scheduler.
+ * @brief Update the schedule of a task that the scheduler has started.
  *
- * @param[in]  scheduled_task   Scheduled task.
+ * @param[in]  task_uuid  UUID of the task.
+ */
+static void
+scheduled_task_started (const gchar *task_uuid)
+{
+  schedule_t schedule;
+  int periods;
+
+  schedule = task_schedule_uuid (task_uuid);
+  if (schedule
+      && schedule_period (schedule) == 0
+      && schedule_duration (schedule) == 0
+      /* Check next time too, in case the user changed the schedule
+       * after this task was added to the "starts" list. */
+      && task_schedule_next_time_uuid (task_uuid) == 0)
+    /* A once-off schedule without a duration, remove it from the task.
+     * If it has a duration it will be removed by manage_schedule via
+     * clear_duration_schedules, after the duration. */
+    set_task_schedule_uuid (task_uuid, 0, -1);
+  else if ((periods = task_schedule_periods_uuid (task_uuid)))
+    {
+      /* A task restricted to a certain number of scheduled runs. */
+      if (periods > 1)
+        {
+          set_task_schedule_periods (task_uuid, periods - 1);
+        }
+      else if (periods == 1
+               && schedule_duration (schedule) == 0)
+        {
+          /* Last run of a task restricted to a certain number of
+           * scheduled runs. */
+          set_task_schedule_uuid (task_uuid, 0, 1);
+        }
+      else if (periods == 1)
+        /* Flag that the task has started, for
+         * update_duration_schedule_periods. */
+        set_task_schedule_next_time_uuid (task_uuid, 0);
+    }
+}
+
+/**
+ * @brief Start the tasks of one owner, for the scheduler.
+ *
+ * Forks a single child connected to the Manager which authenticates
+ * once and starts the tasks back-to-back, reporting the result of each
+ * start over a pipe.
+ *
+ * Consumes the list and the scheduled tasks.
+ *
+ * @param[in]  owner_tasks      Scheduled tasks, all of the same owner.
  * @param[in]  fork_connection  Function that forks a child which is connected
  *                              to the Manager.  Must return PID in parent, 0
  *                              in child, or -1 on error.
- * @param[in]  sigmask_current  Sigmask to restore in child.
- *
- * @return 0 success, -1 error.  Child does not return.
  */
-static int
-scheduled_task_start (scheduled_task_t *scheduled_task,
-                      manage_connection_forker_t fork_connection,
-                      sigset_t *sigmask_current)
+static void
+scheduled_owner_tasks_start (GSList *owner_tasks,
+                             manage_connection_forker_t fork_connection)
 {
-  int pid;
+  scheduled_task_t *first;
   gvm_connection_t connection;
   gmp_authenticate_info_opts_t auth_opts;
+  GSList *point;
+  GHashTable *started_uuids;
+  int pipe_fds[2], pid, status;
+  FILE *stream;
+  char line[128];
 
-  /* Fork a child to start the task and wait for the response, so that the
-   * parent can return to the main loop.  Only the parent returns. */
+  first = owner_tasks->data;
 
-  pid = fork ();
-  switch (pid)
+  if (pipe (pipe_fds))
     {
-      case 0:
-        /* Child.  Carry on to start the task, reopen the database (required
-         * after fork). */
-
-        /* Restore the sigmask that was blanked for pselect. */
-        pthread_sigmask (SIG_SETMASK, sigmask_current, NULL);
-
-        init_sentry ();
-        reinit_manage_process ();
-        manage_session_init (current_credentials.uuid);
-        break;
-
-      case -1:
-        /* Parent on error. */
-        g_warning ("%s: fork failed", __func__);
-        return -1;
-
-      default:
-        /* Parent.  Continue to next task. */
-        g_debug ("%s: %i forked %i", __func__, getpid (), pid);
-        return 0;
+      g_warning ("%s: pipe: %s", __func__, strerror (errno));
+      for (point = owner_tasks; point; point = point->next)
+        reschedule_task (((scheduled_task_t *) point->data)->task_uuid);
+      g_slist_free_full (owner_tasks, (GDestroyNotify) scheduled_task_free);
+      return;
     }
 
   /* Run the callback to fork a child connected to the Manager. */
 
-  pid = fork_connection (&connection, scheduled_task->owner_uuid);
+  pid = fork_connection (&connection, first->owner_uuid);
   switch (pid)
     {
       case 0:
-        /* Child.  Break, start task, exit. */
-        break;
+        /* Child.  Start the tasks over one connection, then exit. */
 
-      case -1:
-        /* Parent on error. */
-        g_warning ("%s: fork_connection failed", __func__);
-        reschedule_task (scheduled_task->task_uuid);
-        scheduled_task_free (scheduled_task);
-        gvm_close_sentry ();
-        exit (EXIT_FAILURE);
-        break;
+        close (pipe_fds[0]);
+        stream = fdopen (pipe_fds[1], "w");
+        if (stream == NULL)
+          {
+            g_warning ("%s: fdopen: %s", __func__, strerror (errno));
+            gvm_connection_free (&connection);
+            gvm_close_sentry ();
+            exit (EXIT_FAILURE);
+          }
 
-      default:
-        {
-          int status;
+        setproctitle ("scheduler: starting tasks of %s", first->owner_name);
 
-          /* Parent.  Wait for child, to check return. */
+        auth_opts = gmp_authenticate_info_opts_defaults;
+        auth_opts.username = first->owner_name;
+        if (gmp_authenticate_info_ext_c (&connection, auth_opts))
+          {
+            /* No results are written, so the parent reschedules all. */
+            g_warning ("%s: gmp_authenticate failed", __func__);
+            fclose (stream);
+            gvm_connection_free (&connection);
+            gvm_close_sentry ();
+            exit (EXIT_FAILURE);
+          }
 
-          setproctitle ("scheduler: waiting for %i", pid);
+        for (point = owner_tasks; point; point = point->next)
+          {
+            scheduled_task_t *scheduled_task = point->data;
+            int started;
 
-          g_debug ("%s: %i fork_connectioned %i",
-                   __func__, getpid (), pid);
+            setproctitle ("scheduler: starting %s",
+                          scheduled_task->task_uuid);
 
-          if (signal (SIGCHLD, SIG_DFL) == SIG_ERR)
-            g_warning ("%s: failed to set SIGCHLD", __func__);
-          while (waitpid (pid, &status, 0) < 0)
-            {
-              if (errno == ECHILD)
-                {
-                  g_warning ("%s: Failed to get child exit,"
-                             " so task '%s' may not have been scheduled",
-                             __func__,
-                             scheduled_task->task_uuid);
-                  scheduled_task_free (scheduled_task);
-                  gvm_close_sentry ();
-                  exit (EXIT_FAILURE);
-                }
-              if (errno == EINTR)
-                continue;
-              g_warning ("%s: waitpid: %s",
-                         __func__,
-                         strerror (errno));
-              g_warning ("%s: As a result, task '%s' may not have been"
-                         " scheduled",
-                         __func__,
-                         scheduled_task->task_uuid);
-              scheduled_task_free (scheduled_task);
-              gvm_close_sentry ();
-              exit (EXIT_FAILURE);
-            }
-          if (WIFEXITED (status))
-            switch (WEXITSTATUS (status))
+            started = 1;
+            if (gmp_resume_task_report_c (&connection,
+                                          scheduled_task->task_uuid,
+                                          NULL))
               {
-                case EXIT_SUCCESS:
+                gmp_start_task_opts_t opts;
+
+                opts = gmp_start_task_opts_defaults;
+                opts.task_id = scheduled_task->task_uuid;
+
+                switch (gmp_start_task_ext_c (&connection, opts))
                   {
-                    schedule_t schedule;
-                    int periods;
-                    const gchar *task_uuid;
-
-                    /* Child succeeded, so task successfully started. */
-
-                    task_uuid = scheduled_task->task_uuid;
-                    schedule = task_schedule_uuid (task_uuid);
-                    if (schedule
-                        && schedule_period (schedule) == 0
-                        && schedule_duration (schedule) == 0
-                        /* Check next time too, in case the user changed
-                         * the schedule after this task was added to the
-                         * "starts" list. */
-                        && task_schedule_next_time_uuid (task_uuid) == 0)
-                      /* A once-off schedule without a duration, remove
-                       * it from the task.  If it has a duration it
-                       * will be removed by manage_schedule via
-                       * clear_duration_schedules, after the duration. */
-                      set_task_schedule_uuid (task_uuid, 0, -1);
-                    else if ((periods = task_schedule_periods_uuid
-                                         (task_uuid)))
-                      {
-                        /* A task restricted to a certain number of
-                         * scheduled runs. */
-                        if (periods > 1)
-                          {
-                            set_task_schedule_periods (task_uuid,
-                                                       periods - 1);
-                          }
-                        else if (periods == 1
-                                 && schedule_duration (schedule) == 0)
-                          {
-                            /* Last run of a task restricted to a certain
-                             * number of scheduled runs. */
-                            set_task_schedule_uuid (task_uuid, 0, 1);
-                          }
-                        else if (periods == 1)
-                          /* Flag that the task has started, for
-                           * update_duration_schedule_periods. */
-                          set_task_schedule_next_time_uuid (task_uuid, 0);
-                      }
-                  }
-                  scheduled_task_free (scheduled_task);
-                  gvm_close_sentry ();
-                  exit (EXIT_SUCCESS);
+                    case 0:
+                      break;
 
-                case EXIT_FAILURE:
-                default:
-                  break;
+                    case 99:
+                      /* Report the task as handled, so that the parent
+                       * stops trying to start it. */
+                      g_warning ("%s: user denied permission to start task",
+                                 __func__);
+                      break;
+
+                    default:
+                      g_warning ("%s: gmp_start_task and gmp_resume_task"
+                                 " failed", __func__);
+                      started = 0;
+                  }
               }
 
-          /* Child failed, reset task schedule time and exit. */
+            fprintf (stream, "%i %s\n", started, scheduled_task->task_uuid);
+          }
 
-          g_warning ("%s: child failed", __func__);
-          reschedule_task (scheduled_task->task_uuid);
-          scheduled_task_free (scheduled_task);
-          gvm_close_sentry ();
-          exit (EXIT_FAILURE);
-        }
+        fclose (stream);
+        g_slist_free_full (owner_tasks, (GDestroyNotify) scheduled_task_free);
+        gvm_connection_free (&connection);
+        gvm_close_sentry ();
+        exit (EXIT_SUCCESS);
+
+      case -1:
+        /* Parent on error. */
+        g_warning ("%s: fork_connection failed", __func__);
+        close (pipe_fds[0]);
+        close (pipe_fds[1]);
+        for (point = owner_tasks; point; point = point->next)
+          reschedule_task (((scheduled_task_t *) point->data)->task_uuid);
+        g_slist_free_full (owner_tasks, (GDestroyNotify) scheduled_task_free);
+        return;
+
+      default:
+        /* Parent.  Read the start results, wait for the child. */
+        break;
     }
 
-  /* Start the task. */
+  setproctitle ("scheduler: waiting for %i", pid);
 
-  setproctitle ("scheduler: starting %s", scheduled_task->task_uuid);
+  g_debug ("%s: %i fork_connectioned %i", __func__, getpid (), pid);
 
-  auth_opts = gmp_authenticate_info_opts_defaults;
-  auth_opts.username = scheduled_task->owner_name;
-  if (gmp_authenticate_info_ext_c (&connection, auth_opts))
+  if (signal (SIGCHLD, SIG_DFL) == SIG_ERR)
+    g_warning ("%s: failed to set SIGCHLD", __func__);
+
+  started_uuids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                         NULL);
+
+  close (pipe_fds[1]);
+  stream = fdopen (pipe_fds[0], "r");
+  if (stream == NULL)
     {
-      g_warning ("%s: gmp_authenticate failed", __func__);
-      scheduled_task_free (scheduled_task);
-      gvm_connection_free (&connection);
-      gvm_close_sentry ();
-      exit (EXIT_FAILURE);
+      g_warning ("%s: fdopen: %s", __func__, strerror (errno));
+      close (pipe_fds[0]);
+    }
+  else
+    {
+      while (fgets (line, sizeof (line), stream))
+        {
+          int started;
+          char uuid[64];
+
+          if (sscanf (line, "%i %63s", &started, uuid) == 2
+              && started)
+            g_hash_table_add (started_uuids, g_strdup (uuid));
+        }
+      fclose (stream);
     }
 
-  if (gmp_resume_task_report_c (&connection,
-                                scheduled_task->task_uuid,
-                                NULL))
+  while (waitpid (pid, &status, 0) < 0)
     {
-      gmp_start_task_opts_t opts;
+      if (errno == EINTR)
+        continue;
+      g_warning ("%s: waitpid: %s", __func__, strerror (errno));
+      g_warning ("%s: As a result, tasks of user '%s' may not have been"
+                 " scheduled",
+                 __func__,
+                 first->owner_name);
+      break;
+    }
 
-      opts = gmp_start_task_opts_defaults;
-      opts.task_id = scheduled_task->task_uuid;
+  /* Update the schedules of the started tasks, and reschedule the rest
+   * so that they are tried again. */
 
-      switch (gmp_start_task_ext_c (&connection, opts))
+  for (point = owner_tasks; point; point = point->next)
+    {
+      scheduled_task_t *scheduled_task = point->data;
+
+      if (g_hash_table_contains (started_uuids, scheduled_task->task_uuid))
+        scheduled_task_started (scheduled_task->task_uuid);
+      else
         {
-          case 0:
-            break;
+          g_warning ("%s: failed to start task '%s'",
+                     __func__, scheduled_task->task_uuid);
+          reschedule_task (scheduled_task->task_uuid);
+        }
+    }
 
-          case 99:
-            g_warning ("%s: user denied permission to start task", __func__);
-            scheduled_task_free (scheduled_task);
-            gvm_connection_free (&connection);
-            gvm_close_sentry ();
-            /* Return success, so that parent stops trying to start the task. */
-            exit (EXIT_SUCCESS);
+  g_hash_table_destroy (started_uuids);
+  g_slist_free_full (owner_tasks, (GDestroyNotify) scheduled_task_free);
+}
 
-          default:
-            g_warning ("%s: gmp_start_task and gmp_resume_task failed", __func__);
-            scheduled_task_free (scheduled_task);
-            gvm_connection_free (&connection);
-            gvm_close_sentry ();
-            exit (EXIT_FAILURE);
+/**
+ * @brief Start a batch of tasks, for the scheduler.
+ *
+ * Only the parent returns.  The child groups the tasks by owner and
+ * starts the tasks of each owner over a single authenticated GMP
+ * connection, so a wave of scheduled starts costs one connection per
+ * owner instead of one fork per task.
+ *
+ * @param[in]  starts           List of scheduled tasks.  The child consumes
+ *                              its copy; the caller keeps ownership.
+ * @param[in]  fork_connection  Function that forks a child which is connected
+ *                              to the Manager.  Must return PID in parent, 0
+ *                              in child, or -1 on error.
+ * @param[in]  sigmask_current  Sigmask to restore in child.
+ *
+ * @return 0 success, -1 error.  Child does not return.
+ */
+static int
+scheduled_tasks_start (GSList *starts,
+                       manage_connection_forker_t fork_connection,
+                       sigset_t *sigmask_current)
+{
+  int pid;
+
+  /* Fork a child to start the tasks and wait for the responses, so that
+   * the parent can return to the main loop.  Only the parent returns. */
+
+  pid = fork ();
+  switch (pid)
+    {
+      case 0:
+        /* Child.  Carry on to start the tasks, reopen the database
+         * (required after fork). */
+
+        /* Restore the sigmask that was blanked for pselect. */
+        pthread_sigmask (SIG_SETMASK, sigmask_current, NULL);
+
+        init_sentry ();
+        reinit_manage_process ();
+        manage_session_init (current_credentials.uuid);
+        break;
+
+      case -1:
+        /* Parent on error. */
+        g_warning ("%s: fork failed", __func__);
+        return -1;
+
+      default:
+        /* Parent.  Continue to the stops. */
+        g_debug ("%s: %i forked %i", __func__, getpid (), pid);
+        return 0;
+    }
+
+  while (starts)
+    {
+      scheduled_task_t *scheduled_task;
+      GSList *owner_tasks, *point;
+
+      scheduled_task = starts->data;
+
+      /* Move all tasks of this owner into their own list. */
+
+      owner_tasks = g_slist_append (NULL, scheduled_task);
+      starts = g_slist_delete_link (starts, starts);
+      point = starts;
+      while (point)
+        {
+          GSList *next_point = point->next;
+          scheduled_task_t *other = point->data;
+
+          if (strcmp (other->owner_uuid, scheduled_task->owner_uuid) == 0)
+            {
+              owner_tasks = g_slist_append (owner_tasks, other);
+              starts = g_slist_delete_link (starts, point);
+            }
+          point = next_point;
         }
+
+      scheduled_owner_tasks_start (owner_tasks, fork_connection);
     }
 
-  scheduled_task_free (scheduled_task);
-  gvm_connection_free (&connection);
   gvm_close_sentry ();
   exit (EXIT_SUCCESS);
 }
@@ -5540,7 +5946,8 @@ manage_sync (sigset_t *sigmask_current,
              int (*fork_update_nvt_cache) (pid_t*),
              gboolean try_gvmd_data_sync)
 {
-  lockfile_t lockfile;
+  lockfile_t nvt_main, nvt_feed, scap_main, scap_feed, cert_main, cert_feed;
+  lockfile_t data_main, data_feed;
 
   reinit_manage_process ();
   manage_session_init (current_credentials.uuid);
@@ -5550,21 +5957,55 @@ manage_sync (sigset_t *sigmask_current,
       if (wait_for_mem (check_min_mem_feed_update,
                         mem_wait_retries,
                         min_mem_feed_update,
-                        "SecInfo feed sync") == 0
-          && feed_lockfile_lock (&lockfile) == 0)
+                        "SecInfo feed sync") == 0)
         {
-          pid_t nvts_pid, scap_pid, cert_pid;
-          nvts_pid = manage_sync_nvts (fork_update_nvt_cache);
-          scap_pid = manage_sync_scap (sigmask_current);
-          cert_pid = manage_sync_cert (sigmask_current);
-
-          wait_for_pid (nvts_pid, "NVTs sync");
-          wait_for_pid (scap_pid, "SCAP sync");
-          wait_for_pid (cert_pid, "CERT sync");
-
-          update_scap_extra ();
+          int nvts_locked, scap_locked, cert_locked;
+
+          /* Lock each feed separately, so that any feed that another
+           * process is currently syncing is simply skipped this round,
+           * while the others still run, concurrently. */
+
+          nvts_locked = (feed_type_lockfile_lock (&nvt_main, &nvt_feed,
+                                                  NVT_FEED)
+                         == 0);
+          scap_locked = (feed_type_lockfile_lock (&scap_main, &scap_feed,
+                                                  SCAP_FEED)
+                         == 0);
+          cert_locked = (feed_type_lockfile_lock (&cert_main, &cert_feed,
+                                                  CERT_FEED)
+                         == 0);
+
+          if (nvts_locked || scap_locked || cert_locked)
+            {
+              pid_t nvts_pid, scap_pid, cert_pid;
+
+              nvts_pid = nvts_locked
+                          ? manage_sync_nvts (fork_update_nvt_cache)
+                          : -1;
+              scap_pid = scap_locked
+                          ? manage_sync_scap (sigmask_current)
+                          : -1;
+              cert_pid = cert_locked
+                          ? manage_sync_cert (sigmask_current)
+                          : -1;
+
+              if (nvts_locked)
+                wait_for_pid (nvts_pid, "NVTs sync");
+              if (scap_locked)
+                wait_for_pid (scap_pid, "SCAP sync");
+              if (cert_locked)
+                wait_for_pid (cert_pid, "CERT sync");
+
+              if (nvts_locked || scap_locked)
+                update_scap_extra ();
+            }
 
-          lockfile_unlock (&lockfile);
+          if (nvts_locked)
+            feed_type_lockfile_unlock (&nvt_main, &nvt_feed);
+          if (scap_locked)
+            feed_type_lockfile_unlock (&scap_main, &scap_feed);
+          if (cert_locked)
+            feed_type_lockfile_unlock (&cert_main, &cert_feed);
         }
     }
 
@@ -5577,17 +6018,73 @@ manage_sync (sigset_t *sigmask_current,
                         mem_wait_retries,
                         min_mem_feed_update,
                         "data objects feed sync") == 0
-          && feed_lockfile_lock (&lockfile) == 0)
+          && feed_type_lockfile_lock (&data_main, &data_feed,
+                                      GVMD_DATA_FEED) == 0)
         {
           manage_sync_configs ();
           manage_sync_port_lists ();
           manage_sync_report_formats ();
 
-          lockfile_unlock (&lockfile);
+          feed_type_lockfile_unlock (&data_main, &data_feed);
         }
     }
 }
 
+/**
+ * @brief Delete reports that exceed the retention period.
+ *
+ * In gvmd, periodically called from the main daemon loop, in a dedicated
+ * child process, because the purge may take a long time.
+ */
+void
+manage_purge_expired_reports ()
+{
+  reinit_manage_process ();
+  manage_session_init (current_credentials.uuid);
+
+  purge_expired_reports ();
+}
+
+/**
+ * @brief Check whether any queued alert deliveries are ready to run.
+ *
+ * @return 1 if there are deliveries due, else 0.
+ */
+int
+manage_alert_deliveries_due ()
+{
+  return alert_deliveries_due ();
+}
+
+/**
+ * @brief Run the alert deliveries that are due.
+ *
+ * Intended for a process forked for the purpose, like
+ * manage_purge_expired_reports.
+ */
+void
+manage_alert_deliveries ()
+{
+  reinit_manage_process ();
+  manage_session_init (current_credentials.uuid);
+
+  alert_deliveries_run ();
+}
+
+/**
+ * @brief Run the startup database checks that init_manage deferred.
+ *
+ * Intended for a process forked for the purpose, like
+ * manage_purge_expired_reports.
+ */
+void
+manage_deferred_startup_checks ()
+{
+  reinit_manage_process ();
+
+  deferred_startup_checks_run ();
+}
+
 /**
  * @brief Adds a switch statement for handling the return value of a
  *        gvmd data rebuild.
@@ -5641,7 +6138,7 @@ manage_rebuild_gvmd_data_from_feed (const char *types,
                                     gchar **error_msg)
 {
   int ret;
-  lockfile_t lockfile;
+  lockfile_t main_lockfile, feed_lockfile;
   gboolean sync_configs, sync_port_lists, sync_report_formats;
 
   sync_configs = sync_port_lists = sync_report_formats = FALSE;
@@ -5693,7 +6190,8 @@ manage_rebuild_gvmd_data_from_feed (const char *types,
       g_strfreev (split);
     }
 
-  ret = feed_lockfile_lock_timeout (&lockfile);
+  ret = feed_type_lockfile_lock_timeout (&main_lockfile, &feed_lockfile,
+                                         GVMD_DATA_FEED);
   if (ret == 1)
     {
       if (error_msg)
@@ -5737,7 +6235,7 @@ manage_rebuild_gvmd_data_from_feed (const char *types,
       REBUILD_SWITCH ("report formats")
     }
 
-  feed_lockfile_unlock (&lockfile);
+  feed_type_lockfile_unlock (&main_lockfile, &feed_lockfile);
   return 0;
 }
 
@@ -5815,6 +6313,22 @@ manage_schedule (manage_connection_forker_t fork_connection,
         const char *icalendar, *zone;
         int timed_out;
 
+        /* Defer the start when available memory is low, leaving
+         * schedule_next_time as is so that the next tick tries again. */
+
+        if (check_min_mem_scan_start () == 0)
+          {
+            scan_start_deferrals++;
+            g_info ("%s: deferring start of task %s:"
+                    " less than %d MiB of memory available"
+                    " (%d starts deferred so far)",
+                    __func__,
+                    task_schedule_iterator_task_uuid (&schedules),
+                    min_mem_scan_start,
+                    scan_start_deferrals);
+            continue;
+          }
+
         /* Check if task schedule is timed out before updating next due time */
         timed_out = task_schedule_iterator_timed_out (&schedules);
 
@@ -5875,25 +6389,21 @@ manage_schedule (manage_connection_forker_t fork_connection,
       }
   cleanup_task_schedule_iterator (&schedules);
 
-  /* Start tasks in forked processes, now that the SQL statement is closed. */
+  /* Start tasks in a forked process, now that the SQL statement is
+   * closed.  The child batches the starts over one GMP connection per
+   * owner. */
 
-  while (starts)
+  if (starts)
     {
-      scheduled_task_t *scheduled_task;
-      GSList *head;
-
-      scheduled_task = starts->data;
-
-      head = starts;
-      starts = starts->next;
-      g_slist_free_1 (head);
+      if (scheduled_tasks_start (starts, fork_connection, sigmask_current))
+        {
+          GSList *point;
 
-      if (scheduled_task_start (scheduled_task,
-                                fork_connection,
-                                sigmask_current))
-        /* Error.  Reschedule and continue to next task. */
-        reschedule_task (scheduled_task->task_uuid);
-      scheduled_task_free (scheduled_task);
+          /* Error.  Reschedule the tasks so they are tried again. */
+          for (point = starts; point; point = point->next)
+            reschedule_task (((scheduled_task_t *) point->data)->task_uuid);
+        }
+      g_slist_free_full (starts, (GDestroyNotify) scheduled_task_free);
     }
 
   /* Stop tasks in forked processes, now that the SQL statement is closed. */
@@ -6885,6 +7395,69 @@ get_min_mem_feed_update ()
   return min_mem_feed_update;
 }
 
+/**
+ * @brief Check if the minimum memory for starting a scheduled scan is
+ *        available.
+ *
+ * @return 1 if minimum memory amount is available, 0 if not
+ */
+int
+check_min_mem_scan_start ()
+{
+  if (min_mem_scan_start)
+    {
+      guint64 min_mem_bytes = (guint64)min_mem_scan_start * 1048576llu;
+      return phys_mem_available () >= min_mem_bytes ? 1 : 0;
+    }
+  return 1;
+}
+
+/**
+ * @brief Get the minimum memory for starting scheduled scans.
+ *
+ * @return The current minimum memory for scan starts in MiB.
+ */
+int
+get_min_mem_scan_start ()
+{
+  return min_mem_scan_start;
+}
+
+/**
+ * @brief Set the minimum memory for starting scheduled scans.
+ *
+ * @param[in]  new_min_mem The new minimum memory for scan starts in MiB.
+ */
+void
+set_min_mem_scan_start (int new_min_mem)
+{
+  guint64 min_mem_bytes = (guint64)new_min_mem * 1048576llu;
+  if (new_min_mem < 0)
+    min_mem_scan_start = 0;
+  else if (min_mem_bytes > phys_mem_total ())
+    {
+      g_warning ("%s: requested scan start minimum memory limit (%d MiB)"
+                 " exceeds total physical memory (%lld MiB)."
+                 " The setting is ignored.",
+                 __func__,
+                 new_min_mem,
+                 phys_mem_total () / 1048576llu);
+    }
+  else
+    min_mem_scan_start = new_min_mem;
+}
+
+/**
+ * @brief Get the number of scheduled scan starts deferred due to low memory.
+ *
+ * @return The number of deferred scan starts.
+ */
+int
+get_scan_start_deferrals ()
+{
+  return scan_start_deferrals;
+}
+
 /**
  * @brief Get the minimum memory for feed updates.
  *
@@ -6934,6 +7507,32 @@ set_max_concurrent_scan_updates (int new_max)
     max_concurrent_scan_updates = new_max;
 }
 
+/**
+ * @brief Set the maximum number of idle database connections kept for reuse.
+ *
+ * @param[in] new_size The new maximum number of idle connections.
+ */
+void
+set_db_connection_pool_size (int new_size)
+{
+  if (new_size < 0)
+    sql_pool_size (0);
+  else
+    sql_pool_size (new_size);
+}
+
+/**
+ * @brief Set the maximum tolerated replication lag of the DB read replica.
+ *
+ * @param[in] new_limit The new maximum lag in seconds.
+ */
+void
+set_db_replica_lag_limit (int new_limit)
+{
+  if (new_limit >= 0)
+    sql_replica_lag_limit (new_limit);
+}
+
 /**
  * @brief Write start time to sync lock file.
  *
@@ -7064,6 +7663,172 @@ feed_lockfile_unlock (lockfile_t *lockfile)
   return 0;
 }
 
+/**
+ * @brief Get the lock file path for a single feed type.
+ *
+ * The feeds write to disjoint schemas, so each gets its own lock file,
+ * derived from the main feed lock path.  The main lock file stays as the
+ * whole-feed lock that external sync scripts take exclusively.
+ *
+ * @param[in]  feed_type  NVT_FEED, SCAP_FEED, CERT_FEED or GVMD_DATA_FEED.
+ *
+ * @return Newly allocated lock file path.  Free with g_free.
+ */
+gchar *
+feed_type_lock_path (int feed_type)
+{
+  const gchar *suffix;
+
+  switch (feed_type)
+    {
+      case NVT_FEED:
+        suffix = "nvt";
+        break;
+      case SCAP_FEED:
+        suffix = "scap";
+        break;
+      case CERT_FEED:
+        suffix = "cert";
+        break;
+      case GVMD_DATA_FEED:
+        suffix = "gvmd-data";
+        break;
+      default:
+        assert (0);
+        suffix = "unknown";
+        break;
+    }
+
+  return g_strdup_printf ("%s-%s", get_feed_lock_path (), suffix);
+}
+
+/**
+ * @brief Acquire the lock for a single feed type, without blocking.
+ *
+ * Takes a shared lock on the main feed lock file, so that external sync
+ * scripts, which lock it exclusively while writing the feed directory,
+ * are still excluded, and then an exclusive lock on the feed type's own
+ * lock file.  Syncs of different feed types can therefore run
+ * concurrently, while two syncs of the same feed type exclude each other.
+ *
+ * @param[out] main_lockfile  Main feed lockfile data struct.
+ * @param[out] feed_lockfile  Feed type lockfile data struct.
+ * @param[in]  feed_type      NVT_FEED, SCAP_FEED, CERT_FEED or
+ *                            GVMD_DATA_FEED.
+ *
+ * @return 0 success, 1 already locked, -1 error
+ */
+int
+feed_type_lockfile_lock (lockfile_t *main_lockfile,
+                         lockfile_t *feed_lockfile,
+                         int feed_type)
+{
+  int ret;
+  gchar *lock_path;
+
+  ret = lockfile_lock_path_shared_nb (main_lockfile, get_feed_lock_path ());
+  if (ret)
+    return ret;
+
+  lock_path = feed_type_lock_path (feed_type);
+  ret = lockfile_lock_path_nb (feed_lockfile, lock_path);
+  g_free (lock_path);
+  if (ret)
+    {
+      lockfile_unlock (main_lockfile);
+      return ret;
+    }
+
+  /* Write the file contents (timestamp) */
+  write_sync_start (feed_lockfile->fd);
+
+  return 0;
+}
+
+/**
+ * @brief Acquire the lock for a single feed type, retrying on contention.
+ *
+ * Like \ref feed_type_lockfile_lock, but retries for the feed lock
+ * timeout, as \ref feed_lockfile_lock_timeout does for the whole feed.
+ *
+ * @param[out] main_lockfile  Main feed lockfile data struct.
+ * @param[out] feed_lockfile  Feed type lockfile data struct.
+ * @param[in]  feed_type      NVT_FEED, SCAP_FEED, CERT_FEED or
+ *                            GVMD_DATA_FEED.
+ *
+ * @return 0 success, 1 already locked, -1 error
+ */
+int
+feed_type_lockfile_lock_timeout (lockfile_t *main_lockfile,
+                                 lockfile_t *feed_lockfile,
+                                 int feed_type)
+{
+  int lock_status;
+  gboolean log_timeout;
+  time_t timeout_end;
+
+  /* Try to lock the files */
+
+  log_timeout = TRUE;
+  timeout_end = time (NULL) + feed_lock_timeout;
+  do
+    {
+      lock_status = feed_type_lockfile_lock (main_lockfile, feed_lockfile,
+                                             feed_type);
+      if (lock_status == 1 /* already locked, but no error */
+          && timeout_end > time (NULL))
+        {
+          if (log_timeout)
+            {
+              log_timeout = FALSE;
+              g_message ("%s: Feed is currently locked by another process,"
+                         " will retry until %s.",
+                         __func__, iso_time (&timeout_end));
+            }
+          gvm_sleep (1);
+        }
+      else if (lock_status) /* error */
+        {
+          return lock_status;
+        }
+    } while (lock_status); /* lock is acquired when lock_status is 0 */
+
+  return 0;
+}
+
+/**
+ * @brief Release the lock for a single feed type.
+ *
+ * @param[in] main_lockfile  Main feed lockfile data struct.
+ * @param[in] feed_lockfile  Feed type lockfile data struct.
+ *
+ * @return 0 success, -1 error
+ */
+int
+feed_type_lockfile_unlock (lockfile_t *main_lockfile,
+                           lockfile_t *feed_lockfile)
+{
+  int ret;
+
+  /* Clear timestamp from lock file. */
+  if (ftruncate (feed_lockfile->fd, 0))
+    g_warning ("%s: failed to ftruncate lockfile: %s",
+               __func__,
+               strerror (errno));
+
+  /* Unlock the lockfiles */
+  ret = lockfile_unlock (feed_lockfile);
+  if (lockfile_unlock (main_lockfile))
+    ret = -1;
+  if (ret)
+    {
+      g_critical ("%s: Error releasing feed lock", __func__);
+      return -1;
+    }
+
+  return 0;
+}
+
 /**
  * @brief Request a feed synchronization script selftest.
  *
@@ -7516,7 +8281,7 @@ nvts_check_feed (int *lockfile_in_use,
 int
 gvm_migrate_secinfo (int feed_type)
 {
-  lockfile_t lockfile;
+  lockfile_t main_lockfile, feed_lockfile;
   int ret;
 
   if (feed_type != SCAP_FEED && feed_type != CERT_FEED)
@@ -7525,7 +8290,8 @@ gvm_migrate_secinfo (int feed_type)
       return -1;
     }
 
-  ret = feed_lockfile_lock_timeout (&lockfile);
+  ret = feed_type_lockfile_lock_timeout (&main_lockfile, &feed_lockfile,
+                                         feed_type);
   if (ret == 1)
     return 1;
   else if (ret)
@@ -7536,7 +8302,7 @@ gvm_migrate_secinfo (int feed_type)
   else
     ret = check_cert_db_version ();
 
-  feed_lockfile_unlock (&lockfile);
+  feed_type_lockfile_unlock (&main_lockfile, &feed_lockfile);
 
   return ret;
 }
@@ -7557,6 +8323,94 @@ manage_update_nvts_osp (const gchar *update_socket)
 
 /* Wizards. */
 
+/**
+ * @brief A cached wizard document.
+ */
+typedef struct
+{
+  time_t mtime;     ///< Modification time of the file when it was parsed.
+  entity_t entity;  ///< Parsed document.
+} wizard_cache_entry_t;
+
+/**
+ * @brief Parsed wizard documents, keyed by file path.
+ */
+static GHashTable *wizard_cache = NULL;
+
+/**
+ * @brief Get the parsed document of a wizard file.
+ *
+ * Caches the parsed document in the process, rereading the file when its
+ * modification time changes, so that repeated wizard runs skip the file
+ * read and parse.
+ *
+ * @param[in]  file  Path to wizard XML file.
+ *
+ * @return Parsed wizard on success, else NULL.  The entity is owned by the
+ *         cache and must not be freed by the caller.
+ */
+static entity_t
+wizard_cache_get (const gchar *file)
+{
+  struct stat state;
+  wizard_cache_entry_t *entry;
+  gchar *wizard;
+  gsize wizard_len;
+  GError *get_error;
+  entity_t entity;
+
+  if (stat (file, &state))
+    {
+      g_warning ("%s: Failed to stat wizard: %s",
+                 __func__,
+                 strerror (errno));
+      return NULL;
+    }
+
+  if (wizard_cache == NULL)
+    wizard_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, NULL);
+
+  entry = g_hash_table_lookup (wizard_cache, file);
+  if (entry && entry->mtime == state.st_mtime)
+    return entry->entity;
+
+  get_error = NULL;
+  g_file_get_contents (file,
+                       &wizard,
+                       &wizard_len,
+                       &get_error);
+  if (get_error)
+    {
+      g_warning ("%s: Failed to read wizard: %s",
+                 __func__,
+                 get_error->message);
+      g_error_free (get_error);
+      return NULL;
+    }
+
+  entity = NULL;
+  if (parse_entity (wizard, &entity))
+    {
+      g_warning ("%s: Failed to parse wizard", __func__);
+      g_free (wizard);
+      return NULL;
+    }
+  g_free (wizard);
+
+  if (entry)
+    free_entity (entry->entity);
+  else
+    {
+      entry = g_malloc (sizeof (wizard_cache_entry_t));
+      g_hash_table_insert (wizard_cache, g_strdup (file), entry);
+    }
+  entry->mtime = state.st_mtime;
+  entry->entity = entity;
+
+  return entity;
+}
+
 /**
  * @brief Run a wizard.
  *
@@ -7594,9 +8448,7 @@ manage_run_wizard (const gchar *wizard_name,
                    gchar **ret_response)
 {
   GString *params_xml;
-  gchar *file, *file_name, *response, *extra, *extra_wrapped, *wizard;
-  gsize wizard_len;
-  GError *get_error;
+  gchar *file, *file_name, *response, *extra, *extra_wrapped;
   entity_t entity, mode_entity, params_entity, read_only_entity;
   entity_t param_def, step;
   entities_t modes, steps, param_defs;
@@ -7620,7 +8472,7 @@ manage_run_wizard (const gchar *wizard_name,
   if (*point)
     return 1;
 
-  /* Read wizard from file. */
+  /* Get the parsed wizard, from the cache or from the file. */
 
   file_name = g_strdup_printf ("%s.xml", wizard_name);
   file = g_build_filename (GVMD_DATA_DIR,
@@ -7629,31 +8481,10 @@ manage_run_wizard (const gchar *wizard_name,
                            NULL);
   g_free (file_name);
 
-  get_error = NULL;
-  g_file_get_contents (file,
-                       &wizard,
-                       &wizard_len,
-                       &get_error);
+  entity = wizard_cache_get (file);
   g_free (file);
-  if (get_error)
-    {
-      g_warning ("%s: Failed to read wizard: %s",
-                 __func__,
-                 get_error->message);
-      g_error_free (get_error);
-      return -1;
-    }
-
-  /* Parse wizard. */
-
-  entity = NULL;
-  if (parse_entity (wizard, &entity))
-    {
-      g_warning ("%s: Failed to parse wizard", __func__);
-      g_free (wizard);
-      return -1;
-    }
-  g_free (wizard);
+  if (entity == NULL)
+    return -1;
 
   /* Select mode */
   if (mode && strcmp (mode, ""))
@@ -7675,7 +8506,6 @@ manage_run_wizard (const gchar *wizard_name,
 
       if (mode_found == 0)
         {
-          free_entity (entity);
           if (ret_response)
             *ret_response = g_strdup ("");
 
@@ -7695,7 +8525,6 @@ manage_run_wizard (const gchar *wizard_name,
       read_only_entity = entity_child (mode_entity, "read_only");
       if (read_only_entity == NULL)
         {
-          free_entity (entity);
           return 5;
         }
     }
@@ -7721,7 +8550,6 @@ manage_run_wizard (const gchar *wizard_name,
             {
               g_warning ("%s: Wizard PARAM missing NAME",
                          __func__);
-              free_entity (entity);
               return -1;
             }
           else
@@ -7733,7 +8561,6 @@ manage_run_wizard (const gchar *wizard_name,
             {
               g_warning ("%s: Wizard PARAM missing REGEX",
                          __func__);
-              free_entity (entity);
               return -1;
             }
           else
@@ -7772,7 +8599,6 @@ manage_run_wizard (const gchar *wizard_name,
                                                   " parameter '%s'.",
                                                   pair->value, name);
                             }
-                          free_entity (entity);
                           g_string_free (params_xml, TRUE);
                           return 6;
                         }
@@ -7788,7 +8614,6 @@ manage_run_wizard (const gchar *wizard_name,
                                                     " missing",
                                                     name);
                 }
-              free_entity (entity);
               return 6;
             }
 
@@ -7841,7 +8666,6 @@ manage_run_wizard (const gchar *wizard_name,
             {
               g_warning ("%s: Wizard STEP missing COMMAND",
                          __func__);
-              free_entity (entity);
               g_free (response);
               g_free (extra);
               g_string_free (params_xml, TRUE);
@@ -7855,7 +8679,6 @@ manage_run_wizard (const gchar *wizard_name,
             {
               g_warning ("%s: Wizard XSL file create failed",
                          __func__);
-              free_entity (entity);
               g_free (response);
               g_free (extra);
               g_string_free (params_xml, TRUE);
@@ -7868,7 +8691,6 @@ manage_run_wizard (const gchar *wizard_name,
               g_warning ("%s: Wizard XSL file open failed",
                          __func__);
               close (xsl_fd);
-              free_entity (entity);
               g_free (response);
               g_free (extra);
               g_string_free (params_xml, TRUE);
@@ -7887,7 +8709,6 @@ manage_run_wizard (const gchar *wizard_name,
                          __func__);
               fclose (xsl_file);
               unlink (xsl_file_name);
-              free_entity (entity);
               g_free (response);
               g_free (extra);
               g_string_free (params_xml, TRUE);
@@ -7902,7 +8723,6 @@ manage_run_wizard (const gchar *wizard_name,
               fclose (xsl_file);
               unlink (xsl_file_name);
               close (xml_fd);
-              free_entity (entity);
               g_free (response);
               g_free (extra);
               g_string_free (params_xml, TRUE);
@@ -7926,7 +8746,6 @@ manage_run_wizard (const gchar *wizard_name,
               unlink (xsl_file_name);
               fclose (xml_file);
               unlink (xml_file_name);
-              free_entity (entity);
               g_warning ("%s: Wizard failed to write XML",
                          __func__);
               g_free (response);
@@ -7949,7 +8768,6 @@ manage_run_wizard (const gchar *wizard_name,
             {
               g_warning ("%s: Wizard XSL transform failed",
                          __func__);
-              free_entity (entity);
               g_free (response);
               g_free (extra);
               g_string_free (params_xml, TRUE);
@@ -7967,7 +8785,6 @@ manage_run_wizard (const gchar *wizard_name,
             }
           else
             {
-              free_entity (entity);
               g_free (response);
               g_free (extra);
               g_string_free (params_xml, TRUE);
@@ -7986,7 +8803,6 @@ manage_run_wizard (const gchar *wizard_name,
                 {
                   g_warning ("%s: Wizard failed to parse response",
                              __func__);
-                  free_entity (entity);
                   g_free (response);
                   g_free (extra);
                   g_string_free (params_xml, TRUE);
@@ -8011,7 +8827,6 @@ manage_run_wizard (const gchar *wizard_name,
                       *command_error_code = g_strdup (status);
                     }
                   free_entity (response_entity);
-                  free_entity (entity);
                   g_free (response);
                   g_free (extra);
                   g_string_free (params_xml, TRUE);
@@ -8033,7 +8848,6 @@ manage_run_wizard (const gchar *wizard_name,
                 {
                   g_warning ("%s: Wizard extra_data XSL file create failed",
                             __func__);
-                  free_entity (entity);
                   g_free (response);
                   g_free (extra);
                   g_string_free (params_xml, TRUE);
@@ -8046,7 +8860,6 @@ manage_run_wizard (const gchar *wizard_name,
                   g_warning ("%s: Wizard extra_data XSL file open failed",
                             __func__);
                   close (xsl_fd);
-                  free_entity (entity);
                   g_free (response);
                   g_free (extra);
                   g_string_free (params_xml, TRUE);
@@ -8065,7 +8878,6 @@ manage_run_wizard (const gchar *wizard_name,
                             __func__);
                   fclose (xsl_file);
                   unlink (xsl_file_name);
-                  free_entity (entity);
                   g_free (response);
                   g_free (extra);
                   g_string_free (params_xml, TRUE);
@@ -8080,7 +8892,6 @@ manage_run_wizard (const gchar *wizard_name,
                   fclose (xsl_file);
                   unlink (xsl_file_name);
                   close (xml_fd);
-                  free_entity (entity);
                   g_free (response);
                   g_free (extra);
                   g_string_free (params_xml, TRUE);
@@ -8106,7 +8917,6 @@ manage_run_wizard (const gchar *wizard_name,
                   unlink (extra_xsl_file_name);
                   fclose (xml_file);
                   unlink (extra_xml_file_name);
-                  free_entity (entity);
                   g_warning ("%s: Wizard failed to write XML",
                             __func__);
                   g_free (response);
@@ -8162,13 +8972,11 @@ manage_run_wizard (const gchar *wizard_name,
       else
         {
           g_warning ("%s: failed to parse extra data", __func__);
-          free_entity (entity);
           g_string_free (params_xml, TRUE);
           return -1;
         }
     }
 
-  free_entity (entity);
   g_string_free (params_xml, TRUE);
 
   /* All the steps succeeded. */
@@ -49,6 +49,8 @@ typedef struct {
   gchar *host; ///< The database host or socket directory
   gchar *port; ///< The database port or socket file extension
   gchar *user; ///< The database user name
+  gchar *replica_host; ///< Host of an optional read replica
+  gchar *replica_port; ///< Port of the read replica, NULL for the DB port
 } db_conn_info_t;
 
 /**
@@ -230,6 +232,9 @@ set_db_version (int version);
 int
 manage_migrate (GSList*, const db_conn_info_t*);
 
+int
+manage_migrate_dry_run (GSList*, const db_conn_info_t*);
+
 int
 manage_encrypt_all_credentials (GSList *, const db_conn_info_t *);
 
@@ -398,6 +403,9 @@ find_resource (const char*, const char*, resource_t*);
 gboolean
 find_resource_no_acl (const char*, const char*, resource_t*);
 
+void
+find_resource_cache_mode (int);
+
 const char *
 type_name_plural (const char*);
 
@@ -584,6 +592,17 @@ typedef enum
   ALERT_CONDITION_FILTER_COUNT_CHANGED
 } alert_condition_t;
 
+/**
+ * @brief States of queued alert deliveries.
+ */
+typedef enum
+{
+  ALERT_DELIVERY_QUEUED,
+  ALERT_DELIVERY_RUNNING,
+  ALERT_DELIVERY_DONE,
+  ALERT_DELIVERY_FAILED
+} alert_delivery_status_t;
+
 int
 manage_check_alerts (GSList *, const db_conn_info_t *);
 
@@ -630,6 +649,9 @@ trash_alert_writable (alert_t);
 int
 alert_count (const get_data_t *);
 
+int
+alert_delivery_count (alert_t, alert_delivery_status_t);
+
 int
 init_alert_iterator (iterator_t*, get_data_t*);
 
@@ -1306,8 +1328,14 @@ void
 update_duration_schedule_periods (task_t);
 
 int
-create_report (array_t*, const char *, const char *, const char *, const char *,
-               array_t*, array_t*, array_t*, char **);
+create_report_spool_result (FILE *, const char *, const char *, const char *,
+                            const char *, const char *, const char *,
+                            const char *, const char *, const char *,
+                            const char *);
+
+int
+create_report (FILE *, int, const char *, const char *, const char *,
+               const char *, array_t*, array_t*, array_t*, char **);
 
 void
 report_add_result (report_t, result_t);
@@ -1337,6 +1365,9 @@ int
 report_scan_result_count (report_t, const char*, const char*, int, const char*,
                           const char*, int, int, int*);
 
+void
+report_counts_prefetch (int, int);
+
 int
 report_counts (const char*, int*, int*, int*, int*, int*, double*,
                int, int);
@@ -1523,6 +1554,9 @@ result_iterator_may_have_notes (iterator_t*);
 int
 result_iterator_may_have_overrides (iterator_t*);
 
+int
+result_iterator_may_have_tags (iterator_t*);
+
 int
 result_iterator_may_have_tickets (iterator_t*);
 
@@ -2991,6 +3025,21 @@ set_scheduled_user_uuid (const gchar* uuid);
 void
 manage_sync (sigset_t *, int (*fork_update_nvt_cache) (pid_t*), gboolean);
 
+void
+manage_purge_expired_reports ();
+
+int
+manage_alert_deliveries_due ();
+
+void
+manage_alert_deliveries ();
+
+int
+manage_startup_checks_deferred ();
+
+void
+manage_deferred_startup_checks ();
+
 int
 manage_rebuild_gvmd_data_from_feed (const char *,
                                     GSList *,
@@ -3974,6 +4023,12 @@ get_max_concurrent_scan_updates ();
 void
 set_max_concurrent_scan_updates (int);
 
+void
+set_db_connection_pool_size (int);
+
+void
+set_db_replica_lag_limit (int);
+
 int
 get_mem_wait_retries ();
 
@@ -3989,6 +4044,18 @@ get_min_mem_feed_update ();
 void
 set_min_mem_feed_update (int);
 
+int
+check_min_mem_scan_start ();
+
+int
+get_min_mem_scan_start ();
+
+void
+set_min_mem_scan_start (int);
+
+int
+get_scan_start_deferrals ();
+
 void
 write_sync_start (int);
 
@@ -4001,6 +4068,18 @@ feed_lockfile_lock_timeout (lockfile_t*);
 int
 feed_lockfile_unlock (lockfile_t *);
 
+gchar *
+feed_type_lock_path (int);
+
+int
+feed_type_lockfile_lock (lockfile_t *, lockfile_t *, int);
+
+int
+feed_type_lockfile_lock_timeout (lockfile_t *, lockfile_t *, int);
+
+int
+feed_type_lockfile_unlock (lockfile_t *, lockfile_t *);
+
 int
 gvm_migrate_secinfo (int);
 
@@ -4042,6 +4121,9 @@ manage_run_wizard (const gchar *, int (*) (void*, gchar*, gchar**),
 
 /* Helpers. */
 
+void
+xml_escape_text_append (GString *, const char *, gssize);
+
 gchar *
 xml_escape_text_truncated (const char *, size_t, const char *);
 
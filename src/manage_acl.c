@@ -39,6 +39,68 @@
  */
 #define G_LOG_DOMAIN "md manage"
 
+/**
+ * @brief Cache of ACL decisions for the current session.
+ *
+ * Permissions change rarely while GMP commands arrive constantly, so the
+ * results of the permission checks are kept for the life of the session.
+ * Keys include the user UUID, so the cache survives reauthentication as
+ * a different user.  The cache is cleared via acl_cache_reset whenever
+ * this process changes permissions, roles or group or role membership.
+ */
+static GHashTable *acl_cache = NULL;
+
+/**
+ * @brief Clear the session ACL decision cache.
+ *
+ * For calling after any change to permissions, roles or group or role
+ * membership, so that following checks see the change.
+ */
+void
+acl_cache_reset ()
+{
+  if (acl_cache)
+    g_hash_table_remove_all (acl_cache);
+}
+
+/**
+ * @brief Get a decision from the session ACL cache.
+ *
+ * @param[in]  key  Cache key.
+ *
+ * @return Cached check result, or -1 if there is no entry for the key.
+ */
+static int
+acl_cache_get (const gchar *key)
+{
+  gpointer value;
+
+  if (acl_cache == NULL)
+    return -1;
+
+  value = g_hash_table_lookup (acl_cache, key);
+  if (value == NULL)
+    return -1;
+
+  return GPOINTER_TO_INT (value) - 1;
+}
+
+/**
+ * @brief Add a decision to the session ACL cache.
+ *
+ * @param[in]  key    Cache key.  Consumed.
+ * @param[in]  value  Check result.
+ */
+static void
+acl_cache_set (gchar *key, int value)
+{
+  if (acl_cache == NULL)
+    acl_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       NULL);
+
+  g_hash_table_replace (acl_cache, key, GINT_TO_POINTER (value + 1));
+}
+
 /**
  * @brief Test whether the current user may perform an operation.
  *
@@ -158,15 +220,37 @@ acl_commands (gchar **disabled_commands)
 int
 acl_user_may (const char *operation)
 {
+  int ret;
+  gchar *key;
+
   if (strlen (current_credentials.uuid) == 0)
     /* Allow the dummy user in init_manage to do anything. */
     return 1;
 
-  if (sql_int ("SELECT user_can_everything ('%s');",
-               current_credentials.uuid))
+  key = g_strdup_printf ("everything %s", current_credentials.uuid);
+  ret = acl_cache_get (key);
+  if (ret == -1)
+    {
+      ret = sql_int ("SELECT user_can_everything ('%s');",
+                     current_credentials.uuid);
+      acl_cache_set (key, ret);
+    }
+  else
+    g_free (key);
+  if (ret)
     return 1;
 
-  return user_may_internal (operation);
+  key = g_strdup_printf ("may %s %s", current_credentials.uuid, operation);
+  ret = acl_cache_get (key);
+  if (ret >= 0)
+    {
+      g_free (key);
+      return ret;
+    }
+
+  ret = user_may_internal (operation);
+  acl_cache_set (key, ret);
+  return ret;
 }
 
 /**
@@ -263,9 +347,17 @@ acl_user_can_super_everyone (const char *uuid)
 int
 acl_user_can_everything (const char *user_id)
 {
-  gchar *quoted_user_id;
+  gchar *quoted_user_id, *key;
   int ret;
 
+  key = g_strdup_printf ("everything %s", user_id);
+  ret = acl_cache_get (key);
+  if (ret >= 0)
+    {
+      g_free (key);
+      return ret;
+    }
+
   quoted_user_id = sql_quote (user_id);
   ret = sql_int ("SELECT count(*) > 0 FROM permissions"
                  " WHERE resource = 0"
@@ -296,6 +388,7 @@ acl_user_can_everything (const char *user_id)
                  quoted_user_id,
                  quoted_user_id);
   g_free (quoted_user_id);
+  acl_cache_set (key, ret);
   return ret;
 }
 
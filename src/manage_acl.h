@@ -128,6 +128,9 @@
 command_t *
 acl_commands (gchar **);
 
+void
+acl_cache_reset ();
+
 int
 acl_user_may (const char *);
 
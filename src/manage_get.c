@@ -36,6 +36,7 @@
 void
 get_data_reset (get_data_t *data)
 {
+  free (data->continuation);
   free (data->id);
   free (data->filt_id);
   free (data->filter);
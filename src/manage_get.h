@@ -33,6 +33,9 @@
  */
 typedef struct
 {
+  char *continuation;  ///< Keyset pagination token: UUID of the last resource
+                       ///< of the previous page.  Overrides "first" and the
+                       ///< sort order.
   int details;         ///< Boolean.  Whether to include full details.
   char *filt_id;       ///< Filter ID.  Overrides "filter".
   char *filter;        ///< Filter term.
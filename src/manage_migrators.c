@@ -43,7 +43,11 @@
  *
  *  - Add the migrator function in the style of the others.  In particular,
  *    the function must check the version, do the modification and then set
- *    the new version, all inside an exclusive transaction.  Use the generic
+ *    the new version, all inside an exclusive transaction.  Passes that
+ *    rewrite very large tables may instead run in keyed chunks that each
+ *    commit with a resume point, so that locks are held briefly and an
+ *    interrupted migration continues where it stopped; see
+ *    migrate_chunked_update and migrate_219_to_220.  Use the generic
  *    iterator (init_iterator, iterator_string, iterator_int64...) because the
  *    specialised iterators (like init_target_iterator) can change behaviour
  *    across Manager SVN versions.  Use copies of any other "manage" interfaces,
@@ -180,6 +184,101 @@ move (const gchar *table, const gchar *old, const gchar *new)
   sql ("ALTER TABLE %s RENAME COLUMN %s TO %s;", table, old, new);
 }
 
+/**
+ * @brief Number of rows a chunked migration pass covers per transaction.
+ */
+#define MIGRATE_CHUNK_SIZE 50000
+
+/**
+ * @brief Get the resume point of a chunked migration pass.
+ *
+ * @param[in]  name  Name of the pass.
+ *
+ * @return Highest row id that the pass has committed, 0 to start over.
+ */
+static long long int
+migrate_chunk_progress (const char *name)
+{
+  return sql_int64_0 ("SELECT coalesce ((SELECT CAST (value AS bigint)"
+                      "                  FROM meta"
+                      "                  WHERE name = 'migrate_progress_%s'),"
+                      "                 0);",
+                      name);
+}
+
+/**
+ * @brief Record the resume point of a chunked migration pass.
+ *
+ * Called inside the transaction of the chunk, so the resume point commits
+ * atomically with the chunk itself.
+ *
+ * @param[in]  name  Name of the pass.
+ * @param[in]  last  Highest row id that the chunk covered.
+ */
+static void
+migrate_chunk_checkpoint (const char *name, long long int last)
+{
+  sql ("DELETE FROM meta WHERE name = 'migrate_progress_%s';", name);
+  sql ("INSERT INTO meta (name, value)"
+       " VALUES ('migrate_progress_%s', '%lli');",
+       name, last);
+}
+
+/**
+ * @brief Remove the resume point of a finished chunked migration pass.
+ *
+ * @param[in]  name  Name of the pass.
+ */
+static void
+migrate_chunk_done (const char *name)
+{
+  sql ("DELETE FROM meta WHERE name = 'migrate_progress_%s';", name);
+}
+
+/**
+ * @brief Run a whole-table UPDATE in keyed chunks.
+ *
+ * An alternative to running the UPDATE inside the single transaction of the
+ * migrator, for passes that rewrite large tables.  Each chunk covers a range
+ * of row ids and commits in its own transaction together with a resume point
+ * in the meta table, so locks are held briefly and an interrupted migration
+ * continues from the last committed chunk when the migrator runs again.  The
+ * WHERE clause must only match rows that the SET clause still has to
+ * convert, so that rerunning a chunk is harmless.
+ *
+ * @param[in]  name          Name of the pass, for the resume point.
+ * @param[in]  table         Table.
+ * @param[in]  set_clause    SET clause of the UPDATE.
+ * @param[in]  where_clause  WHERE clause that selects unconverted rows.
+ */
+static void
+migrate_chunked_update (const char *name, const char *table,
+                        const char *set_clause, const char *where_clause)
+{
+  long long int last, max;
+
+  last = migrate_chunk_progress (name);
+  max = sql_int64_0 ("SELECT coalesce (max (id), 0) FROM \"%s\";", table);
+
+  while (last < max)
+    {
+      sql_begin_immediate ();
+      sql ("UPDATE \"%s\" SET %s"
+           " WHERE id > %lli"
+           " AND id <= %lli"
+           " AND (%s);",
+           table, set_clause, last, last + MIGRATE_CHUNK_SIZE, where_clause);
+      last += MIGRATE_CHUNK_SIZE;
+      migrate_chunk_checkpoint (name, last);
+      sql_commit ();
+
+      g_debug ("%s: %s: %lli of %lli rows covered",
+               __func__, name, last < max ? last : max, max);
+    }
+
+  migrate_chunk_done (name);
+}
+
 /**
  * @brief Migrate the database from version 204 to version 205.
  *
@@ -1451,43 +1550,67 @@ migrate_219_to_220_new_name (const char *old_name)
 static void
 replace_preference_names_219_to_220 (const char *table_name)
 {
-  iterator_t preferences;
+  gchar *pass_name;
+  long long int last, max;
 
   /* 1.3.6.1.4.1.25623.1.0.14259:checkbox:Log nmap output
    * =>
-   * 1.3.6.1.4.1.25623.1.0.14259:21:checkbox:Log nmap output */
+   * 1.3.6.1.4.1.25623.1.0.14259:21:checkbox:Log nmap output
+   *
+   * The new name comes from a lookup table in C, so this walks the rows with
+   * an iterator, in keyed chunks that each commit in their own transaction
+   * with a resume point, like migrate_chunked_update. */
 
-  init_iterator (&preferences,
-                 "SELECT id, name"
-                 " FROM \"%s\""
-                 " WHERE name LIKE '%%:%%:%%'"
-                 " AND name !~ '.*:[0-9]+:.*:.*';",
-                 table_name);
+  pass_name = g_strdup_printf ("219_to_220_%s", table_name);
+  last = migrate_chunk_progress (pass_name);
+  max = sql_int64_0 ("SELECT coalesce (max (id), 0) FROM \"%s\";", table_name);
 
-  while (next (&preferences))
+  while (last < max)
     {
-      resource_t preference;
-      const char *old_name;
-      const gchar *new_name;
+      iterator_t preferences;
 
-      preference = iterator_int64 (&preferences, 0);
-      old_name = iterator_string (&preferences, 1);
-      new_name = migrate_219_to_220_new_name (old_name);
-      if (new_name)
-        {
-          gchar *quoted_new_name;
+      sql_begin_immediate ();
+      init_iterator (&preferences,
+                     "SELECT id, name"
+                     " FROM \"%s\""
+                     " WHERE id > %lli"
+                     " AND id <= %lli"
+                     " AND name LIKE '%%:%%:%%'"
+                     " AND name !~ '.*:[0-9]+:.*:.*';",
+                     table_name, last, last + MIGRATE_CHUNK_SIZE);
 
-          quoted_new_name = sql_quote (new_name);
-          sql ("UPDATE \"%s\" SET name = '%s' WHERE id = %llu;",
-               table_name,
-               quoted_new_name,
-               preference);
-          g_free (quoted_new_name);
+      while (next (&preferences))
+        {
+          resource_t preference;
+          const char *old_name;
+          const gchar *new_name;
+
+          preference = iterator_int64 (&preferences, 0);
+          old_name = iterator_string (&preferences, 1);
+          new_name = migrate_219_to_220_new_name (old_name);
+          if (new_name)
+            {
+              gchar *quoted_new_name;
+
+              quoted_new_name = sql_quote (new_name);
+              sql ("UPDATE \"%s\" SET name = '%s' WHERE id = %llu;",
+                   table_name,
+                   quoted_new_name,
+                   preference);
+              g_free (quoted_new_name);
+            }
+          else
+            g_warning ("%s: No new name for '%s'", __func__, old_name);
         }
-      else
-        g_warning ("%s: No new name for '%s'", __func__, old_name);
+      cleanup_iterator (&preferences);
+
+      last += MIGRATE_CHUNK_SIZE;
+      migrate_chunk_checkpoint (pass_name, last);
+      sql_commit ();
     }
-  cleanup_iterator (&preferences);
+
+  migrate_chunk_done (pass_name);
+  g_free (pass_name);
 }
 
 /**
@@ -1498,15 +1621,16 @@ replace_preference_names_219_to_220 (const char *table_name)
 int
 migrate_219_to_220 ()
 {
-  sql_begin_immediate ();
-
-  /* Ensure that the database is currently version 219. */
+  /* Ensure that the database is currently version 219.
+   *
+   * The version check and bump do not share a transaction with the rename
+   * passes here, because those run in resumable keyed chunks to keep lock
+   * times short on large preference tables; see migrate_chunked_update.
+   * The gvm-migrating lock keeps the migration exclusive, and rerunning a
+   * chunk is harmless because the passes only match unconverted names. */
 
   if (manage_db_version () != 219)
-    {
-      sql_rollback ();
-      return -1;
-    }
+    return -1;
 
   /* Update the database. */
 
@@ -1517,9 +1641,11 @@ migrate_219_to_220 ()
    *     =>
    *     1.3.6.1.4.1.25623.1.0.107305:entry:timeout  */
 
-  sql ("UPDATE nvt_preferences"
-       " SET name = split_part (name, ':', 1) || ':entry:timeout'"
-       " WHERE name = split_part (name, ':', 1) || ':entry:Timeout';");
+  migrate_chunked_update ("219_to_220_timeout", "nvt_preferences",
+                          "name = split_part (name, ':', 1)"
+                          " || ':entry:timeout'",
+                          "name = split_part (name, ':', 1)"
+                          " || ':entry:Timeout'");
 
   /* Then update config and NVT preferences from the 3 part format to the
    * newer 4 part format:
@@ -1535,6 +1661,8 @@ migrate_219_to_220 ()
   replace_preference_names_219_to_220 ("config_preferences");
   replace_preference_names_219_to_220 ("config_preferences_trash");
 
+  sql_begin_immediate ();
+
   /* Force an NVT update to update newer NVTs not covered by the
    *  hardcoded list in case the feed update was run just before migration. */
   sql ("UPDATE meta SET value='0' WHERE name='nvts_feed_version';");
@@ -3218,6 +3346,81 @@ migrate_255_to_256 ()
   return 0;
 }
 
+/**
+ * @brief Migrate the database from version 256 to version 257.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_256_to_257 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 256. */
+
+  if (manage_db_version () != 256)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  /* Existing rows are left NULL, because the backfill could take hours on
+   * large installations.  The delta comparison computes the hash on the fly
+   * for such rows. */
+
+  sql ("ALTER TABLE IF EXISTS results ADD COLUMN delta_hash text;");
+
+  /* Set the database version to 257. */
+
+  set_db_version (257);
+
+  sql_commit ();
+
+  return 0;
+}
+
+/**
+ * @brief Migrate the database from version 257 to version 258.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+migrate_257_to_258 ()
+{
+  sql_begin_immediate ();
+
+  /* Ensure that the database is currently version 257. */
+
+  if (manage_db_version () != 257)
+    {
+      sql_rollback ();
+      return -1;
+    }
+
+  /* Update the database. */
+
+  sql ("CREATE TABLE IF NOT EXISTS nvt_families"
+       " (name text UNIQUE NOT NULL,"
+       "  nvt_count integer,"
+       "  max_modification_time integer);");
+
+  sql ("INSERT INTO nvt_families (name, nvt_count, max_modification_time)"
+       " SELECT family, count (*), max (modification_time)"
+       " FROM nvts"
+       " WHERE family IS NOT NULL"
+       " GROUP BY family;");
+
+  /* Set the database version to 258. */
+
+  set_db_version (258);
+
+  sql_commit ();
+
+  return 0;
+}
+
 #undef UPDATE_DASHBOARD_SETTINGS
 
 /**
@@ -3280,6 +3483,8 @@ static migrator_t database_migrators[] = {
   {254, migrate_253_to_254},
   {255, migrate_254_to_255},
   {256, migrate_255_to_256},
+  {257, migrate_256_to_257},
+  {258, migrate_257_to_258},
   /* End marker. */
   {-1, NULL}};
 
@@ -3513,3 +3718,84 @@ manage_migrate (GSList *log_config, const db_conn_info_t *database)
   cleanup_manage_process (TRUE);
   return 0;
 }
+
+/**
+ * @brief List the migrations a database needs, without running any.
+ *
+ * Prints each pending migrator along with the planner row estimates of the
+ * largest tables, as a rough guide to how long the migration will hold the
+ * database, so upgrades can be planned to fit maintenance windows.
+ *
+ * @param[in]  log_config  Log configuration.
+ * @param[in]  database    Location of manage database.
+ *
+ * @return 0 migrations pending, 1 already on supported version, 2 too hard,
+ *         -1 error.
+ */
+int
+manage_migrate_dry_run (GSList *log_config, const db_conn_info_t *database)
+{
+  migrator_t *migrators;
+  iterator_t tables;
+  int old_version, new_version;
+
+  g_log_set_handler (
+    G_LOG_DOMAIN, ALL_LOG_LEVELS, (GLogFunc) gvm_log_func, log_config);
+
+  init_manage_process (database);
+
+  old_version = manage_db_version ();
+  new_version = manage_db_supported_version ();
+
+  if (old_version == -1)
+    {
+      cleanup_manage_process (TRUE);
+      return -1;
+    }
+
+  if (old_version == -2 || old_version == new_version)
+    {
+      g_info ("   Database already at supported version %i.", new_version);
+      cleanup_manage_process (TRUE);
+      return 1;
+    }
+
+  switch (migrate_is_available (old_version, new_version))
+    {
+    case -1:
+      cleanup_manage_process (TRUE);
+      return -1;
+    case 0:
+      cleanup_manage_process (TRUE);
+      return 2;
+    }
+
+  g_info ("   Database at version %i, supported version is %i.",
+          old_version, new_version);
+
+  migrators = database_migrators + old_version - MIGRATE_MIN_OLD_VERSION;
+
+  while ((migrators->version >= 0) && (migrators->version <= new_version))
+    {
+      g_info ("   Would migrate to %i", migrators->version);
+      migrators++;
+    }
+
+  /* Migration time is dominated by the passes over the largest tables and by
+   * the final ANALYZE, so print the planner row estimates of those tables. */
+
+  init_iterator (&tables,
+                 "SELECT relname, reltuples::bigint FROM pg_class"
+                 " WHERE relkind = 'r'"
+                 " AND relnamespace = 'public'::regnamespace"
+                 " ORDER BY reltuples DESC"
+                 " LIMIT 10;");
+  while (next (&tables))
+    g_info ("   Table %s: around %lli rows",
+            iterator_string (&tables, 0),
+            iterator_int64 (&tables, 1));
+  cleanup_iterator (&tables);
+
+  cleanup_manage_process (TRUE);
+  return 0;
+}
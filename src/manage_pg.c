@@ -26,11 +26,19 @@
 
 #include <strings.h> /* for strcasecmp() */
 #include <assert.h>  /* for assert() */
+#include <errno.h>
+#include <stdlib.h>  /* for exit() */
+#include <string.h>  /* for strerror() */
+#include <sys/wait.h> /* for waitpid() */
+#include <time.h>
 
+#include "debug_utils.h" /* for init_sentry() */
 #include "sql.h"
 #include "manage_sql.h"
+#include "manage_sql_secinfo.h"
 #include "manage_utils.h"
 #include "manage_acl.h"
+#include "utils.h" /* for fork_with_handlers() */
 
 #undef G_LOG_DOMAIN
 /**
@@ -177,6 +185,70 @@ sql_rename_column (const char *old_table, const char *new_table,
  "    LIMIT 1),"                                            \
  "   " severity_sql ")"
 
+/**
+ * @brief Path of the gvm-pg-server library, as seen by the database server.
+ */
+#define GVM_PG_SERVER_LIB GVM_LIB_INSTALL_DIR "/libgvm-pg-server"
+
+/**
+ * @brief Create the SQL functions served in C by the gvm-pg-server library.
+ *
+ * These are the per row functions that the severity counts call once per
+ * result, where the C versions save the interpreter overhead of the
+ * pl/pgsql and SQL versions defined in \ref manage_create_sql_functions.
+ *
+ * @return 0 success, -1 the library is not usable on the database server.
+ */
+static int
+manage_create_c_functions ()
+{
+  /* Probe with a symbol that only the current library exports, so that a
+   * stale library from an earlier install, whose compatibility stubs
+   * just return NULL, is never bound.  The temporary function goes away
+   * with the session. */
+  if (sql_error ("CREATE OR REPLACE FUNCTION pg_temp.c_function_probe"
+                 " (double precision, text)"
+                 " RETURNS boolean"
+                 " AS '" GVM_PG_SERVER_LIB "', 'sql_severity_in_level'"
+                 " LANGUAGE C STABLE;"))
+    return -1;
+
+  sql ("CREATE OR REPLACE FUNCTION severity_matches_ov"
+       " (a double precision, b double precision)"
+       " RETURNS boolean"
+       " AS '" GVM_PG_SERVER_LIB "', 'sql_severity_matches_ov'"
+       " LANGUAGE C IMMUTABLE;");
+
+  sql ("CREATE OR REPLACE FUNCTION level_max_severity (lvl text, cls text)"
+       " RETURNS double precision"
+       " AS '" GVM_PG_SERVER_LIB "', 'sql_level_max_severity'"
+       " LANGUAGE C;");
+
+  sql ("CREATE OR REPLACE FUNCTION level_min_severity (lvl text, cls text)"
+       " RETURNS double precision"
+       " AS '" GVM_PG_SERVER_LIB "', 'sql_level_min_severity'"
+       " LANGUAGE C;");
+
+  sql ("CREATE OR REPLACE FUNCTION severity_in_level (double precision,"
+       "                                              text)"
+       " RETURNS boolean"
+       " AS '" GVM_PG_SERVER_LIB "', 'sql_severity_in_level'"
+       " LANGUAGE C STABLE;");
+
+  sql ("CREATE OR REPLACE FUNCTION severity_to_level (double precision,"
+       "                                              integer)"
+       " RETURNS text"
+       " AS '" GVM_PG_SERVER_LIB "', 'sql_severity_to_level'"
+       " LANGUAGE C IMMUTABLE;");
+
+  sql ("CREATE OR REPLACE FUNCTION severity_to_level (text, integer)"
+       " RETURNS text"
+       " AS '" GVM_PG_SERVER_LIB "', 'sql_severity_to_level_text'"
+       " LANGUAGE C IMMUTABLE;");
+
+  return 0;
+}
+
 /**
  * @brief Create functions.
  *
@@ -186,6 +258,7 @@ int
 manage_create_sql_functions ()
 {
   static int created = 0;
+  int c_functions;
   int current_db_version = manage_db_version ();
 
   if (created)
@@ -446,6 +519,90 @@ manage_create_sql_functions ()
            " END;"
            "$$ LANGUAGE plpgsql;");
 
+      sql ("CREATE OR REPLACE FUNCTION resource_name_fast (text, text,"
+           "                                               integer)"
+           " RETURNS text AS $$"
+           /* Variant of resource_name for use in listings.  The frequent
+            * types are handled with static statements, whose plans plpgsql
+            * caches for the session, instead of the dynamic SQL in
+            * resource_name, which is parsed and planned again on every
+            * call.  Rarer types fall through to resource_name. */
+           " BEGIN"
+           "   CASE"
+           "   WHEN $1 = 'task'"
+           "   THEN RETURN (SELECT name FROM tasks WHERE uuid = $2);"
+           "   WHEN $1 = 'target'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM targets WHERE uuid = $2);"
+           "   WHEN $1 = 'target'"
+           "   THEN RETURN (SELECT name FROM targets_trash WHERE uuid = $2);"
+           "   WHEN $1 = 'config'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM configs WHERE uuid = $2);"
+           "   WHEN $1 = 'config'"
+           "   THEN RETURN (SELECT name FROM configs_trash WHERE uuid = $2);"
+           "   WHEN $1 = 'port_list'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM port_lists WHERE uuid = $2);"
+           "   WHEN $1 = 'port_list'"
+           "   THEN RETURN (SELECT name FROM port_lists_trash"
+           "                WHERE uuid = $2);"
+           "   WHEN $1 = 'credential'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM credentials WHERE uuid = $2);"
+           "   WHEN $1 = 'credential'"
+           "   THEN RETURN (SELECT name FROM credentials_trash"
+           "                WHERE uuid = $2);"
+           "   WHEN $1 = 'scanner'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM scanners WHERE uuid = $2);"
+           "   WHEN $1 = 'scanner'"
+           "   THEN RETURN (SELECT name FROM scanners_trash WHERE uuid = $2);"
+           "   WHEN $1 = 'schedule'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM schedules WHERE uuid = $2);"
+           "   WHEN $1 = 'schedule'"
+           "   THEN RETURN (SELECT name FROM schedules_trash"
+           "                WHERE uuid = $2);"
+           "   WHEN $1 = 'alert'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM alerts WHERE uuid = $2);"
+           "   WHEN $1 = 'alert'"
+           "   THEN RETURN (SELECT name FROM alerts_trash WHERE uuid = $2);"
+           "   WHEN $1 = 'filter'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM filters WHERE uuid = $2);"
+           "   WHEN $1 = 'filter'"
+           "   THEN RETURN (SELECT name FROM filters_trash WHERE uuid = $2);"
+           "   WHEN $1 = 'group'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM groups WHERE uuid = $2);"
+           "   WHEN $1 = 'group'"
+           "   THEN RETURN (SELECT name FROM groups_trash WHERE uuid = $2);"
+           "   WHEN $1 = 'role'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM roles WHERE uuid = $2);"
+           "   WHEN $1 = 'role'"
+           "   THEN RETURN (SELECT name FROM roles_trash WHERE uuid = $2);"
+           "   WHEN $1 = 'report_format'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM report_formats WHERE uuid = $2);"
+           "   WHEN $1 = 'report_format'"
+           "   THEN RETURN (SELECT name FROM report_formats_trash"
+           "                WHERE uuid = $2);"
+           "   WHEN $1 = 'ticket'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM tickets WHERE uuid = $2);"
+           "   WHEN $1 = 'ticket'"
+           "   THEN RETURN (SELECT name FROM tickets_trash WHERE uuid = $2);"
+           "   WHEN $1 = 'user'"
+           "        AND $3 = " G_STRINGIFY (LOCATION_TABLE)
+           "   THEN RETURN (SELECT name FROM users WHERE uuid = $2);"
+           "   ELSE RETURN resource_name ($1, $2, $3);"
+           "   END CASE;"
+           " END;"
+           "$$ LANGUAGE plpgsql STABLE;");
+
       created = 1;
     }
 
@@ -895,6 +1052,20 @@ manage_create_sql_functions ()
        "$$ LANGUAGE plpgsql"
        " IMMUTABLE;");
 
+  /* Content hash of the fields that identify a result across reports,
+   * used for delta report comparison. */
+  sql ("CREATE OR REPLACE FUNCTION result_delta_hash ("
+       "  host text, port text, nvt text, description text)"
+       "RETURNS text AS $$ "
+       "BEGIN"
+       "  RETURN md5 (coalesce (host, '')"
+       "              || '|' || normalize_port (coalesce (port, ''))"
+       "              || '|' || coalesce (nvt, '')"
+       "              || '|' || coalesce (description, ''));"
+       "END;"
+       "$$ LANGUAGE plpgsql"
+       " IMMUTABLE;");
+
   sql ("CREATE OR REPLACE FUNCTION report_compliance_status ("
        "  report_id integer)"
        "RETURNS text AS $$ "
@@ -1091,15 +1262,31 @@ manage_create_sql_functions ()
 
       sql ("CREATE OR REPLACE FUNCTION report_progress (integer)"
            " RETURNS integer AS $$"
-           /* Get the progress of a report. */
+           /* Get the progress of a report.
+            *
+            * The progress counter is maintained on the reports row while
+            * the scan runs, so this is a single row read. */
            "  SELECT CASE"
            "         WHEN $1 = 0"
            "         THEN -1"
-           "         WHEN report_active ($1)"
-           "         THEN (SELECT slave_progress FROM reports WHERE id = $1)"
-           "         ELSE -1"
+           "         ELSE (SELECT CASE"
+           "                      WHEN scan_run_status"
+           "                           IN (%i, %i, %i, %i, %i, %i, %i, %i, %i)"
+           "                      THEN slave_progress"
+           "                      ELSE -1"
+           "                      END"
+           "               FROM reports WHERE id = $1)"
            "         END;"
-           "$$ LANGUAGE SQL;");
+           "$$ LANGUAGE SQL;",
+           TASK_STATUS_REQUESTED,
+           TASK_STATUS_RUNNING,
+           TASK_STATUS_DELETE_REQUESTED,
+           TASK_STATUS_DELETE_ULTIMATE_REQUESTED,
+           TASK_STATUS_STOP_REQUESTED,
+           TASK_STATUS_STOPPED,
+           TASK_STATUS_INTERRUPTED,
+           TASK_STATUS_QUEUED,
+           TASK_STATUS_PROCESSING);
 
       sql ("CREATE OR REPLACE FUNCTION dynamic_severity ()"
            " RETURNS boolean AS $$"
@@ -1788,6 +1975,18 @@ manage_create_sql_functions ()
            "$$ LANGUAGE SQL;");
     }
 
+  /* Replace the hot per row functions with the C versions from the
+   * gvm-pg-server library, when the library is installed on the database
+   * server.  The interpreted definitions above remain the fallback. */
+
+  sql ("SET ROLE \"%s\";", DB_SUPERUSER_ROLE);
+  c_functions = (manage_create_c_functions () == 0);
+  sql ("RESET role;");
+  if (c_functions == 0)
+    g_info ("%s: gvm-pg-server library not usable, keeping the pl/pgsql"
+            " severity functions",
+            __func__);
+
   return 0;
 }
 
@@ -1806,14 +2005,116 @@ manage_create_result_indexes ()
   sql ("SELECT create_index ('results_by_nvt', 'results', 'nvt');");
   sql ("SELECT create_index ('results_by_task', 'results', 'task');");
   sql ("SELECT create_index ('results_by_date', 'results', 'date');");
+  sql ("SELECT create_index ('results_by_report_and_delta_hash', 'results',"
+       "                     'report, delta_hash');");
+  sql ("SELECT create_index ('results_by_report_and_nvt', 'results',"
+       "                     'report, nvt');");
 }
 
 /**
  * @brief Create or replace the vulns view.
+ *
+ * The used_nvts table replaces the DISTINCT scan of results that the view
+ * used to run on every access.  It is maintained incrementally by statement
+ * level triggers on results, so it stays correct as results are inserted
+ * and reports or tasks are deleted, at any data size.
  */
 void
 create_view_vulns ()
 {
+  if (sql_int ("SELECT EXISTS (SELECT * FROM information_schema.tables"
+               "               WHERE table_catalog = '%s'"
+               "               AND table_schema = 'public'"
+               "               AND table_name = 'used_nvts')"
+               " ::integer;",
+               sql_database ())
+      == 0)
+    {
+      sql ("CREATE TABLE used_nvts"
+           " (nvt text PRIMARY KEY,"
+           "  count integer);");
+
+      /* The ORDER BY in the trigger bodies keeps the row lock order stable
+       * between concurrent bulk changes, to avoid deadlocks. */
+
+      sql ("CREATE OR REPLACE FUNCTION used_nvts_results_insert ()"
+           " RETURNS TRIGGER AS $$"
+           " BEGIN"
+           "   INSERT INTO used_nvts (nvt, count)"
+           "   SELECT nvt, count(*) FROM new_results"
+           "   WHERE severity != " G_STRINGIFY (SEVERITY_ERROR)
+           "   GROUP BY nvt"
+           "   ORDER BY nvt"
+           "   ON CONFLICT (nvt)"
+           "   DO UPDATE SET count = used_nvts.count + EXCLUDED.count;"
+           "   RETURN NULL;"
+           " END;"
+           "$$ LANGUAGE plpgsql;");
+
+      sql ("CREATE OR REPLACE FUNCTION used_nvts_results_delete ()"
+           " RETURNS TRIGGER AS $$"
+           " BEGIN"
+           "   UPDATE used_nvts"
+           "   SET count = used_nvts.count - removed.count"
+           "   FROM (SELECT nvt, count(*) AS count FROM old_results"
+           "         WHERE severity != " G_STRINGIFY (SEVERITY_ERROR)
+           "         GROUP BY nvt"
+           "         ORDER BY nvt) AS removed"
+           "   WHERE used_nvts.nvt = removed.nvt;"
+           "   DELETE FROM used_nvts WHERE count <= 0;"
+           "   RETURN NULL;"
+           " END;"
+           "$$ LANGUAGE plpgsql;");
+
+      sql ("CREATE OR REPLACE FUNCTION used_nvts_results_update ()"
+           " RETURNS TRIGGER AS $$"
+           " BEGIN"
+           "   INSERT INTO used_nvts (nvt, count)"
+           "   SELECT nvt, count(*) FROM new_results"
+           "   WHERE severity != " G_STRINGIFY (SEVERITY_ERROR)
+           "   GROUP BY nvt"
+           "   ORDER BY nvt"
+           "   ON CONFLICT (nvt)"
+           "   DO UPDATE SET count = used_nvts.count + EXCLUDED.count;"
+           "   UPDATE used_nvts"
+           "   SET count = used_nvts.count - removed.count"
+           "   FROM (SELECT nvt, count(*) AS count FROM old_results"
+           "         WHERE severity != " G_STRINGIFY (SEVERITY_ERROR)
+           "         GROUP BY nvt"
+           "         ORDER BY nvt) AS removed"
+           "   WHERE used_nvts.nvt = removed.nvt;"
+           "   DELETE FROM used_nvts WHERE count <= 0;"
+           "   RETURN NULL;"
+           " END;"
+           "$$ LANGUAGE plpgsql;");
+
+      sql ("DROP TRIGGER IF EXISTS results_used_nvts_insert ON results;");
+      sql ("CREATE TRIGGER results_used_nvts_insert"
+           " AFTER INSERT ON results"
+           " REFERENCING NEW TABLE AS new_results"
+           " FOR EACH STATEMENT"
+           " EXECUTE PROCEDURE used_nvts_results_insert ();");
+
+      sql ("DROP TRIGGER IF EXISTS results_used_nvts_delete ON results;");
+      sql ("CREATE TRIGGER results_used_nvts_delete"
+           " AFTER DELETE ON results"
+           " REFERENCING OLD TABLE AS old_results"
+           " FOR EACH STATEMENT"
+           " EXECUTE PROCEDURE used_nvts_results_delete ();");
+
+      sql ("DROP TRIGGER IF EXISTS results_used_nvts_update ON results;");
+      sql ("CREATE TRIGGER results_used_nvts_update"
+           " AFTER UPDATE OF nvt, severity ON results"
+           " REFERENCING OLD TABLE AS old_results NEW TABLE AS new_results"
+           " FOR EACH STATEMENT"
+           " EXECUTE PROCEDURE used_nvts_results_update ();");
+
+      sql ("INSERT INTO used_nvts (nvt, count)"
+           " SELECT nvt, count(*) FROM results"
+           " WHERE severity != " G_STRINGIFY (SEVERITY_ERROR)
+           " GROUP BY nvt;");
+    }
+
   sql ("DROP VIEW IF EXISTS vulns;");
 
   if (sql_int ("SELECT EXISTS (SELECT * FROM information_schema.tables"
@@ -1823,28 +2124,22 @@ create_view_vulns ()
                " ::integer;",
                sql_database ()))
     sql ("CREATE OR REPLACE VIEW vulns AS"
-         " WITH used_nvts"
-         " AS (SELECT DISTINCT nvt FROM results"
-         "     WHERE (results.severity != " G_STRINGIFY (SEVERITY_ERROR) "))"
          " SELECT id, uuid, name, creation_time, modification_time,"
          "        cvss_base::double precision AS severity, qod, 'nvt' AS type"
          " FROM nvts"
-         " WHERE uuid in (SELECT * FROM used_nvts)"
+         " WHERE uuid in (SELECT nvt FROM used_nvts)"
          " UNION SELECT id, uuid, name, creation_time, modification_time,"
          "       severity, "
          G_STRINGIFY (QOD_DEFAULT) " AS qod,"
          "       'cve' AS type"
          " FROM cves"
-         " WHERE uuid in (SELECT * FROM used_nvts)");
+         " WHERE uuid in (SELECT nvt FROM used_nvts)");
   else
     sql ("CREATE OR REPLACE VIEW vulns AS"
-         " WITH used_nvts"
-         " AS (SELECT DISTINCT nvt FROM results"
-         "     WHERE (results.severity != " G_STRINGIFY (SEVERITY_ERROR) "))"
          " SELECT id, uuid, name, creation_time, modification_time,"
          "        cvss_base::double precision AS severity, qod, 'nvt' AS type"
          " FROM nvts"
-         " WHERE uuid in (SELECT * FROM used_nvts)");
+         " WHERE uuid in (SELECT nvt FROM used_nvts)");
 }
 
 /**
@@ -2103,6 +2398,21 @@ create_tables ()
        "  name text,"
        "  data text);");
 
+  sql ("CREATE TABLE IF NOT EXISTS alert_deliveries"
+       " (id SERIAL PRIMARY KEY,"
+       "  uuid text UNIQUE NOT NULL,"
+       "  alert integer REFERENCES alerts (id) ON DELETE RESTRICT,"
+       "  task integer,"
+       "  report integer,"
+       "  event integer,"
+       "  event_data integer,"
+       "  status integer,"
+       "  attempts integer,"
+       "  next_attempt integer,"
+       "  message text,"
+       "  creation_time integer,"
+       "  modification_time integer);");
+
   sql ("CREATE TABLE IF NOT EXISTS credentials"
        " (id SERIAL PRIMARY KEY,"
        "  uuid text UNIQUE NOT NULL,"
@@ -2327,6 +2637,10 @@ create_tables ()
        "  comment text,"
        "  exclude integer);");
 
+  sql ("CREATE TABLE IF NOT EXISTS port_list_range_cache"
+       " (port_list integer PRIMARY KEY," /* REFERENCES port_lists (id) */
+       "  ranges text);");
+
   sql ("CREATE TABLE IF NOT EXISTS port_ranges_trash"
        " (id SERIAL PRIMARY KEY,"
        "  uuid text UNIQUE NOT NULL,"
@@ -2541,6 +2855,10 @@ create_tables ()
        "  scanner_location integer,"
        "  usage_type text);");
 
+  sql ("CREATE TABLE IF NOT EXISTS config_nvts"
+       " (config integer,"  /* REFERENCES configs (id) */
+       "  nvt text);");
+
   sql ("CREATE TABLE IF NOT EXISTS config_preferences"
        " (id SERIAL PRIMARY KEY,"
        "  config integer REFERENCES configs (id) ON DELETE RESTRICT,"
@@ -2687,6 +3005,16 @@ create_tables ()
        "  end_time integer,"
        "  min_qod integer);");
 
+  sql ("CREATE TABLE IF NOT EXISTS report_filter_counts"
+       " (id SERIAL PRIMARY KEY,"
+       "  report integer REFERENCES reports (id) ON DELETE RESTRICT,"
+       "  \"user\" integer REFERENCES users (id) ON DELETE RESTRICT,"
+       "  term text,"
+       "  override integer,"
+       "  severity decimal,"
+       "  count integer,"
+       "  end_time integer);");
+
   sql ("CREATE TABLE IF NOT EXISTS results"
        " (id SERIAL PRIMARY KEY,"
        "  uuid text UNIQUE NOT NULL,"
@@ -2706,7 +3034,8 @@ create_tables ()
        "  date integer,"
        "  hostname text,"
        "  path text,"
-       "  hash_value text);");
+       "  hash_value text,"
+       "  delta_hash text);");
 
   sql ("CREATE TABLE IF NOT EXISTS results_trash"
        " (id SERIAL PRIMARY KEY,"
@@ -2728,6 +3057,24 @@ create_tables ()
        "  hostname text,"
        "  path text);");
 
+  /* Store new result descriptions LZ4 compressed where the server supports
+   * it (PostgreSQL 14+ built with LZ4).  Descriptions dominate the size of
+   * the results tables, LZ4 detoasting is several times faster than the
+   * default pglz, and the lower TOAST target makes medium size descriptions
+   * eligible for compression at all.  Existing rows keep their storage;
+   * reads are decompressed transparently either way. */
+  if (sql_int ("SELECT EXISTS (SELECT * FROM pg_settings"
+               "               WHERE name = 'default_toast_compression'"
+               "               AND 'lz4' = ANY (enumvals))::integer;"))
+    {
+      sql ("ALTER TABLE results"
+           " ALTER COLUMN description SET COMPRESSION lz4;");
+      sql ("ALTER TABLE results SET (toast_tuple_target = 256);");
+      sql ("ALTER TABLE results_trash"
+           " ALTER COLUMN description SET COMPRESSION lz4;");
+      sql ("ALTER TABLE results_trash SET (toast_tuple_target = 256);");
+    }
+
   /* All the NVTs that have ever been encountered in results and overrides.
    *
    * This gives the textual NVT oids an integer ID, so that they can be
@@ -2865,18 +3212,155 @@ create_tables ()
        "  current_port integer,"
        "  max_port integer);");
 
-  sql ("CREATE TABLE IF NOT EXISTS report_host_details"
+  /* Host details are stored dictionary encoded: the highly repetitive
+   * detail strings are interned once in report_host_detail_texts and the
+   * detail rows hold the text ids.  The report_host_details view below
+   * presents the old plain text layout, so the rest of the code can keep
+   * reading and writing details as before. */
+
+  sql ("CREATE TABLE IF NOT EXISTS report_host_detail_texts"
+       " (id SERIAL PRIMARY KEY,"
+       "  text text UNIQUE NOT NULL);");
+
+  sql ("CREATE TABLE IF NOT EXISTS report_host_detail_rows"
        " (id SERIAL PRIMARY KEY,"
        "  report_host integer REFERENCES report_hosts (id) ON DELETE RESTRICT,"
-       "  source_type text,"
-       "  source_name text,"
-       "  source_description text,"
-       "  name text,"
-       "  value text,"
+       "  source_type integer," // REFERENCES report_host_detail_texts (id),
+       "  source_name integer," // REFERENCES report_host_detail_texts (id),
+       "  source_description integer," // REFERENCES report_host_detail_texts (id),
+       "  name integer," // REFERENCES report_host_detail_texts (id),
+       "  value integer," // REFERENCES report_host_detail_texts (id),
        "  hash_value text);");
 
+  sql ("CREATE OR REPLACE FUNCTION report_host_detail_intern (detail_text"
+       "                                                      text)"
+       " RETURNS integer AS $$"
+       " DECLARE text_id integer;"
+       " BEGIN"
+       "   IF detail_text IS NULL THEN"
+       "     RETURN NULL;"
+       "   END IF;"
+       "   LOOP"
+       "     SELECT id INTO text_id FROM report_host_detail_texts"
+       "     WHERE text = detail_text;"
+       "     IF FOUND THEN"
+       "       RETURN text_id;"
+       "     END IF;"
+       "     INSERT INTO report_host_detail_texts (text)"
+       "     VALUES (detail_text)"
+       "     ON CONFLICT (text) DO NOTHING"
+       "     RETURNING id INTO text_id;"
+       "     IF text_id IS NOT NULL THEN"
+       "       RETURN text_id;"
+       "     END IF;"
+       /*    A concurrent insert won the conflict, so reread the id. */
+       "   END LOOP;"
+       " END;"
+       "$$ LANGUAGE plpgsql;");
+
+  if (sql_int ("SELECT EXISTS (SELECT * FROM information_schema.tables"
+               "               WHERE table_catalog = '%s'"
+               "               AND table_schema = 'public'"
+               "               AND table_name = 'report_host_details'"
+               "               AND table_type = 'BASE TABLE')"
+               " ::integer;",
+               sql_database ()))
+    {
+      /* Convert the plain text details of a pre dictionary install. */
+
+      sql ("INSERT INTO report_host_detail_texts (text)"
+           " SELECT DISTINCT detail_text"
+           " FROM (SELECT source_type AS detail_text FROM report_host_details"
+           "       UNION SELECT source_name FROM report_host_details"
+           "       UNION SELECT source_description FROM report_host_details"
+           "       UNION SELECT name FROM report_host_details"
+           "       UNION SELECT value FROM report_host_details) AS texts"
+           " WHERE detail_text IS NOT NULL"
+           " ON CONFLICT (text) DO NOTHING;");
+
+      sql ("INSERT INTO report_host_detail_rows"
+           " (id, report_host, source_type, source_name, source_description,"
+           "  name, value, hash_value)"
+           " SELECT id, report_host,"
+           "        report_host_detail_intern (source_type),"
+           "        report_host_detail_intern (source_name),"
+           "        report_host_detail_intern (source_description),"
+           "        report_host_detail_intern (name),"
+           "        report_host_detail_intern (value),"
+           "        hash_value"
+           " FROM report_host_details;");
+
+      sql ("DROP TABLE report_host_details;");
+    }
+
+  sql ("CREATE OR REPLACE VIEW report_host_details AS"
+       " SELECT details.id AS id,"
+       "        details.report_host AS report_host,"
+       "        source_types.text AS source_type,"
+       "        source_names.text AS source_name,"
+       "        source_descriptions.text AS source_description,"
+       "        names.text AS name,"
+       "        detail_values.text AS value,"
+       "        details.hash_value AS hash_value"
+       " FROM report_host_detail_rows AS details"
+       " LEFT JOIN report_host_detail_texts AS source_types"
+       "   ON source_types.id = details.source_type"
+       " LEFT JOIN report_host_detail_texts AS source_names"
+       "   ON source_names.id = details.source_name"
+       " LEFT JOIN report_host_detail_texts AS source_descriptions"
+       "   ON source_descriptions.id = details.source_description"
+       " LEFT JOIN report_host_detail_texts AS names"
+       "   ON names.id = details.name"
+       " LEFT JOIN report_host_detail_texts AS detail_values"
+       "   ON detail_values.id = details.value;");
+
+  sql ("CREATE OR REPLACE FUNCTION report_host_details_insert ()"
+       " RETURNS TRIGGER AS $$"
+       " BEGIN"
+       "   NEW.id := nextval ('report_host_detail_rows_id_seq');"
+       "   INSERT INTO report_host_detail_rows"
+       "   (id, report_host, source_type, source_name, source_description,"
+       "    name, value, hash_value)"
+       "   VALUES (NEW.id, NEW.report_host,"
+       "           report_host_detail_intern (NEW.source_type),"
+       "           report_host_detail_intern (NEW.source_name),"
+       "           report_host_detail_intern (NEW.source_description),"
+       "           report_host_detail_intern (NEW.name),"
+       "           report_host_detail_intern (NEW.value),"
+       "           NEW.hash_value);"
+       "   RETURN NEW;"
+       " END;"
+       "$$ LANGUAGE plpgsql;");
+
+  sql ("CREATE OR REPLACE FUNCTION report_host_details_delete ()"
+       " RETURNS TRIGGER AS $$"
+       " BEGIN"
+       "   DELETE FROM report_host_detail_rows WHERE id = OLD.id;"
+       "   RETURN OLD;"
+       " END;"
+       "$$ LANGUAGE plpgsql;");
+
+  sql ("DROP TRIGGER IF EXISTS report_host_details_insert"
+       " ON report_host_details;");
+  sql ("CREATE TRIGGER report_host_details_insert"
+       " INSTEAD OF INSERT ON report_host_details"
+       " FOR EACH ROW"
+       " EXECUTE PROCEDURE report_host_details_insert ();");
+
+  sql ("DROP TRIGGER IF EXISTS report_host_details_delete"
+       " ON report_host_details;");
+  sql ("CREATE TRIGGER report_host_details_delete"
+       " INSTEAD OF DELETE ON report_host_details"
+       " FOR EACH ROW"
+       " EXECUTE PROCEDURE report_host_details_delete ();");
+
   create_tables_nvt ("");
 
+  sql ("CREATE TABLE IF NOT EXISTS nvt_families"
+       " (name text UNIQUE NOT NULL,"
+       "  nvt_count integer,"
+       "  max_modification_time integer);");
+
   sql ("CREATE TABLE IF NOT EXISTS notes"
        " (id SERIAL PRIMARY KEY,"
        "  uuid text UNIQUE NOT NULL,"
@@ -3124,6 +3608,12 @@ create_tables ()
 
   /* Create indexes. */
 
+  sql ("SELECT create_index ('alert_deliveries_by_status_next_attempt',"
+       "                     'alert_deliveries', 'status, next_attempt');");
+
+  sql ("SELECT create_index ('config_nvts_by_config',"
+       "                     'config_nvts', 'config, nvt');");
+
   sql ("SELECT create_index ('config_preferences_by_config',"
        "                     'config_preferences', 'config');");
 
@@ -3132,6 +3622,8 @@ create_tables ()
 
   sql ("SELECT create_index ('host_identifiers_by_host',"
        "                     'host_identifiers', 'host');");
+  sql ("SELECT create_index ('host_identifiers_by_host_name_value',"
+       "                     'host_identifiers', 'host, name, value');");
   sql ("SELECT create_index ('host_identifiers_by_value',"
        "                     'host_identifiers', 'value');");
 
@@ -3157,9 +3649,25 @@ create_tables ()
   sql ("SELECT create_index ('report_counts_by_report_and_override',"
        "                     'report_counts', 'report, override');");
 
+  sql ("SELECT create_index ('report_filter_counts_by_report_and_user',"
+       "                     'report_filter_counts', 'report, \"user\"');");
+
   sql ("SELECT create_index ('reports_by_task',"
        "                     'reports', 'task');");
 
+  /* Serves the "last report of the task" probes (task_last_report and
+   * friends), which order by creation_time within a task and status, so
+   * that they stay index lookups on tasks with many reports. */
+  sql ("SELECT create_index ('reports_by_task_status_time',"
+       "                     'reports',"
+       "                     'task, scan_run_status, creation_time DESC');");
+
+  sql ("SELECT create_index ('tasks_by_schedule_next_time',"
+       "                     'tasks', 'schedule_next_time');");
+
+  sql ("SELECT create_index ('tickets_by_task_nvt_host',"
+       "                     'tickets', 'task, nvt, host');");
+
   sql ("SELECT create_index ('tag_resources_by_resource',"
        "                     'tag_resources',"
        "                     'resource_type, resource, resource_location');");
@@ -3179,13 +3687,28 @@ create_tables ()
        "                     'tls_certificate_origins',"
        "                     'origin_id, origin_type')");
 
-  /* Previously this included the value column but that can be bigger than 8191,
-   * the maximum size that Postgres can handle.  For example, this can happen
-   * for "ports".  Mostly value is short, like a CPE for the "App" detail,
-   * which is what the index is for. */
+  sql ("SELECT create_index ('tls_certificates_by_owner_and_sha256_fingerprint',"
+       "                     'tls_certificates',"
+       "                     'owner, sha256_fingerprint')");
+
+  sql ("SELECT create_index ('tls_certificates_by_owner_and_md5_fingerprint',"
+       "                     'tls_certificates',"
+       "                     'owner, md5_fingerprint')");
+
+  sql ("SELECT create_index ('tls_certificates_by_sha256_fingerprint',"
+       "                     'tls_certificates',"
+       "                     'sha256_fingerprint')");
+
+  sql ("SELECT create_index ('tls_certificate_sources_by_cert_location_origin',"
+       "                     'tls_certificate_sources',"
+       "                     'tls_certificate, location, origin')");
+
+  /* The name column is the dictionary id of the detail name, so lookups
+   * like the "App" details of a report host stay on this index after the
+   * planner has resolved the name to its id. */
   sql ("SELECT create_index"
-       "        ('report_host_details_by_report_host_and_name',"
-       "         'report_host_details',"
+       "        ('report_host_detail_rows_by_report_host_and_name',"
+       "         'report_host_detail_rows',"
        "         'report_host, name');");
   sql ("SELECT create_index"
        "        ('report_hosts_by_report_and_host',"
@@ -3382,8 +3905,8 @@ manage_db_init (const gchar *name)
 {
   if (strcasecmp (name, "cert") == 0)
     {
-      sql ("DROP SCHEMA IF EXISTS cert CASCADE;");
-      sql ("CREATE SCHEMA cert;");
+      sql ("DROP SCHEMA IF EXISTS cert2 CASCADE;");
+      sql ("CREATE SCHEMA cert2;");
 
       sql ("SELECT set_config ('search_path',"
            "                   current_setting ('search_path') || ',cert',"
@@ -3391,12 +3914,12 @@ manage_db_init (const gchar *name)
 
       /* Create tables and indexes. */
 
-      sql ("CREATE TABLE cert.meta"
+      sql ("CREATE TABLE cert2.meta"
            " (id SERIAL PRIMARY KEY,"
            "  name text UNIQUE,"
            "  value text);");
 
-      sql ("CREATE TABLE cert.cert_bund_advs"
+      sql ("CREATE TABLE cert2.cert_bund_advs"
            " (id SERIAL PRIMARY KEY,"
            "  uuid text UNIQUE,"
            "  name text UNIQUE,"
@@ -3408,19 +3931,19 @@ manage_db_init (const gchar *name)
            "  cve_refs INTEGER,"
            "  severity DOUBLE PRECISION);");
       sql ("CREATE UNIQUE INDEX cert_bund_advs_idx"
-           " ON cert.cert_bund_advs (name);");
+           " ON cert2.cert_bund_advs (name);");
       sql ("CREATE INDEX cert_bund_advs_by_creation_time"
-           " ON cert.cert_bund_advs (creation_time);");
+           " ON cert2.cert_bund_advs (creation_time);");
 
-      sql ("CREATE TABLE cert.cert_bund_cves"
+      sql ("CREATE TABLE cert2.cert_bund_cves"
            " (adv_id INTEGER,"
            "  cve_name VARCHAR(20));");
       sql ("CREATE INDEX cert_bund_cves_adv_idx"
-           " ON cert.cert_bund_cves (adv_id);");
+           " ON cert2.cert_bund_cves (adv_id);");
       sql ("CREATE INDEX cert_bund_cves_cve_idx"
-           " ON cert.cert_bund_cves (cve_name);");
+           " ON cert2.cert_bund_cves (cve_name);");
 
-      sql ("CREATE TABLE cert.dfn_cert_advs"
+      sql ("CREATE TABLE cert2.dfn_cert_advs"
            " (id SERIAL PRIMARY KEY,"
            "  uuid text UNIQUE,"
            "  name text UNIQUE,"
@@ -3432,21 +3955,21 @@ manage_db_init (const gchar *name)
            "  cve_refs INTEGER,"
            "  severity DOUBLE PRECISION);");
       sql ("CREATE UNIQUE INDEX dfn_cert_advs_idx"
-           " ON cert.dfn_cert_advs (name);");
+           " ON cert2.dfn_cert_advs (name);");
       sql ("CREATE INDEX dfn_cert_advs_by_creation_time"
-           " ON cert.dfn_cert_advs (creation_time);");
+           " ON cert2.dfn_cert_advs (creation_time);");
 
-      sql ("CREATE TABLE cert.dfn_cert_cves"
+      sql ("CREATE TABLE cert2.dfn_cert_cves"
            " (adv_id INTEGER,"
            "  cve_name text);");
       sql ("CREATE INDEX dfn_cert_cves_adv_idx"
-           " ON cert.dfn_cert_cves (adv_id);");
+           " ON cert2.dfn_cert_cves (adv_id);");
       sql ("CREATE INDEX dfn_cert_cves_cve_idx"
-           " ON cert.dfn_cert_cves (cve_name);");
+           " ON cert2.dfn_cert_cves (cve_name);");
 
       /* Create deletion triggers. */
 
-      sql ("CREATE OR REPLACE FUNCTION cert.cert_delete_bund_adv ()"
+      sql ("CREATE OR REPLACE FUNCTION cert2.cert_delete_bund_adv ()"
            " RETURNS TRIGGER AS $$"
            " BEGIN"
            "   DELETE FROM cert_bund_cves where adv_id = old.id;"
@@ -3455,10 +3978,10 @@ manage_db_init (const gchar *name)
            "$$ LANGUAGE plpgsql;");
 
       sql ("CREATE TRIGGER bund_delete"
-           " AFTER DELETE ON cert.cert_bund_advs"
-           " FOR EACH ROW EXECUTE PROCEDURE cert.cert_delete_bund_adv ();");
+           " AFTER DELETE ON cert2.cert_bund_advs"
+           " FOR EACH ROW EXECUTE PROCEDURE cert2.cert_delete_bund_adv ();");
 
-      sql ("CREATE OR REPLACE FUNCTION cert.cert_delete_cve ()"
+      sql ("CREATE OR REPLACE FUNCTION cert2.cert_delete_cve ()"
            " RETURNS TRIGGER AS $$"
            " BEGIN"
            "   DELETE FROM dfn_cert_cves where adv_id = old.id;"
@@ -3467,15 +3990,15 @@ manage_db_init (const gchar *name)
            "$$ LANGUAGE plpgsql;");
 
       sql ("CREATE TRIGGER cve_delete"
-           " AFTER DELETE ON cert.dfn_cert_advs"
-           " FOR EACH ROW EXECUTE PROCEDURE cert.cert_delete_cve ();");
+           " AFTER DELETE ON cert2.dfn_cert_advs"
+           " FOR EACH ROW EXECUTE PROCEDURE cert2.cert_delete_cve ();");
 
       /* Init tables. */
 
-      sql ("INSERT INTO cert.meta (name, value)"
+      sql ("INSERT INTO cert2.meta (name, value)"
            " VALUES ('database_version', '%i');",
            GVMD_CERT_DATABASE_VERSION);
-      sql ("INSERT INTO cert.meta (name, value)"
+      sql ("INSERT INTO cert2.meta (name, value)"
            " VALUES ('last_update', '0');");
     }
   else if (strcasecmp (name, "scap") == 0)
@@ -3671,38 +4194,239 @@ manage_db_add_constraints (const gchar *name)
  *
  * @return 0 success, -1 error.
  */
+/**
+ * @brief Index definitions for the scap2 schema.
+ */
+static const struct {
+  const gchar *name;       ///< Name of the index.
+  const gchar *statement;  ///< Statement that creates the index.
+} scap_index_defs[] = {
+  { "cve_idx",
+    "CREATE UNIQUE INDEX cve_idx"
+    " ON scap2.cves (name);" },
+  { "cves_by_creation_time_idx",
+    "CREATE INDEX cves_by_creation_time_idx"
+    " ON scap2.cves (creation_time);" },
+  { "cves_by_modification_time_idx",
+    "CREATE INDEX cves_by_modification_time_idx"
+    " ON scap2.cves (modification_time);" },
+  { "cves_by_severity",
+    "CREATE INDEX cves_by_severity"
+    " ON scap2.cves (severity);" },
+  { "cpe_idx",
+    "CREATE UNIQUE INDEX cpe_idx"
+    " ON scap2.cpes (name);" },
+  { "cpes_by_creation_time_idx",
+    "CREATE INDEX cpes_by_creation_time_idx"
+    " ON scap2.cpes (creation_time);" },
+  { "cpes_by_modification_time_idx",
+    "CREATE INDEX cpes_by_modification_time_idx"
+    " ON scap2.cpes (modification_time);" },
+  { "cpes_by_severity",
+    "CREATE INDEX cpes_by_severity"
+    " ON scap2.cpes (severity);" },
+  { "cpes_by_uuid",
+    "CREATE INDEX cpes_by_uuid"
+    " ON scap2.cpes (uuid);" },
+  { "cpes_by_lower_name",
+    "CREATE INDEX cpes_by_lower_name"
+    " ON scap2.cpes (LOWER (name));" },
+  { "afp_cpe_idx",
+    "CREATE INDEX afp_cpe_idx"
+    " ON scap2.affected_products (cpe, cve);" },
+  { "afp_cve_idx",
+    "CREATE INDEX afp_cve_idx"
+    " ON scap2.affected_products (cve);" },
+  { "epss_scores_by_cve",
+    "CREATE INDEX epss_scores_by_cve"
+    " ON scap2.epss_scores (cve);" },
+};
+
+/**
+ * @brief Create a shard of the scap2 indexes, logging per-index timing.
+ *
+ * @param[in]  offset  Index of the first definition of the shard.
+ * @param[in]  step    Distance between the definitions of the shard.
+ */
+static void
+create_scap_indexes (guint offset, guint step)
+{
+  guint index;
+
+  /* Let PostgreSQL parallelise each build beyond its default. */
+  sql ("SET max_parallel_maintenance_workers TO 4;");
+
+  for (index = offset; index < G_N_ELEMENTS (scap_index_defs); index += step)
+    {
+      time_t start;
+
+      start = time (NULL);
+      sql ("%s", scap_index_defs[index].statement);
+      g_info ("%s: %s: %i s", __func__, scap_index_defs[index].name,
+              (int) (time (NULL) - start));
+    }
+}
+
 int
 manage_db_init_indexes (const gchar *name)
 {
   if (strcasecmp (name, "scap") == 0)
     {
-      sql ("CREATE UNIQUE INDEX cve_idx"
-           " ON scap2.cves (name);");
-      sql ("CREATE INDEX cves_by_creation_time_idx"
-           " ON scap2.cves (creation_time);");
-      sql ("CREATE INDEX cves_by_modification_time_idx"
-           " ON scap2.cves (modification_time);");
-      sql ("CREATE INDEX cves_by_severity"
-           " ON scap2.cves (severity);");
-
-      sql ("CREATE UNIQUE INDEX cpe_idx"
-           " ON scap2.cpes (name);");
-      sql ("CREATE INDEX cpes_by_creation_time_idx"
-           " ON scap2.cpes (creation_time);");
-      sql ("CREATE INDEX cpes_by_modification_time_idx"
-           " ON scap2.cpes (modification_time);");
-      sql ("CREATE INDEX cpes_by_severity"
-           " ON scap2.cpes (severity);");
-      sql ("CREATE INDEX cpes_by_uuid"
-           " ON scap2.cpes (uuid);");
-
-      sql ("CREATE INDEX afp_cpe_idx"
-           " ON scap2.affected_products (cpe);");
-      sql ("CREATE INDEX afp_cve_idx"
-           " ON scap2.affected_products (cve);");
-
-      sql ("CREATE INDEX epss_scores_by_cve"
-           " ON scap2.epss_scores (cve);");
+      int n_workers, worker, fail;
+
+      n_workers = get_secinfo_parallel_workers ();
+      if (n_workers > (int) G_N_ELEMENTS (scap_index_defs))
+        n_workers = G_N_ELEMENTS (scap_index_defs);
+
+      if (n_workers <= 1)
+        {
+          create_scap_indexes (0, 1);
+          return 0;
+        }
+
+      /* Independent indexes, so build them concurrently with one
+       * connection per worker. */
+
+      fail = 0;
+      for (worker = 0; worker < n_workers; worker++)
+        {
+          pid_t pid;
+
+          pid = fork_with_handlers ();
+          switch (pid)
+            {
+              case 0:
+                /* Child.  Reopen the database (required after fork) and
+                 * build every n_workers'th index, starting at worker. */
+                init_sentry ();
+                cleanup_manage_process (FALSE);
+                reinit_manage_process ();
+                manage_session_init (current_credentials.uuid);
+
+                create_scap_indexes (worker, n_workers);
+
+                gvm_close_sentry ();
+                exit (EXIT_SUCCESS);
+
+              case -1:
+                g_warning ("%s: fork failed", __func__);
+                fail = 1;
+                break;
+
+              default:
+                break;
+            }
+        }
+
+      while (1)
+        {
+          int status;
+          pid_t pid;
+
+          pid = waitpid (-1, &status, 0);
+          if (pid == -1)
+            {
+              if (errno == ECHILD)
+                break;
+              if (errno == EINTR)
+                continue;
+              g_warning ("%s: waitpid: %s", __func__, strerror (errno));
+              fail = 1;
+              break;
+            }
+          if ((WIFEXITED (status) && WEXITSTATUS (status) != EXIT_SUCCESS)
+              || WIFSIGNALED (status))
+            fail = 1;
+        }
+
+      if (fail)
+        return -1;
+    }
+  else
+    {
+      assert (0);
+      return -1;
+    }
+
+  return 0;
+}
+
+/**
+ * @brief Create an external database as a copy of the current one.
+ *
+ * Creates the staging schema ("cert2" or "scap2") with indexes and
+ * constraints and fills it with the contents of the corresponding live
+ * schema, so that an update can work incrementally on the copy before
+ * the usual schema swap.
+ *
+ * @param[in]  name  Name.  "cert" or "scap".
+ *
+ * @return 0 success, -1 error.
+ */
+int
+manage_db_copy (const gchar *name)
+{
+  if (strcasecmp (name, "scap") == 0)
+    {
+      static const gchar *tables[] = {
+        "cves", "cpes", "cpe_refs", "cpes_deprecated_by", "cpe_match_nodes",
+        "cpe_nodes_match_criteria", "cpe_match_strings", "cpe_matches",
+        "cpe_details", "affected_products", "epss_scores", "cve_references",
+        NULL };
+      static const gchar *serial_tables[] = {
+        "cves", "cpes", "cpe_refs", "cpes_deprecated_by", "cpe_match_nodes",
+        "cpe_nodes_match_criteria", "cpe_match_strings", "cpe_matches",
+        "cpe_details", "cve_references",
+        NULL };
+      int index;
+
+      if (manage_db_init ("scap"))
+        return -1;
+
+      /* Copy the data before adding the indexes, like the rebuild does. */
+
+      for (index = 0; tables[index]; index++)
+        sql ("INSERT INTO scap2.%s SELECT * FROM scap.%s;",
+             tables[index], tables[index]);
+
+      if (manage_db_init_indexes ("scap")
+          || manage_db_add_constraints ("scap"))
+        return -1;
+
+      /* Move the id sequences past the copied rows. */
+
+      for (index = 0; serial_tables[index]; index++)
+        sql ("SELECT setval ('scap2.%s_id_seq',"
+             "               coalesce ((SELECT max (id) FROM scap2.%s), 0)"
+             "               + 1,"
+             "               false);",
+             serial_tables[index], serial_tables[index]);
+    }
+  else if (strcasecmp (name, "cert") == 0)
+    {
+      static const gchar *tables[] = {
+        "cert_bund_advs", "cert_bund_cves", "dfn_cert_advs", "dfn_cert_cves",
+        NULL };
+      static const gchar *serial_tables[] = {
+        "cert_bund_advs", "dfn_cert_advs",
+        NULL };
+      int index;
+
+      if (manage_db_init ("cert"))
+        return -1;
+
+      for (index = 0; tables[index]; index++)
+        sql ("INSERT INTO cert2.%s SELECT * FROM cert.%s;",
+             tables[index], tables[index]);
+
+      /* Move the id sequences past the copied rows. */
+
+      for (index = 0; serial_tables[index]; index++)
+        sql ("SELECT setval ('cert2.%s_id_seq',"
+             "               coalesce ((SELECT max (id) FROM cert2.%s), 0)"
+             "               + 1,"
+             "               false);",
+             serial_tables[index], serial_tables[index]);
     }
   else
     {
@@ -29,8 +29,11 @@
 #include "postgres.h"
 #include "fmgr.h"
 #include "executor/spi.h"
+#include "utils/builtins.h"
 #include "glib.h"
 
+#include <strings.h> /* for strcasecmp */
+
 #include <gvm/base/hosts.h>
 
 #ifdef PG_MODULE_MAGIC
@@ -62,18 +65,27 @@ sql_hosts_contains (PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1 (sql_level_max_severity);
 
 /**
- * @brief Dummy function to allow restoring gvmd-9.0 dumps.
+ * @brief Return the maximum severity of a severity level.
  *
- * @deprecated This function will be removed once direct migration
- *             compatibility with gvmd 9.0 is no longer required
+ * This is a callback for a SQL function of two arguments.  The second
+ * argument, the severity class, is accepted for compatibility but no
+ * longer used.
  *
- * @return Postgres NULL Datum.
+ * @return Postgres Datum.
  */
- __attribute__((deprecated))
 Datum
 sql_level_max_severity (PG_FUNCTION_ARGS)
 {
-  PG_RETURN_NULL ();
+  char *level;
+  double severity;
+
+  if (PG_ARGISNULL (0))
+    PG_RETURN_FLOAT8 (SEVERITY_UNDEFINED);
+
+  level = text_to_cstring (PG_GETARG_TEXT_PP (0));
+  severity = level_max_severity (level);
+  pfree (level);
+  PG_RETURN_FLOAT8 (severity);
 }
 
 /**
@@ -82,18 +94,27 @@ sql_level_max_severity (PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1 (sql_level_min_severity);
 
 /**
- * @brief Dummy function to allow restoring gvmd-9.0 dumps.
+ * @brief Return the minimum severity of a severity level.
  *
- * @deprecated This function will be removed once direct migration
- *             compatibility with gvmd 9.0 is no longer required
+ * This is a callback for a SQL function of two arguments.  The second
+ * argument, the severity class, is accepted for compatibility but no
+ * longer used.
  *
- * @return Postgres NULL Datum.
+ * @return Postgres Datum.
  */
- __attribute__((deprecated))
 Datum
 sql_level_min_severity (PG_FUNCTION_ARGS)
 {
-  PG_RETURN_NULL ();
+  char *level;
+  double severity;
+
+  if (PG_ARGISNULL (0))
+    PG_RETURN_FLOAT8 (SEVERITY_UNDEFINED);
+
+  level = text_to_cstring (PG_GETARG_TEXT_PP (0));
+  severity = level_min_severity (level);
+  pfree (level);
+  PG_RETURN_FLOAT8 (severity);
 }
 
 /**
@@ -160,17 +181,171 @@ sql_max_hosts (PG_FUNCTION_ARGS)
 PG_FUNCTION_INFO_V1 (sql_severity_matches_ov);
 
 /**
- * @brief Return max severity of level.
+ * @brief Return whether a result severity matches an override severity.
  *
- * This is a callback for a SQL function of one argument.
+ * This is a callback for a SQL function of two arguments.
  *
  * @return Postgres Datum.
  */
- __attribute__((deprecated))
 Datum
 sql_severity_matches_ov (PG_FUNCTION_ARGS)
 {
-  PG_RETURN_NULL ();
+  double severity, ov_severity;
+
+  if (PG_ARGISNULL (0))
+    PG_RETURN_BOOL (0);
+  if (PG_ARGISNULL (1))
+    PG_RETURN_BOOL (1);
+
+  severity = PG_GETARG_FLOAT8 (0);
+  ov_severity = PG_GETARG_FLOAT8 (1);
+  if (severity <= 0)
+    PG_RETURN_BOOL (severity == ov_severity);
+  PG_RETURN_BOOL (severity >= ov_severity);
+}
+
+/**
+ * @brief Define function for Postgres.
+ */
+PG_FUNCTION_INFO_V1 (sql_severity_in_level);
+
+/**
+ * @brief Return whether a severity falls in a severity level.
+ *
+ * This is a callback for a SQL function of two arguments.
+ *
+ * @return Postgres Datum.
+ */
+Datum
+sql_severity_in_level (PG_FUNCTION_ARGS)
+{
+  char *level;
+  double severity;
+  int known, ret;
+
+  if (PG_ARGISNULL (1))
+    PG_RETURN_BOOL (0);
+
+  known = (PG_ARGISNULL (0) == 0);
+  severity = known ? PG_GETARG_FLOAT8 (0) : 0;
+
+  level = text_to_cstring (PG_GETARG_TEXT_PP (1));
+  if (strcasecmp (level, "high") == 0)
+    ret = (severity >= 7 && severity <= 10);
+  else if (strcasecmp (level, "medium") == 0)
+    ret = (severity >= 4 && severity < 7);
+  else if (strcasecmp (level, "low") == 0)
+    ret = (severity > 0 && severity < 4);
+  else if (strcasecmp (level, "none") == 0
+           || strcasecmp (level, "log") == 0)
+    ret = (severity == 0);
+  else if (strcasecmp (level, "false") == 0)
+    ret = (severity == -1);
+  else if (strcasecmp (level, "error") == 0)
+    ret = (severity == -3);
+  else
+    {
+      pfree (level);
+      PG_RETURN_BOOL (0);
+    }
+  pfree (level);
+
+  if (known == 0)
+    /* A NULL severity compared against a known level stays NULL, like
+     * the comparisons in the SQL definition. */
+    PG_RETURN_NULL ();
+  PG_RETURN_BOOL (ret);
+}
+
+/**
+ * @brief Get the level name for a severity.
+ *
+ * @param[in]  severity   Severity.
+ * @param[in]  auto_type  1 if the severity is from an automatic severity
+ *                        override, else 0.
+ *
+ * @return Static level name.
+ */
+static const char *
+severity_to_level_name (double severity, int auto_type)
+{
+  if (severity == SEVERITY_LOG)
+    return "Log";
+  if (severity == SEVERITY_FP)
+    return "False Positive";
+  if (severity == SEVERITY_ERROR)
+    return "Error";
+  if (severity > 0.0 && severity <= 10.0)
+    {
+      if (auto_type == 1)
+        return "Alarm";
+      if (severity >= 7.0)
+        return "High";
+      if (severity >= 4.0)
+        return "Medium";
+      return "Low";
+    }
+  return "Internal Error";
+}
+
+/**
+ * @brief Define function for Postgres.
+ */
+PG_FUNCTION_INFO_V1 (sql_severity_to_level);
+
+/**
+ * @brief Return the level name for a severity.
+ *
+ * This is a callback for a SQL function of two arguments.
+ *
+ * @return Postgres Datum.
+ */
+Datum
+sql_severity_to_level (PG_FUNCTION_ARGS)
+{
+  double severity;
+  int auto_type;
+
+  if (PG_ARGISNULL (0))
+    PG_RETURN_TEXT_P (cstring_to_text ("Internal Error"));
+
+  severity = PG_GETARG_FLOAT8 (0);
+  auto_type = PG_ARGISNULL (1) ? 0 : PG_GETARG_INT32 (1);
+  PG_RETURN_TEXT_P (cstring_to_text (severity_to_level_name (severity,
+                                                             auto_type)));
+}
+
+/**
+ * @brief Define function for Postgres.
+ */
+PG_FUNCTION_INFO_V1 (sql_severity_to_level_text);
+
+/**
+ * @brief Return the level name for a severity given as text.
+ *
+ * This is a callback for a SQL function of two arguments.
+ *
+ * @return Postgres Datum.
+ */
+Datum
+sql_severity_to_level_text (PG_FUNCTION_ARGS)
+{
+  char *severity_text;
+  double severity;
+  int auto_type;
+
+  if (PG_ARGISNULL (0))
+    PG_RETURN_TEXT_P (cstring_to_text ("Internal Error"));
+
+  severity_text = text_to_cstring (PG_GETARG_TEXT_PP (0));
+  /* Parse like the cast to double precision, erroring on bad input. */
+  severity = DatumGetFloat8 (DirectFunctionCall1 (float8in,
+                                                  CStringGetDatum
+                                                   (severity_text)));
+  pfree (severity_text);
+  auto_type = PG_ARGISNULL (1) ? 0 : PG_GETARG_INT32 (1);
+  PG_RETURN_TEXT_P (cstring_to_text (severity_to_level_name (severity,
+                                                             auto_type)));
 }
 
 /**
@@ -41,6 +41,7 @@
 #include "manage_sql_tls_certificates.h"
 #include "manage_acl.h"
 #include "manage_authentication.h"
+#include "ipc.h"
 #include "lsc_user.h"
 #include "sql.h"
 #include "utils.h"
@@ -156,6 +157,12 @@ check_db_extensions ();
 static int
 check_db_encryption_key ();
 
+static void
+credential_decrypt_ctx_reset ();
+
+static void
+credential_package_cache_remove (credential_t, const char *);
+
 void
 manage_attach_databases ();
 
@@ -285,6 +292,9 @@ cleanup_schedule_times ();
 static char *
 permission_name (permission_t);
 
+static GArray *
+permission_subject_users (const char *, resource_t);
+
 static void
 cache_permissions_for_resource (const char *, resource_t, GArray*);
 
@@ -331,6 +341,9 @@ static void
 set_credential_snmp_secret (credential_t, const char *, const char *,
                             const char *);
 
+static int
+setting_auto_cache_rebuild_sql ();
+
 static int
 setting_auto_cache_rebuild_int ();
 
@@ -431,6 +444,21 @@ static int max_email_message_length = MAX_EMAIL_MESSAGE_LENGTH;
  */
 static nvtis_t* nvti_cache = NULL;
 
+/**
+ * @brief Whether to load NVTis on demand instead of the full NVT cache.
+ */
+static int lazy_nvt_cache = 0;
+
+/**
+ * @brief NVTis loaded on demand, keyed by OID.
+ */
+static GHashTable *lazy_nvtis = NULL;
+
+/**
+ * @brief OIDs of the on-demand NVTis, least recently used first.
+ */
+static GQueue lazy_nvti_oids = G_QUEUE_INIT;
+
 /**
  * @brief Name of the database file.
  */
@@ -520,6 +548,7 @@ command_t gmp_commands[]
     {"GET_NVTS", "Get one or all available NVTs."},
     {"GET_NVT_FAMILIES", "Get a list of all NVT families."},
     {"GET_OVERRIDES", "Get all overrides."},
+    {"GET_PERFORMANCE_COUNTERS", "Get the performance counters."},
     {"GET_PERMISSIONS", "Get all permissions."},
     {"GET_PORT_LISTS", "Get all port lists."},
     {"GET_PREFERENCES", "Get preferences for all available NVTs."},
@@ -1614,6 +1643,16 @@ filter_free (array_t *split)
  */
 static int table_order_if_sort_not_specified = 0;
 
+/**
+ * @brief Flag to turn the next GET iterator into a counting aggregate.
+ *
+ * If this is true then the listing query of the next init_get_iterator2_with
+ * call is wrapped in a GROUP BY over its single SELECT column, so the
+ * iterator returns (value, count) rows instead of one row per resource.  The
+ * flag is consumed by init_get_iterator2_with.
+ */
+static int group_by_for_count = 0;
+
 /**
  * @brief Ensure filter parts contains the special keywords.
  *
@@ -2868,7 +2907,107 @@ filter_clause_append_tag_id (GString *clause, keyword_t *keyword,
 }
 
 /**
- * @brief Return SQL WHERE clause for restricting a SELECT to a filter term.
+ * @brief A compiled filter term.
+ *
+ * The outputs of compiling a filter term, kept in the compiled filter
+ * cache so that the term does not have to be split and turned into SQL
+ * again on every GET.
+ */
+typedef struct
+{
+  gchar *clause;         ///< WHERE clause, or NULL.
+  gchar *order;          ///< ORDER clause.
+  int first;             ///< First row.
+  int max;               ///< Max rows, before the rows-per-page default.
+  array_t *permissions;  ///< Values of "permission" keywords.
+  gchar *owner_filter;   ///< Value of "owner" keyword, or NULL.
+} compiled_filter_t;
+
+/**
+ * @brief Cache of compiled filter terms.
+ *
+ * Keyed by resource type, trash flag, user and filter term.  Terms that
+ * contain keywords relative to the current time are never entered.
+ */
+static GHashTable *filter_cache = NULL;
+
+/**
+ * @brief Maximum number of entries in the compiled filter cache.
+ */
+#define FILTER_CACHE_MAX 100
+
+/**
+ * @brief Free a compiled filter.
+ *
+ * @param[in]  compiled  Compiled filter.
+ */
+static void
+compiled_filter_free (compiled_filter_t *compiled)
+{
+  g_free (compiled->clause);
+  g_free (compiled->order);
+  if (compiled->permissions)
+    array_free (compiled->permissions);
+  g_free (compiled->owner_filter);
+  g_free (compiled);
+}
+
+/**
+ * @brief Clear the compiled filter cache.
+ */
+static void
+filter_cache_reset ()
+{
+  if (filter_cache)
+    g_hash_table_remove_all (filter_cache);
+}
+
+/**
+ * @brief Build the compiled filter cache key for a filter term.
+ *
+ * @param[in]  type    Resource type.
+ * @param[in]  filter  Filter term.
+ * @param[in]  trash   Whether the trash table is being queried.
+ *
+ * @return Newly allocated key.
+ */
+static gchar *
+filter_cache_key (const char *type, const char *filter, int trash)
+{
+  return g_strdup_printf ("%s\1%i\1%i\1%s\1%s",
+                          type ? type : "",
+                          trash,
+                          table_order_if_sort_not_specified,
+                          current_credentials.uuid
+                           ? current_credentials.uuid
+                           : "",
+                          filter);
+}
+
+/**
+ * @brief Check whether a keyword was parsed as a time relative to now.
+ *
+ * Relative keywords like "-7d" get the current time baked in when they
+ * are parsed, so a term that contains one cannot be cached.
+ *
+ * @param[in]  keyword  Keyword.
+ *
+ * @return 1 if the keyword is a relative time, else 0.
+ */
+static int
+keyword_relative_time (keyword_t *keyword)
+{
+  int len;
+
+  if (keyword->type != KEYWORD_TYPE_INTEGER || keyword->string == NULL)
+    return 0;
+
+  len = strlen (keyword->string);
+  return len > 1 && strchr ("smhdwMy", keyword->string[len - 1]) != NULL;
+}
+
+/**
+ * @brief Compile a filter term into an SQL WHERE clause.
  *
  * @param[in]  type     Resource type.
  * @param[in]  filter   Filter term.
@@ -2878,18 +3017,23 @@ filter_clause_append_tag_id (GString *clause, keyword_t *keyword,
  * @param[out] trash           Whether the trash table is being queried.
  * @param[out] order_return  If given then order clause.
  * @param[out] first_return  If given then first row.
- * @param[out] max_return    If given then max rows.
+ * @param[out] max_return    If given then max rows, without the
+ *                           rows-per-page default applied.
  * @param[out] permissions   When given then permissions string vector.
  * @param[out] owner_filter  When given then value of owner keyword.
+ * @param[out] cacheable     Set to 0 if the term may compile differently
+ *                           next time, for example because it contains a
+ *                           relative time.
  *
  * @return WHERE clause for filter if one is required, else NULL.
  */
-gchar *
-filter_clause (const char* type, const char* filter,
-               const char **filter_columns, column_t *select_columns,
-               column_t *where_columns, int trash, gchar **order_return,
-               int *first_return, int *max_return, array_t **permissions,
-               gchar **owner_filter)
+static gchar *
+filter_clause_compile (const char* type, const char* filter,
+                       const char **filter_columns, column_t *select_columns,
+                       column_t *where_columns, int trash,
+                       gchar **order_return, int *first_return,
+                       int *max_return, array_t **permissions,
+                       gchar **owner_filter, int *cacheable)
 {
   GString *clause, *order;
   keyword_t **point;
@@ -2932,6 +3076,9 @@ filter_clause (const char* type, const char* filter,
 
       keyword = *point;
 
+      if (cacheable && keyword_relative_time (keyword))
+        *cacheable = 0;
+
       if ((keyword->column == NULL)
           && (strlen (keyword->string) == 0))
         {
@@ -3912,20 +4059,118 @@ filter_clause (const char* type, const char* filter,
   else
     g_string_free (order, TRUE);
 
+  if (strlen (clause->str))
+    return g_string_free (clause, FALSE);
+  g_string_free (clause, TRUE);
+  return NULL;
+}
+
+/**
+ * @brief Return SQL WHERE clause for restricting a SELECT to a filter term.
+ *
+ * Compiled terms are cached, so a term that dashboards send repeatedly
+ * is only split and turned into SQL once.
+ *
+ * @param[in]  type     Resource type.
+ * @param[in]  filter   Filter term.
+ * @param[in]  filter_columns  Filter columns.
+ * @param[in]  select_columns  SELECT columns.
+ * @param[in]  where_columns   Columns in SQL that only appear in WHERE clause.
+ * @param[out] trash           Whether the trash table is being queried.
+ * @param[out] order_return  If given then order clause.
+ * @param[out] first_return  If given then first row.
+ * @param[out] max_return    If given then max rows.
+ * @param[out] permissions   When given then permissions string vector.
+ * @param[out] owner_filter  When given then value of owner keyword.
+ *
+ * @return WHERE clause for filter if one is required, else NULL.
+ */
+gchar *
+filter_clause (const char* type, const char* filter,
+               const char **filter_columns, column_t *select_columns,
+               column_t *where_columns, int trash, gchar **order_return,
+               int *first_return, int *max_return, array_t **permissions,
+               gchar **owner_filter)
+{
+  compiled_filter_t *compiled;
+  gchar *key;
+  int stored, max;
+
+  if (filter == NULL)
+    filter = "";
+
+  while (*filter && isspace (*filter)) filter++;
+
+  key = filter_cache_key (type, filter, trash);
+  compiled = filter_cache ? g_hash_table_lookup (filter_cache, key) : NULL;
+  stored = (compiled != NULL);
+  if (compiled)
+    g_free (key);
+  else
+    {
+      int term_cacheable;
+
+      compiled = g_malloc0 (sizeof (compiled_filter_t));
+      term_cacheable = 1;
+      compiled->clause = filter_clause_compile (type, filter, filter_columns,
+                                                select_columns, where_columns,
+                                                trash, &compiled->order,
+                                                &compiled->first,
+                                                &compiled->max,
+                                                &compiled->permissions,
+                                                &compiled->owner_filter,
+                                                &term_cacheable);
+      if (term_cacheable)
+        {
+          if (filter_cache == NULL)
+            filter_cache
+             = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                      (GDestroyNotify) compiled_filter_free);
+          else if (g_hash_table_size (filter_cache) >= FILTER_CACHE_MAX)
+            g_hash_table_remove_all (filter_cache);
+          g_hash_table_replace (filter_cache, key, compiled);
+          stored = 1;
+        }
+      else
+        g_free (key);
+    }
+
+  /* Copy the compiled filter out to the caller. */
+
+  if (order_return)
+    *order_return = g_strdup (compiled->order);
+  if (first_return)
+    *first_return = compiled->first;
   if (max_return)
     {
-      if (*max_return == -2)
-        setting_value_int (SETTING_UUID_ROWS_PER_PAGE, max_return);
-      else if (*max_return < 1)
-        *max_return = -1;
+      max = compiled->max;
+      if (max == -2)
+        setting_value_int (SETTING_UUID_ROWS_PER_PAGE, &max);
+      else if (max < 1)
+        max = -1;
+
+      *max_return = manage_max_rows (max);
+    }
+  if (permissions)
+    {
+      int index;
 
-      *max_return = manage_max_rows (*max_return);
+      *permissions = make_array ();
+      for (index = 0; index < compiled->permissions->len; index++)
+        array_add (*permissions,
+                   g_strdup (g_ptr_array_index (compiled->permissions,
+                                                index)));
     }
+  if (owner_filter)
+    *owner_filter = g_strdup (compiled->owner_filter);
 
-  if (strlen (clause->str))
-    return g_string_free (clause, FALSE);
-  g_string_free (clause, TRUE);
-  return NULL;
+  if (stored)
+    return g_strdup (compiled->clause);
+
+  key = compiled->clause;
+  compiled->clause = NULL;
+  compiled_filter_free (compiled);
+  return key;
 }
 
 
@@ -4298,9 +4543,143 @@ find_resource_no_acl (const char* type, const char* uuid, resource_t* resource)
 }
 
 
+/**
+ * @brief Maximum number of entries in the UUID to row id cache.
+ */
+#define FIND_RESOURCE_CACHE_MAX 512
+
+/**
+ * @brief Seconds before an entry in the UUID to row id cache expires.
+ *
+ * Bounds how long a cached lookup can outlive a deletion or permission
+ * change made by another process, which this process cannot see.
+ */
+#define FIND_RESOURCE_CACHE_TTL 60
+
+/**
+ * @brief An entry in the UUID to row id cache.
+ */
+typedef struct
+{
+  resource_t resource;  ///< Row id of the resource.
+  time_t added;         ///< Time the entry was added.
+  gint64 used;          ///< Use serial, for choosing the eviction victim.
+} find_resource_cache_entry_t;
+
+/**
+ * @brief Cache of ACL checked UUID to row id lookups.
+ *
+ * Maps "type:trash:user:permission:uuid" to an entry.  Positive lookups
+ * only.
+ */
+static GHashTable *find_resource_cache = NULL;
+
+/**
+ * @brief Use serial of the UUID to row id cache.
+ */
+static gint64 find_resource_cache_serial = 0;
+
+/**
+ * @brief Whether the UUID to row id cache is in use.
+ */
+static int find_resource_cache_enabled = 0;
+
+/**
+ * @brief Turn the UUID to row id cache on or off.
+ *
+ * Called at the start of every GMP command.  The cache is only on during
+ * the read only GET commands, and turning it off also empties it, so a
+ * command that may change the database always looks resources up in the
+ * db and never leaves stale entries behind for later commands.
+ *
+ * @param[in]  enable  Whether to enable the cache.
+ */
+void
+find_resource_cache_mode (int enable)
+{
+  find_resource_cache_enabled = enable;
+  if (enable == 0 && find_resource_cache)
+    g_hash_table_remove_all (find_resource_cache);
+}
+
+/**
+ * @brief Build the key of an ACL checked UUID lookup in the cache.
+ *
+ * @param[in]   type        Type of resource.
+ * @param[in]   uuid        UUID of resource.
+ * @param[in]   permission  Permission.
+ * @param[in]   trash       Whether resource is in trashcan.
+ *
+ * @return Newly allocated key, or NULL when there is no user and the
+ *         lookup may not be cached.
+ */
+static gchar *
+find_resource_cache_key (const char *type, const char *uuid,
+                         const char *permission, int trash)
+{
+  if (find_resource_cache_enabled == 0 || current_credentials.uuid == NULL)
+    return NULL;
+  return g_strdup_printf ("%s:%i:%s:%s:%s",
+                          type,
+                          trash,
+                          current_credentials.uuid,
+                          permission ? permission : "",
+                          uuid);
+}
+
+/**
+ * @brief Add an entry to the UUID to row id cache, evicting when full.
+ *
+ * @param[in]  key       Cache key.  Ownership is taken.
+ * @param[in]  resource  Row id of the resource.
+ */
+static void
+find_resource_cache_add (gchar *key, resource_t resource)
+{
+  find_resource_cache_entry_t *entry;
+
+  if (find_resource_cache == NULL)
+    find_resource_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, g_free);
+
+  if (g_hash_table_size (find_resource_cache) >= FIND_RESOURCE_CACHE_MAX)
+    {
+      GHashTableIter iter;
+      gpointer iter_key, iter_value, victim;
+      gint64 victim_used;
+
+      /* Evict the least recently used entry. */
+      victim = NULL;
+      victim_used = 0;
+      g_hash_table_iter_init (&iter, find_resource_cache);
+      while (g_hash_table_iter_next (&iter, &iter_key, &iter_value))
+        if (victim == NULL
+            || ((find_resource_cache_entry_t *) iter_value)->used
+               < victim_used)
+          {
+            victim = iter_key;
+            victim_used = ((find_resource_cache_entry_t *) iter_value)->used;
+          }
+      if (victim)
+        g_hash_table_remove (find_resource_cache, victim);
+    }
+
+  entry = g_malloc (sizeof (*entry));
+  entry->resource = resource;
+  entry->added = time (NULL);
+  entry->used = ++find_resource_cache_serial;
+  g_hash_table_insert (find_resource_cache, key, entry);
+}
+
 /**
  * @brief Find a resource given a UUID and a permission.
  *
+ * Successful lookups are cached per process, keyed by type, UUID,
+ * permission and user, so repeating commands skip the ACL checked
+ * lookup.  The cache is only active during read only GMP commands, and
+ * entries expire after a short time to cover changes made by other
+ * processes.
+ *
  * @param[in]   type        Type of resource.
  * @param[in]   uuid        UUID of resource.
  * @param[out]  resource    Resource return, 0 if successfully failed to find
@@ -4316,15 +4695,36 @@ find_resource_with_permission (const char* type, const char* uuid,
                                resource_t* resource, const char *permission,
                                int trash)
 {
-  gchar *quoted_uuid;
+  gchar *quoted_uuid, *key;
   if (uuid == NULL)
     return TRUE;
   if ((type == NULL) || (valid_db_resource_type (type) == 0))
     return TRUE;
+
+  key = find_resource_cache_key (type, uuid, permission, trash);
+  if (key && find_resource_cache)
+    {
+      find_resource_cache_entry_t *entry;
+
+      entry = g_hash_table_lookup (find_resource_cache, key);
+      if (entry)
+        {
+          if (time (NULL) - entry->added < FIND_RESOURCE_CACHE_TTL)
+            {
+              entry->used = ++find_resource_cache_serial;
+              *resource = entry->resource;
+              g_free (key);
+              return FALSE;
+            }
+          g_hash_table_remove (find_resource_cache, key);
+        }
+    }
+
   quoted_uuid = sql_quote (uuid);
   if (acl_user_has_access_uuid (type, quoted_uuid, permission, trash) == 0)
     {
       g_free (quoted_uuid);
+      g_free (key);
       *resource = 0;
       return FALSE;
     }
@@ -4357,10 +4757,16 @@ find_resource_with_permission (const char* type, const char* uuid,
         assert (0);
       case -1:
         g_free (quoted_uuid);
+        g_free (key);
         return TRUE;
         break;
     }
 
+  if (key && *resource)
+    find_resource_cache_add (key, *resource);
+  else
+    g_free (key);
+
   g_free (quoted_uuid);
   return FALSE;
 }
@@ -4969,8 +5375,9 @@ init_get_iterator2_with (iterator_t* iterator, const char *type,
                          int acl_with_optional,
                          int assume_permitted)
 {
-  int first, max;
+  int first, max, group_by;
   gchar *clause, *order, *filter, *owned_clause, *with_clause;
+  gchar *keyset_clause;
   array_t *permissions;
   resource_t resource = 0;
   gchar *owner_filter;
@@ -4978,6 +5385,9 @@ init_get_iterator2_with (iterator_t* iterator, const char *type,
 
   assert (get);
 
+  group_by = group_by_for_count;
+  group_by_for_count = 0;
+
   if (select_columns == NULL)
     {
       assert (0);
@@ -5110,6 +5520,28 @@ init_get_iterator2_with (iterator_t* iterator, const char *type,
       order = NULL;
     }
 
+  keyset_clause = NULL;
+  if (get->continuation && strlen (get->continuation)
+      && resource == 0 && get->trash == 0 && max != -1)
+    {
+      gchar *quoted_continuation;
+
+      /* Keyset pagination.  The token is the id of the last resource of the
+       * previous page.  Seeking to it by row avoids the scan and discard
+       * that OFFSET does for deep pages, at the cost of forcing the sort
+       * order to row order. */
+      quoted_continuation = sql_quote (get->continuation);
+      keyset_clause = g_strdup_printf (" AND %ss.id"
+                                       " > coalesce ((SELECT id FROM %ss"
+                                       "              WHERE uuid = '%s'),"
+                                       "             0)",
+                                       type, type, quoted_continuation);
+      g_free (quoted_continuation);
+      g_free (order);
+      order = g_strdup_printf (" ORDER BY %ss.id ASC", type);
+      first = 0;
+    }
+
   if (resource && get->trash)
     init_iterator (iterator,
                    "%sSELECT %s"
@@ -5164,14 +5596,19 @@ init_get_iterator2_with (iterator_t* iterator, const char *type,
                    order ? order : "",
                    order ? (extra_order ? extra_order : "") : "");
   else
-    init_iterator (iterator,
+    /* When pagination is off the row count is unbounded, so use a cursor
+     * backed iterator to keep memory use flat. */
+    (max == -1 ? init_cursor_iterator : init_iterator)
+                  (iterator,
                    "%s%sSELECT %s"
                    " FROM %ss %s"
                    " WHERE"
-                   " %s%s%s%s%s%s%s"
+                   " %s%s%s%s%s%s%s%s"
                    " LIMIT %s OFFSET %i%s;",
                    with_clause ? with_clause : "",
-                   distinct ? "SELECT DISTINCT * FROM (" : "",
+                   group_by
+                    ? "SELECT grouped.*, count (*) FROM ("
+                    : (distinct ? "SELECT DISTINCT * FROM (" : ""),
                    columns,
                    type,
                    extra_tables ? extra_tables : "",
@@ -5180,15 +5617,21 @@ init_get_iterator2_with (iterator_t* iterator, const char *type,
                    clause ? clause : "",
                    clause ? ")" : "",
                    extra_where ? extra_where : "",
+                   keyset_clause ? keyset_clause : "",
                    order ? order : "",
-                   order ? (extra_order ? extra_order : "") : "",
+                   (order && (keyset_clause == NULL))
+                    ? (extra_order ? extra_order : "")
+                    : "",
                    sql_select_limit (max),
                    first,
-                   distinct ? ") AS subquery_for_distinct" : "");
+                   group_by
+                    ? ") AS grouped GROUP BY 1"
+                    : (distinct ? ") AS subquery_for_distinct" : ""));
 
   g_free (columns);
   g_free (with_clause);
   g_free (owned_clause);
+  g_free (keyset_clause);
   g_free (order);
   g_free (clause);
   return 0;
@@ -8335,6 +8778,7 @@ delete_alert (const char *alert_id, int ultimate)
        alert);
   sql ("DELETE FROM alert_event_data WHERE alert = %llu;", alert);
   sql ("DELETE FROM alert_method_data WHERE alert = %llu;", alert);
+  sql ("DELETE FROM alert_deliveries WHERE alert = %llu;", alert);
   sql ("DELETE FROM alerts WHERE id = %llu;", alert);
   sql_commit ();
   return 0;
@@ -9498,6 +9942,12 @@ email (const char *to_address, const char *from_address, const char *subject,
 /**
  * @brief GET an HTTP resource.
  *
+ * Spawns a fresh client process for the single URL.  All the HTTP based
+ * alert methods work this way, with the vFire and TippingPoint scripts
+ * running their own external clients, so connections are never reused
+ * between alert deliveries.  Pooling would need a persistent client held
+ * by the alert delivery runner in place of the script interface.
+ *
  * @param[in]  url  URL.
  *
  * @return 0 success, -1 error.
@@ -12284,6 +12734,129 @@ generate_alert_filter_get (alert_t alert, const get_data_t *base_get_data,
   return 0;
 }
 
+/**
+ * @brief Rendered report content kept in the render cache.
+ */
+typedef struct
+{
+  gchar *content;        ///< Rendered report.
+  gsize length;          ///< Length of rendered report.
+  gchar *extension;      ///< File extension of report format.
+  gchar *content_type;   ///< Content type of report format.
+  gchar *term;           ///< Filter term.
+  gchar *report_zone;    ///< Actual timezone used in report.
+  gchar *host_summary;   ///< Summary of results per host.
+} report_render_t;
+
+/**
+ * @brief Cache of rendered report content.
+ *
+ * Lets the alerts on a single event share one run of the report format
+ * scripts.  Only active between report_render_cache_init and
+ * report_render_cache_cleanup, which limits the cache to processes that
+ * run a batch of alert deliveries.
+ */
+static GHashTable *report_render_cache = NULL;
+
+/**
+ * @brief Free a rendered report from the render cache.
+ *
+ * @param[in]  item  Rendered report.
+ */
+static void
+report_render_free (gpointer item)
+{
+  report_render_t *render;
+
+  render = item;
+  g_free (render->content);
+  g_free (render->extension);
+  g_free (render->content_type);
+  g_free (render->term);
+  g_free (render->report_zone);
+  g_free (render->host_summary);
+  g_free (render);
+}
+
+/**
+ * @brief Start caching rendered report content.
+ */
+static void
+report_render_cache_init ()
+{
+  assert (report_render_cache == NULL);
+  report_render_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, report_render_free);
+}
+
+/**
+ * @brief Stop caching rendered report content, freeing the cache.
+ */
+static void
+report_render_cache_cleanup ()
+{
+  if (report_render_cache)
+    {
+      g_hash_table_destroy (report_render_cache);
+      report_render_cache = NULL;
+    }
+}
+
+/**
+ * @brief Build the render cache key for a report rendering.
+ *
+ * The key covers every input of the rendering, and also which of the
+ * optional outputs the caller requested, so that a cached rendering is
+ * only reused when it can fill all the requested outputs.
+ *
+ * @param[in]  report             Report.
+ * @param[in]  delta_report       Delta report, or 0.
+ * @param[in]  report_format      Report format.
+ * @param[in]  report_config      Report config, or 0.
+ * @param[in]  notes_details      Whether to include details of notes.
+ * @param[in]  overrides_details  Whether to include override details.
+ * @param[in]  get                GET data that determines the filter.
+ * @param[in]  content_length     Length output of the caller.
+ * @param[in]  extension          Extension output of the caller.
+ * @param[in]  content_type       Content type output of the caller.
+ * @param[in]  term               Term output of the caller.
+ * @param[in]  report_zone        Zone output of the caller.
+ * @param[in]  host_summary       Host summary output of the caller.
+ *
+ * @return Newly allocated key, or NULL if the cache is inactive.
+ */
+static gchar *
+report_render_key (report_t report, report_t delta_report,
+                   report_format_t report_format,
+                   report_config_t report_config, int notes_details,
+                   int overrides_details, const get_data_t *get,
+                   gsize *content_length, gchar **extension,
+                   gchar **content_type, gchar **term, gchar **report_zone,
+                   gchar **host_summary)
+{
+  int outputs;
+
+  if (report_render_cache == NULL || content_length == NULL)
+    return NULL;
+
+  outputs = (extension ? 1 : 0)
+            | (content_type ? 2 : 0)
+            | (term ? 4 : 0)
+            | (report_zone ? 8 : 0)
+            | (host_summary ? 16 : 0);
+
+  return g_strdup_printf ("%llu\1%llu\1%llu\1%llu\1%i\1%i\1%i\1%s\1%s",
+                          report,
+                          delta_report,
+                          report_format,
+                          report_config,
+                          notes_details,
+                          overrides_details,
+                          outputs,
+                          get->filt_id ? get->filt_id : "",
+                          get->filter ? get->filter : "");
+}
+
 /**
  * @brief Generate report content for alert
  *
@@ -12334,7 +12907,9 @@ report_content_for_alert (alert_t alert, report_t report, task_t task,
   gboolean report_format_is_fallback = FALSE;
   report_config_t report_config;
   get_data_t *alert_filter_get;
-  gchar *report_content;
+  const get_data_t *used_get;
+  report_t delta_report;
+  gchar *report_content, *cache_key;
   filter_t filter;
 
   assert (content);
@@ -12474,11 +13049,52 @@ report_content_for_alert (alert_t alert, report_t report, task_t task,
       report_config = 0;
     }
 
-  // Generate report content
+  // Generate report content, reusing any cached rendering of the report
+
+  delta_report = get_delta_report (alert, task, report);
+  used_get = alert_filter_get ? alert_filter_get : get;
+  cache_key = report_render_key (report, delta_report, report_format,
+                                 report_config, notes_details,
+                                 overrides_details, used_get, content_length,
+                                 extension, content_type, term, report_zone,
+                                 host_summary);
+
+  if (cache_key)
+    {
+      report_render_t *render;
+
+      render = g_hash_table_lookup (report_render_cache, cache_key);
+      if (render)
+        {
+          g_debug ("%s: reusing rendered report for alert", __func__);
+          *content = g_malloc (render->length + 1);
+          memcpy (*content, render->content, render->length);
+          (*content)[render->length] = '\0';
+          *content_length = render->length;
+          if (extension)
+            *extension = g_strdup (render->extension);
+          if (content_type)
+            *content_type = g_strdup (render->content_type);
+          if (term)
+            *term = g_strdup (render->term);
+          if (report_zone)
+            *report_zone = g_strdup (render->report_zone);
+          if (host_summary)
+            *host_summary = g_strdup (render->host_summary);
+          *used_report_format = report_format;
+          g_free (cache_key);
+          if (alert_filter_get)
+            {
+              get_data_reset (alert_filter_get);
+              g_free (alert_filter_get);
+            }
+          return 0;
+        }
+    }
 
   report_content = manage_report (report,
-                                  get_delta_report (alert, task, report),
-                                  alert_filter_get ? alert_filter_get : get,
+                                  delta_report,
+                                  used_get,
                                   report_format,
                                   report_config,
                                   notes_details,
@@ -12497,7 +13113,28 @@ report_content_for_alert (alert_t alert, report_t report, task_t task,
     }
 
   if (report_content == NULL)
-    return -1;
+    {
+      g_free (cache_key);
+      return -1;
+    }
+
+  if (cache_key)
+    {
+      report_render_t *render;
+
+      render = g_new0 (report_render_t, 1);
+      render->length = *content_length;
+      render->content = g_malloc (render->length + 1);
+      memcpy (render->content, report_content, render->length);
+      render->content[render->length] = '\0';
+      render->extension = extension ? g_strdup (*extension) : NULL;
+      render->content_type = content_type ? g_strdup (*content_type) : NULL;
+      render->term = term ? g_strdup (*term) : NULL;
+      render->report_zone = report_zone ? g_strdup (*report_zone) : NULL;
+      render->host_summary = host_summary ? g_strdup (*host_summary) : NULL;
+      /* The insert consumes the key. */
+      g_hash_table_insert (report_render_cache, cache_key, render);
+    }
 
   *content = report_content;
   *used_report_format = report_format;
@@ -14882,6 +15519,14 @@ condition_met (task_t task, report_t report, alert_t alert,
   return 0;
 }
 
+/**
+ * @brief Maximum number of concurrent processes for running alerts.
+ */
+#define EVENT_ALERT_PROCESSES 4
+
+static void
+alert_delivery_enqueue (alert_t, task_t, report_t, event_t, int);
+
 /**
  * @brief Produce an event.
  *
@@ -14923,30 +15568,465 @@ event (event_t event, void* event_data, resource_t resource_1,
     }
   cleanup_iterator (&alerts);
 
+  /* Queue the alerts for task events, so that a slow delivery can never
+   * delay the process that is finishing the task.  The queue is drained
+   * with retries by alert_deliveries_run. */
+  if (event == EVENT_TASK_RUN_STATUS_CHANGED)
+    {
+      index = alerts_triggered->len;
+      while (index--)
+        alert_delivery_enqueue (g_array_index (alerts_triggered, alert_t,
+                                               index),
+                                resource_1,
+                                resource_2,
+                                event,
+                                (task_status_t) event_data);
+      g_array_free (alerts_triggered, TRUE);
+      return;
+    }
+
   /* Run the alerts outside the iterator, because they may take some
    * time and the iterator would prevent update processes (GMP MODIFY_XXX,
    * CREATE_XXX, ...) from locking the database. */
   index = alerts_triggered->len;
-  while (index--)
+  if (index > 1)
     {
-      alert_t alert;
-      alert_condition_t condition;
+      GArray *children;
 
-      alert = g_array_index (alerts_triggered, alert_t, index);
-      condition = alert_condition (alert);
-      escalate_1 (alert,
-                  resource_1,
-                  resource_2,
-                  event,
-                  event_data,
-                  alert_method (alert),
-                  condition,
-                  NULL);
+      /* More than one alert, so run them in child processes, a bounded
+       * number at a time.  The alert methods run independent external
+       * programs like the report format scripts, so generating the report
+       * artifacts of a burst of alerts parallelises safely. */
+      children = g_array_new (TRUE, TRUE, sizeof (pid_t));
+      while (index--)
+        {
+          alert_t alert;
+          alert_condition_t condition;
+          pid_t pid;
+
+          while (children->len >= EVENT_ALERT_PROCESSES)
+            {
+              pid = g_array_index (children, pid_t, 0);
+              if (waitpid (pid, NULL, 0) < 0)
+                {
+                  if (errno == EINTR)
+                    continue;
+                  g_warning ("%s: waitpid: %s", __func__, strerror (errno));
+                }
+              g_array_remove_index (children, 0);
+            }
+
+          alert = g_array_index (alerts_triggered, alert_t, index);
+          condition = alert_condition (alert);
+
+          pid = fork ();
+          switch (pid)
+            {
+              case 0:
+                /* Child.  Reopen the database (required after fork) and
+                 * run the alert. */
+                init_sentry ();
+                cleanup_manage_process (FALSE);
+                reinit_manage_process ();
+                setproctitle ("Running alert");
+                escalate_1 (alert,
+                            resource_1,
+                            resource_2,
+                            event,
+                            event_data,
+                            alert_method (alert),
+                            condition,
+                            NULL);
+                gvm_close_sentry ();
+                exit (EXIT_SUCCESS);
+                break;
+              case -1:
+                /* Parent when error.  Run the alert ourselves. */
+                g_warning ("%s: fork: %s", __func__, strerror (errno));
+                escalate_1 (alert,
+                            resource_1,
+                            resource_2,
+                            event,
+                            event_data,
+                            alert_method (alert),
+                            condition,
+                            NULL);
+                break;
+              default:
+                /* Parent.  Note the child for waiting. */
+                g_debug ("%s: %i forked %i", __func__, getpid (), pid);
+                g_array_append_val (children, pid);
+                break;
+            }
+        }
+
+      while (children->len)
+        {
+          pid_t pid;
+
+          pid = g_array_index (children, pid_t, 0);
+          if (waitpid (pid, NULL, 0) < 0)
+            {
+              if (errno == EINTR)
+                continue;
+              g_warning ("%s: waitpid: %s", __func__, strerror (errno));
+            }
+          g_array_remove_index (children, 0);
+        }
+      g_array_free (children, TRUE);
     }
+  else
+    while (index--)
+      {
+        alert_t alert;
+        alert_condition_t condition;
+
+        alert = g_array_index (alerts_triggered, alert_t, index);
+        condition = alert_condition (alert);
+        escalate_1 (alert,
+                    resource_1,
+                    resource_2,
+                    event,
+                    event_data,
+                    alert_method (alert),
+                    condition,
+                    NULL);
+      }
 
   g_array_free (alerts_triggered, TRUE);
 }
 
+/**
+ * @brief Interval in seconds before the first retry of an alert delivery.
+ *
+ * The interval doubles on each further attempt.
+ */
+#define ALERT_DELIVERY_RETRY_INTERVAL 60
+
+/**
+ * @brief Give up on an alert delivery after this many attempts.
+ */
+#define ALERT_DELIVERY_MAX_ATTEMPTS 5
+
+/**
+ * @brief Seconds after which a RUNNING delivery counts as due again.
+ *
+ * This reclaims deliveries that were claimed by a runner which crashed
+ * before recording an outcome.
+ */
+#define ALERT_DELIVERY_STUCK_INTERVAL 3600
+
+/**
+ * @brief Add an alert delivery to the queue.
+ *
+ * @param[in]  alert       Alert to deliver.
+ * @param[in]  task        Task that produced the event.
+ * @param[in]  report      Report associated with the event, if any.
+ * @param[in]  event       Event.
+ * @param[in]  event_data  Event type specific details.
+ */
+static void
+alert_delivery_enqueue (alert_t alert, task_t task, report_t report,
+                        event_t event, int event_data)
+{
+  sql ("INSERT INTO alert_deliveries"
+       " (uuid, alert, task, report, event, event_data, status, attempts,"
+       "  next_attempt, creation_time, modification_time)"
+       " VALUES (make_uuid (), %llu, %llu, %llu, %i, %i, %i, 0, m_now (),"
+       "         m_now (), m_now ());",
+       alert,
+       task,
+       report,
+       event,
+       event_data,
+       ALERT_DELIVERY_QUEUED);
+}
+
+/**
+ * @brief Count the queued deliveries of an alert that are in a given state.
+ *
+ * @param[in]  alert   Alert.
+ * @param[in]  status  State of the deliveries to count.
+ *
+ * @return Number of deliveries.
+ */
+int
+alert_delivery_count (alert_t alert, alert_delivery_status_t status)
+{
+  return sql_int ("SELECT count (*) FROM alert_deliveries"
+                  " WHERE alert = %llu AND status = %i;",
+                  alert,
+                  status);
+}
+
+/**
+ * @brief Check whether any queued alert deliveries are ready to run.
+ *
+ * @return 1 if there are deliveries due, else 0.
+ */
+int
+alert_deliveries_due ()
+{
+  return sql_int ("SELECT EXISTS (SELECT * FROM alert_deliveries"
+                  "               WHERE (status = %i"
+                  "                      AND next_attempt <= m_now ())"
+                  "               OR (status = %i"
+                  "                   AND modification_time"
+                  "                       <= m_now () - %i));",
+                  ALERT_DELIVERY_QUEUED,
+                  ALERT_DELIVERY_RUNNING,
+                  ALERT_DELIVERY_STUCK_INTERVAL);
+}
+
+/**
+ * @brief Run a single delivery from the alert delivery queue.
+ *
+ * Assumes the identity of the alert owner for the delivery and records the
+ * outcome in the queue, scheduling a retry with a doubling delay when the
+ * delivery fails.
+ *
+ * @param[in]  delivery    Row in alert_deliveries.
+ * @param[in]  alert       Alert to deliver.
+ * @param[in]  task        Task that produced the event.
+ * @param[in]  report      Report associated with the event, if any.
+ * @param[in]  event       Event.
+ * @param[in]  event_data  Event type specific details.
+ * @param[in]  attempts    Number of attempts made before this one.
+ */
+static void
+alert_delivery_run (resource_t delivery, alert_t alert, task_t task,
+                    report_t report, event_t event, int event_data,
+                    int attempts)
+{
+  int ret;
+  gchar *script_message;
+
+  current_credentials.uuid = alert_owner_uuid (alert);
+  if (current_credentials.uuid == NULL)
+    {
+      sql ("UPDATE alert_deliveries"
+           " SET status = %i, message = 'Failed to find alert owner',"
+           "     modification_time = m_now ()"
+           " WHERE id = %llu;",
+           ALERT_DELIVERY_FAILED,
+           delivery);
+      return;
+    }
+  current_credentials.username
+    = sql_string ("SELECT name FROM users WHERE uuid = '%s';",
+                  current_credentials.uuid);
+  manage_session_init (current_credentials.uuid);
+
+  script_message = NULL;
+  ret = escalate_1 (alert, task, report, event,
+                    GINT_TO_POINTER (event_data), alert_method (alert),
+                    alert_condition (alert), &script_message);
+
+  if (ret == 0)
+    sql ("UPDATE alert_deliveries"
+         " SET status = %i, message = NULL, modification_time = m_now ()"
+         " WHERE id = %llu;",
+         ALERT_DELIVERY_DONE,
+         delivery);
+  else
+    {
+      gchar *quoted_message;
+
+      quoted_message = sql_quote (script_message ? script_message : "");
+      if (attempts + 1 >= ALERT_DELIVERY_MAX_ATTEMPTS)
+        sql ("UPDATE alert_deliveries"
+             " SET status = %i, attempts = %i, message = nullif ('%s', ''),"
+             "     modification_time = m_now ()"
+             " WHERE id = %llu;",
+             ALERT_DELIVERY_FAILED,
+             attempts + 1,
+             quoted_message,
+             delivery);
+      else
+        sql ("UPDATE alert_deliveries"
+             " SET status = %i, attempts = %i, message = nullif ('%s', ''),"
+             "     next_attempt = m_now () + %i,"
+             "     modification_time = m_now ()"
+             " WHERE id = %llu;",
+             ALERT_DELIVERY_QUEUED,
+             attempts + 1,
+             quoted_message,
+             ALERT_DELIVERY_RETRY_INTERVAL << attempts,
+             delivery);
+      g_free (quoted_message);
+    }
+
+  g_free (script_message);
+  free (current_credentials.username);
+  free (current_credentials.uuid);
+  current_credentials.username = NULL;
+  current_credentials.uuid = NULL;
+}
+
+/**
+ * @brief A delivery claimed from the alert delivery queue.
+ */
+typedef struct
+{
+  resource_t delivery;  ///< Row in alert_deliveries.
+  alert_t alert;        ///< Alert to deliver.
+  task_t task;          ///< Task that produced the event.
+  report_t report;      ///< Report associated with the event, if any.
+  event_t event;        ///< Event.
+  int event_data;       ///< Event type specific details.
+  int attempts;         ///< Number of attempts made so far.
+} alert_delivery_t;
+
+/**
+ * @brief Run the alert deliveries that are due.
+ *
+ * Claims all the due deliveries and then runs them in child processes, a
+ * bounded number at a time, waiting for all the children.  Failed
+ * deliveries stay in the queue for a later retry.
+ */
+void
+alert_deliveries_run ()
+{
+  iterator_t deliveries;
+  GArray *due, *children;
+  guint index;
+
+  /* Claim the due deliveries before forking, so that only this runner
+   * works on them. */
+
+  due = g_array_new (FALSE, FALSE, sizeof (alert_delivery_t));
+  init_iterator (&deliveries,
+                 "SELECT id, alert, task, report, event, event_data,"
+                 "       attempts"
+                 " FROM alert_deliveries"
+                 " WHERE (status = %i AND next_attempt <= m_now ())"
+                 " OR (status = %i AND modification_time <= m_now () - %i)"
+                 " ORDER BY report, id;",
+                 ALERT_DELIVERY_QUEUED,
+                 ALERT_DELIVERY_RUNNING,
+                 ALERT_DELIVERY_STUCK_INTERVAL);
+  while (next (&deliveries))
+    {
+      alert_delivery_t delivery;
+
+      delivery.delivery = iterator_int64 (&deliveries, 0);
+      delivery.alert = iterator_int64 (&deliveries, 1);
+      delivery.task = iterator_int64 (&deliveries, 2);
+      delivery.report = iterator_int64 (&deliveries, 3);
+      delivery.event = iterator_int (&deliveries, 4);
+      delivery.event_data = iterator_int (&deliveries, 5);
+      delivery.attempts = iterator_int (&deliveries, 6);
+      g_array_append_val (due, delivery);
+    }
+  cleanup_iterator (&deliveries);
+
+  for (index = 0; index < due->len; index++)
+    sql ("UPDATE alert_deliveries"
+         " SET status = %i, modification_time = m_now ()"
+         " WHERE id = %llu;",
+         ALERT_DELIVERY_RUNNING,
+         g_array_index (due, alert_delivery_t, index).delivery);
+
+  /* Run the deliveries in child processes, a bounded number at a time.
+   * The deliveries for one report go to a single child, which caches the
+   * rendered report content, so that the alerts fanning out from one
+   * event run the report format scripts only once. */
+
+  children = g_array_new (TRUE, TRUE, sizeof (pid_t));
+  index = 0;
+  while (index < due->len)
+    {
+      alert_delivery_t *delivery;
+      guint group_end;
+      pid_t pid;
+
+      group_end = index + 1;
+      while (group_end < due->len
+             && (g_array_index (due, alert_delivery_t, group_end).report
+                 == g_array_index (due, alert_delivery_t, index).report))
+        group_end++;
+
+      while (children->len >= EVENT_ALERT_PROCESSES)
+        {
+          pid = g_array_index (children, pid_t, 0);
+          if (waitpid (pid, NULL, 0) < 0)
+            {
+              if (errno == EINTR)
+                continue;
+              g_warning ("%s: waitpid: %s", __func__, strerror (errno));
+            }
+          g_array_remove_index (children, 0);
+        }
+
+      pid = fork ();
+      switch (pid)
+        {
+          case 0:
+            /* Child.  Reopen the database (required after fork) and run
+             * the deliveries for the report. */
+            init_sentry ();
+            cleanup_manage_process (FALSE);
+            reinit_manage_process ();
+            setproctitle ("Delivering alerts");
+            report_render_cache_init ();
+            for (; index < group_end; index++)
+              {
+                delivery = &g_array_index (due, alert_delivery_t, index);
+                alert_delivery_run (delivery->delivery,
+                                    delivery->alert,
+                                    delivery->task,
+                                    delivery->report,
+                                    delivery->event,
+                                    delivery->event_data,
+                                    delivery->attempts);
+              }
+            report_render_cache_cleanup ();
+            gvm_close_sentry ();
+            exit (EXIT_SUCCESS);
+            break;
+          case -1:
+            /* Parent when error.  Run the deliveries ourselves. */
+            g_warning ("%s: fork: %s", __func__, strerror (errno));
+            report_render_cache_init ();
+            for (; index < group_end; index++)
+              {
+                delivery = &g_array_index (due, alert_delivery_t, index);
+                alert_delivery_run (delivery->delivery,
+                                    delivery->alert,
+                                    delivery->task,
+                                    delivery->report,
+                                    delivery->event,
+                                    delivery->event_data,
+                                    delivery->attempts);
+              }
+            report_render_cache_cleanup ();
+            break;
+          default:
+            /* Parent.  Note the child for waiting. */
+            g_debug ("%s: %i forked %i", __func__, getpid (), pid);
+            g_array_append_val (children, pid);
+            index = group_end;
+            break;
+        }
+    }
+
+  while (children->len)
+    {
+      pid_t pid;
+
+      pid = g_array_index (children, pid_t, 0);
+      if (waitpid (pid, NULL, 0) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          g_warning ("%s: waitpid: %s", __func__, strerror (errno));
+        }
+      g_array_remove_index (children, 0);
+    }
+  g_array_free (children, TRUE);
+  g_array_free (due, TRUE);
+}
+
 /**
  * @brief Initialise an alert task iterator.
  *
@@ -15802,6 +16882,77 @@ reinit_manage_process ()
   init_manage_process (&gvmd_db_conn_info);
 }
 
+/**
+ * @brief Maximum number of NVTis kept in the on-demand NVT cache.
+ */
+#define LAZY_NVT_CACHE_MAX 256
+
+/**
+ * @brief Set whether to load NVTis on demand instead of the full NVT cache.
+ *
+ * @param[in]  lazy  Whether to load NVTis on demand.
+ */
+void
+set_lazy_nvt_cache (int lazy)
+{
+  lazy_nvt_cache = lazy;
+}
+
+/**
+ * @brief Load a single NVTi from the database.
+ *
+ * @param[in]  oid  OID of the NVT.
+ *
+ * @return NVTi if found, else NULL.
+ */
+static nvti_t *
+lazy_nvti_load (const gchar *oid)
+{
+  gchar *quoted_oid;
+  iterator_t refs, prefs;
+  nvti_t *nvti;
+
+  quoted_oid = sql_quote (oid);
+
+  if (sql_int ("SELECT count (*) FROM nvts WHERE oid = '%s';", quoted_oid)
+      == 0)
+    {
+      g_free (quoted_oid);
+      return NULL;
+    }
+
+  nvti = nvti_new ();
+  nvti_set_oid (nvti, oid);
+
+  init_iterator (&refs,
+                 "SELECT type, ref_id, ref_text FROM vt_refs"
+                 " WHERE vt_oid = '%s';",
+                 quoted_oid);
+  while (next (&refs))
+    nvti_add_vtref (nvti,
+                    vtref_new (iterator_string (&refs, 0),
+                               iterator_string (&refs, 1),
+                               iterator_string (&refs, 2)));
+  cleanup_iterator (&refs);
+
+  init_iterator (&prefs,
+                 "SELECT pref_id, pref_name, value"
+                 " FROM nvt_preferences"
+                 " WHERE pref_nvt = '%s'"
+                 " AND NOT (pref_type = 'entry' AND pref_name = 'timeout');",
+                 quoted_oid);
+  while (next (&prefs))
+    nvti_add_pref (nvti,
+                   nvtpref_new (iterator_int (&prefs, 0),
+                                iterator_string (&prefs, 1),
+                                iterator_string (&prefs, 2),
+                                NULL));
+  cleanup_iterator (&prefs);
+
+  g_free (quoted_oid);
+  return nvti;
+}
+
 /**
  * @brief Update the memory cache of NVTs.
  *
@@ -15812,6 +16963,43 @@ reinit_manage_process ()
 nvti_t *
 lookup_nvti (const gchar *nvt)
 {
+  if (lazy_nvt_cache)
+    {
+      nvti_t *nvti;
+      GList *link;
+
+      if (lazy_nvtis == NULL)
+        lazy_nvtis = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                            (GDestroyNotify) nvti_free);
+
+      nvti = g_hash_table_lookup (lazy_nvtis, nvt);
+      if (nvti)
+        {
+          /* Move the OID to the most recently used end of the queue. */
+          link = g_queue_find_custom (&lazy_nvti_oids, nvt,
+                                      (GCompareFunc) strcmp);
+          g_queue_unlink (&lazy_nvti_oids, link);
+          g_queue_push_tail_link (&lazy_nvti_oids, link);
+          return nvti;
+        }
+
+      nvti = lazy_nvti_load (nvt);
+      if (nvti == NULL)
+        return NULL;
+
+      g_hash_table_insert (lazy_nvtis, g_strdup (nvt), nvti);
+      g_queue_push_tail (&lazy_nvti_oids, g_strdup (nvt));
+      if (g_queue_get_length (&lazy_nvti_oids) > LAZY_NVT_CACHE_MAX)
+        {
+          gchar *oldest;
+
+          oldest = g_queue_pop_head (&lazy_nvti_oids);
+          g_hash_table_remove (lazy_nvtis, oldest);
+          g_free (oldest);
+        }
+      return nvti;
+    }
+
   return nvtis_lookup (nvti_cache, nvt);
 }
 
@@ -15822,11 +17010,58 @@ static void
 update_nvti_cache ()
 {
   iterator_t nvts, prefs;
+  GHashTable *nvt_prefs;
+  GHashTableIter iter;
+  gpointer value;
+
+  if (lazy_nvt_cache)
+    {
+      /* Drop the on-demand cache so NVTis are fetched fresh on next use. */
+      if (lazy_nvtis)
+        {
+          g_hash_table_destroy (lazy_nvtis);
+          lazy_nvtis = NULL;
+        }
+      g_queue_foreach (&lazy_nvti_oids, (GFunc) g_free, NULL);
+      g_queue_clear (&lazy_nvti_oids);
+      return;
+    }
 
   nvtis_free (nvti_cache);
 
   nvti_cache = nvtis_new ();
 
+  /* Group the preferences by NVT in a hash table first, so that attaching
+   * them below is a single lookup per NVT instead of a scan over every
+   * preference for every NVT. */
+
+  nvt_prefs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  init_iterator (&prefs,
+                 "SELECT pref_id, pref_nvt, pref_name, value"
+                 " FROM nvt_preferences"
+                 " WHERE NOT (pref_type = 'entry' AND pref_name = 'timeout')");
+
+  while (next (&prefs))
+    {
+      GSList *list;
+
+      if (iterator_string (&prefs, 1) == NULL)
+        continue;
+
+      list = g_hash_table_lookup (nvt_prefs, iterator_string (&prefs, 1));
+      list = g_slist_prepend (list,
+                              nvtpref_new (iterator_int (&prefs, 0),
+                                           iterator_string (&prefs, 2),
+                                           iterator_string (&prefs, 3),
+                                           NULL));
+      g_hash_table_insert (nvt_prefs,
+                           g_strdup (iterator_string (&prefs, 1)),
+                           list);
+    }
+
+  cleanup_iterator (&prefs);
+
   /* Because there are many NVTs and many refs it's slow to query the refs
    * for each NVT.  So this query gets the NVTs and their refs at the same
    * time.
@@ -15841,11 +17076,6 @@ update_nvti_cache ()
                  " FROM nvts"
                  " LEFT OUTER JOIN vt_refs ON nvts.oid = vt_refs.vt_oid;");
 
-  init_iterator (&prefs,
-                 "SELECT pref_id, pref_nvt, pref_name, value"
-                 " FROM nvt_preferences"
-                 " WHERE NOT (pref_type = 'entry' AND pref_name = 'timeout')");
-
   while (next (&nvts))
     {
       nvti_t *nvti;
@@ -15853,22 +17083,24 @@ update_nvti_cache ()
       nvti = nvtis_lookup (nvti_cache, iterator_string (&nvts, 0));
       if (nvti == NULL)
         {
+          GSList *list, *point;
+
           nvti = nvti_new ();
           nvti_set_oid (nvti, iterator_string (&nvts, 0));
 
           nvtis_add (nvti_cache, nvti);
 
-          while (next (&prefs))
-            if (iterator_string (&prefs, 1)
-                && (strcmp (iterator_string (&prefs, 1),
-                            iterator_string (&nvts, 0))
-                    == 0))
-              nvti_add_pref (nvti,
-                             nvtpref_new (iterator_int (&prefs, 0),
-                                          iterator_string (&prefs, 2),
-                                          iterator_string (&prefs, 3),
-                                          NULL));
-          iterator_rewind (&prefs);
+          list = g_hash_table_lookup (nvt_prefs, iterator_string (&nvts, 0));
+          if (list)
+            {
+              /* The list was built backwards, so restore the query order
+               * before handing the preferences over to the NVT. */
+              list = g_slist_reverse (list);
+              for (point = list; point; point = point->next)
+                nvti_add_pref (nvti, point->data);
+              g_slist_free (list);
+              g_hash_table_remove (nvt_prefs, iterator_string (&nvts, 0));
+            }
         }
 
       if (iterator_null (&nvts, 2))
@@ -15881,7 +17113,13 @@ update_nvti_cache ()
     }
 
   cleanup_iterator (&nvts);
-  cleanup_iterator (&prefs);
+
+  /* Free any preferences of NVTs that are not in the nvts table. */
+
+  g_hash_table_iter_init (&iter, nvt_prefs);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    g_slist_free_full (value, (GDestroyNotify) nvtpref_free);
+  g_hash_table_destroy (nvt_prefs);
 
   malloc_trim (0);
 }
@@ -15903,6 +17141,7 @@ manage_update_nvti_cache ()
                " WHERE name = 'update_nvti_cache';",
                sql_schema ()))
     {
+      invalidate_nvts_feed_version_cache ();
       update_nvti_cache ();
       sql ("UPDATE %s.meta SET value = 0 WHERE name = 'update_nvti_cache';",
            sql_schema ());
@@ -16117,6 +17356,19 @@ check_db_settings ()
          "  || ' being processed.',"
          "  '100' );");
 
+  if (sql_int ("SELECT count(*) FROM settings"
+               " WHERE uuid = '" SETTING_UUID_REPORT_RETENTION "'"
+               " AND " ACL_IS_GLOBAL () ";")
+      == 0)
+    sql ("INSERT into settings (uuid, owner, name, comment, value)"
+         " VALUES"
+         " ('" SETTING_UUID_REPORT_RETENTION "', NULL,"
+         "  'Report Retention Period',"
+         "  'Number of days to keep reports.  Reports older than this are'"
+         "  || ' deleted in batches by a background job.'"
+         "  || '  0 means keep reports forever.',"
+         "  '0' );");
+
   if (sql_int ("SELECT count(*) FROM settings"
               " WHERE uuid = '" SETTING_UUID_USER_INTERFACE_TIME_FORMAT "'"
               " AND " ACL_IS_GLOBAL () ";")
@@ -16764,6 +18016,68 @@ manage_migrate_relay_sensors ()
     }
 }
 
+/**
+ * @brief Whether the startup database checks were deferred at startup.
+ */
+static int startup_checks_deferred = 0;
+
+/**
+ * @brief Whether the deferred startup checks should check the encryption key.
+ */
+static int deferred_check_encryption_key = 0;
+
+/**
+ * @brief Calculate the checksum that identifies a verified startup.
+ *
+ * The checksum covers everything the outcome of the startup checks depends
+ * on: the gvmd version, the database version and the NVT feed version.  When
+ * any of these has changed since the checks last passed, the checks run in
+ * the foreground again.
+ *
+ * @return Freshly allocated checksum.
+ */
+static gchar *
+startup_check_checksum ()
+{
+  char *feed_version;
+  gchar *checksum;
+
+  feed_version = nvts_feed_version ();
+  checksum = g_strdup_printf ("%i %s %s",
+                              GVMD_DATABASE_VERSION,
+                              GVMD_VERSION,
+                              feed_version ? feed_version : "");
+  g_free (feed_version);
+  return checksum;
+}
+
+/**
+ * @brief Check whether the startup checks passed for the current versions.
+ *
+ * @return 1 if the previous startup checks passed and nothing they depend on
+ *         has changed since, else 0.
+ */
+static int
+startup_check_recorded ()
+{
+  gchar *checksum;
+  char *recorded;
+  int ret;
+
+  /* Via sql_string, because on a fresh database the meta table does not
+   * exist until check_db runs create_tables. */
+  recorded = sql_string ("SELECT value FROM meta"
+                         " WHERE name = 'startup_check';");
+  if (recorded == NULL)
+    return 0;
+
+  checksum = startup_check_checksum ();
+  ret = strcmp (recorded, checksum) == 0;
+  g_free (checksum);
+  free (recorded);
+  return ret;
+}
+
 /**
  * @brief Ensure that the database is in order.
  *
@@ -16776,6 +18090,8 @@ manage_migrate_relay_sensors ()
 static int
 check_db (int check_encryption_key)
 {
+  gchar *checksum, *quoted_checksum;
+
   /* The file locks managed at startup ensure that this is the only Manager
    * process accessing the db.  Nothing else should be accessing the db, access
    * should always go through Manager. */
@@ -16802,6 +18118,17 @@ check_db (int check_encryption_key)
   if (check_encryption_key && check_db_encryption_key ())
     goto fail;
 
+  /* Record the clean check, so that the next startup of the same gvmd,
+   * database and feed versions can defer the checks and serve right away. */
+
+  checksum = startup_check_checksum ();
+  quoted_checksum = sql_quote (checksum);
+  sql ("DELETE FROM meta WHERE name = 'startup_check';");
+  sql ("INSERT INTO meta (name, value) VALUES ('startup_check', '%s');",
+       quoted_checksum);
+  g_free (quoted_checksum);
+  g_free (checksum);
+
   sql_commit ();
   return 0;
 
@@ -16946,6 +18273,41 @@ cleanup_tables ()
        " WHERE \"user\" NOT IN (SELECT id FROM users);");
 }
 
+/**
+ * @brief Check whether the startup database checks were deferred.
+ *
+ * @return 1 if init_manage deferred the checks, else 0.
+ */
+int
+manage_startup_checks_deferred ()
+{
+  return startup_checks_deferred;
+}
+
+/**
+ * @brief Run the startup database checks that were deferred.
+ *
+ * For a child forked by the main process once it is serving.  The checks are
+ * expected to find everything in place, because init_manage only defers them
+ * when the previous run passed for the same gvmd, database and feed
+ * versions.  Any drift the checks do find is repaired in the usual single
+ * transaction.
+ */
+void
+deferred_startup_checks_run ()
+{
+  if (check_db (deferred_check_encryption_key))
+    {
+      g_warning ("%s: deferred startup checks failed", __func__);
+      return;
+    }
+
+  cleanup_tables ();
+
+  /* Requires NVT cache. */
+  check_db_configs ();
+}
+
 /**
  * @brief Initialize the manage library.
  *
@@ -17064,11 +18426,24 @@ init_manage_internal (GSList *log_config,
        *   2 a helper processes (--create-user, --get-users, etc) when the
        *     main process is not running. */
 
-      ret = check_db (check_encryption_key);
-      if (ret)
-        return ret;
+      if (startup_check_recorded ())
+        {
+          /* The checks passed on the previous startup of the same gvmd,
+           * database and feed versions, so serve right away.  The full
+           * checks still run, in a child that the main process forks once
+           * it is serving. */
 
-      cleanup_tables ();
+          startup_checks_deferred = 1;
+          deferred_check_encryption_key = check_encryption_key;
+        }
+      else
+        {
+          ret = check_db (check_encryption_key);
+          if (ret)
+            return ret;
+
+          cleanup_tables ();
+        }
 
       /* Set max_hosts in db, so database server side can access it. */
 
@@ -17080,12 +18455,12 @@ init_manage_internal (GSList *log_config,
     /* Stop any active tasks. */
     stop_active_tasks ();
 
-  /* Load the NVT cache into memory. */
+  /* Load the NVT cache into memory, unless NVTis are loaded on demand. */
 
-  if (nvti_cache == NULL)
+  if (nvti_cache == NULL && lazy_nvt_cache == 0)
     update_nvti_cache ();
 
-  if (skip_db_check == 0)
+  if (skip_db_check == 0 && startup_checks_deferred == 0)
     /* Requires NVT cache. */
     check_db_configs ();
 
@@ -17094,6 +18469,12 @@ init_manage_internal (GSList *log_config,
   gvmd_db_conn_info.host = database->host ? g_strdup (database->host) : NULL;
   gvmd_db_conn_info.port = database->port ? g_strdup (database->port) : NULL;
   gvmd_db_conn_info.user = database->user ? g_strdup (database->user) : NULL;
+  gvmd_db_conn_info.replica_host = database->replica_host
+                                    ? g_strdup (database->replica_host)
+                                    : NULL;
+  gvmd_db_conn_info.replica_port = database->replica_port
+                                    ? g_strdup (database->replica_port)
+                                    : NULL;
 
   if (fork_connection)
     manage_fork_connection = fork_connection;
@@ -17193,6 +18574,9 @@ init_manage_helper (GSList *log_config, const db_conn_info_t *database,
 void
 cleanup_manage_process (gboolean cleanup)
 {
+  /* Scrub any credential plaintexts cached for this session. */
+  credential_decrypt_ctx_reset ();
+
   if (sql_is_open ())
     {
       if (cleanup)
@@ -17512,6 +18896,8 @@ credentials_setup (credentials_t *credentials)
                 " ORDER BY coalesce (owner, 0) DESC LIMIT 1;",
                 credentials->uuid);
 
+  auto_cache_rebuild_cached = setting_auto_cache_rebuild_sql ();
+
   return 0;
 }
 
@@ -17531,6 +18917,11 @@ auth_cache_find (const char *username, const char *password, int method)
   char *hash, *quoted_username;
   int ret;
 
+  /* Check the in-memory verdict cache first, to save the hash
+   * verification and db round trip on repeat logins. */
+  if (auth_verdict_cache_check (username, password, method) == 0)
+    return 0;
+
   quoted_username = sql_quote (username);
   hash = sql_string ("SELECT hash FROM auth_cache WHERE username = '%s'"
                      " AND method = %i AND creation_time >= m_now () - %d"
@@ -17557,6 +18948,11 @@ auth_cache_find (const char *username, const char *password, int method)
           break;
   }
   g_free (hash);
+
+  if (ret == 0)
+    auth_verdict_cache_add (username, password, method,
+                            get_auth_timeout () * 60);
+
   return ret;
 }
 
@@ -17577,6 +18973,8 @@ auth_cache_insert (const char *username, const char *password, int method)
   hash = manage_authentication_hash(password);
   sql ("INSERT INTO auth_cache (username, hash, method, creation_time)"
        " VALUES ('%s', '%s', %i, m_now ());", quoted_username, hash, method);
+  auth_verdict_cache_add (username, password, method,
+                          get_auth_timeout () * 60);
   /* Cleanup cache */
   sql ("DELETE FROM auth_cache WHERE creation_time < m_now () - %d",
        get_auth_timeout()*60);
@@ -17591,6 +18989,7 @@ auth_cache_insert (const char *username, const char *password, int method)
 static void
 auth_cache_delete (const char *username)
 {
+  auth_verdict_cache_remove (username);
   sql ("DELETE from auth_cache WHERE username = '%s'", username);
 }
 
@@ -19619,6 +21018,139 @@ auto_delete_reports ()
   g_array_free (reports_to_delete, TRUE);
 }
 
+/**
+ * @brief Number of reports to delete in a single retention transaction.
+ */
+#define RETENTION_BATCH_SIZE 10
+
+/**
+ * @brief Number of microseconds to sleep between retention batches.
+ */
+#define RETENTION_BATCH_SLEEP 500000
+
+/**
+ * @brief Delete reports that are older than the retention period.
+ *
+ * The reports are deleted in small batches with a commit after each batch,
+ * so that other processes can get at the tables in between.
+ *
+ * Does nothing when the "Report Retention Period" setting is 0 (the
+ * default).
+ */
+void
+purge_expired_reports ()
+{
+  iterator_t reports;
+  GArray *reports_to_delete;
+  int days, batch, deleted, batch_deleted, index;
+  time_t cutoff;
+
+  if (setting_value_int (SETTING_UUID_REPORT_RETENTION, &days)
+      || days <= 0)
+    return;
+
+  cutoff = time (NULL) - ((time_t) days * 60 * 60 * 24);
+
+  reports_to_delete = g_array_new (TRUE, TRUE, sizeof (report_t));
+
+  init_iterator (&reports,
+                 "SELECT reports.id FROM reports, tasks"
+                 " WHERE reports.task = tasks.id"
+                 " AND tasks.owner IS NOT NULL"
+                 " AND tasks.hidden = 0"
+                 " AND reports.creation_time < %ld"
+                 " ORDER BY reports.creation_time;",
+                 (long) cutoff);
+  while (next (&reports))
+    {
+      report_t report;
+
+      report = iterator_int64 (&reports, 0);
+      assert (report);
+      g_array_append_val (reports_to_delete, report);
+    }
+  cleanup_iterator (&reports);
+
+  if (reports_to_delete->len == 0)
+    {
+      g_array_free (reports_to_delete, TRUE);
+      return;
+    }
+
+  g_info ("Report retention: %u reports exceed the retention period of"
+          " %i days",
+          reports_to_delete->len,
+          days);
+
+  deleted = 0;
+  batch_deleted = 0;
+  batch = 0;
+  sql_begin_immediate ();
+  for (index = 0; index < reports_to_delete->len; index++)
+    {
+      int ret;
+      report_t report = g_array_index (reports_to_delete, report_t, index);
+
+      /* As in delete_report, this prevents other processes from getting the
+       * report ID. */
+      if (sql_int ("SELECT try_exclusive_lock('reports');") == 0)
+        {
+          g_debug ("%s: could not acquire lock on reports table", __func__);
+          sql_rollback ();
+          g_array_free (reports_to_delete, TRUE);
+          return;
+        }
+
+      /* Check if report still exists in case another process has deleted it
+       *  in the meantime. */
+      if (sql_int ("SELECT count(*) FROM reports WHERE id = %llu",
+                    report))
+        {
+          ret = delete_report_internal (report);
+          if (ret == 2)
+            /* Report is in use. */
+            g_debug ("%s: %llu is in use", __func__, report);
+          else if (ret)
+            {
+              /* Drop the rest of the batch, in case the transaction was
+               * aborted.  The dropped reports are picked up again on the
+               * next round. */
+              g_warning ("%s: failed to delete %llu (%i)",
+                         __func__, report, ret);
+              sql_rollback ();
+              sql_begin_immediate ();
+              batch = 0;
+              batch_deleted = 0;
+              continue;
+            }
+          else
+            batch_deleted++;
+        }
+
+      batch++;
+      if (batch == RETENTION_BATCH_SIZE)
+        {
+          sql_commit ();
+          deleted += batch_deleted;
+          g_info ("Report retention: deleted %i of %u expired reports",
+                  deleted,
+                  reports_to_delete->len);
+          gvm_usleep (RETENTION_BATCH_SLEEP);
+          sql_begin_immediate ();
+          batch = 0;
+          batch_deleted = 0;
+        }
+    }
+  sql_commit ();
+  deleted += batch_deleted;
+
+  g_info ("Report retention: done, deleted %i of %u expired reports",
+          deleted,
+          reports_to_delete->len);
+
+  g_array_free (reports_to_delete, TRUE);
+}
+
 
 /**
  * @brief Get definitions file from a task's config.
@@ -19724,7 +21256,17 @@ result_nvt_notice (const gchar *nvt)
 }
 
 /**
- * @brief Make an OSP result.
+ * @brief Columns of the results table covered by osp_result_values.
+ */
+#define OSP_RESULT_COLUMNS                                  \
+ "owner, date, task, host, hostname, port, nvt,"            \
+ "  nvt_version, severity, type, qod, qod_type, description," \
+ "  path, uuid, result_nvt, hash_value, delta_hash"
+
+/**
+ * @brief Build a VALUES tuple for inserting an OSP result.
+ *
+ * Also ensures the NVT of the result occurs in result_nvts.
  *
  * @param[in]  task         The task associated with the result.
  * @param[in]  host         Target host of result.
@@ -19738,17 +21280,19 @@ result_nvt_notice (const gchar *nvt)
  * @param[in]  path         Result path, e.g. file location of a product.
  * @param[in]  hash_value   Hash value of the result.
  *
- * @return A result descriptor for the new result, 0 if error.
+ * @return Freshly allocated tuple for the \ref OSP_RESULT_COLUMNS columns
+ *         of the results table, NULL if error.
  */
-result_t
-make_osp_result (task_t task, const char *host, const char *hostname,
-                 const char *nvt, const char *type, const char *description,
-                 const char *port, const char *severity, int qod,
-                 const char *path, const char *hash_value)
+static gchar *
+osp_result_values (task_t task, const char *host, const char *hostname,
+                   const char *nvt, const char *type, const char *description,
+                   const char *port, const char *severity, int qod,
+                   const char *path, const char *hash_value)
 {
   char *nvt_revision = NULL;
   gchar *quoted_type, *quoted_desc, *quoted_nvt, *result_severity, *quoted_port;
   gchar *quoted_host, *quoted_hostname, *quoted_path, *quoted_hash_value;
+  gchar *values;
 
   assert (task);
   assert (type);
@@ -19783,24 +21327,25 @@ make_osp_result (task_t task, const char *host, const char *hostname,
           */
           g_warning ("%s: Result without severity for test %s",
                      __func__, nvt ? nvt : "(unknown)");
-          return 0;
+          return NULL;
         }
     }
   else
     result_severity = sql_quote (severity);
   result_nvt_notice (quoted_nvt);
-  sql ("INSERT into results"
-       " (owner, date, task, host, hostname, port, nvt,"
-       "  nvt_version, severity, type, qod, qod_type, description,"
-       "  path, uuid, result_nvt, hash_value)"
-       " VALUES (NULL, m_now(), %llu, '%s', '%s', '%s', '%s',"
-       "         '%s', '%s', '%s', %d, '', '%s',"
-       "         '%s', make_uuid (),"
-       "         (SELECT id FROM result_nvts WHERE nvt = '%s'), '%s');",
-       task, quoted_host, quoted_hostname, quoted_port, quoted_nvt,
-       nvt_revision ?: "", result_severity ?: "0",
-       quoted_type, qod, quoted_desc, quoted_path, quoted_nvt,
-       quoted_hash_value);
+  values = g_strdup_printf ("(NULL, m_now(), %llu, '%s', '%s', '%s', '%s',"
+                            " '%s', '%s', '%s', %d, '', '%s',"
+                            " '%s', make_uuid (),"
+                            " (SELECT id FROM result_nvts WHERE nvt = '%s'),"
+                            " '%s',"
+                            " result_delta_hash ('%s', '%s', '%s', '%s'))",
+                            task, quoted_host, quoted_hostname, quoted_port,
+                            quoted_nvt,
+                            nvt_revision ?: "", result_severity ?: "0",
+                            quoted_type, qod, quoted_desc, quoted_path,
+                            quoted_nvt,
+                            quoted_hash_value,
+                            quoted_host, quoted_port, quoted_nvt, quoted_desc);
   g_free (result_severity);
   g_free (nvt_revision);
   g_free (quoted_type);
@@ -19812,7 +21357,46 @@ make_osp_result (task_t task, const char *host, const char *hostname,
   g_free (quoted_path);
   g_free (quoted_hash_value);
 
-  return sql_last_insert_id ();
+  return values;
+}
+
+/**
+ * @brief Make an OSP result.
+ *
+ * @param[in]  task         The task associated with the result.
+ * @param[in]  host         Target host of result.
+ * @param[in]  hostname     Hostname of the result.
+ * @param[in]  nvt          A title for the result.
+ * @param[in]  type         Type of result.  "Alarm", etc.
+ * @param[in]  description  Description of the result.
+ * @param[in]  port         Result port.
+ * @param[in]  severity     Result severity.
+ * @param[in]  qod          Quality of detection.
+ * @param[in]  path         Result path, e.g. file location of a product.
+ * @param[in]  hash_value   Hash value of the result.
+ *
+ * @return A result descriptor for the new result, 0 if error.
+ */
+result_t
+make_osp_result (task_t task, const char *host, const char *hostname,
+                 const char *nvt, const char *type, const char *description,
+                 const char *port, const char *severity, int qod,
+                 const char *path, const char *hash_value)
+{
+  gchar *values;
+  result_t result;
+
+  values = osp_result_values (task, host, hostname, nvt, type, description,
+                              port, severity, qod, path, hash_value);
+  if (values == NULL)
+    return 0;
+
+  result = sql_insert_id ("INSERT into results (" OSP_RESULT_COLUMNS ")"
+                          " VALUES %s RETURNING id;",
+                          values);
+  g_free (values);
+
+  return result;
 }
 
 /**
@@ -19977,6 +21561,7 @@ host_notice (const char *host_name, const char *identifier_type,
              int check_for_existing_identifier)
 {
   host_t host;
+  resource_t identifier;
   gchar *quoted_identifier_value, *quoted_identifier_type, *quoted_source_type;
   gchar *quoted_source_id;
 
@@ -19995,16 +21580,17 @@ host_notice (const char *host_name, const char *identifier_type,
     {
       gchar *quoted_host_name;
       quoted_host_name = sql_quote (host_name);
-      sql ("INSERT into hosts"
-           " (uuid, owner, name, comment, creation_time, modification_time)"
-           " VALUES"
-           " (make_uuid (), (SELECT id FROM users WHERE uuid = '%s'), '%s', '',"
-           "  m_now (), m_now ());",
-           current_credentials.uuid,
-           quoted_host_name);
+      host = sql_insert_id ("INSERT into hosts"
+                            " (uuid, owner, name, comment, creation_time,"
+                            "  modification_time)"
+                            " VALUES"
+                            " (make_uuid (),"
+                            "  (SELECT id FROM users WHERE uuid = '%s'), '%s',"
+                            "  '', m_now (), m_now ())"
+                            " RETURNING id;",
+                            current_credentials.uuid,
+                            quoted_host_name);
       g_free (quoted_host_name);
-
-      host = sql_last_insert_id ();
     }
 
   quoted_identifier_value = sql_quote (identifier_value);
@@ -20028,24 +21614,28 @@ host_notice (const char *host_name, const char *identifier_type,
                   quoted_source_id))
     return 0;
 
-  sql ("INSERT into host_identifiers"
-       " (uuid, host, owner, name, comment, value, source_type, source_id,"
-       "  source_data, creation_time, modification_time)"
-       " VALUES"
-       " (make_uuid (), %llu, (SELECT id FROM users WHERE uuid = '%s'), '%s',"
-       "  '', '%s', '%s', '%s', '', m_now (), m_now ());",
-       host,
-       current_credentials.uuid,
-       quoted_identifier_type,
-       quoted_identifier_value,
-       quoted_source_type,
-       quoted_source_id);
+  identifier = sql_insert_id ("INSERT into host_identifiers"
+                              " (uuid, host, owner, name, comment, value,"
+                              "  source_type, source_id, source_data,"
+                              "  creation_time, modification_time)"
+                              " VALUES"
+                              " (make_uuid (), %llu,"
+                              "  (SELECT id FROM users WHERE uuid = '%s'),"
+                              "  '%s', '', '%s', '%s', '%s', '', m_now (),"
+                              "  m_now ())"
+                              " RETURNING id;",
+                              host,
+                              current_credentials.uuid,
+                              quoted_identifier_type,
+                              quoted_identifier_value,
+                              quoted_source_type,
+                              quoted_source_id);
 
   sql ("UPDATE hosts SET modification_time = (SELECT modification_time"
        "                                      FROM host_identifiers"
        "                                      WHERE id = %llu)"
        " WHERE id = %llu;",
-       sql_last_insert_id (),
+       identifier,
        host);
 
   g_free (quoted_identifier_type);
@@ -20106,7 +21696,8 @@ make_result (task_t task, const char* host, const char *hostname,
 {
   result_t result;
   gchar *nvt_revision, *severity, *qod, *qod_type;
-  gchar *quoted_nvt, *quoted_hostname, *quoted_descr, *quoted_path;
+  gchar *quoted_nvt, *statement;
+  const char *params[9];
   nvt_t nvt_id = 0;
 
   if (nvt && strcmp (nvt, "") && (find_nvt (nvt, &nvt_id) || nvt_id <= 0))
@@ -20155,32 +21746,36 @@ make_result (task_t task, const char* host, const char *hostname,
       g_free (severity);
       severity = g_strdup ("0.0");
     }
-  quoted_hostname = sql_quote (hostname ? hostname : "");
-  quoted_descr = sql_quote (description ?: "");
-  quoted_path = sql_quote (path ? path : "");
   result_nvt_notice (nvt);
-  sql ("INSERT into results"
-       " (owner, date, task, host, hostname, port,"
-       "  nvt, nvt_version, severity, type,"
-       "  description, uuid, qod, qod_type, path, result_nvt)"
-       " VALUES"
-       " (NULL, m_now (), %llu, '%s', '%s', '%s',"
-       "  '%s', '%s', '%s', '%s',"
-       "  '%s', make_uuid (), %s, %s, '%s',"
-       "  (SELECT id FROM result_nvts WHERE nvt = '%s'));",
-       task, host ?: "", quoted_hostname, port ?: "",
-       quoted_nvt ?: "", nvt_revision, severity, type,
-       quoted_descr, qod, qod_type, quoted_path, quoted_nvt ? quoted_nvt : "");
+  statement = g_strdup_printf
+               ("INSERT into results"
+                " (owner, date, task, host, hostname, port,"
+                "  nvt, nvt_version, severity, type,"
+                "  description, uuid, qod, qod_type, path, result_nvt)"
+                " VALUES"
+                " (NULL, m_now (), %llu, $1, $2, $3,"
+                "  $4, $5, $6, $7,"
+                "  $8, make_uuid (), %s, %s, $9,"
+                "  (SELECT id FROM result_nvts WHERE nvt = $4))"
+                " RETURNING id;",
+                task, qod, qod_type);
+  params[0] = host ?: "";
+  params[1] = hostname ?: "";
+  params[2] = port ?: "";
+  params[3] = (nvt && strcmp (nvt, "")) ? nvt : "";
+  params[4] = nvt_revision;
+  params[5] = severity;
+  params[6] = type;
+  params[7] = description ?: "";
+  params[8] = path ?: "";
+  result = sql_params_insert_id (statement, 9, params);
+  g_free (statement);
 
   g_free (quoted_nvt);
-  g_free (quoted_hostname);
-  g_free (quoted_descr);
   g_free (qod);
   g_free (qod_type);
   g_free (nvt_revision);
   g_free (severity);
-  g_free (quoted_path);
-  result = sql_last_insert_id ();
   return result;
 }
 
@@ -20199,23 +21794,32 @@ result_t
 make_cve_result (task_t task, const char* host, const char *nvt, double cvss,
                  const char* description)
 {
-  gchar *quoted_descr;
-  quoted_descr = sql_quote (description ?: "");
-  result_nvt_notice (nvt);
-  sql ("INSERT into results"
-       " (owner, date, task, host, port, nvt, nvt_version, severity, type,"
-       "  description, uuid, qod, qod_type, path, result_nvt)"
-       " VALUES"
-       " (NULL, m_now (), %llu, '%s', '', '%s',"
-       "  (SELECT iso_time (modification_time)"
-       "     FROM scap.cves WHERE uuid='%s'),"
-       "  '%1.1f', '%s', '%s', make_uuid (), %i, '', '',"
-       "  (SELECT id FROM result_nvts WHERE nvt = '%s'));",
-       task, host ?: "", nvt, nvt, cvss, severity_to_type (cvss),
-       quoted_descr, QOD_DEFAULT, nvt);
+  gchar *statement, *severity;
+  const char *params[4];
+  result_t result;
 
-  g_free (quoted_descr);
-  return sql_last_insert_id ();
+  result_nvt_notice (nvt);
+  statement = g_strdup_printf
+               ("INSERT into results"
+                " (owner, date, task, host, port, nvt, nvt_version, severity,"
+                "  type, description, uuid, qod, qod_type, path, result_nvt)"
+                " VALUES"
+                " (NULL, m_now (), %llu, $1, '', $2,"
+                "  (SELECT iso_time (modification_time)"
+                "     FROM scap.cves WHERE uuid = $2),"
+                "  $3, '%s', $4, make_uuid (), %i, '', '',"
+                "  (SELECT id FROM result_nvts WHERE nvt = $2))"
+                " RETURNING id;",
+                task, severity_to_type (cvss), QOD_DEFAULT);
+  severity = g_strdup_printf ("%1.1f", cvss);
+  params[0] = host ?: "";
+  params[1] = nvt;
+  params[2] = severity;
+  params[3] = description ?: "";
+  result = sql_params_insert_id (statement, 4, params);
+  g_free (statement);
+  g_free (severity);
+  return result;
 }
 
 /**
@@ -20990,6 +22594,10 @@ reports_clear_count_cache (const gchar *uuid)
        " WHERE report_counts.user = (SELECT id FROM users"
        "                             WHERE uuid = '%s');",
        quoted_uuid);
+  sql ("DELETE FROM report_filter_counts"
+       " WHERE report_filter_counts.user = (SELECT id FROM users"
+       "                                    WHERE uuid = '%s');",
+       quoted_uuid);
   g_free (quoted_uuid);
 }
 
@@ -21003,6 +22611,11 @@ reports_clear_count_cache_dynamic ()
        " WHERE report_counts.user IN (SELECT owner FROM settings"
        "                              WHERE name = 'Dynamic Severity'"
        "                              AND value = '1');");
+  sql ("DELETE FROM report_filter_counts"
+       " WHERE report_filter_counts.user"
+       "       IN (SELECT owner FROM settings"
+       "           WHERE name = 'Dynamic Severity'"
+       "           AND value = '1');");
 }
 
 /**
@@ -21024,6 +22637,10 @@ reports_build_count_cache (int clear, int* changes_out)
        "        WHERE tasks.id = (SELECT task FROM reports"
        "                          WHERE reports.id = report_counts.report));");
 
+  /* Clear the term keyed filter count cache entirely, as it is not
+   * rebuilt below. */
+  sql ("DELETE FROM report_filter_counts;");
+
   init_iterator (&reports,
                  "SELECT id FROM reports"
                  " WHERE (SELECT hidden = 0 FROM tasks"
@@ -21262,6 +22879,11 @@ report_clear_count_cache (report_t report,
            "%s",
            report,
            extra_where ? extra_where : "");
+      sql ("DELETE FROM report_filter_counts"
+           " WHERE report = %llu"
+           "%s",
+           report,
+           extra_where ? extra_where : "");
     }
   else if (clear_original || clear_overridden)
     {
@@ -21273,6 +22895,13 @@ report_clear_count_cache (report_t report,
            report,
            override,
            extra_where ? extra_where : "");
+      sql ("DELETE FROM report_filter_counts"
+           " WHERE report = %llu"
+           "   AND override = %d"
+           "%s",
+           report,
+           override,
+           extra_where ? extra_where : "");
     }
 }
 
@@ -21288,13 +22917,14 @@ report_clear_count_cache (report_t report,
 report_t
 make_report (task_t task, const char* uuid, task_status_t status)
 {
-  sql ("INSERT into reports (uuid, owner, task, creation_time,"
-       " modification_time, comment, scan_run_status, slave_progress)"
-       " VALUES ('%s',"
-       " (SELECT owner FROM tasks WHERE tasks.id = %llu),"
-       " %llu, %i, %i, '', %u, 0);",
-       uuid, task, task, time (NULL), time (NULL), status);
-  return sql_last_insert_id ();
+  return sql_insert_id ("INSERT into reports (uuid, owner, task,"
+                        " creation_time, modification_time, comment,"
+                        " scan_run_status, slave_progress)"
+                        " VALUES ('%s',"
+                        " (SELECT owner FROM tasks WHERE tasks.id = %llu),"
+                        " %llu, %i, %i, '', %u, 0)"
+                        " RETURNING id;",
+                        uuid, task, task, time (NULL), time (NULL), status);
 }
 
 /**
@@ -21366,34 +22996,27 @@ insert_report_host_detail (report_t report, const char *host,
                            const char *s_desc, const char *name,
                            const char *value, const char *hash_value)
 {
-  char *quoted_host, *quoted_source_name, *quoted_source_type;
-  char *quoted_source_desc, *quoted_name, *quoted_value;
-  char *quoted_hash_value;
-
-  quoted_host = sql_quote (host);
-  quoted_source_type = sql_quote (s_type);
-  quoted_source_name = sql_quote (s_name);
-  quoted_source_desc = sql_quote (s_desc);
-  quoted_name = sql_quote (name);
-  quoted_value = sql_quote (value);
-  quoted_hash_value = sql_quote(hash_value ?: "");
-  sql ("INSERT INTO report_host_details"
-       " (report_host, source_type, source_name, source_description,"
-       "  name, value, hash_value)"
-       " VALUES"
-       " ((SELECT id FROM report_hosts"
-       "   WHERE report = %llu AND host = '%s'),"
-       "  '%s', '%s', '%s', '%s', '%s', '%s');",
-       report, quoted_host, quoted_source_type, quoted_source_name,
-       quoted_source_desc, quoted_name, quoted_value, quoted_hash_value);
+  gchar *statement;
+  const char *params[7];
 
-  g_free (quoted_host);
-  g_free (quoted_source_type);
-  g_free (quoted_source_name);
-  g_free (quoted_source_desc);
-  g_free (quoted_name);
-  g_free (quoted_value);
-  g_free (quoted_hash_value);
+  statement = g_strdup_printf
+               ("INSERT INTO report_host_details"
+                " (report_host, source_type, source_name, source_description,"
+                "  name, value, hash_value)"
+                " VALUES"
+                " ((SELECT id FROM report_hosts"
+                "   WHERE report = %llu AND host = $1),"
+                "  $2, $3, $4, $5, $6, $7);",
+                report);
+  params[0] = host;
+  params[1] = s_type;
+  params[2] = s_name;
+  params[3] = s_desc;
+  params[4] = name;
+  params[5] = value;
+  params[6] = hash_value ?: "";
+  sql_params (statement, 7, params);
+  g_free (statement);
 }
 
 /**
@@ -21412,9 +23035,122 @@ insert_report_host_detail (report_t report, const char *host,
 #define CREATE_REPORT_CHUNK_SLEEP 1000
 
 /**
- * @brief Create a report from an array of results.
+ * @brief Send a buffer of result rows to the db in a single COPY statement.
+ *
+ * Clears the buffer on success.
+ *
+ * @param[in]  buffer  Buffer of tab separated result rows.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+create_report_copy_results (GString *buffer)
+{
+  if (buffer->len == 0)
+    return 0;
+
+  if (sql_copy_start ("COPY results"
+                      " (uuid, owner, date, task, host, hostname, port,"
+                      "  nvt, type, description, nvt_version, severity,"
+                      "  qod, qod_type, report)"
+                      " FROM STDIN"))
+    return -1;
+  if (sql_copy_write (buffer->str, buffer->len))
+    {
+      sql_copy_end ();
+      return -1;
+    }
+  if (sql_copy_end ())
+    return -1;
+  g_string_truncate (buffer, 0);
+  return 0;
+}
+
+/**
+ * @brief Spool an uploaded result for \ref create_report.
  *
- * @param[in]   results       Array of create_report_result_t pointers.
+ * Appends the result to the spool file as the COPY text format columns
+ * host, hostname, port, nvt, type, description, nvt_version, severity,
+ * qod and qod_type, so the parser can free each result as soon as it is
+ * complete instead of accumulating the whole upload in memory.
+ *
+ * @param[in]  spool             Spool file.
+ * @param[in]  host              Host.
+ * @param[in]  hostname          Hostname.
+ * @param[in]  port              Port.
+ * @param[in]  nvt_oid           OID of the NVT that produced the result.
+ * @param[in]  threat            Threat, or NULL for "Log".
+ * @param[in]  description       Description.
+ * @param[in]  scan_nvt_version  Version of the NVT used in the scan.
+ * @param[in]  severity          Severity, NULL or empty for an SQL NULL.
+ * @param[in]  qod               QoD, NULL, empty or "0" for the default.
+ * @param[in]  qod_type          QoD type.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+create_report_spool_result (FILE *spool, const char *host,
+                            const char *hostname, const char *port,
+                            const char *nvt_oid, const char *threat,
+                            const char *description,
+                            const char *scan_nvt_version,
+                            const char *severity, const char *qod,
+                            const char *qod_type)
+{
+  gchar *copy_host, *copy_hostname, *copy_port, *copy_nvt_oid;
+  gchar *copy_description, *copy_scan_nvt_version, *copy_severity;
+  gchar *copy_qod, *copy_qod_type;
+  int ret;
+
+  copy_host = sql_copy_escape (host ? host : "");
+  copy_hostname = sql_copy_escape (hostname ? hostname : "");
+  copy_port = sql_copy_escape (port ? port : "");
+  copy_nvt_oid = sql_copy_escape (nvt_oid ? nvt_oid : "");
+  copy_description = sql_copy_escape (description ? description : "");
+  copy_scan_nvt_version = sql_copy_escape (scan_nvt_version
+                                            ? scan_nvt_version
+                                            : "");
+  if (severity && strcmp (severity, ""))
+    copy_severity = sql_copy_escape (severity);
+  else
+    copy_severity = sql_copy_escape (NULL);
+  if (qod && strcmp (qod, "") && strcmp (qod, "0"))
+    copy_qod = sql_copy_escape (qod);
+  else
+    copy_qod = g_strdup (G_STRINGIFY (QOD_DEFAULT));
+  copy_qod_type = sql_copy_escape (qod_type ? qod_type : "");
+
+  ret = fprintf (spool, "%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n",
+                 copy_host,
+                 copy_hostname,
+                 copy_port,
+                 copy_nvt_oid,
+                 threat ? threat_message_type (threat) : "Log Message",
+                 copy_description,
+                 copy_scan_nvt_version,
+                 copy_severity,
+                 copy_qod,
+                 copy_qod_type);
+
+  g_free (copy_host);
+  g_free (copy_hostname);
+  g_free (copy_port);
+  g_free (copy_nvt_oid);
+  g_free (copy_description);
+  g_free (copy_scan_nvt_version);
+  g_free (copy_severity);
+  g_free (copy_qod);
+  g_free (copy_qod_type);
+
+  return ret < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Create a report from a spool of results.
+ *
+ * @param[in]   results_file   Spool of results written by
+ *                             \ref create_report_spool_result.
+ * @param[in]   results_count  Number of results in the spool.
  * @param[in]   task_id       UUID of container task, or NULL to create new one.
  * @param[in]   in_assets     Whether to create assets from the report.
  * @param[in]   scan_start    Scan start time text.
@@ -21431,13 +23167,17 @@ insert_report_host_detail (report_t report, const char *host,
  *         container, -6 permission to create assets denied.
  */
 int
-create_report (array_t *results, const char *task_id, const char *in_assets,
+create_report (FILE *results_file, int results_count, const char *task_id,
+               const char *in_assets,
                const char *scan_start, const char *scan_end,
                array_t *host_starts, array_t *host_ends, array_t *details,
                char **report_id)
 {
   int index, in_assets_int, count, insert_count, first, rc;
-  create_report_result_t *result, *end, *start;
+  create_report_result_t *end, *start;
+  char *line;
+  size_t line_size;
+  ssize_t line_len;
   report_t report;
   user_t owner;
   task_t task;
@@ -21453,6 +23193,11 @@ create_report (array_t *results, const char *task_id, const char *in_assets,
 
   g_debug ("%s", __func__);
 
+  /* Push any buffered spool data out to the file now, so that the fork
+   * below cannot flush the same data from both processes. */
+  if (results_file)
+    fflush (results_file);
+
   if (acl_user_may ("create_report") == 0)
     return 99;
 
@@ -21506,8 +23251,8 @@ create_report (array_t *results, const char *task_id, const char *in_assets,
   /* Show that the upload has started. */
 
   set_task_run_status (task, TASK_STATUS_RUNNING);
-  sql ("UPDATE tasks SET upload_result_count = %llu WHERE id = %llu;",
-       results->len,
+  sql ("UPDATE tasks SET upload_result_count = %i WHERE id = %llu;",
+       results_count,
        task);
   sql_commit ();
 
@@ -21609,78 +23354,43 @@ create_report (array_t *results, const char *task_id, const char *in_assets,
 
   g_debug ("%s: add results", __func__);
   insert = g_string_new ("");
-  index = 0;
-  first = 1;
   insert_count = 0;
   count = 0;
-  while ((result = (create_report_result_t*) g_ptr_array_index (results,
-                                                                index++)))
-    {
-      gchar *quoted_host, *quoted_hostname, *quoted_port, *quoted_nvt_oid;
-      gchar *quoted_description, *quoted_scan_nvt_version, *quoted_severity;
-      gchar *quoted_qod, *quoted_qod_type;
-      g_debug ("%s: add results: index: %i", __func__, index);
-
-      quoted_host = sql_quote (result->host ? result->host : "");
-      quoted_hostname = sql_quote (result->hostname ? result->hostname : "");
-      quoted_port = sql_quote (result->port ? result->port : "");
-      quoted_nvt_oid = sql_quote (result->nvt_oid ? result->nvt_oid : "");
-      quoted_description = sql_quote (result->description
-                                       ? result->description
-                                       : "");
-      quoted_scan_nvt_version = sql_quote (result->scan_nvt_version
-                                       ? result->scan_nvt_version
-                                       : "");
-      quoted_severity =  sql_quote (result->severity ? result->severity : "");
-      if (result->qod && strcmp (result->qod, "") && strcmp (result->qod, "0"))
-        quoted_qod = sql_quote (result->qod);
-      else
-        quoted_qod = g_strdup (G_STRINGIFY (QOD_DEFAULT));
-      quoted_qod_type = sql_quote (result->qod_type ? result->qod_type : "");
-      result_nvt_notice (quoted_nvt_oid);
+  line = NULL;
+  line_size = 0;
+  rewind (results_file);
+  while ((line_len = getline (&line, &line_size, results_file)) > 0)
+    {
+      gchar *uuid;
 
-      if (first)
-        g_string_append (insert,
-                         "INSERT INTO results"
-                         " (uuid, owner, date, task, host, hostname, port,"
-                         "  nvt, type, description,"
-                         "  nvt_version, severity, qod, qod_type,"
-                         "  result_nvt, report)"
-                         " VALUES");
-      else
-        g_string_append (insert, ", ");
-      first = 0;
+      if (line[line_len - 1] == '\n')
+        line[line_len - 1] = '\0';
+
+      uuid = gvm_uuid_make ();
       g_string_append_printf (insert,
-                              " (make_uuid (), %llu, m_now (), %llu, '%s',"
-                              "  '%s', '%s', '%s', '%s', '%s', '%s', '%s',"
-                              "  '%s', '%s',"
-                              "  (SELECT id FROM result_nvts WHERE nvt = '%s'),"
-                              "  %llu)",
+                              "%s\t%llu\t%i\t%llu\t%s\t%llu\n",
+                              uuid,
                               owner,
+                              (int) time (NULL),
                               task,
-                              quoted_host,
-                              quoted_hostname,
-                              quoted_port,
-                              quoted_nvt_oid,
-                              result->threat
-                               ? threat_message_type (result->threat)
-                               : "Log Message",
-                              quoted_description,
-                              quoted_scan_nvt_version,
-                              quoted_severity,
-                              quoted_qod,
-                              quoted_qod_type,
-                              quoted_nvt_oid,
+                              line,
                               report);
+      free (uuid);
 
-      /* Limit the number of results inserted at a time. */
+      /* Limit the number of results sent per COPY statement. */
       if (insert_count == CREATE_REPORT_INSERT_SIZE)
         {
-          sql ("%s", insert->str);
-          g_string_truncate (insert, 0);
+          if (create_report_copy_results (insert))
+            {
+              g_warning ("%s: failed to copy results into db", __func__);
+              sql_rollback ();
+              g_string_free (insert, TRUE);
+              free (line);
+              gvm_close_sentry ();
+              exit (EXIT_FAILURE);
+            }
           count++;
           insert_count = 0;
-          first = 1;
 
           if (count == CREATE_REPORT_CHUNK_SIZE)
             {
@@ -21692,27 +23402,45 @@ create_report (array_t *results, const char *task_id, const char *in_assets,
             }
         }
       insert_count++;
-
-      g_free (quoted_host);
-      g_free (quoted_hostname);
-      g_free (quoted_port);
-      g_free (quoted_nvt_oid);
-      g_free (quoted_description);
-      g_free (quoted_scan_nvt_version);
-      g_free (quoted_severity);
-      g_free (quoted_qod);
-      g_free (quoted_qod_type);
     }
+  free (line);
 
-  if (first == 0)
+  if (create_report_copy_results (insert))
     {
-      sql ("%s", insert->str);
-      report_cache_counts (report, 1, 1, NULL);
-      sql_commit ();
-      gvm_usleep (CREATE_REPORT_CHUNK_SLEEP);
-      sql_begin_immediate ();
+      g_warning ("%s: failed to copy results into db", __func__);
+      sql_rollback ();
+      g_string_free (insert, TRUE);
+      gvm_close_sentry ();
+      exit (EXIT_FAILURE);
     }
 
+  /* Ensure the NVTs of the results occur in result_nvts.  The spool only
+   * stores the COPY row, so this runs for the whole report in one
+   * statement instead of per result. */
+  sql ("INSERT INTO result_nvts (nvt)"
+       " SELECT DISTINCT nvt FROM results WHERE report = %llu"
+       " ON CONFLICT DO NOTHING;",
+       report);
+
+  /* The result_nvts lookups are deferred to a single post load update,
+   * because COPY does not allow per row subqueries. */
+  sql ("UPDATE results SET result_nvt = result_nvts.id"
+       " FROM result_nvts"
+       " WHERE results.report = %llu"
+       " AND result_nvts.nvt = results.nvt;",
+       report);
+
+  sql ("UPDATE results"
+       " SET delta_hash = result_delta_hash (host, port, nvt, description)"
+       " WHERE report = %llu"
+       " AND delta_hash IS NULL;",
+       report);
+
+  report_cache_counts (report, 1, 1, NULL);
+  sql_commit ();
+  gvm_usleep (CREATE_REPORT_CHUNK_SLEEP);
+  sql_begin_immediate ();
+
   sql ("INSERT INTO result_nvt_reports (result_nvt, report)"
        " SELECT distinct result_nvt, %llu FROM results"
        " WHERE results.report = %llu;",
@@ -22090,6 +23818,173 @@ report_add_result_for_buffer (report_t report, result_t result)
   cleanup_iterator (&cache_iterator);
 }
 
+/**
+ * @brief Refresh the end_time of the overridden count cache of a report.
+ *
+ * @param[in]  report  The report.
+ */
+static void
+report_counts_update_end_time (report_t report)
+{
+  sql ("UPDATE report_counts"
+       " SET end_time = (SELECT coalesce(min(overrides.end_time), 0)"
+       "                 FROM overrides, results"
+       "                 WHERE overrides.nvt = results.nvt"
+       "                 AND results.report = %llu"
+       "                 AND overrides.end_time >= m_now ())"
+       " WHERE report = %llu AND override = 1;",
+       report, report);
+}
+
+/**
+ * @brief Apply the contribution of one NVT's results to cached counts.
+ *
+ * Computes the overridden severity distribution of the report's results
+ * that have the given NVT, for every cached overridden count combination,
+ * and adds it to the cache with the given sign.  An override can be
+ * excluded from the calculation, to get the distribution as it is without
+ * that override.
+ *
+ * Subtracting the distribution without an override and adding the
+ * distribution with it updates the cache for a new override with work
+ * proportional to the results of the one NVT, where rebuilding would
+ * re-count every result of the report.
+ *
+ * @param[in]  report            Report.
+ * @param[in]  nvt               OID of the NVT.
+ * @param[in]  exclude_override  Override to leave out, or 0 for none.
+ * @param[in]  sign              1 to add the contribution, -1 to subtract.
+ * @param[in]  users_where       Optional SQL clause to limit users.
+ */
+static void
+report_cache_counts_nvt_delta (report_t report, const char *nvt,
+                               override_t exclude_override, int sign,
+                               const char *users_where)
+{
+  iterator_t cache_iterator;
+  gchar *quoted_nvt, *old_user_id;
+
+  if (nvt == NULL)
+    return;
+
+  old_user_id = current_credentials.uuid;
+  quoted_nvt = sql_quote (nvt);
+  init_report_counts_build_iterator (&cache_iterator, report, INT_MAX, 0,
+                                     users_where);
+  while (next (&cache_iterator))
+    {
+      int min_qod = report_counts_build_iterator_min_qod (&cache_iterator);
+      int override = report_counts_build_iterator_override (&cache_iterator);
+      user_t user = report_counts_build_iterator_user (&cache_iterator);
+      iterator_t distribution;
+      gchar *owned_clause, *with_clause;
+
+      if (override == 0)
+        /* Overrides do not change the original severity counts. */
+        continue;
+
+      current_credentials.uuid
+        = sql_string ("SELECT uuid FROM users WHERE id = %llu",
+                      user);
+      manage_session_init (current_credentials.uuid);
+
+      owned_clause = acl_where_owned_for_get ("override", NULL, NULL,
+                                              &with_clause);
+
+      init_iterator (&distribution,
+                     "SELECT ov_severity, count (*) FROM"
+                     " (SELECT coalesce ((%s SELECT overrides.new_severity"
+                     "                    FROM overrides"
+                     "                    WHERE overrides.nvt = results.nvt"
+                     "                    AND overrides.id != %llu"
+                     "                    AND %s"
+                     "                    AND ((overrides.end_time = 0)"
+                     "                         OR (overrides.end_time"
+                     "                             >= m_now ()))"
+                     "                    AND (overrides.task ="
+                     "                         (SELECT reports.task"
+                     "                          FROM reports"
+                     "                          WHERE reports.id = %llu)"
+                     "                         OR overrides.task = 0)"
+                     "                    AND (overrides.result = results.id"
+                     "                         OR overrides.result = 0)"
+                     "                    AND (overrides.hosts is NULL"
+                     "                         OR overrides.hosts = ''"
+                     "                         OR hosts_contains"
+                     "                             (overrides.hosts,"
+                     "                              results.host))"
+                     "                    AND (overrides.port is NULL"
+                     "                         OR overrides.port = ''"
+                     "                         OR overrides.port"
+                     "                            = results.port)"
+                     "                    AND severity_matches_ov"
+                     "                        (results.severity,"
+                     "                         overrides.severity)"
+                     "                    ORDER BY overrides.result DESC,"
+                     "                      overrides.task DESC,"
+                     "                      overrides.port DESC,"
+                     "                      overrides.severity ASC,"
+                     "                      overrides.creation_time DESC"
+                     "                    LIMIT 1),"
+                     "                   results.severity) AS ov_severity"
+                     "  FROM results"
+                     "  WHERE results.report = %llu"
+                     "  AND results.nvt = '%s'"
+                     "  AND results.qod >= %d) AS nvt_severities"
+                     " GROUP BY ov_severity;",
+                     with_clause ? with_clause : "",
+                     exclude_override,
+                     owned_clause,
+                     report,
+                     report,
+                     quoted_nvt,
+                     min_qod);
+
+      g_free (with_clause);
+      g_free (owned_clause);
+
+      while (next (&distribution))
+        {
+          double severity;
+          int count;
+          rowid_t rowid;
+
+          severity = iterator_double (&distribution, 0);
+          count = iterator_int (&distribution, 1);
+
+          rowid = 0;
+          sql_int64 (&rowid,
+                     "SELECT id FROM report_counts"
+                     " WHERE report = %llu"
+                     " AND \"user\" = %llu"
+                     " AND override = 1"
+                     " AND severity = %1.1f"
+                     " AND min_qod = %d",
+                     report, user, severity, min_qod);
+          if (rowid)
+            sql ("UPDATE report_counts"
+                 " SET count = count + %d"
+                 " WHERE id = %llu;",
+                 sign * count,
+                 rowid);
+          else if (sign > 0)
+            sql ("INSERT INTO report_counts"
+                 " (report, \"user\", override, min_qod, severity, count,"
+                 "  end_time)"
+                 " VALUES"
+                 " (%llu, %llu, 1, %d, %1.1f, %d, 0);",
+                 report, user, min_qod, severity, count);
+        }
+      cleanup_iterator (&distribution);
+
+      g_free (current_credentials.uuid);
+    }
+  cleanup_iterator (&cache_iterator);
+  current_credentials.uuid = old_user_id;
+  manage_session_init (current_credentials.uuid);
+  g_free (quoted_nvt);
+}
+
 /**
  * @brief Add a result to a report.
  *
@@ -22110,14 +24005,7 @@ report_add_result (report_t report, result_t result)
 
   report_add_result_for_buffer (report, result);
 
-  sql ("UPDATE report_counts"
-       " SET end_time = (SELECT coalesce(min(overrides.end_time), 0)"
-       "                 FROM overrides, results"
-       "                 WHERE overrides.nvt = results.nvt"
-       "                 AND results.report = %llu"
-       "                 AND overrides.end_time >= m_now ())"
-       " WHERE report = %llu AND override = 1;",
-       report, report);
+  report_counts_update_end_time (report);
 }
 
 /**
@@ -22161,14 +24049,7 @@ report_add_results_array (report_t report, GArray *results)
       report_add_result_for_buffer (report, result);
     }
 
-  sql ("UPDATE report_counts"
-       " SET end_time = (SELECT coalesce(min(overrides.end_time), 0)"
-       "                 FROM overrides, results"
-       "                 WHERE overrides.nvt = results.nvt"
-       "                 AND results.report = %llu"
-       "                 AND overrides.end_time >= m_now ())"
-       " WHERE report = %llu AND override = 1;",
-       report, report);
+  report_counts_update_end_time (report);
 
   g_string_free (array_sql, TRUE);
 }
@@ -23116,6 +24997,22 @@ where_qod (int min_qod)
     { "coalesce (result_vt_epss.max_epss_severity, 0.0)",                     \
       "max_epss_severity",                                                    \
       KEYWORD_TYPE_DOUBLE },                                                  \
+    { "(SELECT CASE"                                                          \
+      "        WHEN EXISTS (SELECT * FROM tags"                               \
+      "                     WHERE resource_type = 'result'"                   \
+      "                     AND active = 1"                                   \
+      "                     AND EXISTS (SELECT * FROM tag_resources"          \
+      "                                 WHERE tag = tags.id"                  \
+      "                                 AND resource = results.id"            \
+      "                                 AND resource_location"                \
+      "                                     = " G_STRINGIFY (LOCATION_TABLE)  \
+      "                                 AND tag_resources.resource_type"      \
+      "                                     = 'result'))"                     \
+      "        THEN 1"                                                        \
+      "        ELSE 0"                                                        \
+      "        END)",                                                         \
+      NULL,                                                                   \
+      KEYWORD_TYPE_INTEGER },                                                 \
 
 /**
  * @brief Result iterator columns.
@@ -23311,6 +25208,153 @@ result_iterator_opts_table (int override, int dynamic)
   return ret;
 }
 
+/**
+ * @brief User whose overrides are compiled into the session table.
+ */
+static gchar *session_overrides_user = NULL;
+
+/**
+ * @brief Stamp of the overrides table when the session table was built.
+ */
+static gchar *session_overrides_stamp = NULL;
+
+/**
+ * @brief Drop the compiled override set of the session.
+ *
+ * Forces a rebuild on the next query that applies overrides, after the
+ * process itself creates, modifies or deletes an override.
+ */
+static void
+session_overrides_invalidate ()
+{
+  g_free (session_overrides_user);
+  g_free (session_overrides_stamp);
+  session_overrides_user = NULL;
+  session_overrides_stamp = NULL;
+}
+
+/**
+ * @brief Compile the overrides of the current user into a session table.
+ *
+ * Overrides change rarely but are consulted in every count and iterator
+ * query that applies them, so the permission checked set of the current
+ * user is compiled once into the temporary table session_overrides and
+ * reused by all queries on the connection.  A cheap stamp of the
+ * overrides table is probed on every call, so changes made by other
+ * processes trigger a rebuild.
+ *
+ * @return 0 session table is up to date, -1 it may not be used.
+ */
+static int
+session_overrides_refresh ()
+{
+  gchar *stamp, *owned_clause;
+  char *user_id;
+
+  if (current_credentials.uuid == NULL)
+    return -1;
+
+  stamp = sql_string ("SELECT coalesce (max (modification_time), 0)"
+                      "       || ' ' || count (*)"
+                      " FROM overrides;");
+  if (stamp == NULL)
+    return -1;
+
+  if (session_overrides_user
+      && session_overrides_stamp
+      && strcmp (session_overrides_user, current_credentials.uuid) == 0
+      && strcmp (session_overrides_stamp, stamp) == 0)
+    {
+      g_free (stamp);
+      return 0;
+    }
+
+  user_id = sql_string ("SELECT id FROM users WHERE uuid = '%s';",
+                        current_credentials.uuid);
+  if (user_id == NULL)
+    {
+      g_free (stamp);
+      return -1;
+    }
+
+  sql ("CREATE TEMPORARY TABLE IF NOT EXISTS session_overrides"
+       " (result_nvt integer,"
+       "  result integer,"
+       "  task integer,"
+       "  hosts text,"
+       "  port text,"
+       "  severity double precision,"
+       "  new_severity double precision,"
+       "  ord integer);");
+  sql ("CREATE INDEX IF NOT EXISTS session_overrides_by_result_nvt"
+       " ON session_overrides (result_nvt);");
+  sql ("DELETE FROM session_overrides;");
+
+  owned_clause = acl_where_owned_for_get ("override", user_id, NULL, NULL);
+  sql ("INSERT INTO session_overrides"
+       " (result_nvt, result, task, hosts, port, severity, new_severity,"
+       "  ord)"
+       " SELECT result_nvt, result, task, hosts, port, severity,"
+       "        new_severity,"
+       "        row_number () OVER (ORDER BY result DESC, task DESC,"
+       "                            port DESC, severity ASC,"
+       "                            creation_time DESC)"
+       " FROM overrides"
+       " WHERE %s"
+       " AND ((end_time = 0) OR (end_time >= m_now ()));",
+       owned_clause);
+  g_free (owned_clause);
+  free (user_id);
+
+  g_free (session_overrides_user);
+  g_free (session_overrides_stamp);
+  session_overrides_user = g_strdup (current_credentials.uuid);
+  session_overrides_stamp = stamp;
+
+  return 0;
+}
+
+/**
+ * @brief Get the SQL to apply the session override set to a severity.
+ *
+ * The match conditions and ordering mirror the result_overrides view,
+ * with the permission check and end_time filter already compiled into
+ * the session table.
+ *
+ * @param[in]  severity_sql   SQL of the severity the overrides apply to.
+ * @param[in]  results_table  Results table.
+ *
+ * @return Newly allocated SQL clause.
+ */
+static gchar *
+session_overrides_severity_sql (const gchar *severity_sql,
+                                const char *results_table)
+{
+  return g_strdup_printf
+          ("coalesce ((SELECT new_severity FROM session_overrides"
+           "           WHERE session_overrides.result_nvt"
+           "                 = %s.result_nvt"
+           "           AND (session_overrides.result = 0"
+           "                OR session_overrides.result = %s.id)"
+           "           AND (session_overrides.task = 0"
+           "                OR session_overrides.task"
+           "                   = (SELECT reports.task FROM reports"
+           "                      WHERE reports.id = %s.report))"
+           "           AND (session_overrides.hosts is NULL"
+           "                OR session_overrides.hosts = ''"
+           "                OR hosts_contains (session_overrides.hosts,"
+           "                                   %s.host))"
+           "           AND (session_overrides.port is NULL"
+           "                OR session_overrides.port = ''"
+           "                OR session_overrides.port = %s.port)"
+           "           AND severity_matches_ov (%s,"
+           "                                    session_overrides.severity)"
+           "           ORDER BY ord LIMIT 1),"
+           "          %s)",
+           results_table, results_table, results_table, results_table,
+           results_table, severity_sql, severity_sql);
+}
+
 /**
  * @brief Get new severity clause.
  *
@@ -23324,6 +25368,17 @@ new_severity_clause (int apply_overrides, int dynamic_severity)
 {
   if (apply_overrides)
     {
+      if (session_overrides_refresh () == 0)
+        {
+          /* Overrides from the compiled session set. */
+          if (dynamic_severity)
+            return session_overrides_severity_sql
+                    ("current_severity (results.severity, results.nvt)",
+                     "results");
+          return session_overrides_severity_sql ("results.severity",
+                                                 "results");
+        }
+
       if (dynamic_severity)
         /* Overrides, dynamic. */
         return g_strdup_printf ("(SELECT new_severity FROM result_new_severities_dynamic"
@@ -23694,6 +25749,30 @@ init_result_get_iterator_severity (iterator_t* iterator, const get_data_t *get,
   return ret;
 }
 
+/**
+ * @brief Initialise a result severity count iterator.
+ *
+ * The iterator returns (severity, count) rows, aggregated in the database,
+ * instead of one severity per result.
+ *
+ * @param[in]  iterator    Iterator.
+ * @param[in]  get         GET data.
+ * @param[in]  report      Report to restrict returned results to.
+ * @param[in]  host        Host to limit results to.
+ *
+ * @return 0 success, 1 failed to find result, 2 failed to find filter (filt_id),
+ *         -1 error.
+ */
+static int
+init_result_get_iterator_severity_counts (iterator_t* iterator,
+                                          const get_data_t *get,
+                                          report_t report, const char* host)
+{
+  group_by_for_count = 1;
+  return init_result_get_iterator_severity (iterator, get, report, host,
+                                            NULL);
+}
+
 /**
  * @brief SQL for getting current severity.
  */
@@ -23715,11 +25794,42 @@ init_result_get_iterator_severity (iterator_t* iterator, const get_data_t *get,
  * @return SQL clause for FROM.
  */
 static gchar *
-result_iterator_lateral (int apply_overrides, 
-                         int dynamic_severity, 
-                         const char *results_table, 
+result_iterator_lateral (int apply_overrides,
+                         int dynamic_severity,
+                         const char *results_table,
                          const char *nvts_table)
 {
+  if (apply_overrides && session_overrides_refresh () == 0)
+    {
+      /* Overrides from the compiled session set. */
+      gchar *clause, *ret;
+
+      if (dynamic_severity)
+        {
+          clause = session_overrides_severity_sql
+                    ("(SELECT curr_severity FROM curr LIMIT 1)",
+                     results_table);
+          ret = g_strdup_printf
+                 (" (WITH curr AS (SELECT " CURRENT_SEVERITY_SQL
+                  " AS curr_severity)"
+                  " SELECT %s AS new_severity)",
+                  results_table, nvts_table, results_table, results_table,
+                  clause);
+        }
+      else
+        {
+          gchar *severity_sql;
+
+          severity_sql = g_strdup_printf ("%s.severity", results_table);
+          clause = session_overrides_severity_sql (severity_sql,
+                                                   results_table);
+          g_free (severity_sql);
+          ret = g_strdup_printf ("(SELECT %s AS new_severity)", clause);
+        }
+      g_free (clause);
+      return ret;
+    }
+
   if (apply_overrides && dynamic_severity)
     /* Overrides, dynamic. */
     return g_strdup_printf(
@@ -24520,6 +26630,20 @@ result_iterator_max_epss_severity (iterator_t* iterator)
   return iterator_double (iterator, GET_ITERATOR_COLUMN_COUNT + 43);
 }
 
+/**
+ * @brief Get whether user tags may exist from a result iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return 1 if user tags may exist, else 0.
+ */
+int
+result_iterator_may_have_tags (iterator_t* iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int (iterator, GET_ITERATOR_COLUMN_COUNT + 44);
+}
+
 /**
  * @brief Get CERT-BUNDs from a result iterator.
  *
@@ -24531,7 +26655,7 @@ gchar **
 result_iterator_cert_bunds (iterator_t* iterator)
 {
   if (iterator->done) return 0;
-  return iterator_array (iterator, GET_ITERATOR_COLUMN_COUNT + 44);
+  return iterator_array (iterator, GET_ITERATOR_COLUMN_COUNT + 45);
 }
 
 /**
@@ -24545,7 +26669,7 @@ gchar **
 result_iterator_dfn_certs (iterator_t* iterator)
 {
   if (iterator->done) return 0;
-  return iterator_array (iterator, GET_ITERATOR_COLUMN_COUNT + 45);
+  return iterator_array (iterator, GET_ITERATOR_COLUMN_COUNT + 46);
 }
 
 /**
@@ -25132,7 +27256,7 @@ init_report_host_iterator (iterator_t* iterator, report_t report, const char *ho
                        "              LIMIT 1))"
                        " FROM report_hosts WHERE report = %llu"
                        "%s%s%s"
-                       " ORDER BY order_inet (host);",
+                       " ORDER BY order_inet (host), id;",
                        report,
                        host ? " AND host = '" : "",
                        host ? host : "",
@@ -25415,6 +27539,63 @@ init_report_host_details_iterator (iterator_t* iterator,
                  report_host);
 }
 
+/**
+ * @brief Initialise an iterator over the host details of an entire report.
+ *
+ * The rows are ordered to match init_report_host_iterator when that is
+ * iterating over all hosts of the report, so that the two iterators can
+ * be merged in a single pass.
+ *
+ * @param[in]  iterator  Iterator.
+ * @param[in]  report    Report whose host details the iterator loops over.
+ */
+static void
+init_report_details_iterator (iterator_t* iterator, report_t report)
+{
+  /* The 'detected_at' and 'detected_by' entries are filtered out of the final
+   * reports as they are only used internally for product detection. */
+  init_iterator (iterator,
+                 "SELECT report_host_details.report_host, name, value,"
+                 "       source_type, source_name, source_description, NULL,"
+                 "       order_inet (report_hosts.host) AS host_ord,"
+                 "       report_hosts.id AS rh_id"
+                 " FROM report_host_details, report_hosts"
+                 " WHERE report_host_details.report_host = report_hosts.id"
+                 " AND report_hosts.report = %llu"
+                 " AND NOT name IN ('detected_at', 'detected_by')"
+                 " AND NOT name LIKE 'detected_by@%%'"
+                 " UNION SELECT report_host_details.report_host, 'Closed CVE',"
+                 "              cve, 'openvasmd', oid, nvts.name, cvss_base,"
+                 "              order_inet (report_hosts.host),"
+                 "              report_hosts.id"
+                 "       FROM nvts, report_host_details, report_hosts"
+                 "       WHERE cve != ''"
+                 "       AND family IN (" LSC_FAMILY_LIST ")"
+                 "       AND nvts.oid = report_host_details.source_name"
+                 "       AND report_host_details.report_host"
+                 "           = report_hosts.id"
+                 "       AND report_hosts.report = %llu"
+                 "       AND report_host_details.name = 'EXIT_CODE'"
+                 "       AND report_host_details.value = 'EXIT_NOTVULN'"
+                 " ORDER BY host_ord, rh_id;",
+                 report,
+                 report);
+}
+
+/**
+ * @brief Get the report host from a whole-report details iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return The report host of the report host detail.
+ */
+static report_host_t
+report_host_details_iterator_report_host (iterator_t* iterator)
+{
+  if (iterator->done) return 0;
+  return iterator_int64 (iterator, 0);
+}
+
 /**
  * @brief Get the name from a report host details iterator.
  *
@@ -25885,19 +28066,13 @@ report_severity_data (report_t report, const char *host,
 
       get_all = report_results_get_data (1, -1, apply_overrides, 0);
       ignore_max_rows_per_page = 1;
-      init_result_get_iterator_severity (&results, get_all, report, host, NULL);
+      init_result_get_iterator_severity_counts (&results, get_all, report,
+                                                host);
       ignore_max_rows_per_page = 0;
       while (next (&results))
-        {
-          double severity;
-
-          if (results.done)
-            severity = 0.0;
-          else
-            severity = iterator_double (&results, 0);
-
-          severity_data_add (severity_data, severity);
-        }
+        severity_data_add_count (severity_data,
+                                 iterator_double (&results, 0),
+                                 iterator_int (&results, 1));
       cleanup_iterator (&results);
       get_data_reset (get_all);
       free (get_all);
@@ -25914,22 +28089,157 @@ report_severity_data (report_t report, const char *host,
       get_filtered.ignore_pagination = 1;
 
       ignore_max_rows_per_page = 1;
-      init_result_get_iterator_severity (&results, &get_filtered, report, host,
-                                         NULL);
+      init_result_get_iterator_severity_counts (&results, &get_filtered,
+                                                report, host);
       ignore_max_rows_per_page = 0;
       while (next (&results))
-        {
-          double severity;
+        severity_data_add_count (filtered_severity_data,
+                                 iterator_double (&results, 0),
+                                 iterator_int (&results, 1));
+      cleanup_iterator (&results);
+    }
+}
 
-          if (results.done)
-            severity = 0.0;
-          else
-            severity = iterator_double (&results, 0);
+/**
+ * @brief Prefetched message counts of a report.
+ */
+typedef struct
+{
+  int holes;            ///< Number of hole results.
+  int infos;            ///< Number of info results.
+  int logs;             ///< Number of log results.
+  int warnings;         ///< Number of warning results.
+  int false_positives;  ///< Number of false positive results.
+  double severity;      ///< Maximum severity.
+} report_counts_entry_t;
 
-          severity_data_add (filtered_severity_data, severity);
+/**
+ * @brief Prefetched cached report counts, keyed by report UUID.
+ */
+static GHashTable *report_counts_prefetched = NULL;
+
+/**
+ * @brief The override flag the prefetched counts were loaded with.
+ */
+static int report_counts_prefetch_override = 0;
+
+/**
+ * @brief The minimum QoD the prefetched counts were loaded with.
+ */
+static int report_counts_prefetch_min_qod = 0;
+
+/**
+ * @brief Add the counts of a report to the prefetched counts.
+ *
+ * @param[in]  uuid  UUID of the report.
+ * @param[in]  data  Severity data accumulated from the count cache.
+ */
+static void
+report_counts_prefetch_add (const char *uuid, severity_data_t *data)
+{
+  report_counts_entry_t *entry;
+
+  entry = g_malloc0 (sizeof (*entry));
+  severity_data_level_counts (data, NULL, &entry->false_positives,
+                              &entry->logs, &entry->infos, &entry->warnings,
+                              &entry->holes);
+  entry->severity = data->max;
+  g_hash_table_insert (report_counts_prefetched, g_strdup (uuid), entry);
+}
+
+/**
+ * @brief Prefetch the cached counts of the noteworthy reports of all tasks.
+ *
+ * Loads the cached counts of the first, last and second last finished
+ * report of every task in a single query against the count cache, so that
+ * the per task report_counts calls of a GET_TASKS listing are served from
+ * memory instead of querying the cache report by report.  Reports without
+ * a valid cache entry are simply absent from the prefetch and fall back
+ * to the usual path, which also refreshes the cache for the next listing.
+ *
+ * @param[in]  override  Whether overrides are applied to the results.
+ * @param[in]  min_qod   Minimum QoD of results to count.
+ */
+void
+report_counts_prefetch (int override, int min_qod)
+{
+  iterator_t rows;
+  severity_data_t severity_data;
+  gchar *current_uuid;
+
+  if (current_credentials.uuid == NULL)
+    return;
+
+  if (report_counts_prefetched)
+    g_hash_table_remove_all (report_counts_prefetched);
+  else
+    report_counts_prefetched = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                      g_free, g_free);
+
+  report_counts_prefetch_override = override;
+  report_counts_prefetch_min_qod = min_qod;
+
+  init_iterator (&rows,
+                 "SELECT reports.uuid, report_counts.severity,"
+                 "       report_counts.count"
+                 " FROM report_counts, reports"
+                 " WHERE report_counts.report = reports.id"
+                 " AND report_counts.\"user\" = (SELECT id FROM users"
+                 "                               WHERE users.uuid = '%s')"
+                 " AND report_counts.override = %i"
+                 " AND report_counts.min_qod = %i"
+                 " AND (report_counts.end_time = 0"
+                 "      OR report_counts.end_time >= m_now ())"
+                 " AND reports.id"
+                 "     IN (SELECT task_last_report (id) FROM tasks"
+                 "         WHERE hidden = 0"
+                 "         UNION"
+                 "         SELECT task_second_last_report (id) FROM tasks"
+                 "         WHERE hidden = 0"
+                 "         UNION"
+                 "         SELECT (SELECT id FROM reports"
+                 "                 WHERE task = tasks.id"
+                 "                 AND scan_run_status = %u"
+                 "                 ORDER BY creation_time ASC LIMIT 1)"
+                 "         FROM tasks WHERE hidden = 0)"
+                 " AND user_has_access_uuid (CAST ('report' AS text),"
+                 "                           CAST (reports.uuid AS text),"
+                 "                           CAST ('get_reports' AS text),"
+                 "                           0)"
+                 " ORDER BY reports.uuid;",
+                 current_credentials.uuid,
+                 override,
+                 min_qod,
+                 TASK_STATUS_DONE);
+
+  init_severity_data (&severity_data);
+  current_uuid = NULL;
+  while (next (&rows))
+    {
+      const char *uuid;
+
+      uuid = iterator_string (&rows, 0);
+      if (current_uuid && strcmp (uuid, current_uuid))
+        {
+          report_counts_prefetch_add (current_uuid, &severity_data);
+          cleanup_severity_data (&severity_data);
+          init_severity_data (&severity_data);
+          g_free (current_uuid);
+          current_uuid = NULL;
         }
-      cleanup_iterator (&results);
+      if (current_uuid == NULL)
+        current_uuid = g_strdup (uuid);
+      severity_data_add_count (&severity_data,
+                               iterator_double (&rows, 1),
+                               iterator_int (&rows, 2));
+    }
+  if (current_uuid)
+    {
+      report_counts_prefetch_add (current_uuid, &severity_data);
+      g_free (current_uuid);
     }
+  cleanup_severity_data (&severity_data);
+  cleanup_iterator (&rows);
 }
 
 /**
@@ -25959,6 +28269,32 @@ report_counts (const char* report_id, int* holes, int* infos,
   report_t report;
   int ret;
   get_data_t *get;
+
+  if (report_counts_prefetched
+      && override == report_counts_prefetch_override
+      && min_qod == report_counts_prefetch_min_qod)
+    {
+      report_counts_entry_t *entry;
+
+      entry = g_hash_table_lookup (report_counts_prefetched, report_id);
+      if (entry)
+        {
+          if (holes)
+            *holes = entry->holes;
+          if (infos)
+            *infos = entry->infos;
+          if (logs)
+            *logs = entry->logs;
+          if (warnings)
+            *warnings = entry->warnings;
+          if (false_positives)
+            *false_positives = entry->false_positives;
+          if (severity)
+            *severity = entry->severity;
+          return 0;
+        }
+    }
+
   // TODO Wrap in transaction.
   if (find_report_with_permission (report_id, &report, "get_reports"))
     return -1;
@@ -26132,6 +28468,188 @@ cache_report_counts (report_t report, int override, int min_qod,
   return 0;
 }
 
+/**
+ * @brief Check whether the filtered counts of a report are cached.
+ *
+ * The term keyed cache complements the report_counts cache, covering the
+ * filter terms that report_counts cannot cache, like the filters of alert
+ * conditions.  Entries are only added for finished reports, whose results
+ * no longer change.
+ *
+ * @param[in]  report  Report.
+ * @param[in]  term    Filter term.
+ *
+ * @return 1 if cached, else 0.
+ */
+static int
+report_filter_counts_cache_exists (report_t report, const char *term)
+{
+  gchar *quoted_term;
+  int ret;
+
+  quoted_term = sql_quote (term);
+  ret = sql_int ("SELECT EXISTS (SELECT * FROM report_filter_counts"
+                 " WHERE report = %llu"
+                 "   AND \"user\" = (SELECT id FROM users"
+                 "                   WHERE users.uuid = '%s')"
+                 "   AND term = '%s'"
+                 "   AND (end_time = 0 OR end_time >= m_now ()));",
+                 report, current_credentials.uuid, quoted_term);
+  g_free (quoted_term);
+  return ret;
+}
+
+/**
+ * @brief Get cached filtered counts for a report and the current user.
+ *
+ * @param[in]   report  The report to get counts from.
+ * @param[in]   term    Filter term.
+ * @param[out]  data    The severity_data_t to save counts in.
+ */
+static void
+report_filter_counts_from_cache (report_t report, const char *term,
+                                 severity_data_t* data)
+{
+  iterator_t iterator;
+  gchar *quoted_term;
+
+  quoted_term = sql_quote (term);
+  init_iterator (&iterator,
+                 "SELECT severity, count FROM report_filter_counts"
+                 " WHERE report = %llu"
+                 "   AND \"user\" = (SELECT id FROM users"
+                 "                   WHERE users.uuid = '%s')"
+                 "   AND term = '%s'"
+                 "   AND (end_time = 0 OR end_time >= m_now ());",
+                 report, current_credentials.uuid, quoted_term);
+  g_free (quoted_term);
+  while (next (&iterator))
+    {
+      severity_data_add_count (data,
+                               iterator_double (&iterator, 0),
+                               iterator_int (&iterator, 1));
+    }
+  cleanup_iterator (&iterator);
+}
+
+/**
+ * @brief Cache the filtered counts for a finished report.
+ *
+ * @param[in]   report    Report.
+ * @param[in]   term      Filter term.
+ * @param[in]   override  Whether the filter applies overrides.
+ * @param[in]   data      Severity data struct containing the counts.
+ *
+ * @return 0 if successful, 1 gave up, -1 error (see sql_giveup).
+ */
+static int
+cache_report_filter_counts (report_t report, const char *term, int override,
+                            severity_data_t* data)
+{
+  int i, ret;
+  double severity;
+  int end_time;
+  gchar *quoted_term;
+
+  if (sql_int ("SELECT scan_run_status = %u FROM reports WHERE id = %llu;",
+               TASK_STATUS_DONE, report) == 0)
+    /* Only cache finished reports, whose results no longer change. */
+    return 1;
+
+  quoted_term = sql_quote (term);
+
+  ret = sql_giveup ("DELETE FROM report_filter_counts"
+                    " WHERE report = %llu"
+                    "   AND term = '%s'"
+                    "   AND \"user\" = (SELECT id FROM users"
+                    "                   WHERE users.uuid = '%s');",
+                    report, quoted_term, current_credentials.uuid);
+  if (ret)
+    {
+      g_free (quoted_term);
+      return ret;
+    }
+
+  if (data->total == 0)
+    {
+      /* Create dummy entry for empty counts */
+      ret = sql_giveup ("INSERT INTO report_filter_counts"
+                        " (report, \"user\", term, override, severity,"
+                        "  count, end_time)"
+                        " VALUES (%llu,"
+                        "         (SELECT id FROM users"
+                        "          WHERE users.uuid = '%s'),"
+                        "         '%s', %d, " G_STRINGIFY (SEVERITY_MISSING) ","
+                        "         0, 0);",
+                        report, current_credentials.uuid, quoted_term,
+                        override);
+      if (ret)
+        {
+          g_free (quoted_term);
+          return ret;
+        }
+    }
+  else
+    {
+      GString *insert;
+      int first;
+
+      i = 0;
+      if (override)
+        end_time = sql_int ("SELECT coalesce(min(end_time), 0)"
+                            " FROM overrides, results"
+                            " WHERE overrides.nvt = results.nvt"
+                            " AND results.report = %llu"
+                            " AND overrides.end_time >= m_now ();",
+                            report);
+      else
+        end_time = 0;
+
+      severity = severity_data_value (i);
+      insert = g_string_new ("INSERT INTO report_filter_counts"
+                             " (report, \"user\", term, override,"
+                             "  severity, count, end_time)"
+                             " VALUES");
+      first = 1;
+      while (severity <= (data->max + (1.0
+                                       / SEVERITY_SUBDIVISIONS
+                                       / SEVERITY_SUBDIVISIONS))
+             && severity != SEVERITY_MISSING)
+        {
+          if (data->counts[i] > 0)
+            {
+              g_string_append_printf (insert,
+                                      "%s (%llu,"
+                                      "    (SELECT id FROM users"
+                                      "     WHERE users.uuid = '%s'),"
+                                      "    '%s', %d, %1.1f, %d, %d)",
+                                      first == 1 ? "" : ",",
+                                      report, current_credentials.uuid,
+                                      quoted_term, override, severity,
+                                      data->counts[i], end_time);
+              first = 0;
+            }
+          i++;
+          severity = severity_data_value (i);
+        }
+
+      if (first == 0)
+        {
+          g_string_append_printf (insert, ";");
+          ret = sql_giveup ("%s", insert->str);
+          if (ret)
+            {
+              g_string_free (insert, TRUE);
+              g_free (quoted_term);
+              return ret;
+            }
+        }
+      g_string_free (insert, TRUE);
+    }
+  g_free (quoted_term);
+  return 0;
+}
+
 /**
  * @brief Get the message counts for a report.
  *
@@ -26168,6 +28686,7 @@ report_counts_id_full (report_t report, int* holes, int* infos,
   keyword_t **point;
   array_t *split;
   int filter_cacheable, unfiltered_requested, filtered_requested, cache_exists;
+  int filter_cache_exists;
   int override, min_qod_int;
   severity_data_t severity_data, filtered_severity_data;
 
@@ -26245,6 +28764,10 @@ report_counts_id_full (report_t report, int* holes, int* infos,
 
   cache_exists = filter_cacheable
                  && report_counts_cache_exists (report, override, min_qod_int);
+  filter_cache_exists = (filter_cacheable == FALSE)
+                        && unfiltered_requested == 0
+                        && host == NULL
+                        && report_filter_counts_cache_exists (report, filter);
   init_severity_data (&severity_data);
   init_severity_data (&filtered_severity_data);
 
@@ -26258,6 +28781,13 @@ report_counts_id_full (report_t report, int* holes, int* infos,
         report_counts_from_cache (report, override, min_qod_int,
                                   &filtered_severity_data);
     }
+  else if (filter_cache_exists)
+    {
+      /* Get filtered counts from the term keyed cache. */
+      if (filtered_requested)
+        report_filter_counts_from_cache (report, filter,
+                                         &filtered_severity_data);
+    }
   else
     {
       /* Recalculate. */
@@ -26289,6 +28819,13 @@ report_counts_id_full (report_t report, int* holes, int* infos,
         cache_report_counts (report, override, min_qod_int,
                              &filtered_severity_data);
     }
+  else if (filter_cacheable == FALSE
+           && filter_cache_exists == 0
+           && unfiltered_requested == 0
+           && filtered_requested
+           && host == NULL)
+    cache_report_filter_counts (report, filter, override,
+                                &filtered_severity_data);
 
   cleanup_severity_data (&severity_data);
   cleanup_severity_data (&filtered_severity_data);
@@ -26579,6 +29116,7 @@ delete_report_internal (report_t report)
        "   AND resource = %llu;",
        report);
   sql ("DELETE FROM report_counts WHERE report = %llu;", report);
+  sql ("DELETE FROM report_filter_counts WHERE report = %llu;", report);
   sql ("DELETE FROM result_nvt_reports WHERE report = %llu;", report);
   sql ("DELETE FROM reports WHERE id = %llu;", report);
 
@@ -26721,9 +29259,14 @@ report_slave_progress (report_t report)
 int
 set_report_slave_progress (report_t report, int progress)
 {
-  sql ("UPDATE reports SET slave_progress = %i WHERE id = %llu;",
+  /* Skip no-op writes, because this is called on every progress poll and
+   * each write creates a dead reports row for vacuum. */
+  sql ("UPDATE reports SET slave_progress = %i"
+       " WHERE id = %llu"
+       " AND slave_progress IS DISTINCT FROM %i;",
        progress,
-       report);
+       report,
+       progress);
   return 0;
 }
 
@@ -28148,6 +30691,39 @@ print_report_host_details_xml (report_host_t report_host, FILE *stream,
   return 0;
 }
 
+/**
+ * @brief Print the XML for a report host's details from a prefetch iterator.
+ *
+ * Consumes from a whole-report details iterator the rows belonging to the
+ * given report host.  The iterator must have been set up with
+ * init_report_details_iterator and the report hosts must be visited in the
+ * iterator's order, as in a merge join.
+ *
+ * @param[in]      report_host   The report host.
+ * @param[in]      details       Whole-report details iterator.
+ * @param[in,out]  details_next  Whether the iterator is on an unconsumed row.
+ * @param[in]      stream        File stream to write to.
+ * @param[in]      lean          Whether to return reduced info.
+ *
+ * @return 0 on success, -1 error.
+ */
+static int
+print_report_host_details_prefetched (report_host_t report_host,
+                                      iterator_t *details,
+                                      gboolean *details_next,
+                                      FILE *stream, int lean)
+{
+  while (*details_next
+         && report_host_details_iterator_report_host (details) == report_host)
+    {
+      if (print_report_host_detail (stream, details, lean))
+        return -1;
+      *details_next = next (details);
+    }
+
+  return 0;
+}
+
 /**
  * @brief Print the XML for a report host's TLS certificates to a file stream.
  * @param[in]  report_host  The report host to get certificates from.
@@ -28165,6 +30741,7 @@ print_report_host_tls_certificates_xml (report_host_t report_host,
   iterator_t tls_certs;
   time_t activation_time, expiration_time;
   gchar *md5_fingerprint, *sha256_fingerprint, *subject, *issuer, *serial;
+  gchar *certificate_format_str;
   gnutls_x509_crt_fmt_t certificate_format;
 
   if (report_host == 0
@@ -28186,9 +30763,9 @@ print_report_host_tls_certificates_xml (report_host_t report_host,
       unsigned char *certificate;
       const char *scanner_fpr_prefixed, *scanner_fpr;
       gchar *quoted_scanner_fpr;
-      char *ssldetails;       
-      iterator_t ports;
-      gboolean valid;
+      char *ssldetails;
+      iterator_t cert_info, ports;
+      gboolean found, valid;
       time_t now;
 
       certificate_prefixed = iterator_string (&tls_certs, 0);
@@ -28208,44 +30785,82 @@ print_report_host_tls_certificates_xml (report_host_t report_host,
       subject = NULL;
       issuer = NULL;
       serial = NULL;
-      certificate_format = 0;
+      certificate_format_str = NULL;
+
+      /* The certificate was parsed when the report was imported and the
+       * metadata stored in tls_certificates, so read the columns instead of
+       * parsing the DER again for every report. */
+
+      init_iterator (&cert_info,
+                     "SELECT activation_time, expiration_time,"
+                     "       md5_fingerprint, sha256_fingerprint, subject_dn,"
+                     "       issuer_dn, serial, certificate_format"
+                     " FROM tls_certificates"
+                     " WHERE sha256_fingerprint = '%s'"
+                     " LIMIT 1;",
+                     quoted_scanner_fpr);
+      found = next (&cert_info);
+      if (found)
+        {
+          activation_time = iterator_int64 (&cert_info, 0);
+          expiration_time = iterator_int64 (&cert_info, 1);
+          md5_fingerprint = g_strdup (iterator_string (&cert_info, 2) ?: "");
+          sha256_fingerprint
+            = g_strdup (iterator_string (&cert_info, 3) ?: "");
+          subject = g_strdup (iterator_string (&cert_info, 4) ?: "");
+          issuer = g_strdup (iterator_string (&cert_info, 5) ?: "");
+          serial = g_strdup (iterator_string (&cert_info, 6) ?: "");
+          certificate_format_str
+            = g_strdup (iterator_string (&cert_info, 7) ?: "unknown");
+        }
+      cleanup_iterator (&cert_info);
 
-      get_certificate_info ((gchar*)certificate,
-                            certificate_size,
-                            TRUE,
-                            &activation_time,
-                            &expiration_time,
-                            &md5_fingerprint,
-                            &sha256_fingerprint,
-                            &subject,
-                            &issuer,
-                            &serial,
-                            &certificate_format);
-
-      if (sha256_fingerprint == NULL)
-        sha256_fingerprint = g_strdup (scanner_fpr);
-
-      ssldetails
-        = sql_string ("SELECT rhd.value"
-                      " FROM report_host_details AS rhd"
-                      " WHERE report_host = %llu"
-                      "   AND name = 'SSLDetails:%s'"
-                      " LIMIT 1;",
-                      report_host,
-                      quoted_scanner_fpr);
-
-      if (ssldetails)
-        parse_ssldetails (ssldetails,
-                          &activation_time,
-                          &expiration_time,
-                          &issuer,
-                          &serial);
-      else
-        g_warning ("%s: No SSLDetails found for fingerprint %s",
-                   __func__,
-                   scanner_fpr);
+      if (found == FALSE)
+        {
+          /* Certificate imported before the metadata columns existed. */
+
+          certificate_format = 0;
+
+          get_certificate_info ((gchar*)certificate,
+                                certificate_size,
+                                TRUE,
+                                &activation_time,
+                                &expiration_time,
+                                &md5_fingerprint,
+                                &sha256_fingerprint,
+                                &subject,
+                                &issuer,
+                                &serial,
+                                &certificate_format);
+
+          if (sha256_fingerprint == NULL)
+            sha256_fingerprint = g_strdup (scanner_fpr);
+
+          certificate_format_str
+            = g_strdup (tls_certificate_format_str (certificate_format));
+
+          ssldetails
+            = sql_string ("SELECT rhd.value"
+                          " FROM report_host_details AS rhd"
+                          " WHERE report_host = %llu"
+                          "   AND name = 'SSLDetails:%s'"
+                          " LIMIT 1;",
+                          report_host,
+                          quoted_scanner_fpr);
+
+          if (ssldetails)
+            parse_ssldetails (ssldetails,
+                              &activation_time,
+                              &expiration_time,
+                              &issuer,
+                              &serial);
+          else
+            g_warning ("%s: No SSLDetails found for fingerprint %s",
+                       __func__,
+                       scanner_fpr);
 
-      free (ssldetails);
+          free (ssldetails);
+        }
 
       now = time (NULL);
 
@@ -28277,7 +30892,7 @@ print_report_host_tls_certificates_xml (report_host_t report_host,
         "<serial>%s</serial>"
         "<host><ip>%s</ip><hostname>%s</hostname></host>",
         scanner_fpr,
-        tls_certificate_format_str (certificate_format),
+        certificate_format_str,
         certificate_b64,
         sha256_fingerprint,
         md5_fingerprint,
@@ -28297,6 +30912,7 @@ print_report_host_tls_certificates_xml (report_host_t report_host,
       g_free (subject);
       g_free (issuer);
       g_free (serial);
+      g_free (certificate_format_str);
 
       free (hostname);
     
@@ -28716,6 +31332,9 @@ host_summary_append (GString *host_summary_buffer, const char *host,
  * @param[in]  f_host_notcompliant      Hashtable for host non compliant results.
  * @param[in]  f_host_incomplete        Hashtable for host incomplete resuls.
  * @param[in]  f_host_undefined         Hashtable for host undefined results.
+ * @param[in]      details       Whole-report details iterator, or NULL to
+ *                               query the details of each host separately.
+ * @param[in,out]  details_next  Whether details is on an unconsumed row.
  *
  * @return 0 on success, -1 error.
  */
@@ -28735,7 +31354,9 @@ print_report_host_xml (FILE *stream,
                        GHashTable *f_host_compliant,
                        GHashTable *f_host_notcompliant,
                        GHashTable *f_host_incomplete,
-                       GHashTable *f_host_undefined)
+                       GHashTable *f_host_undefined,
+                       iterator_t *details,
+                       gboolean *details_next)
 {
   const char *current_host;
   int ports_count;
@@ -28856,8 +31477,15 @@ print_report_host_xml (FILE *stream,
             false_positives_count);
     }
 
-  if (print_report_host_details_xml
-        (host_iterator_report_host (hosts), stream, lean))
+  if (details)
+    {
+      if (print_report_host_details_prefetched
+            (host_iterator_report_host (hosts), details, details_next,
+             stream, lean))
+        return -1;
+    }
+  else if (print_report_host_details_xml
+             (host_iterator_report_host (hosts), stream, lean))
     {
       return -1;
     }
@@ -29071,14 +31699,24 @@ init_v2_delta_iterator (report_t report, iterator_t *results, report_t delta,
   extra_with = g_strdup_printf(" comparison AS ("
     " WITH r1a as (SELECT results.id, description, host, report, port,"
     "              severity, nvt, results.qod, results.uuid, hostname," 
-    "              path, r1_lateral.new_severity as new_severity "
+    "              path, r1_lateral.new_severity as new_severity,"
+    "              coalesce (results.delta_hash,"
+    "                        result_delta_hash (results.host, results.port,"
+    "                                           results.nvt,"
+    "                                           results.description))"
+    "                AS comparison_hash "
     "       FROM results "
     "       LEFT JOIN (SELECT cvss_base, oid AS nvts_oid FROM nvts)"
     "       AS nvts_cols"
     "       ON nvts_cols.nvts_oid = results.nvt"
     "       %s, LATERAL %s AS r1_lateral" 
     "       WHERE report = %llu),"
-    " r2a as (SELECT results.*, r2_lateral.new_severity AS new_severity" 
+    " r2a as (SELECT results.*, r2_lateral.new_severity AS new_severity,"
+    "              coalesce (results.delta_hash,"
+    "                        result_delta_hash (results.host, results.port,"
+    "                                           results.nvt,"
+    "                                           results.description))"
+    "                AS comparison_hash" 
     "        FROM results" 
     "        LEFT JOIN (SELECT cvss_base, oid AS nvts_oid FROM nvts)"
     "        AS nvts_cols" 
@@ -29086,22 +31724,18 @@ init_v2_delta_iterator (report_t report, iterator_t *results, report_t delta,
     "        %s, LATERAL %s AS r2_lateral" 
     "        WHERE report = %llu),"
     " r1 as (SELECT DISTINCT ON (r1a.id) r1a.*, r2a.id as r2id, row_number() over w1 as r1_rank"
-    "        FROM r1a LEFT JOIN r2a ON r1a.host = r2a.host"
-    "        AND normalize_port(r1a.port) = normalize_port(r2a.port)" 
-    "        AND r1a.nvt = r2a.nvt "
+    "        FROM r1a LEFT JOIN r2a"
+    "        ON r1a.comparison_hash = r2a.comparison_hash"
     "        AND (r1a.new_severity = 0) = (r2a.new_severity = 0)"
-    "        AND (r1a.description = r2a.description)"
-    "        WINDOW w1 AS (PARTITION BY r1a.host, normalize_port(r1a.port),"
-    "                      r1a.nvt, r1a.new_severity = 0, r2a.id is null ORDER BY r2a.id)"
+    "        WINDOW w1 AS (PARTITION BY r1a.comparison_hash,"
+    "                      r1a.new_severity = 0, r2a.id is null ORDER BY r2a.id)"
     "        ORDER BY r1a.id),"
     " r2 as (SELECT DISTINCT ON (r2a.id) r2a.*, r1a.id as r1id, row_number() over w2 as r2_rank"
-    "        FROM r2a LEFT JOIN r1a ON r2a.host = r1a.host"
-    "        AND normalize_port(r2a.port) = normalize_port(r1a.port)" 
-    "        AND r2a.nvt = r1a.nvt "
+    "        FROM r2a LEFT JOIN r1a"
+    "        ON r2a.comparison_hash = r1a.comparison_hash"
     "        AND (r2a.new_severity = 0) = (r1a.new_severity = 0)"
-    "        AND (r2a.description = r1a.description)"
-    "        WINDOW w2 AS (PARTITION BY r2a.host, normalize_port(r2a.port),"
-    "                      r2a.nvt, r2a.new_severity = 0, r1a.id is null ORDER BY r1a.id)"
+    "        WINDOW w2 AS (PARTITION BY r2a.comparison_hash,"
+    "                      r2a.new_severity = 0, r1a.id is null ORDER BY r1a.id)"
     "        ORDER BY r2a.id)"
     " (SELECT r1.id AS result1_id," 
     " r2.id AS result2_id," 
@@ -29133,9 +31767,7 @@ init_v2_delta_iterator (report_t report, iterator_t *results, report_t delta,
     " r2.nvt_version AS delta_nvt_version"
     " FROM r1"
     " FULL OUTER JOIN r2"
-    " ON r1.host = r2.host"
-    " AND normalize_port(r1.port) = normalize_port(r2.port)" 
-    " AND r1.nvt = r2.nvt "
+    " ON r1.comparison_hash = r2.comparison_hash"
     " AND (r1.new_severity = 0) = (r2.new_severity = 0)"
     " AND ((r1id IS NULL AND r2id IS NULL) OR"
     "      r2id = r2.id OR r1id = r1.id)"
@@ -30109,12 +32741,14 @@ print_v2_report_delta_xml (FILE *out, iterator_t *results,
 }
 
 /**
- * @brief Print the main XML content for a report to a file.
+ * @brief Print the main XML content for a report to a file or stream.
  *
  * @param[in]  report      The report.
  * @param[in]  delta       Report to compare with the report.
  * @param[in]  task        Task associated with report.
- * @param[in]  xml_start   File name.
+ * @param[in]  xml_start   File name.  NULL to print to xml_stream instead.
+ * @param[in]  xml_stream  Stream to print to when xml_start is NULL.  Closed
+ *                         by this function, even on failure.
  * @param[in]  get         GET command data.
  * @param[in]  notes_details      If notes, Whether to include details.
  * @param[in]  overrides_details  If overrides, Whether to include details.
@@ -30129,7 +32763,8 @@ print_v2_report_delta_xml (FILE *out, iterator_t *results,
  */
 static int
 print_report_xml_start (report_t report, report_t delta, task_t task,
-                        gchar* xml_start, const get_data_t *get,
+                        gchar* xml_start, FILE *xml_stream,
+                        const get_data_t *get,
                         int notes_details, int overrides_details,
                         int result_tags, int ignore_pagination, int lean,
                         gchar **filter_term_return, gchar **zone_return,
@@ -30214,15 +32849,22 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
       return -1;
     }
 
-  out = fopen (xml_start, "w");
-
-  if (out == NULL)
+  if (xml_start)
     {
-      g_warning ("%s: fopen failed: %s",
-                 __func__,
-                 strerror (errno));
-      return -1;
+      out = fopen (xml_start, "w");
+
+      if (out == NULL)
+        {
+          g_warning ("%s: fopen failed: %s",
+                     __func__,
+                     strerror (errno));
+          return -1;
+        }
     }
+  else
+    /* Streaming mode.  The stream is closed here as usual, which flushes
+     * the remaining output to the client. */
+    out = xml_stream;
 
   assert (get);
 
@@ -31316,7 +33958,9 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
                                           f_host_compliant,
                                           f_host_notcompliant,
                                           f_host_incomplete,
-                                          f_host_undefined))
+                                          f_host_undefined,
+                                          NULL,
+                                          NULL))
 
                 {
                     goto failed_print_report_host;
@@ -31327,8 +33971,14 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
     }
   else if (get->details)
     {
-      iterator_t hosts;
+      iterator_t hosts, details;
+      gboolean details_next;
+
+      /* Fetch the details of all hosts with a single query, ordered like
+       * the host iterator, instead of querying them host by host. */
       init_report_host_iterator (&hosts, report, NULL, 0);
+      init_report_details_iterator (&details, report);
+      details_next = next (&details);
       while (next (&hosts))
         {
           if (print_report_host_xml (out,
@@ -31346,9 +33996,15 @@ print_report_xml_start (report_t report, report_t delta, task_t task,
                                     f_host_compliant,
                                     f_host_notcompliant,
                                     f_host_incomplete,
-                                    f_host_undefined))
-            goto failed_print_report_host;
+                                    f_host_undefined,
+                                    &details,
+                                    &details_next))
+            {
+              cleanup_iterator (&details);
+              goto failed_print_report_host;
+            }
         }
+      cleanup_iterator (&details);
       cleanup_iterator (&hosts);
     }
   if (strcmp (tsk_usage_type, "audit") == 0)
@@ -31553,8 +34209,8 @@ manage_report (report_t report, report_t delta_report, const get_data_t *get,
     }
 
   xml_start = g_strdup_printf ("%s/report-start.xml", xml_dir);
-  ret = print_report_xml_start (report, delta_report, task, xml_start, get,
-                                notes_details, overrides_details,
+  ret = print_report_xml_start (report, delta_report, task, xml_start, NULL,
+                                get, notes_details, overrides_details,
                                 1 /* result_tags */,
                                 0 /* ignore_pagination */,
                                 0 /* lean */,
@@ -31657,6 +34313,68 @@ manage_report (report_t report, report_t delta_report, const get_data_t *get,
   return output;
 }
 
+/**
+ * @brief Data for the stream that manage_send_report streams reports over.
+ */
+typedef struct
+{
+  gboolean (*send) (const char *,
+                    int (*) (const char *, void *),
+                    void *);                     ///< Function to write to client.
+  int (*send_data_1) (const char *, void *);    ///< Second argument to send.
+  void *send_data_2;                            ///< Third argument to send.
+  int error;                                    ///< Whether a send failed.
+} send_report_stream_data_t;
+
+/**
+ * @brief Write function of the stream manage_send_report streams over.
+ *
+ * @param[in]  cookie  Pointer to the send_report_stream_data_t.
+ * @param[in]  buf     Data to write.
+ * @param[in]  size    Size of data.
+ *
+ * @return Number of bytes written, -1 on error.
+ */
+static ssize_t
+send_report_stream_write (void *cookie, const char *buf, size_t size)
+{
+  send_report_stream_data_t *data;
+  gchar *chunk;
+
+  data = (send_report_stream_data_t *) cookie;
+  chunk = g_strndup (buf, size);
+  if (data->send (chunk, data->send_data_1, data->send_data_2))
+    {
+      g_free (chunk);
+      data->error = 1;
+      return -1;
+    }
+  g_free (chunk);
+  return size;
+}
+
+/**
+ * @brief Open a stream that sends everything written to it to the client.
+ *
+ * @param[in]  data  Stream data, filled in by caller.
+ *
+ * @return Stream on success, else NULL.
+ */
+static FILE *
+send_report_stream_open (send_report_stream_data_t *data)
+{
+  cookie_io_functions_t io_functions;
+  FILE *stream;
+
+  memset (&io_functions, 0, sizeof (io_functions));
+  io_functions.write = send_report_stream_write;
+
+  stream = fopencookie (data, "w", io_functions);
+  if (stream == NULL)
+    g_warning ("%s: fopencookie failed", __func__);
+  return stream;
+}
+
 /**
  * @brief Size of base64 chunk in manage_send_report.
  */
@@ -31765,6 +34483,89 @@ manage_send_report (report_t report, report_t delta_report,
       return -1;
     }
 
+  /* For plain XML output there is nothing to post-process, so stream the
+   * report XML to the client in chunks as it is generated, instead of
+   * spooling the entire report through files first.  This keeps the memory
+   * and disk use flat and gets the first byte out much earlier for big
+   * reports. */
+
+  if (base64 == 0)
+    {
+      gchar *format_uuid;
+      int stream_xml;
+
+      if (report_format > 0)
+        {
+          format_uuid = report_format_uuid (report_format);
+          stream_xml = format_uuid
+                       && (strcmp (format_uuid,
+                                   "a994b278-1f62-11e1-96ac-406186ea4fc5")
+                           == 0);
+          g_free (format_uuid);
+        }
+      else
+        /* No report format: raw XML. */
+        stream_xml = 1;
+
+      if (stream_xml)
+        {
+          FILE *stream;
+          send_report_stream_data_t stream_data;
+
+          /* Check the filter here, so that nothing has been sent to the
+           * client if the filter is missing. */
+          if (get->filt_id && strlen (get->filt_id)
+              && strcmp (get->filt_id, FILT_ID_NONE))
+            {
+              gchar *term;
+
+              term = filter_term (get->filt_id);
+              if (term == NULL)
+                return 2;
+              g_free (term);
+            }
+
+          stream_data.send = send;
+          stream_data.send_data_1 = send_data_1;
+          stream_data.send_data_2 = send_data_2;
+          stream_data.error = 0;
+
+          if (prefix && send (prefix, send_data_1, send_data_2))
+            {
+              g_warning ("%s: send prefix error", __func__);
+              return -1;
+            }
+
+          stream = send_report_stream_open (&stream_data);
+          if (stream == NULL)
+            return -1;
+
+          /* Closes the stream, flushing the rest to the client. */
+          ret = print_report_xml_start (report, delta_report, task, NULL,
+                                        stream, get, notes_details,
+                                        overrides_details, result_tags,
+                                        ignore_pagination, lean, NULL, NULL,
+                                        NULL);
+          if (ret || stream_data.error)
+            return -1;
+
+          stream = send_report_stream_open (&stream_data);
+          if (stream == NULL)
+            return -1;
+
+          if (print_report_xml_close (stream, report_format, report_config))
+            return -1;
+
+          if (fclose (stream) || stream_data.error)
+            {
+              g_warning ("%s: send error", __func__);
+              return -1;
+            }
+
+          return 0;
+        }
+    }
+
   if (mkdtemp (xml_dir) == NULL)
     {
       g_warning ("%s: mkdtemp failed", __func__);
@@ -31772,9 +34573,10 @@ manage_send_report (report_t report, report_t delta_report,
     }
 
   xml_start = g_strdup_printf ("%s/report-start.xml", xml_dir);
-  ret = print_report_xml_start (report, delta_report, task, xml_start, get,
-                                notes_details, overrides_details, result_tags,
-                                ignore_pagination, lean, NULL, NULL, NULL);
+  ret = print_report_xml_start (report, delta_report, task, xml_start, NULL,
+                                get, notes_details, overrides_details,
+                                result_tags, ignore_pagination, lean, NULL,
+                                NULL, NULL);
   if (ret)
     {
       g_free (xml_start);
@@ -32228,6 +35030,42 @@ check_host_detail_exists (report_t report, const char *host, const char *s_type,
   return return_value;
 }
 
+/**
+ * @brief Number of results to buffer before inserting in parse_osp_report.
+ */
+#define OSP_RESULTS_PER_INSERT 500
+
+/**
+ * @brief Insert buffered OSP results in a single statement.
+ *
+ * @param[in]      values         VALUES tuples for the results INSERT.
+ * @param[in,out]  results_array  Array to append the new result ids to.
+ */
+static void
+flush_osp_results (GString *values, GArray *results_array)
+{
+  iterator_t results;
+
+  if (values->len == 0)
+    return;
+
+  init_iterator (&results,
+                 "INSERT into results (" OSP_RESULT_COLUMNS ")"
+                 " VALUES %s"
+                 " RETURNING id;",
+                 values->str);
+  while (next (&results))
+    {
+      result_t result;
+
+      result = iterator_int64 (&results, 0);
+      g_array_append_val (results_array, result);
+    }
+  cleanup_iterator (&results);
+
+  g_string_truncate (values, 0);
+}
+
 /**
  * @brief Parse an OSP report.
  *
@@ -32245,6 +35083,8 @@ parse_osp_report (task_t task, report_t report, const char *report_xml)
   time_t start_time, end_time;
   gboolean has_results = FALSE;
   GArray *results_array;
+  GString *results_values;
+  int buffered_results = 0;
   GHashTable *hashed_osp_results;
   GHashTable *hashed_host_details;
 
@@ -32271,6 +35111,7 @@ parse_osp_report (task_t task, report_t report, const char *report_xml)
   sql_begin_immediate ();
   /* Set the report's start and end times. */
   results_array = g_array_new (TRUE, TRUE, sizeof (result_t));
+  results_values = g_string_new ("");
   start_time = 0;
   str = entity_attribute (entity, "start_time");
   if (str)
@@ -32301,7 +35142,6 @@ parse_osp_report (task_t task, report_t report, const char *report_xml)
   defs_file = task_definitions_file (task);
   while (results)
     {
-      result_t result;
       const char *type, *name, *severity, *host, *hostname, *test_id, *port;
       const char *qod, *path;
       char *desc = NULL, *nvt_id = NULL, *severity_str = NULL;
@@ -32392,18 +35232,32 @@ parse_osp_report (task_t task, report_t report, const char *report_xml)
           if (!check_osp_result_exists (report, task, r_entity, &hash_value,
                                         hashed_osp_results))
             {
-              result = make_osp_result (task,
-                                        host,
-                                        hostname,
-                                        nvt_id,
-                                        type,
-                                        desc,
-                                        port ?: "",
-                                        severity_str ?: severity,
-                                        qod_int,
-                                        path,
-                                        hash_value);
-              g_array_append_val (results_array, result);
+              gchar *values;
+
+              values = osp_result_values (task,
+                                          host,
+                                          hostname,
+                                          nvt_id,
+                                          type,
+                                          desc,
+                                          port ?: "",
+                                          severity_str ?: severity,
+                                          qod_int,
+                                          path,
+                                          hash_value);
+              if (values)
+                {
+                  if (results_values->len)
+                    g_string_append (results_values, ", ");
+                  g_string_append (results_values, values);
+                  g_free (values);
+                  buffered_results++;
+                  if (buffered_results == OSP_RESULTS_PER_INSERT)
+                    {
+                      flush_osp_results (results_values, results_array);
+                      buffered_results = 0;
+                    }
+                }
             }
           g_free (hash_value);
         }
@@ -32413,6 +35267,8 @@ parse_osp_report (task_t task, report_t report, const char *report_xml)
       results = next_entities (results);
     }
 
+  flush_osp_results (results_values, results_array);
+
   if (has_results)
     {
       sql ("UPDATE reports SET modification_time = m_now() WHERE id = %llu;",
@@ -32424,6 +35280,7 @@ parse_osp_report (task_t task, report_t report, const char *report_xml)
  end_parse_osp_report:
   sql_commit ();
   g_array_free (results_array, TRUE);
+  g_string_free (results_values, TRUE);
   g_hash_table_destroy (hashed_osp_results);
   g_hash_table_destroy (hashed_host_details);
   g_free (defs_file);
@@ -33105,6 +35962,10 @@ delete_task (task_t task, int ultimate)
            " WHERE report IN (SELECT id FROM reports WHERE task = %llu);",
            task);
 
+      sql ("DELETE FROM report_filter_counts"
+           " WHERE report IN (SELECT id FROM reports WHERE task = %llu);",
+           task);
+
       sql ("UPDATE tasks SET hidden = 2 WHERE id = %llu;", task);
     }
 
@@ -33116,7 +35977,9 @@ delete_task (task_t task, int ultimate)
 /**
  * @brief Delete all trash tasks.
  *
- * The caller must do the transaction.
+ * Each task is deleted in its own transaction, so emptying a large
+ * trashcan never blocks foreground writes for long.  On error the tasks
+ * deleted so far stay deleted.
  *
  * @return 0 on success, -1 on error.
  */
@@ -33124,17 +35987,34 @@ static int
 delete_trash_tasks ()
 {
   iterator_t tasks;
+  GArray *ids;
+  int index;
 
+  /* Collect the ids first, because the commits below would close a
+   * cursor that was still open on the tasks. */
+  ids = g_array_new (FALSE, FALSE, sizeof (task_t));
   init_user_task_iterator (&tasks, 1, 1);
   while (next (&tasks))
     {
       task_t task;
 
       task = get_iterator_resource (&tasks);
+      g_array_append_val (ids, task);
+    }
+  cleanup_iterator (&tasks);
+
+  for (index = 0; index < ids->len; index++)
+    {
+      task_t task;
+
+      task = g_array_index (ids, task_t, index);
+
+      sql_begin_immediate ();
 
       if (delete_reports (task))
         {
-          cleanup_iterator (&tasks);
+          sql_rollback ();
+          g_array_free (ids, TRUE);
           return -1;
         }
 
@@ -33145,8 +36025,13 @@ delete_trash_tasks ()
       sql ("DELETE FROM task_files WHERE task = %llu;", task);
       sql ("DELETE FROM task_preferences WHERE task = %llu;", task);
       sql ("DELETE FROM tasks WHERE id = %llu;", task);
+
+      sql_commit ();
+
+      g_info ("Emptying trashcan: %d of %d trash tasks deleted",
+              index + 1, ids->len);
     }
-  cleanup_iterator (&tasks);
+  g_array_free (ids, TRUE);
 
   return 0;
 }
@@ -36018,6 +38903,10 @@ target_port_list (target_t target)
  *
  * @param[in]  target  Target.
  *
+ * The expansion is cached per port list, because large port lists expand
+ * to strings of several megabytes and every task start resolves the same
+ * list again.  The range modifiers clear the cache row.
+ *
  * @return Newly allocated port range if available, else NULL.
  */
 char*
@@ -36025,8 +38914,19 @@ target_port_range (target_t target)
 {
   GString *range;
   iterator_t ranges;
+  port_list_t port_list;
+  char *cached;
+
+  port_list = target_port_list (target);
+
+  cached = sql_string ("SELECT ranges FROM port_list_range_cache"
+                       " WHERE port_list = %llu;",
+                       port_list);
+  if (cached)
+    return cached;
+
   range = g_string_new ("");
-  init_port_range_iterator (&ranges, target_port_list (target), 0, 1,
+  init_port_range_iterator (&ranges, port_list, 0, 1,
                             "type, CAST (start AS INTEGER)");
   if (next (&ranges))
     {
@@ -36067,6 +38967,15 @@ target_port_range (target_t target)
         }
     }
   cleanup_iterator (&ranges);
+
+  /* The string contains only digits, commas, dashes and the protocol
+   * prefixes, so it does not need quoting.  DO NOTHING covers a concurrent
+   * task start that cached the same list first. */
+  sql ("INSERT INTO port_list_range_cache (port_list, ranges)"
+       " VALUES (%llu, '%s')"
+       " ON CONFLICT (port_list) DO NOTHING;",
+       port_list, range->str);
+
   return g_string_free (range, FALSE);
 }
 
@@ -36991,6 +39900,62 @@ check_db_encryption_key ()
   return 0;
 }
 
+/**
+ * @brief Process-wide encryption context for reading credentials.
+ */
+static lsc_crypt_ctx_t credential_crypt_ctx = NULL;
+
+/**
+ * @brief Key UID that credential_crypt_ctx was created for.
+ */
+static gchar *credential_crypt_ctx_uid = NULL;
+
+/**
+ * @brief Get the shared encryption context for reading credentials.
+ *
+ * Sharing one context across iterators keeps its decryption cache warm,
+ * so scan waves that resolve the same credentials repeatedly go to GPG
+ * only once per credential.  The context is renewed when the encryption
+ * key UID changes.
+ *
+ * @return Encryption context.  Owned by this module, so the caller must
+ *         not release it.
+ */
+static lsc_crypt_ctx_t
+credential_decrypt_ctx ()
+{
+  char *encryption_key_uid = current_encryption_key_uid (TRUE);
+
+  if (credential_crypt_ctx
+      && strcmp (encryption_key_uid, credential_crypt_ctx_uid))
+    credential_decrypt_ctx_reset ();
+
+  if (credential_crypt_ctx == NULL)
+    {
+      credential_crypt_ctx = lsc_crypt_new (encryption_key_uid);
+      credential_crypt_ctx_uid = g_strdup (encryption_key_uid);
+    }
+
+  free (encryption_key_uid);
+  return credential_crypt_ctx;
+}
+
+/**
+ * @brief Release the shared credential encryption context.
+ *
+ * Scrubs the plaintexts cached in the context.
+ */
+static void
+credential_decrypt_ctx_reset ()
+{
+  if (credential_crypt_ctx == NULL)
+    return;
+  lsc_crypt_release (credential_crypt_ctx);
+  credential_crypt_ctx = NULL;
+  g_free (credential_crypt_ctx_uid);
+  credential_crypt_ctx_uid = NULL;
+}
+
 /**
  * @brief Check that a string represents a valid Private Key.
  *
@@ -38165,6 +41130,10 @@ delete_credential (const char *credential_id, int ultimate)
   sql ("DELETE FROM credentials_data WHERE credential = %llu;", credential);
   sql ("DELETE FROM credentials WHERE id = %llu;", credential);
 
+  /* The cached packages embed the secrets, so remove them with the
+   * credential. */
+  credential_package_cache_remove (credential, NULL);
+
   sql_commit ();
   return 0;
 }
@@ -38441,20 +41410,16 @@ credential_encrypted_value (credential_t credential, const char* value_name)
     {
       gchar *secret;
       const char* decrypted;
-      lsc_crypt_ctx_t crypt_ctx;
-      char *encryption_key_uid = current_encryption_key_uid (TRUE);
-      crypt_ctx = lsc_crypt_new (encryption_key_uid);
-      free (encryption_key_uid);
 
       secret = sql_string ("SELECT value FROM credentials_data"
                            " WHERE credential = %llu"
                            "   AND type = 'secret';",
                            credential);
 
-      decrypted = lsc_crypt_decrypt (crypt_ctx, secret, value_name);
+      decrypted = lsc_crypt_decrypt (credential_decrypt_ctx (), secret,
+                                     value_name);
       if (decrypted)
         value = g_strdup (decrypted);
-      lsc_crypt_release (crypt_ctx);
       g_free (secret);
     }
 
@@ -38811,15 +41776,9 @@ credential_iterator_encrypted_data (iterator_t* iterator, const char* type)
      Return the password as is or NULL.  */
   if (secret)
     {
-      /* This is an encrypted credential.  */
-      if (!iterator->crypt_ctx)
-        {
-          char *encryption_key_uid = current_encryption_key_uid (TRUE);
-          iterator->crypt_ctx = lsc_crypt_new (encryption_key_uid);
-          free (encryption_key_uid);
-        }
-
-      return lsc_crypt_decrypt (iterator->crypt_ctx, secret, type);
+      /* This is an encrypted credential.  Use the shared context, so
+       * that the decryption is cached across iterators. */
+      return lsc_crypt_decrypt (credential_decrypt_ctx (), secret, type);
     }
   else
     {
@@ -38962,6 +41921,148 @@ credential_iterator_privacy_password (iterator_t* iterator)
 }
 
 
+/**
+ * @brief Get the package cache path of the current credential of an iterator.
+ *
+ * The credential id, format and modification time make up the file name,
+ * so a modified credential switches to a new cache file.
+ *
+ * @param[in]  iterator  Credential iterator.
+ * @param[in]  format    Package format name.
+ * @param[in]  extra     Extra key data to hash into the name, or NULL.
+ *
+ * @return Newly allocated path of the cache file.
+ */
+static gchar *
+credential_package_cache_path (iterator_t *iterator, const char *format,
+                               const char *extra)
+{
+  gchar *name, *path;
+  long long int modification_time;
+
+  modification_time = sql_int64_0 ("SELECT modification_time"
+                                   " FROM credentials WHERE id = %llu;",
+                                   get_iterator_resource (iterator));
+
+  if (extra)
+    name = g_strdup_printf ("%llu-%s-%lli-%u",
+                            get_iterator_resource (iterator),
+                            format,
+                            modification_time,
+                            g_str_hash (extra));
+  else
+    name = g_strdup_printf ("%llu-%s-%lli",
+                            get_iterator_resource (iterator),
+                            format,
+                            modification_time);
+  path = g_build_filename (GVMD_STATE_DIR, "lsc_package_cache", name, NULL);
+  g_free (name);
+  return path;
+}
+
+/**
+ * @brief Remove cached packages of a credential.
+ *
+ * @param[in]  credential  Credential.
+ * @param[in]  format      Package format name, or NULL for all formats.
+ */
+static void
+credential_package_cache_remove (credential_t credential, const char *format)
+{
+  gchar *cache_dir, *prefix;
+  const gchar *name;
+  GDir *dir;
+
+  cache_dir = g_build_filename (GVMD_STATE_DIR, "lsc_package_cache", NULL);
+  if (format)
+    prefix = g_strdup_printf ("%llu-%s-", credential, format);
+  else
+    prefix = g_strdup_printf ("%llu-", credential);
+  dir = g_dir_open (cache_dir, 0, NULL);
+  if (dir)
+    {
+      while ((name = g_dir_read_name (dir)))
+        if (g_str_has_prefix (name, prefix))
+          {
+            gchar *path;
+
+            path = g_build_filename (cache_dir, name, NULL);
+            g_unlink (path);
+            g_free (path);
+          }
+      g_dir_close (dir);
+    }
+  g_free (prefix);
+  g_free (cache_dir);
+}
+
+/**
+ * @brief Cache a generated credential package on disk.
+ *
+ * Removes cache files of older versions of the same credential and
+ * format first.
+ *
+ * @param[in]  iterator      Credential iterator.
+ * @param[in]  format        Package format name.
+ * @param[in]  cache_path    Path of the cache file.
+ * @param[in]  package       Package content.
+ * @param[in]  package_size  Length of package in bytes.
+ */
+static void
+credential_package_cache_save (iterator_t *iterator, const char *format,
+                               const gchar *cache_path, const void *package,
+                               gsize package_size)
+{
+  gchar *cache_dir;
+  GError *error;
+
+  cache_dir = g_build_filename (GVMD_STATE_DIR, "lsc_package_cache", NULL);
+  if (g_mkdir_with_parents (cache_dir, 0700 /* "rwx------" */))
+    {
+      g_warning ("%s: Failed to create package cache dir: %s",
+                 __func__,
+                 strerror (errno));
+      g_free (cache_dir);
+      return;
+    }
+  g_free (cache_dir);
+
+  credential_package_cache_remove (get_iterator_resource (iterator), format);
+
+  error = NULL;
+  if (g_file_set_contents (cache_path, package, package_size, &error)
+      == FALSE)
+    {
+      g_warning ("%s: Failed to write package cache: %s",
+                 __func__,
+                 error->message);
+      g_error_free (error);
+    }
+}
+
+/**
+ * @brief Get a cached credential package in base64 encoding.
+ *
+ * @param[in]  cache_path  Path of the cache file.
+ *
+ * @return Newly allocated base64 encoded package if cached, else NULL.
+ */
+static gchar *
+credential_package_cache_check (const gchar *cache_path)
+{
+  gchar *content, *package64;
+  gsize content_size;
+
+  if (g_file_get_contents (cache_path, &content, &content_size, NULL)
+      == FALSE)
+    return NULL;
+  package64 = content_size
+              ? g_base64_encode ((guchar *) content, content_size)
+              : g_strdup ("");
+  g_free (content);
+  return package64;
+}
+
 /**
  * @brief Get the rpm from a Credential iterator.
  *
@@ -38976,29 +42077,41 @@ credential_iterator_rpm (iterator_t *iterator)
   void *rpm;
   char *public_key;
   gsize rpm_size;
-  gchar *rpm64;
+  gchar *cache_path, *rpm64;
 
   if (iterator->done) return NULL;
 
+  if (credential_iterator_format_available
+          (iterator, CREDENTIAL_FORMAT_RPM) == FALSE)
+    return NULL;
+
+  cache_path = credential_package_cache_path (iterator, "rpm", NULL);
+  rpm64 = credential_package_cache_check (cache_path);
+  if (rpm64)
+    {
+      g_free (cache_path);
+      return rpm64;
+    }
+
   private_key = credential_iterator_private_key (iterator);
   pass = credential_iterator_password (iterator);
   public_key = gvm_ssh_public_from_private (private_key, pass);
   if (!public_key)
-    return NULL;
-  login = credential_iterator_login (iterator);
-  if (credential_iterator_format_available
-          (iterator, CREDENTIAL_FORMAT_RPM) == FALSE)
     {
-      g_free (public_key);
+      g_free (cache_path);
       return NULL;
     }
-  else if (lsc_user_rpm_recreate (login, public_key, &rpm, &rpm_size))
+  login = credential_iterator_login (iterator);
+  if (lsc_user_rpm_recreate (login, public_key, &rpm, &rpm_size))
     {
       g_warning ("%s: Failed to create RPM", __func__);
       g_free (public_key);
+      g_free (cache_path);
       return NULL;
     }
   g_free (public_key);
+  credential_package_cache_save (iterator, "rpm", cache_path, rpm, rpm_size);
+  g_free (cache_path);
   rpm64 = (rpm && rpm_size)
           ? g_base64_encode (rpm, rpm_size)
           : g_strdup ("");
@@ -39020,36 +42133,53 @@ credential_iterator_deb (iterator_t *iterator)
   char *public_key, *maintainer;
   void *deb;
   gsize deb_size;
-  gchar *deb64;
+  gchar *cache_path, *deb64;
 
   if (iterator->done) return NULL;
 
+  if (credential_iterator_format_available
+          (iterator, CREDENTIAL_FORMAT_DEB) == FALSE)
+    return NULL;
+
   maintainer = NULL;
   setting_value (SETTING_UUID_LSC_DEB_MAINTAINER, &maintainer);
+
+  /* The maintainer is part of the cache key, because it is built into
+   * the package. */
+  cache_path = credential_package_cache_path (iterator, "deb",
+                                              maintainer ? maintainer : "");
+  deb64 = credential_package_cache_check (cache_path);
+  if (deb64)
+    {
+      g_free (cache_path);
+      free (maintainer);
+      return deb64;
+    }
+
   private_key = credential_iterator_private_key (iterator);
   pass = credential_iterator_password (iterator);
   public_key = gvm_ssh_public_from_private (private_key, pass);
   if (!public_key)
-    return NULL;
-  login = credential_iterator_login (iterator);
-  if (credential_iterator_format_available
-          (iterator, CREDENTIAL_FORMAT_DEB) == FALSE)
     {
-      g_free (public_key);
+      g_free (cache_path);
       free (maintainer);
       return NULL;
     }
-  else if (lsc_user_deb_recreate (login, public_key,
-                                  maintainer ? maintainer : "",
-                                  &deb, &deb_size))
+  login = credential_iterator_login (iterator);
+  if (lsc_user_deb_recreate (login, public_key,
+                             maintainer ? maintainer : "",
+                             &deb, &deb_size))
     {
       g_warning ("%s: Failed to create DEB", __func__);
       g_free (public_key);
+      g_free (cache_path);
       free (maintainer);
       return NULL;
     }
   g_free (public_key);
   free (maintainer);
+  credential_package_cache_save (iterator, "deb", cache_path, deb, deb_size);
+  g_free (cache_path);
 
   deb64 = (deb && deb_size)
           ? g_base64_encode (deb, deb_size)
@@ -39071,20 +42201,32 @@ credential_iterator_exe (iterator_t *iterator)
   const char *login, *password;
   void *exe;
   gsize exe_size;
-  gchar *exe64;
+  gchar *cache_path, *exe64;
 
   if (iterator->done) return NULL;
 
-  login = credential_iterator_login (iterator);
-  password = credential_iterator_password (iterator);
   if (credential_iterator_format_available
           (iterator, CREDENTIAL_FORMAT_EXE) == FALSE)
     return NULL;
-  else if (lsc_user_exe_recreate (login, password, &exe, &exe_size))
+
+  cache_path = credential_package_cache_path (iterator, "exe", NULL);
+  exe64 = credential_package_cache_check (cache_path);
+  if (exe64)
+    {
+      g_free (cache_path);
+      return exe64;
+    }
+
+  login = credential_iterator_login (iterator);
+  password = credential_iterator_password (iterator);
+  if (lsc_user_exe_recreate (login, password, &exe, &exe_size))
     {
       g_warning ("%s: Failed to create EXE", __func__);
+      g_free (cache_path);
       return NULL;
     }
+  credential_package_cache_save (iterator, "exe", cache_path, exe, exe_size);
+  g_free (cache_path);
   exe64 = (exe && exe_size)
           ? g_base64_encode (exe, exe_size)
           : g_strdup ("");
@@ -40631,7 +43773,16 @@ create_override (const char* active, const char* nvt, const char* text,
                                  ((gpointer*)&reports_ptr), NULL))
     {
       if (auto_cache_rebuild)
-        report_cache_counts (*reports_ptr, 0, 1, users_where);
+        {
+          /* The override can only change the counts of its NVT's results,
+           * so adjust the cache by that NVT's contribution instead of
+           * rebuilding the counts of the whole report. */
+          report_cache_counts_nvt_delta (*reports_ptr, nvt, new_override,
+                                         -1, users_where);
+          report_cache_counts_nvt_delta (*reports_ptr, nvt, 0, 1,
+                                         users_where);
+          report_counts_update_end_time (*reports_ptr);
+        }
       else
         report_clear_count_cache (*reports_ptr, 0, 1, users_where);
     }
@@ -40639,6 +43790,8 @@ create_override (const char* active, const char* nvt, const char* text,
   g_free (override_id);
   g_free (users_where);
 
+  session_overrides_invalidate ();
+
   return 0;
 }
 
@@ -40766,16 +43919,39 @@ delete_override (const char *override_id, int ultimate)
       tags_remove_resource ("override", override, LOCATION_TABLE);
     }
 
+  auto_cache_rebuild = setting_auto_cache_rebuild_int ();
+
+  if (auto_cache_rebuild)
+    {
+      gchar *nvt;
+
+      /* Subtract the override's contribution from the cached counts while
+       * the override still exists, instead of rebuilding the counts of
+       * every affected report after the delete. */
+      nvt = sql_string ("SELECT nvt FROM overrides WHERE id = %llu;",
+                        override);
+      g_hash_table_iter_init (&reports_iter, reports);
+      reports_ptr = NULL;
+      while (g_hash_table_iter_next (&reports_iter,
+                                     ((gpointer*)&reports_ptr), NULL))
+        {
+          report_cache_counts_nvt_delta (*reports_ptr, nvt, 0, -1,
+                                         users_where);
+          report_cache_counts_nvt_delta (*reports_ptr, nvt, override, 1,
+                                         users_where);
+        }
+      g_free (nvt);
+    }
+
   sql ("DELETE FROM overrides WHERE id = %llu;", override);
 
   g_hash_table_iter_init (&reports_iter, reports);
   reports_ptr = NULL;
-  auto_cache_rebuild = setting_auto_cache_rebuild_int ();
   while (g_hash_table_iter_next (&reports_iter,
                                  ((gpointer*)&reports_ptr), NULL))
     {
       if (auto_cache_rebuild)
-        report_cache_counts (*reports_ptr, 0, 1, users_where);
+        report_counts_update_end_time (*reports_ptr);
       else
         report_clear_count_cache (*reports_ptr, 0, 1, users_where);
     }
@@ -40783,6 +43959,7 @@ delete_override (const char *override_id, int ultimate)
   g_free (users_where);
 
   sql_commit ();
+  session_overrides_invalidate ();
   return 0;
 }
 
@@ -41120,6 +44297,8 @@ modify_override (const gchar *override_id, const char *active, const char *nvt,
   if (reports)
     g_hash_table_destroy (reports);
 
+  session_overrides_invalidate ();
+
   return 0;
 }
 
@@ -44414,15 +47593,30 @@ init_task_schedule_iterator (iterator_t* iterator)
                  " schedules.id, tasks.schedule_next_time,"
                  " schedules.icalendar, schedules.timezone,"
                  " schedules.duration,"
-                 " users.uuid, users.name"
+                 " users.uuid, users.name, tasks.run_status"
                  " FROM tasks, schedules, users"
                  " WHERE tasks.schedule = schedules.id"
                  " AND tasks.hidden = 0"
                  " AND (tasks.owner = (users.id))"
+                 /* Only tasks that are due to start or that may be due to
+                  * stop, so that the tick stays cheap however many
+                  * schedules exist. */
+                 " AND ((tasks.run_status IN (%i, %i, %i, %i)"
+                 "       AND tasks.schedule_next_time > 0"
+                 "       AND tasks.schedule_next_time <= m_now ())"
+                 "      OR (schedules.duration > 0"
+                 "          AND tasks.run_status IN (%i, %i, %i)))"
                  /* Sort by task and prefer owner of task or schedule as user */
                  " ORDER BY tasks.id,"
                  "          (users.id = tasks.owner) DESC,"
-                 "          (users.id = schedules.owner) DESC;");
+                 "          (users.id = schedules.owner) DESC;",
+                 TASK_STATUS_DONE,
+                 TASK_STATUS_INTERRUPTED,
+                 TASK_STATUS_NEW,
+                 TASK_STATUS_STOPPED,
+                 TASK_STATUS_RUNNING,
+                 TASK_STATUS_REQUESTED,
+                 TASK_STATUS_QUEUED);
 
   return 0;
 }
@@ -44530,6 +47724,20 @@ DEF_ACCESS (task_schedule_iterator_owner_uuid, 7);
  */
 DEF_ACCESS (task_schedule_iterator_owner_name, 8);
 
+/**
+ * @brief Get the run status from a task schedule iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ *
+ * @return Run status.
+ */
+static task_status_t
+task_schedule_iterator_run_status (iterator_t* iterator)
+{
+  if (iterator->done) return 0;
+  return (task_status_t) iterator_int (iterator, 9);
+}
+
 /**
  * @brief Get the start due state from a task schedule iterator.
  *
@@ -44548,7 +47756,7 @@ task_schedule_iterator_start_due (iterator_t* iterator)
   if (task_schedule_iterator_next_time (iterator) == 0)
     return FALSE;
 
-  run_status = task_run_status (task_schedule_iterator_task (iterator));
+  run_status = task_schedule_iterator_run_status (iterator);
   start_time = task_schedule_iterator_next_time (iterator);
 
   if ((run_status == TASK_STATUS_DONE
@@ -44590,7 +47798,7 @@ task_schedule_iterator_stop_due (iterator_t* iterator)
       if (report && (report_scheduled (report) == 0))
         return FALSE;
 
-      run_status = task_run_status (task_schedule_iterator_task (iterator));
+      run_status = task_schedule_iterator_run_status (iterator);
 
       if (run_status == TASK_STATUS_RUNNING
           || run_status == TASK_STATUS_REQUESTED
@@ -44639,7 +47847,7 @@ task_schedule_iterator_timed_out (iterator_t* iterator)
   if (schedule_timeout_secs < SCHEDULE_TIMEOUT_MIN_SECS)
     schedule_timeout_secs = SCHEDULE_TIMEOUT_MIN_SECS;
 
-  run_status = task_run_status (task_schedule_iterator_task (iterator));
+  run_status = task_schedule_iterator_run_status (iterator);
   duration = task_schedule_iterator_duration (iterator);
 
   if (duration && (duration < schedule_timeout_secs))
@@ -46135,7 +49343,18 @@ create_permission_internal (int check_access, const char *name_arg,
 
   /* Update Permissions cache */
   if (strcasecmp (quoted_name, "super") == 0)
-    cache_all_permissions_for_users (NULL);
+    {
+      GArray *affected_users;
+
+      /* Only the users under the subject are affected. */
+      affected_users = permission_subject_users (subject_id
+                                                  ? subject_type
+                                                  : NULL,
+                                                 subject);
+      cache_all_permissions_for_users (affected_users);
+      if (affected_users)
+        g_array_free (affected_users, TRUE);
+    }
   else if (resource_type && resource)
     cache_permissions_for_resource (resource_type, resource, NULL);
 
@@ -46561,7 +49780,8 @@ trash_permission_writable (permission_t permission)
      "(CASE"                                                                 \
      " WHEN resource_type = '' OR resource_type IS NULL"                     \
      " THEN ''"                                                              \
-     " ELSE resource_name (resource_type, resource_uuid, resource_location)" \
+     " ELSE resource_name_fast (resource_type, resource_uuid,"               \
+     "                          resource_location)"                          \
      " END)",                                                                \
      "_resource",                                                            \
      KEYWORD_TYPE_STRING                                                     \
@@ -46635,7 +49855,8 @@ trash_permission_writable (permission_t permission)
      "(CASE"                                                                 \
      " WHEN resource_type = '' OR resource_type IS NULL"                     \
      " THEN ''"                                                              \
-     " ELSE resource_name (resource_type, resource_uuid, resource_location)" \
+     " ELSE resource_name_fast (resource_type, resource_uuid,"               \
+     "                          resource_location)"                          \
      " END)",                                                                \
      "_resource",                                                            \
      KEYWORD_TYPE_STRING                                                     \
@@ -46970,6 +50191,7 @@ delete_permission (const char *permission_id, int ultimate)
   char *name, *subject_type, *resource_type;
   resource_t subject, resource;
   GHashTable *reports = NULL;
+  GArray *affected_users;
   int clear_original = 0;
   gchar *subject_where;
 
@@ -47031,6 +50253,7 @@ delete_permission (const char *permission_id, int ultimate)
       return 99;
     }
   subject_where = subject_where_clause (subject_type, subject);
+  affected_users = permission_subject_users (subject_type, subject);
   free (subject_type);
 
   if (ultimate == 0)
@@ -47059,10 +50282,14 @@ delete_permission (const char *permission_id, int ultimate)
 
   /* Update Permissions cache */
   if (strcasecmp (name, "super") == 0)
-    cache_all_permissions_for_users (NULL);
+    /* Only the users under the subject are affected. */
+    cache_all_permissions_for_users (affected_users);
   else if (resource_type && resource)
     cache_permissions_for_resource (resource_type, resource, NULL);
 
+  if (affected_users)
+    g_array_free (affected_users, TRUE);
+
   /* Update Reports cache */
   if (resource_type && (resource > 0) && strcmp (resource_type, "override")
       == 0)
@@ -47140,6 +50367,7 @@ modify_permission (const char *permission_id, const char *name_arg,
   char *old_name, *old_resource_type;
   resource_t old_resource;
   GHashTable *reports = NULL;
+  GArray *affected_users;
   int clear_original = 0;
   gchar *subject_where_old, *subject_where_new, *subject_where;
 
@@ -47190,6 +50418,9 @@ modify_permission (const char *permission_id, const char *name_arg,
   /* Get old subject clause */
   subject_where_old = subject_where_clause (existing_subject_type, subject);
 
+  /* Get the users under the old subject, for the cache update. */
+  affected_users = permission_subject_users (existing_subject_type, subject);
+
   /* Set the comment first, to make things easier. */
 
   if (comment)
@@ -47253,6 +50484,8 @@ modify_permission (const char *permission_id, const char *name_arg,
       free (existing_subject_type);
       free (new_subject_id);
       g_free (subject_where_old);
+      if (affected_users)
+        g_array_free (affected_users, TRUE);
       sql_rollback ();
       return ret;
     }
@@ -47327,7 +50560,43 @@ modify_permission (const char *permission_id, const char *name_arg,
   /* Update permission caches according to the modifications. */
 
   if (strcasecmp (name, "super") == 0 || strcasecmp (old_name, "super") == 0)
-    cache_all_permissions_for_users (NULL);
+    {
+      GArray *new_users;
+
+      /* Only the users under the old and the new subject are affected. */
+      new_users = permission_subject_users (new_subject_type
+                                              ? new_subject_type
+                                              : subject_type,
+                                            subject);
+      if (affected_users && new_users)
+        {
+          int index;
+
+          for (index = 0; index < new_users->len; index++)
+            {
+              user_t user;
+              int found_user, affected_index;
+
+              user = g_array_index (new_users, user_t, index);
+              found_user = 0;
+              for (affected_index = 0;
+                   affected_index < affected_users->len && found_user == 0;
+                   affected_index++)
+                if (g_array_index (affected_users, user_t, affected_index)
+                    == user)
+                  found_user = 1;
+              if (found_user == 0)
+                g_array_append_val (affected_users, user);
+            }
+          cache_all_permissions_for_users (affected_users);
+        }
+      else
+        /* A subject is missing, so fall back to all users. */
+        cache_all_permissions_for_users (NULL);
+
+      if (new_users)
+        g_array_free (new_users, TRUE);
+    }
   else
     {
       if (resource_type && resource_id && strcmp (resource_id, ""))
@@ -47341,6 +50610,9 @@ modify_permission (const char *permission_id, const char *name_arg,
         cache_permissions_for_resource (old_resource_type, old_resource, NULL);
     }
 
+  if (affected_users)
+    g_array_free (affected_users, TRUE);
+
   /* Check if caches are affected by the permission and update reports cache */
 
   if (resource_type
@@ -49250,6 +52522,9 @@ modify_filter (const char *filter_id, const char *name, const char *comment,
        quoted_type,
        filter);
 
+  /* Drop compiled filters, so that following GETs see the change. */
+  filter_cache_reset ();
+
   g_free (quoted_comment);
   g_free (quoted_name);
   g_free (quoted_term);
@@ -49263,6 +52538,27 @@ modify_filter (const char *filter_id, const char *name, const char *comment,
 
 /* Schema. */
 
+/**
+ * @brief Get the schema cache path of a schema format.
+ *
+ * The gvmd version is part of the file name, because the schema only
+ * changes with the version.
+ *
+ * @param[in]  uuid_format  UUID of the schema format.
+ *
+ * @return Newly allocated path of the cached schema output.
+ */
+static gchar *
+schema_cache_path (const char *uuid_format)
+{
+  gchar *name, *path;
+
+  name = g_strdup_printf ("%s-" GVMD_VERSION, uuid_format);
+  path = g_build_filename (GVMD_STATE_DIR, "schema_cache", name, NULL);
+  g_free (name);
+  return path;
+}
+
 /**
  * @brief Generate the GMP schema.
  *
@@ -49286,12 +52582,6 @@ manage_schema (gchar *format, gchar **output_return, gsize *output_length,
     gchar *uuid_format;
     char output_dir[] = "/tmp/gvmd_schema_XXXXXX";
 
-    if (mkdtemp (output_dir) == NULL)
-      {
-        g_warning ("%s: mkdtemp failed", __func__);
-        return -1;
-      }
-
     /* Setup file names. */
 
     if (format == NULL)
@@ -49329,6 +52619,34 @@ manage_schema (gchar *format, gchar **output_return, gsize *output_length,
     else
       return 1;
 
+    /* Serve the cached output if this format was generated before. */
+
+    {
+      gchar *cache_path, *output;
+      gsize output_len;
+
+      cache_path = schema_cache_path (uuid_format);
+      if (g_file_get_contents (cache_path, &output, &output_len, NULL))
+        {
+          g_free (cache_path);
+          if (output_length) *output_length = output_len;
+          if (output_return)
+            *output_return = output;
+          else
+            g_free (output);
+          return 0;
+        }
+      g_free (cache_path);
+    }
+
+    if (mkdtemp (output_dir) == NULL)
+      {
+        g_warning ("%s: mkdtemp failed", __func__);
+        if (extension) g_free (*extension);
+        if (content_type) g_free (*content_type);
+        return -1;
+      }
+
     script_dir = g_build_filename (GVMD_DATA_DIR,
                                    "global_schema_formats",
                                    uuid_format,
@@ -49460,6 +52778,35 @@ manage_schema (gchar *format, gchar **output_return, gsize *output_length,
 
         gvm_file_remove_recurse (output_dir);
 
+        /* Cache the output for the next request. */
+
+        {
+          gchar *cache_dir, *cache_path;
+          GError *set_error;
+
+          cache_dir = g_build_filename (GVMD_STATE_DIR, "schema_cache", NULL);
+          if (g_mkdir_with_parents (cache_dir, 0755 /* "rwxr-xr-x" */))
+            g_warning ("%s: Failed to create schema cache dir: %s",
+                       __func__,
+                       strerror (errno));
+          else
+            {
+              cache_path = schema_cache_path (uuid_format);
+              set_error = NULL;
+              if (g_file_set_contents (cache_path, output, output_len,
+                                       &set_error)
+                  == FALSE)
+                {
+                  g_warning ("%s: Failed to write schema cache: %s",
+                             __func__,
+                             set_error->message);
+                  g_error_free (set_error);
+                }
+              g_free (cache_path);
+            }
+          g_free (cache_dir);
+        }
+
         /* Return the output. */
 
         if (output_length) *output_length = output_len;
@@ -49972,6 +53319,7 @@ manage_restore (const char *id)
       char *name, *resource_type;
       resource_t perm_resource;
       GHashTable *reports = NULL;
+      GArray *affected_users;
       int clear_original = 0;
       char *subject_type;
       resource_t subject;
@@ -49996,16 +53344,21 @@ manage_restore (const char *id)
       subject_type = permission_subject_type (permission);
       subject = permission_subject (permission);
       subject_where = subject_where_clause (subject_type, subject);
+      affected_users = permission_subject_users (subject_type, subject);
       free (subject_type);
 
       tags_set_locations ("permission", resource, permission, LOCATION_TABLE);
 
       if (strcasecmp (name, "super") == 0)
-        cache_all_permissions_for_users (NULL);
+        /* Only the users under the subject are affected. */
+        cache_all_permissions_for_users (affected_users);
       else if (perm_resource != 0
                && resource_type && strcmp (resource_type, ""))
         cache_permissions_for_resource (resource_type, perm_resource, NULL);
 
+      if (affected_users)
+        g_array_free (affected_users, TRUE);
+
       /* Update Reports cache */
       if (resource_type && perm_resource
           && strcmp (resource_type, "override") == 0)
@@ -50428,6 +53781,10 @@ manage_restore (const char *id)
            " WHERE report IN (SELECT id FROM reports WHERE task = %llu);",
            resource);
 
+      sql ("DELETE FROM report_filter_counts"
+           " WHERE report IN (SELECT id FROM reports WHERE task = %llu);",
+           resource);
+
       sql ("UPDATE tasks SET hidden = 0 WHERE id = %llu;", resource);
 
       cache_permissions_for_resource ("task", resource, NULL);
@@ -50450,19 +53807,22 @@ manage_restore (const char *id)
 /**
  * @brief Empty the trashcan.
  *
+ * The resource types are deleted set based and in dependency order, each
+ * type in its own transaction, so a large trashcan is emptied in short
+ * transactions that do not block foreground writes for long.  On error
+ * the types emptied so far stay deleted, and emptying again continues
+ * with the rest.
+ *
  * @return 0 success, 99 permission denied, -1 error.
  */
 int
 manage_empty_trashcan ()
 {
-  sql_begin_immediate ();
-
   if (acl_user_may ("empty_trashcan") == 0)
-    {
-      sql_rollback ();
-      return 99;
-    }
+    return 99;
 
+  g_info ("Emptying trashcan: configs");
+  sql_begin_immediate ();
   sql ("DELETE FROM nvt_selectors"
        " WHERE name != '" MANAGE_NVT_SELECTOR_UUID_ALL "'"
        " AND name IN (SELECT nvt_selector FROM configs_trash"
@@ -50475,7 +53835,15 @@ manage_empty_trashcan ()
        "                                 WHERE uuid = '%s'));",
        current_credentials.uuid);
   sql ("DELETE FROM configs_trash" WHERE_OWNER);
+  sql_commit ();
+
+  g_info ("Emptying trashcan: tickets");
+  sql_begin_immediate ();
   empty_trashcan_tickets ();
+  sql_commit ();
+
+  g_info ("Emptying trashcan: groups");
+  sql_begin_immediate ();
   sql ("DELETE FROM permissions"
        " WHERE subject_type = 'group'"
        " AND subject IN (SELECT id from groups_trash"
@@ -50489,6 +53857,10 @@ manage_empty_trashcan ()
        "                                    WHERE uuid = '%s'));",
        current_credentials.uuid);
   sql ("DELETE FROM groups_trash" WHERE_OWNER);
+  sql_commit ();
+
+  g_info ("Emptying trashcan: alerts");
+  sql_begin_immediate ();
   sql ("DELETE FROM alert_condition_data_trash"
        " WHERE alert IN (SELECT id from alerts_trash"
        "                 WHERE owner = (SELECT id FROM users"
@@ -50505,6 +53877,10 @@ manage_empty_trashcan ()
        "                                WHERE uuid = '%s'));",
        current_credentials.uuid);
   sql ("DELETE FROM alerts_trash" WHERE_OWNER);
+  sql_commit ();
+
+  g_info ("Emptying trashcan: credentials");
+  sql_begin_immediate ();
   sql ("DELETE FROM credentials_trash_data"
        " WHERE credential IN (SELECT id from credentials_trash"
        "                      WHERE owner = (SELECT id FROM users"
@@ -50515,7 +53891,15 @@ manage_empty_trashcan ()
   sql ("DELETE FROM notes_trash" WHERE_OWNER);
   sql ("DELETE FROM overrides_trash" WHERE_OWNER);
   sql ("DELETE FROM permissions_trash" WHERE_OWNER);
+  sql_commit ();
+
+  g_info ("Emptying trashcan: port lists");
+  sql_begin_immediate ();
   empty_trashcan_port_lists ();
+  sql_commit ();
+
+  g_info ("Emptying trashcan: roles");
+  sql_begin_immediate ();
   sql ("DELETE FROM permissions"
        " WHERE subject_type = 'role'"
        " AND subject IN (SELECT id from roles_trash"
@@ -50535,6 +53919,10 @@ manage_empty_trashcan ()
        "                               WHERE uuid = '%s'));",
        current_credentials.uuid);
   sql ("DELETE FROM roles_trash" WHERE_OWNER);
+  sql_commit ();
+
+  g_info ("Emptying trashcan: scanners, schedules, tags and targets");
+  sql_begin_immediate ();
   sql ("DELETE FROM scanners_trash" WHERE_OWNER);
   sql ("DELETE FROM schedules_trash" WHERE_OWNER);
   // Remove resource data of all trash tags of the current user.
@@ -50550,12 +53938,13 @@ manage_empty_trashcan ()
        "                                 WHERE uuid = '%s'));",
        current_credentials.uuid);
   sql ("DELETE FROM targets_trash" WHERE_OWNER);
+  sql_commit ();
+
+  g_info ("Emptying trashcan: tasks");
   if (delete_trash_tasks ())
-    {
-      sql_rollback ();
-      return -1;
-    }
+    return -1;
 
+  sql_begin_immediate ();
   sql ("UPDATE permissions"
        " SET resource = -1"
        " WHERE resource > 0"
@@ -50843,7 +54232,8 @@ hosts_set_identifiers (report_t report)
           host_t host, host_new;
           gchar *quoted_host_name;
           identifier_t *identifier;
-          GString *select;
+          GString *select, *identifier_values;
+          int identifier_count;
 
           if (report_host_noticeable (report, ip) == 0)
             {
@@ -50956,7 +54346,12 @@ hosts_set_identifiers (report_t report)
               host_new = 0;
             }
 
-          /* Add the host identifiers. */
+          /* Add the host identifiers.  The identifiers are collected
+           * and inserted in a single statement per host, as discovery
+           * scans can notice tens of thousands of hosts. */
+
+          identifier_values = NULL;
+          identifier_count = 0;
 
           index = 0;
           while ((identifier = (identifier_t*) g_ptr_array_index (identifiers,
@@ -51044,29 +54439,23 @@ hosts_set_identifiers (report_t report)
                 }
               else
                 {
-                  sql ("INSERT into host_identifiers"
-                       " (uuid, host, owner, name, comment, value, source_type,"
-                       "  source_id, source_data, creation_time, modification_time)"
-                       " VALUES"
-                       " (make_uuid (), %llu,"
-                       "  (SELECT id FROM users WHERE uuid = '%s'),"
-                       "  '%s', '', '%s', '%s', '%s', '%s', m_now (), m_now ());",
-                       host,
-                       current_credentials.uuid,
-                       quoted_identifier_name,
-                       quoted_identifier_value,
-                       quoted_source_type,
-                       quoted_source_id,
-                       quoted_source_data);
-
-                  if (host_new == 0)
-                    sql ("UPDATE hosts"
-                         " SET modification_time = (SELECT modification_time"
-                         "                          FROM host_identifiers"
-                         "                          WHERE id = %llu)"
-                         " WHERE id = %llu;",
-                         sql_last_insert_id (),
-                         host);
+                  if (identifier_values == NULL)
+                    identifier_values = g_string_new ("");
+                  g_string_append_printf (identifier_values,
+                                          "%s(make_uuid (), %llu,"
+                                          "  (SELECT id FROM users"
+                                          "   WHERE uuid = '%s'),"
+                                          "  '%s', '', '%s', '%s', '%s', '%s',"
+                                          "  m_now (), m_now ())",
+                                          identifier_count ? ", " : "",
+                                          host,
+                                          current_credentials.uuid,
+                                          quoted_identifier_name,
+                                          quoted_identifier_value,
+                                          quoted_source_type,
+                                          quoted_source_id,
+                                          quoted_source_data);
+                  identifier_count++;
                 }
 
               g_free (quoted_source_type);
@@ -51078,6 +54467,23 @@ hosts_set_identifiers (report_t report)
               index++;
             }
 
+          if (identifier_values)
+            {
+              sql ("INSERT into host_identifiers"
+                   " (uuid, host, owner, name, comment, value, source_type,"
+                   "  source_id, source_data, creation_time,"
+                   "  modification_time)"
+                   " VALUES %s;",
+                   identifier_values->str);
+
+              if (host_new == 0)
+                sql ("UPDATE hosts SET modification_time = m_now ()"
+                     " WHERE id = %llu;",
+                     host);
+
+              g_string_free (identifier_values, TRUE);
+            }
+
           g_free (quoted_host_name);
           host_index++;
         }
@@ -53174,12 +56580,22 @@ setting_timezone ()
 }
 
 /**
- * @brief Return the Auto Cache Rebuild user setting as an int.
+ * @brief Process-wide cache of the Auto Cache Rebuild user setting.
+ *
+ * The setting is consulted once per report cache update, so it is read
+ * from the db at authentication and kept, like the settings cached in
+ * current_credentials.  -1 while the setting has not been read for the
+ * session user.
+ */
+static int auto_cache_rebuild_cached = -1;
+
+/**
+ * @brief Read the Auto Cache Rebuild setting of the session user.
  *
  * @return 1 if cache is rebuilt automatically, 0 if not.
  */
 static int
-setting_auto_cache_rebuild_int ()
+setting_auto_cache_rebuild_sql ()
 {
   return sql_int ("SELECT coalesce"
                   "        ((SELECT value FROM settings"
@@ -53190,6 +56606,20 @@ setting_auto_cache_rebuild_int ()
                   current_credentials.uuid);
 }
 
+/**
+ * @brief Return the Auto Cache Rebuild user setting as an int.
+ *
+ * @return 1 if cache is rebuilt automatically, 0 if not.
+ */
+static int
+setting_auto_cache_rebuild_int ()
+{
+  if (auto_cache_rebuild_cached >= 0)
+    return auto_cache_rebuild_cached;
+
+  return setting_auto_cache_rebuild_sql ();
+}
+
 /**
  * @brief Return user setting as int.
  *
@@ -53651,6 +57081,7 @@ modify_setting (const gchar *uuid, const gchar *name,
               g_free (value);
               return 2;
             }
+          auto_cache_rebuild_cached = value_int;
         }
 
       if (strcmp (uuid, "11deb7ff-550b-4950-aacf-06faeb7c61b9") == 0)
@@ -55661,6 +59092,10 @@ delete_user (const char *user_id_arg, const char *name_arg,
   sql ("DELETE FROM report_counts"
        " WHERE report IN (SELECT id FROM reports WHERE owner = %llu);",
        user);
+  sql ("DELETE FROM report_filter_counts WHERE \"user\" = %llu", user);
+  sql ("DELETE FROM report_filter_counts"
+       " WHERE report IN (SELECT id FROM reports WHERE owner = %llu);",
+       user);
 
   /* Hosts. */
   sql ("DELETE FROM report_host_details"
@@ -55735,6 +59170,9 @@ delete_user (const char *user_id_arg, const char *name_arg,
   sql ("DELETE FROM alert_method_data_trash"
        " WHERE alert IN (SELECT id FROM alerts_trash WHERE owner = %llu);",
        user);
+  sql ("DELETE FROM alert_deliveries"
+       " WHERE alert IN (SELECT id FROM alerts WHERE owner = %llu);",
+       user);
   sql ("DELETE FROM alerts WHERE owner = %llu;", user);
   sql ("DELETE FROM alerts_trash WHERE owner = %llu;", user);
 
@@ -57526,48 +60964,98 @@ tag_add_resource (tag_t tag, const char *type, const char *uuid,
 }
 
 /**
- * @brief Find a resource by UUID and add it as a tag resource.
+ * @brief Find a resource by UUID for attaching it to a tag.
  *
- * @param[in]  tag         Tag to attach to the resource.
  * @param[in]  type        The resource Type.
  * @param[in]  uuid        The resource UUID.
  * @param[in]  permission  The permission required to get the resource.
+ * @param[out] resource    The resource row id.
+ * @param[out] location    Whether the resource is in the trashcan.
  *
  * @return 0 success, -1 error, 1 resource not found.
  */
 static int
-tag_add_resource_uuid (tag_t tag, const char *type, const char *uuid,
-                       const char *permission)
+tag_resolve_resource_uuid (const char *type, const char *uuid,
+                           const char *permission, resource_t *resource,
+                           int *location)
 {
-  int resource_location = LOCATION_TABLE;
-  resource_t resource;
+  *location = LOCATION_TABLE;
 
   if (find_resource_with_permission (type, uuid,
-                                     &resource, permission, 0))
+                                     resource, permission, 0))
     {
       g_warning ("%s: Failed to find %s %s",
                  __func__, type, uuid);
       return -1;
     }
-  else if (resource == 0
+  else if (*resource == 0
            && type_has_trash (type))
     {
       if (find_resource_with_permission (type, uuid,
-                                         &resource, permission,
+                                         resource, permission,
                                          1))
         {
           g_warning ("%s: Failed to find trash %s %s",
                      __func__, type, uuid);
           return -1;
         }
-      else if (resource != 0)
-        resource_location = LOCATION_TRASH;
+      else if (*resource != 0)
+        *location = LOCATION_TRASH;
     }
 
-  if (resource == 0)
+  if (*resource == 0)
     return 1;
 
-  return tag_add_resource (tag, type, uuid, resource, resource_location);
+  return 0;
+}
+
+/**
+ * @brief Maximum number of value rows per INSERT when attaching resources.
+ */
+#define TAG_ADD_INSERT_SIZE 300
+
+/**
+ * @brief Attach a buffer of resolved resources to a tag in one statement.
+ *
+ * Clears the buffer on success.
+ *
+ * @param[in]  tag     Tag to attach the resources to.
+ * @param[in]  type    Resource type of the buffered rows.
+ * @param[in]  values  Buffer of "(resource, uuid, location)" value rows.
+ */
+static void
+tag_add_resources_flush (tag_t tag, const char *type, GString *values)
+{
+  if (values->len == 0)
+    return;
+
+  if (type_is_info_subtype (type))
+    sql ("INSERT INTO tag_resources"
+         " (tag, resource_type, resource, resource_uuid, resource_location)"
+         " SELECT DISTINCT %llu, '%s', new.resource, new.resource_uuid,"
+         "        new.resource_location"
+         " FROM (VALUES %s)"
+         "      AS new (resource, resource_uuid, resource_location)"
+         " WHERE NOT EXISTS (SELECT 1 FROM tag_resources"
+         "                   WHERE tag = %llu"
+         "                   AND resource_type = '%s'"
+         "                   AND resource_uuid = new.resource_uuid);",
+         tag, type, values->str, tag, type);
+  else
+    sql ("INSERT INTO tag_resources"
+         " (tag, resource_type, resource, resource_uuid, resource_location)"
+         " SELECT DISTINCT %llu, '%s', new.resource, new.resource_uuid,"
+         "        new.resource_location"
+         " FROM (VALUES %s)"
+         "      AS new (resource, resource_uuid, resource_location)"
+         " WHERE NOT EXISTS (SELECT 1 FROM tag_resources"
+         "                   WHERE tag = %llu"
+         "                   AND resource_type = '%s'"
+         "                   AND resource = new.resource"
+         "                   AND resource_location = new.resource_location);",
+         tag, type, values->str, tag, type);
+
+  g_string_truncate (values, 0);
 }
 
 /**
@@ -57585,7 +61073,8 @@ tag_add_resources_list (tag_t tag, const char *type, array_t *uuids,
                         gchar **error_extra)
 {
   gchar *resource_permission, *current_uuid;
-  int index;
+  GString *values;
+  int index, buffered;
 
   if (type_is_info_subtype (type))
     resource_permission = g_strdup ("get_info");
@@ -57609,22 +61098,50 @@ tag_add_resources_list (tag_t tag, const char *type, array_t *uuids,
   else
     resource_permission = g_strdup_printf ("get_%ss", type);
 
+  /* Resolve the UUIDs one by one, for the per resource access check and
+   * error reporting, but insert the resulting rows in batches. */
+
+  values = g_string_new ("");
+  buffered = 0;
   index = 0;
   while ((current_uuid = g_ptr_array_index (uuids, index++)))
     {
-      int ret;
+      resource_t resource;
+      gchar *quoted_uuid;
+      int ret, location;
 
-      ret = tag_add_resource_uuid (tag, type, current_uuid,
-                                   resource_permission);
+      ret = tag_resolve_resource_uuid (type, current_uuid,
+                                       resource_permission, &resource,
+                                       &location);
       if (ret)
         {
           g_free (resource_permission);
+          g_string_free (values, TRUE);
           if (error_extra)
             *error_extra = g_strdup (current_uuid);
           return ret;
         }
+
+      quoted_uuid = sql_insert (current_uuid);
+      g_string_append_printf (values,
+                              "%s(%llu, %s, %d)",
+                              buffered ? ", " : "",
+                              resource,
+                              quoted_uuid,
+                              location);
+      g_free (quoted_uuid);
+
+      buffered++;
+      if (buffered >= TAG_ADD_INSERT_SIZE)
+        {
+          tag_add_resources_flush (tag, type, values);
+          buffered = 0;
+        }
     }
 
+  tag_add_resources_flush (tag, type, values);
+  g_string_free (values, TRUE);
+
   return 0;
 }
 
@@ -57717,10 +61234,6 @@ tag_add_resources_filter (tag_t tag, const char *type, const char *filter)
                 return 2;
               }
 
-            init_iterator (&resources,
-                           "%s",
-                           filtered_select);
-
             break;
           default:
             g_free (columns);
@@ -57741,6 +61254,42 @@ tag_add_resources_filter (tag_t tag, const char *type, const char *filter)
   if (resources_get.extra_params)
     g_hash_table_destroy (resources_get.extra_params);
 
+  if (filtered_select)
+    {
+      /* Attach all the filtered resources in one statement, instead of
+       * inserting the rows one by one. */
+
+      if (type_is_info_subtype (type))
+        sql ("INSERT INTO tag_resources"
+             " (tag, resource_type, resource, resource_uuid,"
+             "  resource_location)"
+             " SELECT DISTINCT %llu, '%s', filtered.id, filtered.uuid, %d"
+             " FROM (%s) AS filtered (id, uuid)"
+             " WHERE NOT EXISTS (SELECT 1 FROM tag_resources"
+             "                   WHERE tag = %llu"
+             "                   AND resource_type = '%s'"
+             "                   AND resource_uuid = filtered.uuid);",
+             tag, type, LOCATION_TABLE, filtered_select,
+             tag, type);
+      else
+        sql ("INSERT INTO tag_resources"
+             " (tag, resource_type, resource, resource_uuid,"
+             "  resource_location)"
+             " SELECT DISTINCT %llu, '%s', filtered.id, filtered.uuid, %d"
+             " FROM (%s) AS filtered (id, uuid)"
+             " WHERE NOT EXISTS (SELECT 1 FROM tag_resources"
+             "                   WHERE tag = %llu"
+             "                   AND resource_type = '%s'"
+             "                   AND resource = filtered.id"
+             "                   AND resource_location = %d);",
+             tag, type, LOCATION_TABLE, filtered_select,
+             tag, type, LOCATION_TABLE);
+
+      g_free (filtered_select);
+
+      return 0;
+    }
+
   ret = 2;
   while (next (&resources))
     {
@@ -57762,8 +61311,6 @@ tag_add_resources_filter (tag_t tag, const char *type, const char *filter)
     }
   cleanup_iterator (&resources);
 
-  g_free (filtered_select);
-
   return ret;
 }
 
@@ -58711,15 +62258,13 @@ resource_tag_exists (const char* type, resource_t resource, int active_only)
   assert (resource);
 
   ret = sql_int ("SELECT EXISTS (SELECT *"
-                 "               FROM tags"
-                 "               WHERE resource_type = '%s'"
-                 "               AND EXISTS"
-                 "                   (SELECT * FROM tag_resources"
-                 "                    WHERE tag = tags.id"
-                 "                    AND resource = %llu"
-                 "                    AND resource_location = %d"
-                 "                    AND tags.resource_type"
-                 "                        = tag_resources.resource_type)"
+                 "               FROM tag_resources, tags"
+                 "               WHERE tag_resources.resource_type = '%s'"
+                 "               AND tag_resources.resource = %llu"
+                 "               AND tag_resources.resource_location = %d"
+                 "               AND tags.id = tag_resources.tag"
+                 "               AND tags.resource_type"
+                 "                   = tag_resources.resource_type"
                  "               %s);",
                  type,
                  resource,
@@ -58746,15 +62291,13 @@ resource_tag_count (const char* type, resource_t resource, int active_only)
   assert (type);
   assert (resource);
 
-  ret = sql_int ("SELECT count (id)"
-                 " FROM tags"
-                 " WHERE resource_type = '%s'"
-                 "   AND EXISTS"
-                 "     (SELECT * FROM tag_resources"
-                 "      WHERE tag = tags.id"
-                 "        AND resource = %llu"
-                 "        AND resource_location = %d"
-                 "        AND tags.resource_type = tag_resources.resource_type)"
+  ret = sql_int ("SELECT count (*)"
+                 " FROM tag_resources, tags"
+                 " WHERE tag_resources.resource_type = '%s'"
+                 "   AND tag_resources.resource = %llu"
+                 "   AND tag_resources.resource_location = %d"
+                 "   AND tags.id = tag_resources.tag"
+                 "   AND tags.resource_type = tag_resources.resource_type"
                  "   %s;",
                  type,
                  resource,
@@ -59550,6 +63093,59 @@ all_users_array ()
   return ret;
 }
 
+/**
+ * @brief  Get the users of a permission subject as a GArray.
+ *
+ * These are the users whose cached permissions a permission on the subject
+ * affects.
+ *
+ * @param[in]  subject_type  Type of subject: "user", "group" or "role".
+ * @param[in]  subject       The subject.
+ *
+ * @return Newly allocated GArray of user_t, or NULL if the subject is
+ *         missing.
+ */
+static GArray *
+permission_subject_users (const char *subject_type, resource_t subject)
+{
+  iterator_t users_iter;
+  GArray *ret;
+
+  if (subject_type == NULL || subject == 0)
+    return NULL;
+
+  ret = g_array_new (TRUE, TRUE, sizeof (user_t));
+
+  if (strcmp (subject_type, "user") == 0)
+    {
+      user_t user;
+
+      user = subject;
+      g_array_append_val (ret, user);
+      return ret;
+    }
+
+  if (strcmp (subject_type, "group") == 0)
+    init_iterator (&users_iter,
+                   "SELECT \"user\" FROM group_users"
+                   " WHERE \"group\" = %llu;",
+                   subject);
+  else
+    init_iterator (&users_iter,
+                   "SELECT \"user\" FROM role_users"
+                   " WHERE role = %llu;",
+                   subject);
+
+  while (next (&users_iter))
+    {
+      user_t user = iterator_int64 (&users_iter, 0);
+      g_array_append_val (ret, user);
+    }
+  cleanup_iterator (&users_iter);
+
+  return ret;
+}
+
 /**
  * @brief Update permissions cache for a resource.
  *
@@ -59654,6 +63250,51 @@ cache_permissions_for_resource (const char *type, resource_t resource,
     g_array_free (cache_users, TRUE);
 }
 
+/**
+ * @brief Rebuild the permission cache of a single user for a type.
+ *
+ * Replaces the user's rows with a single INSERT ... SELECT over all
+ * resources of the type, instead of a round trip per resource.
+ *
+ * @param[in]  type  Resource type.
+ * @param[in]  user  User to rebuild the cache for.
+ */
+static void
+cache_permissions_for_user (const char *type, user_t user)
+{
+  char *old_current_user_id;
+  gchar *user_id;
+
+  old_current_user_id = current_credentials.uuid;
+  user_id = user_uuid (user);
+
+  current_credentials.uuid = user_id;
+  manage_session_init (user_id);
+
+  sql ("DELETE FROM permissions_get_%ss WHERE \"user\" = %llu;",
+       type,
+       user);
+
+  sql ("INSERT INTO permissions_get_%ss"
+       "              (\"user\", %s, has_permission)"
+       "  SELECT %llu, id,"
+       "         user_has_access_uuid (cast ('%s' as text),"
+       "                               uuid,"
+       "                               cast ('get_%ss' as text),"
+       "                               0)"
+       "  FROM %ss;",
+       type,
+       type,
+       user,
+       type,
+       type,
+       type);
+
+  g_free (user_id);
+  current_credentials.uuid = old_current_user_id;
+  manage_session_init (old_current_user_id);
+}
+
 /**
  * @brief Update permissions cache for a given type and selection of users.
  *
@@ -59679,17 +63320,14 @@ cache_permissions_for_users (const char *type, GArray *cache_users)
 
   if (strcmp (type, "task") == 0)
     {
-      iterator_t resources;
-
-      init_iterator (&resources, "SELECT id FROM %ss;", type);
+      int user_index;
 
-      while (next (&resources))
-        {
-          resource_t resource = iterator_int64 (&resources, 0);
-          cache_permissions_for_resource (type, resource, cache_users);
-        }
+      g_debug ("%s: Caching permissions on %ss for %d user(s)",
+               __func__, type, cache_users->len);
 
-      cleanup_iterator (&resources);
+      for (user_index = 0; user_index < cache_users->len; user_index++)
+        cache_permissions_for_user
+         (type, g_array_index (cache_users, user_t, user_index));
     }
 
   if (free_users)
@@ -59707,6 +63345,9 @@ cache_all_permissions_for_users (GArray *cache_users)
 {
   int free_users;
 
+  /* Permissions are changing, so drop the cached ACL decisions. */
+  acl_cache_reset ();
+
   if (cache_users == NULL)
     {
       g_debug ("%s: Getting all users", __func__);
@@ -60113,6 +63754,28 @@ manage_optimize (GSList *log_config, const db_conn_info_t *database,
                                       " of %d TLS certificate(s).",
                                       changes);
     }
+  else if (strcasecmp (name, "cluster-results") == 0)
+    {
+      unsigned long long int old_size, new_size;
+
+      old_size = sql_int64_0 ("SELECT pg_table_size ('results');");
+
+      /* Rewrite the table in results_by_report order, so that reading all
+       * the results of a report becomes mostly sequential I/O.  The rewrite
+       * also leaves the table free of bloat.  Takes an exclusive lock on the
+       * results table for the duration. */
+
+      sql ("CLUSTER results USING results_by_report;");
+      sql ("ANALYZE results;");
+
+      new_size = sql_int64_0 ("SELECT pg_table_size ('results');");
+
+      success_text = g_strdup_printf ("Optimized: cluster-results."
+                                      " Results table clustered by report,"
+                                      " size went from %llu MiB to %llu MiB.",
+                                      old_size / (1024 * 1024),
+                                      new_size / (1024 * 1024));
+    }
   else if (strcasecmp (name, "migrate-relay-sensors") == 0)
     {
       if (get_relay_mapper_path ())
@@ -60160,6 +63823,69 @@ manage_optimize (GSList *log_config, const db_conn_info_t *database,
                                       " reports.",
                                       changes);
     }
+  else if (strcasecmp (name, "rebuild-result-indexes") == 0)
+    {
+      unsigned long long int old_size, new_size;
+
+      old_size = sql_int64_0 ("SELECT pg_indexes_size ('results')"
+                              " + pg_indexes_size ('reports')"
+                              " + pg_indexes_size ('report_hosts')"
+                              " + pg_indexes_size ('report_host_details');");
+
+      /* CONCURRENTLY (PostgreSQL 12 and later) rebuilds without blocking
+       * writes, so this is safe while gvmd is serving.  On older servers
+       * fall back to a blocking REINDEX. */
+
+      if (sql_int ("SELECT current_setting ('server_version_num')::integer;")
+          >= 120000)
+        {
+          sql ("REINDEX TABLE CONCURRENTLY results;");
+          sql ("REINDEX TABLE CONCURRENTLY reports;");
+          sql ("REINDEX TABLE CONCURRENTLY report_hosts;");
+          sql ("REINDEX TABLE CONCURRENTLY report_host_details;");
+        }
+      else
+        {
+          sql ("REINDEX TABLE results;");
+          sql ("REINDEX TABLE reports;");
+          sql ("REINDEX TABLE report_hosts;");
+          sql ("REINDEX TABLE report_host_details;");
+        }
+
+      new_size = sql_int64_0 ("SELECT pg_indexes_size ('results')"
+                              " + pg_indexes_size ('reports')"
+                              " + pg_indexes_size ('report_hosts')"
+                              " + pg_indexes_size ('report_host_details');");
+
+      success_text = g_strdup_printf ("Optimized: rebuild-result-indexes."
+                                      " Result and report index size went"
+                                      " from %llu MiB to %llu MiB.",
+                                      old_size / (1024 * 1024),
+                                      new_size / (1024 * 1024));
+    }
+  else if (strcasecmp (name, "refresh-statistics") == 0)
+    {
+      /* Raise the sample size on the columns that the report and result
+       * queries filter and join on, then refresh the planner statistics.
+       * The raised targets persist, so later automatic ANALYZE runs keep
+       * the extra detail. */
+
+      sql ("ALTER TABLE results ALTER COLUMN report SET STATISTICS 1000;");
+      sql ("ALTER TABLE results ALTER COLUMN host SET STATISTICS 1000;");
+      sql ("ALTER TABLE results ALTER COLUMN nvt SET STATISTICS 1000;");
+      sql ("ALTER TABLE results ALTER COLUMN severity SET STATISTICS 1000;");
+      sql ("ALTER TABLE report_host_details ALTER COLUMN name"
+           " SET STATISTICS 1000;");
+
+      sql ("ANALYZE results;");
+      sql ("ANALYZE reports;");
+      sql ("ANALYZE report_hosts;");
+      sql ("ANALYZE report_host_details;");
+
+      success_text = g_strdup_printf ("Optimized: refresh-statistics."
+                                      " Planner statistics refreshed, with"
+                                      " raised targets on result columns.");
+    }
   else if (strcasecmp (name, "update-report-cache") == 0)
     {
       int changes;
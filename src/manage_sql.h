@@ -147,6 +147,11 @@
  */
 #define SETTING_UUID_SECINFO_SQL_BUFFER_THRESHOLD "316275a9-3629-49ad-9cea-5b3ab155b93f"
 
+/**
+ * @brief UUID of 'Report Retention Period' setting.
+ */
+#define SETTING_UUID_REPORT_RETENTION "1511e84f-da96-40cb-9708-2f768b6943f9"
+
 /**
  * @brief UUID of 'User Interface Time Format' setting.
  */
@@ -305,7 +310,7 @@ typedef struct
 /**
  * @brief Delta results columns offset for result iterator.
  */
-#define RESULT_ITERATOR_DELTA_COLUMN_OFFSET GET_ITERATOR_COLUMN_COUNT + 46
+#define RESULT_ITERATOR_DELTA_COLUMN_OFFSET GET_ITERATOR_COLUMN_COUNT + 47
 
 
 /* Variables */
@@ -411,6 +416,14 @@ void check_generate_scripts ();
 
 void auto_delete_reports ();
 
+void purge_expired_reports ();
+
+int alert_deliveries_due ();
+
+void alert_deliveries_run ();
+
+void deferred_startup_checks_run ();
+
 int parse_iso_time (const char *);
 
 void set_report_scheduled (report_t);
@@ -502,6 +515,9 @@ copy_resource_lock (const char *, const char *, const char *, const char *,
 nvti_t *
 lookup_nvti (const gchar *);
 
+void
+set_lazy_nvt_cache (int);
+
 int
 setting_value (const char *, char **);
 
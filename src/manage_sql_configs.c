@@ -59,6 +59,9 @@ switch_representation (config_t, int);
 static void
 update_config_caches (config_t);
 
+static void
+update_config_nvts_cache (config_t);
+
 
 /* Helpers. */
 
@@ -388,9 +391,9 @@ init_family_iterator (iterator_t* iterator, int all, const char* selector,
   if (selector == NULL)
     {
       init_iterator (iterator,
-                     "SELECT distinct family FROM nvts"
-                     " WHERE family != 'Credentials'"
-                     " ORDER BY family %s;",
+                     "SELECT name FROM nvt_families"
+                     " WHERE name != 'Credentials'"
+                     " ORDER BY name %s;",
                      ascending ? "ASC" : "DESC");
       return;
     }
@@ -400,8 +403,8 @@ init_family_iterator (iterator_t* iterator, int all, const char* selector,
     /* Constraining the universe.  Presume there is a family exclude for
      * every NVT include. */
     init_iterator (iterator,
-                   "SELECT distinct family FROM nvts"
-                   " WHERE family != 'Credentials'"
+                   "SELECT name FROM nvt_families"
+                   " WHERE name != 'Credentials'"
                    " EXCEPT"
                    " SELECT distinct family FROM nvt_selectors"
                    " WHERE type = " G_STRINGIFY (NVT_SELECTOR_TYPE_FAMILY)
@@ -1284,6 +1287,8 @@ manage_set_config_families (config_t config,
     }
   cleanup_iterator (&families);
 
+  update_config_nvts_cache (config);
+
   g_free (quoted_selector);
   free (selector);
   return 0;
@@ -3083,6 +3088,7 @@ delete_config (const char *config_id, int ultimate)
                           LOCATION_TRASH);
     }
 
+  sql ("DELETE FROM config_nvts WHERE config = %llu;", config);
   sql ("DELETE FROM config_preferences WHERE config = %llu;", config);
   sql ("DELETE FROM configs WHERE id = %llu;", config);
 
@@ -3968,6 +3974,8 @@ manage_set_config_nvts (config_t config, const char* family,
        MAX (new_nvt_count, 0),
        config);
 
+  update_config_nvts_cache (config);
+
   g_free (quoted_family);
   g_free (quoted_selector);
   return 0;
@@ -4217,6 +4225,68 @@ DEF_ACCESS (config_timeout_iterator_nvt_name, 2);
  */
 DEF_ACCESS (config_timeout_iterator_value, 3);
 
+/**
+ * @brief Update the cached NVT membership of a config.
+ *
+ * Materialises the effective NVT set of the config's selector into
+ * config_nvts, so scan startup and family listing read an indexed set
+ * instead of resolving the selector logic on every call.
+ *
+ * An NVT is a member if it has an NVT include, otherwise excluded if it
+ * has an NVT exclude, otherwise decided by the family rule, otherwise by
+ * whether the selector constrains the universe.
+ *
+ * It's up to the caller to organise a transaction.
+ *
+ * @param[in]  config  Config to update.
+ */
+static void
+update_config_nvts_cache (config_t config)
+{
+  char *selector;
+  gchar *quoted_selector;
+
+  selector = config_nvt_selector (config);
+  if (selector == NULL)
+    /* The config should always have a selector. */
+    return;
+  quoted_selector = sql_quote (selector);
+  free (selector);
+
+  sql ("DELETE FROM config_nvts WHERE config = %llu;", config);
+  sql ("INSERT INTO config_nvts (config, nvt)"
+       " SELECT %llu, nvts.oid FROM nvts"
+       " WHERE CASE"
+       "       WHEN EXISTS (SELECT 1 FROM nvt_selectors"
+       "                    WHERE name = '%s'"
+       "                    AND type = " G_STRINGIFY (NVT_SELECTOR_TYPE_NVT)
+       "                    AND family_or_nvt = nvts.oid)"
+       "       THEN EXISTS (SELECT 1 FROM nvt_selectors"
+       "                    WHERE name = '%s'"
+       "                    AND type = " G_STRINGIFY (NVT_SELECTOR_TYPE_NVT)
+       "                    AND family_or_nvt = nvts.oid"
+       "                    AND exclude = 0)"
+       "       WHEN EXISTS (SELECT 1 FROM nvt_selectors"
+       "                    WHERE name = '%s'"
+       "                    AND type = " G_STRINGIFY (NVT_SELECTOR_TYPE_FAMILY)
+       "                    AND family_or_nvt = nvts.family)"
+       "       THEN EXISTS (SELECT 1 FROM nvt_selectors"
+       "                    WHERE name = '%s'"
+       "                    AND type = " G_STRINGIFY (NVT_SELECTOR_TYPE_FAMILY)
+       "                    AND family_or_nvt = nvts.family"
+       "                    AND exclude = 0)"
+       "       ELSE (%i = 1)"
+       "       END;",
+       config,
+       quoted_selector,
+       quoted_selector,
+       quoted_selector,
+       quoted_selector,
+       config_families_growing (config));
+
+  g_free (quoted_selector);
+}
+
 /**
  * @brief Update the cached count and growing information in a config.
  *
@@ -4246,6 +4316,8 @@ update_config_cache (iterator_t *configs)
        nvt_selector_nvts_growing_2 (quoted_selector, families_growing),
        quoted_name);
 
+  update_config_nvts_cache (get_iterator_resource (configs));
+
   g_free (quoted_name);
   g_free (quoted_selector);
 }
@@ -209,17 +209,41 @@ nvt_name (const char *oid)
   return ret;
 }
 
+/**
+ * @brief Process cache of the feed version in the meta table.
+ */
+static gchar *cached_nvts_feed_version = NULL;
+
 /**
  * @brief Return feed version of the plugins in the plugin cache.
  *
+ * The version is cached in process memory, because it is consulted on
+ * virtually every GMP request.  The cache is refreshed when the feed
+ * version is set and when the nvti cache update flag is handled.
+ *
  * @return Feed version of plugins if the plugins are cached, else NULL.
  */
 char*
 nvts_feed_version ()
 {
-  return sql_string ("SELECT value FROM %s.meta"
-                     " WHERE name = 'nvts_feed_version';",
-                     sql_schema ());
+  if (cached_nvts_feed_version == NULL)
+    cached_nvts_feed_version
+      = sql_string ("SELECT value FROM %s.meta"
+                    " WHERE name = 'nvts_feed_version';",
+                    sql_schema ());
+  return g_strdup (cached_nvts_feed_version);
+}
+
+/**
+ * @brief Clear the process cache of the feed version.
+ *
+ * The next call of nvts_feed_version will read the version from the db.
+ */
+void
+invalidate_nvts_feed_version_cache ()
+{
+  g_free (cached_nvts_feed_version);
+  cached_nvts_feed_version = NULL;
 }
 
 /**
@@ -264,6 +288,9 @@ set_nvts_feed_version (const char *feed_version)
        sql_schema (),
        quoted);
   g_free (quoted);
+
+  g_free (cached_nvts_feed_version);
+  cached_nvts_feed_version = g_strdup (feed_version);
 }
 
 /**
@@ -302,6 +329,11 @@ find_nvt (const char* oid, nvt_t* nvt)
   return FALSE;
 }
 
+/**
+ * @brief Size at which the COPY buffers of a full rebuild are flushed.
+ */
+#define NVTS_COPY_BUFFER_SIZE 10485760
+
 /**
  * @brief SQL batch.
  */
@@ -585,6 +617,196 @@ insert_nvt (const nvti_t *nvti, int rebuild, batch_t *vt_refs_batch,
   g_free (quoted_qod_type);
 }
 
+/**
+ * @brief Buffer the vt_refs of an NVT for a COPY load.
+ *
+ * @param[in]  nvti    NVT Information.
+ * @param[in]  buffer  COPY buffer for table vt_refs_rebuild.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+copy_vt_refs (const nvti_t *nvti, copy_buffer_t *buffer)
+{
+  int i;
+
+  for (i = 0; i < nvti_vtref_len (nvti); i++)
+    {
+      vtref_t *ref;
+      gchar *escaped_type, *escaped_id, *escaped_text;
+
+      ref = nvti_vtref (nvti, i);
+      escaped_type = sql_copy_escape (vtref_type (ref));
+      escaped_id = sql_copy_escape (vtref_id (ref));
+      escaped_text = sql_copy_escape (vtref_text (ref)
+                                       ? vtref_text (ref) : "");
+
+      g_string_append_printf (buffer->buffer,
+                              "%s\t%s\t%s\t%s\n",
+                              nvti_oid (nvti), escaped_type, escaped_id,
+                              escaped_text);
+
+      g_free (escaped_type);
+      g_free (escaped_id);
+      g_free (escaped_text);
+
+      if (copy_buffer_check_size (buffer))
+        return -1;
+    }
+
+  return 0;
+}
+
+/**
+ * @brief Buffer the vt_severities of an NVT for a COPY load.
+ *
+ * @param[in]  nvti     NVT Information.
+ * @param[in]  buffer   COPY buffer for table vt_severities_rebuild.
+ * @param[out] highest  Highest severity.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+copy_vt_severities (const nvti_t *nvti, copy_buffer_t *buffer,
+                    double *highest)
+{
+  int i;
+
+  *highest = 0;
+
+  for (i = 0; i < nvti_vtseverities_len (nvti); i++)
+    {
+      vtseverity_t *severity;
+      gchar *escaped_type, *escaped_origin, *escaped_value;
+
+      severity = nvti_vtseverity (nvti, i);
+      escaped_type = sql_copy_escape (vtseverity_type (severity));
+      escaped_origin = sql_copy_escape (vtseverity_origin (severity)
+                                         ? vtseverity_origin (severity) : "");
+      escaped_value = sql_copy_escape (vtseverity_value (severity)
+                                        ? vtseverity_value (severity) : "");
+
+      g_string_append_printf (buffer->buffer,
+                              "%s\t%s\t%s\t%i\t%0.1f\t%s\n",
+                              nvti_oid (nvti), escaped_type, escaped_origin,
+                              vtseverity_date (severity),
+                              vtseverity_score (severity), escaped_value);
+
+      if (vtseverity_score (severity) > *highest)
+        *highest = vtseverity_score (severity);
+
+      g_free (escaped_type);
+      g_free (escaped_origin);
+      g_free (escaped_value);
+
+      if (copy_buffer_check_size (buffer))
+        return -1;
+    }
+
+  return 0;
+}
+
+/**
+ * @brief Buffer an NVT for a COPY load during a full rebuild.
+ *
+ * Writes the same rows as \ref insert_nvt, but in COPY text format for
+ * the empty rebuild tables, which is much faster than batched INSERTs.
+ *
+ * @param[in]  nvti            NVT Information.
+ * @param[in]  nvts_buffer     COPY buffer for table nvts_rebuild.
+ * @param[in]  vt_refs_buffer  COPY buffer for table vt_refs_rebuild.
+ * @param[in]  vt_sevs_buffer  COPY buffer for table vt_severities_rebuild.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+copy_nvt (const nvti_t *nvti, copy_buffer_t *nvts_buffer,
+          copy_buffer_t *vt_refs_buffer, copy_buffer_t *vt_sevs_buffer)
+{
+  gchar *qod_str, *qod_type, *cve;
+  gchar *escaped_name, *escaped_summary, *escaped_insight, *escaped_affected;
+  gchar *escaped_impact, *escaped_detection, *escaped_cve, *escaped_tag;
+  gchar *escaped_qod_type, *escaped_family;
+  gchar *escaped_solution, *escaped_solution_type, *escaped_solution_method;
+  int qod, ret;
+  double highest;
+
+  if (copy_vt_refs (nvti, vt_refs_buffer))
+    return -1;
+
+  if (copy_vt_severities (nvti, vt_sevs_buffer, &highest))
+    return -1;
+
+  cve = nvti_refs (nvti, "cve", "", 0);
+
+  escaped_name = sql_copy_escape (nvti_name (nvti) ? nvti_name (nvti) : "");
+  escaped_summary = sql_copy_escape (nvti_summary (nvti)
+                                      ? nvti_summary (nvti) : "");
+  escaped_insight = sql_copy_escape (nvti_insight (nvti)
+                                      ? nvti_insight (nvti) : "");
+  escaped_affected = sql_copy_escape (nvti_affected (nvti)
+                                       ? nvti_affected (nvti) : "");
+  escaped_impact = sql_copy_escape (nvti_impact (nvti)
+                                     ? nvti_impact (nvti) : "");
+
+  escaped_cve = sql_copy_escape (cve ? cve : "");
+  g_free (cve);
+
+  escaped_solution = sql_copy_escape (nvti_solution (nvti)
+                                       ? nvti_solution (nvti) : "");
+  escaped_solution_type = sql_copy_escape (nvti_solution_type (nvti)
+                                            ? nvti_solution_type (nvti) : "");
+  escaped_solution_method
+    = sql_copy_escape (nvti_solution_method (nvti)
+                        ? nvti_solution_method (nvti) : "");
+  escaped_detection = sql_copy_escape (nvti_detection (nvti)
+                                        ? nvti_detection (nvti) : "");
+
+  escaped_tag = sql_copy_escape (nvti_tag (nvti) ? nvti_tag (nvti) : "");
+
+  qod_str = nvti_qod (nvti);
+  qod_type = nvti_qod_type (nvti);
+
+  if (qod_str == NULL || sscanf (qod_str, "%d", &qod) != 1)
+    qod = qod_from_type (qod_type);
+
+  escaped_qod_type = sql_copy_escape (qod_type ? qod_type : "");
+
+  escaped_family = sql_copy_escape (nvti_family (nvti)
+                                     ? nvti_family (nvti) : "");
+
+  g_string_append_printf (nvts_buffer->buffer,
+                          "%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%i\t%s"
+                          "\t%0.1f\t%i\t%i\t%s\t%s\t%s\t%s\t%s\t%d\t%s\n",
+                          nvti_oid (nvti), escaped_name, escaped_summary,
+                          escaped_insight, escaped_affected, escaped_impact,
+                          escaped_cve, escaped_tag, nvti_category (nvti),
+                          escaped_family, highest,
+                          nvti_creation_time (nvti),
+                          nvti_modification_time (nvti),
+                          nvti_oid (nvti), escaped_solution_type,
+                          escaped_solution_method, escaped_solution,
+                          escaped_detection, qod, escaped_qod_type);
+
+  ret = copy_buffer_check_size (nvts_buffer);
+
+  g_free (escaped_name);
+  g_free (escaped_summary);
+  g_free (escaped_insight);
+  g_free (escaped_affected);
+  g_free (escaped_impact);
+  g_free (escaped_cve);
+  g_free (escaped_tag);
+  g_free (escaped_family);
+  g_free (escaped_solution);
+  g_free (escaped_solution_type);
+  g_free (escaped_solution_method);
+  g_free (escaped_detection);
+  g_free (escaped_qod_type);
+
+  return ret;
+}
+
 /**
  * @brief Initialise an NVT iterator.
  *
@@ -758,6 +980,35 @@ select_config_nvts (const config_t config, const char* family, int ascending,
 
   quoted_family = sql_quote (family);
 
+  if (sql_int ("SELECT EXISTS (SELECT 1 FROM config_nvts"
+               "               WHERE config = %llu)"
+               " ::integer;",
+               config))
+    {
+      /* The materialised membership is available, so read the set directly
+       * instead of resolving the selector logic.  An empty cache falls
+       * through, because it is indistinguishable from a missing one, and
+       * recomputing an empty config is cheap anyway. */
+
+      sql = g_strdup_printf
+             ("SELECT %s"
+              " FROM nvts"
+              " WHERE family = '%s'"
+              " AND oid IN (SELECT nvt FROM config_nvts"
+              "             WHERE config = %llu)"
+              " ORDER BY %s %s;",
+              nvt_iterator_columns (),
+              quoted_family,
+              config,
+              sort_field ? sort_field : "name",
+              ascending ? "ASC" : "DESC");
+
+      g_free (quoted_selector);
+      g_free (quoted_family);
+
+      return sql;
+    }
+
   if (config_nvts_growing (config))
     {
       int constraining;
@@ -1013,13 +1264,14 @@ init_nvt_iterator (iterator_t* iterator, nvt_t nvt, config_t config,
       g_free (quoted_category);
     }
   else
-    init_iterator (iterator,
-                   "SELECT %s"
-                   " FROM nvts"
-                   " ORDER BY %s %s;",
-                   nvt_iterator_columns (),
-                   sort_field ? sort_field : "name",
-                   ascending ? "ASC" : "DESC");
+    /* Full NVT listing, so fetch in batches to keep memory use flat. */
+    init_cursor_iterator (iterator,
+                          "SELECT %s"
+                          " FROM nvts"
+                          " ORDER BY %s %s;",
+                          nvt_iterator_columns (),
+                          sort_field ? sort_field : "name",
+                          ascending ? "ASC" : "DESC");
 }
 
 /**
@@ -1362,9 +1614,33 @@ nvt_iterator_has_max_epss_severity (iterator_t* iterator)
   return ret;
 }
 
+/**
+ * @brief Cache of the default timeouts of all NVTs, keyed by OID.
+ */
+static GHashTable *nvt_timeouts = NULL;
+
+/**
+ * @brief Empty the NVT default timeout cache.
+ *
+ * Called when the nvt_preferences table changes.
+ */
+static void
+nvt_timeouts_invalidate ()
+{
+  if (nvt_timeouts)
+    {
+      g_hash_table_destroy (nvt_timeouts);
+      nvt_timeouts = NULL;
+    }
+}
+
 /**
  * @brief Get the default timeout of an NVT.
  *
+ * Callers like GET_NVTS ask for the timeout of one NVT after another, so
+ * the timeouts of all NVTs are loaded in one query on the first call and
+ * kept per process.
+ *
  * @param[in]  oid  The OID of the NVT to get the timeout of.
  *
  * @return  Newly allocated string of the timeout in seconds or NULL.
@@ -1372,9 +1648,30 @@ nvt_iterator_has_max_epss_severity (iterator_t* iterator)
 char *
 nvt_default_timeout (const char* oid)
 {
-  return sql_string ("SELECT value FROM nvt_preferences"
-                     " WHERE name = '%s:0:entry:timeout'",
-                     oid);
+  if (nvt_timeouts == NULL)
+    {
+      iterator_t timeouts;
+
+      nvt_timeouts = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                            g_free, g_free);
+      init_iterator (&timeouts,
+                     "SELECT name, value FROM nvt_preferences"
+                     " WHERE name LIKE '%%:0:entry:timeout';");
+      while (next (&timeouts))
+        {
+          gchar **split;
+
+          split = g_strsplit (iterator_string (&timeouts, 0), ":", 2);
+          if (split[0])
+            g_hash_table_replace (nvt_timeouts,
+                                  g_strdup (split[0]),
+                                  g_strdup (iterator_string (&timeouts, 1)));
+          g_strfreev (split);
+        }
+      cleanup_iterator (&timeouts);
+    }
+
+  return g_strdup (g_hash_table_lookup (nvt_timeouts, oid));
 }
 
 /**
@@ -1397,6 +1694,24 @@ nvt_family (const char *oid)
   return ret;
 }
 
+/**
+ * @brief Refresh the nvt_families table from the nvts table.
+ *
+ * Keeps the per-family NVT count and newest modification time up to date,
+ * so that family listings and counts do not have to scan the whole nvts
+ * table.
+ */
+static void
+refresh_nvt_families ()
+{
+  sql ("DELETE FROM nvt_families;");
+  sql ("INSERT INTO nvt_families (name, nvt_count, max_modification_time)"
+       " SELECT family, count (*), max (modification_time)"
+       " FROM nvts"
+       " WHERE family IS NOT NULL"
+       " GROUP BY family;");
+}
+
 /**
  * @brief Get the number of NVTs in one or all families.
  *
@@ -1413,13 +1728,16 @@ family_nvt_count (const char *family)
     {
       static int nvt_count = -1;
       if (nvt_count == -1)
-        nvt_count = sql_int ("SELECT COUNT(*) FROM nvts"
-                             " WHERE family != 'Credentials';");
+        nvt_count = sql_int ("SELECT coalesce (sum (nvt_count), 0)"
+                             " FROM nvt_families"
+                             " WHERE name != 'Credentials';");
       return nvt_count;
     }
 
   quoted_family = sql_quote (family);
-  int ret = sql_int ("SELECT COUNT(*) FROM nvts WHERE family = '%s';",
+  int ret = sql_int ("SELECT coalesce ((SELECT nvt_count FROM nvt_families"
+                     "                  WHERE name = '%s'),"
+                     "                 0);",
                      quoted_family);
   g_free (quoted_family);
   return ret;
@@ -1433,8 +1751,8 @@ family_nvt_count (const char *family)
 int
 family_count ()
 {
-  return sql_int ("SELECT COUNT(distinct family) FROM nvts"
-                  " WHERE family != 'Credentials';");
+  return sql_int ("SELECT COUNT(*) FROM nvt_families"
+                  " WHERE name != 'Credentials';");
 }
 
 /**
@@ -1468,6 +1786,7 @@ static void
 insert_nvt_preferences_list (GList *nvt_preferences_list, int rebuild)
 {
   g_list_foreach (nvt_preferences_list, insert_nvt_preference, GINT_TO_POINTER (rebuild));
+  nvt_timeouts_invalidate ();
 }
 
 /**
@@ -1896,6 +2215,7 @@ update_nvts_from_vts (element_t *get_vts_response,
   time_t feed_version_epoch;
   char *osp_vt_hash;
   batch_t *vt_refs_batch, *vt_sevs_batch;
+  copy_buffer_t nvts_buffer, vt_refs_buffer, vt_sevs_buffer;
 
   count_modified_vts = 0;
   count_new_vts = 0;
@@ -1940,8 +2260,33 @@ update_nvts_from_vts (element_t *get_vts_response,
      * To solve both cases, we remove all nvt_preferences. */
     sql ("TRUNCATE nvt_preferences;");
 
-  vt_refs_batch = batch_start (vt_ref_insert_size);
-  vt_sevs_batch = batch_start (vt_sev_insert_size);
+  if (rebuild)
+    {
+      /* The rebuild tables are empty, so stream the rows in with COPY and
+       * add the indexes afterwards, which is much faster than batched
+       * INSERTs. */
+      vt_refs_batch = vt_sevs_batch = NULL;
+      copy_buffer_init (&nvts_buffer, NVTS_COPY_BUFFER_SIZE,
+                        "COPY nvts_rebuild"
+                        " (oid, name, summary, insight, affected, impact,"
+                        "  cve, tag, category, family, cvss_base,"
+                        "  creation_time, modification_time, uuid,"
+                        "  solution_type, solution_method, solution,"
+                        "  detection, qod, qod_type)"
+                        " FROM STDIN");
+      copy_buffer_init (&vt_refs_buffer, NVTS_COPY_BUFFER_SIZE,
+                        "COPY vt_refs_rebuild (vt_oid, type, ref_id, ref_text)"
+                        " FROM STDIN");
+      copy_buffer_init (&vt_sevs_buffer, NVTS_COPY_BUFFER_SIZE,
+                        "COPY vt_severities_rebuild"
+                        " (vt_oid, type, origin, date, score, value)"
+                        " FROM STDIN");
+    }
+  else
+    {
+      vt_refs_batch = batch_start (vt_ref_insert_size);
+      vt_sevs_batch = batch_start (vt_sev_insert_size);
+    }
   vt = element_first_child (vts);
   while (vt)
     {
@@ -1955,7 +2300,17 @@ update_nvts_from_vts (element_t *get_vts_response,
       else
         count_modified_vts += 1;
 
-      insert_nvt (nvti, rebuild, vt_refs_batch, vt_sevs_batch);
+      if (rebuild)
+        {
+          if (copy_nvt (nvti, &nvts_buffer, &vt_refs_buffer,
+                        &vt_sevs_buffer))
+            {
+              sql_rollback ();
+              return -1;
+            }
+        }
+      else
+        insert_nvt (nvti, rebuild, vt_refs_batch, vt_sevs_batch);
 
       preferences = NULL;
       if (update_preferences_from_vt (vt, nvti_oid (nvti), &preferences))
@@ -1973,8 +2328,21 @@ update_nvts_from_vts (element_t *get_vts_response,
       nvti_free (nvti);
       vt = element_next (vt);
     }
-  batch_end (vt_refs_batch);
-  batch_end (vt_sevs_batch);
+  if (rebuild)
+    {
+      if (copy_buffer_run (&nvts_buffer, TRUE)
+          || copy_buffer_run (&vt_refs_buffer, TRUE)
+          || copy_buffer_run (&vt_sevs_buffer, TRUE))
+        {
+          sql_rollback ();
+          return -1;
+        }
+    }
+  else
+    {
+      batch_end (vt_refs_batch);
+      batch_end (vt_sevs_batch);
+    }
 
   if (rebuild) {
     sql ("DROP VIEW IF EXISTS results_autofp;");
@@ -1987,6 +2355,8 @@ update_nvts_from_vts (element_t *get_vts_response,
     sql ("ALTER TABLE nvt_preferences_rebuild RENAME TO nvt_preferences;");
     sql ("ALTER TABLE nvts_rebuild RENAME TO nvts;");
 
+    nvt_timeouts_invalidate ();
+
     create_view_vulns ();
 
     create_indexes_nvt ();
@@ -1994,6 +2364,8 @@ update_nvts_from_vts (element_t *get_vts_response,
     create_view_result_vt_epss ();
   }
 
+  refresh_nvt_families ();
+
   set_nvts_check_time (count_new_vts, count_modified_vts);
 
   set_nvts_feed_version (scanner_feed_version);
@@ -2616,7 +2988,15 @@ update_or_rebuild_nvts (int update)
   if (update == 0)
     set_nvts_feed_version ("0");
 
-  ret = update_nvt_cache_osp (osp_update_socket, NULL, scanner_feed_version, update == 0);
+  /* When updating, pass the database feed version so that only VTs
+   * modified since then are requested from the scanner, as in the
+   * regular sync.  A rebuild must fetch everything. */
+  ret = update_nvt_cache_osp (osp_update_socket,
+                              update ? db_feed_version : NULL,
+                              scanner_feed_version,
+                              update == 0);
+  g_free (db_feed_version);
+  g_free (scanner_feed_version);
   if (ret)
     {
       return -1;
@@ -2640,11 +3020,12 @@ int
 manage_rebuild (GSList *log_config, const db_conn_info_t *database)
 {
   int ret;
-  static lockfile_t lockfile;
+  static lockfile_t main_lockfile, feed_lockfile;
 
   g_info ("   Rebuilding NVTs.");
 
-  switch (feed_lockfile_lock_timeout (&lockfile))
+  switch (feed_type_lockfile_lock_timeout (&main_lockfile, &feed_lockfile,
+                                           NVT_FEED))
     {
       case 1:
         printf ("A feed sync is already running.\n");
@@ -2657,7 +3038,7 @@ manage_rebuild (GSList *log_config, const db_conn_info_t *database)
   ret = manage_option_setup (log_config, database);
   if (ret)
     {
-      feed_lockfile_unlock (&lockfile);
+      feed_type_lockfile_unlock (&main_lockfile, &feed_lockfile);
       return ret;
     }
 
@@ -2692,7 +3073,7 @@ manage_rebuild (GSList *log_config, const db_conn_info_t *database)
   if (ret == 0)
     update_scap_extra ();
 
-  feed_lockfile_unlock (&lockfile);
+  feed_type_lockfile_unlock (&main_lockfile, &feed_lockfile);
   manage_option_cleanup ();
 
   return ret;
@@ -2714,10 +3095,11 @@ manage_dump_vt_verification (GSList *log_config,
                              const db_conn_info_t *database)
 {
   int ret;
-  static lockfile_t lockfile;
+  static lockfile_t main_lockfile, feed_lockfile;
   char *verification_str;
 
-  switch (feed_lockfile_lock_timeout (&lockfile))
+  switch (feed_type_lockfile_lock_timeout (&main_lockfile, &feed_lockfile,
+                                           NVT_FEED))
     {
       case 1:
         printf ("A feed sync is already running.\n");
@@ -2730,14 +3112,14 @@ manage_dump_vt_verification (GSList *log_config,
   ret = manage_option_setup (log_config, database);
   if (ret)
     {
-      feed_lockfile_unlock (&lockfile);
+      feed_type_lockfile_unlock (&main_lockfile, &feed_lockfile);
       return ret;
     }
 
   verification_str = sql_string ("SELECT vts_verification_str ();");
   printf ("%s\n", verification_str);
 
-  feed_lockfile_unlock (&lockfile);
+  feed_type_lockfile_unlock (&main_lockfile, &feed_lockfile);
   manage_option_cleanup ();
 
   return 0;
@@ -165,6 +165,9 @@ update_or_rebuild_nvts (int);
 int
 nvts_feed_version_status ();
 
+void
+invalidate_nvts_feed_version_cache ();
+
 int
 manage_update_nvt_cache_osp (const gchar *);
 
@@ -1617,6 +1617,9 @@ create_port_range (const char *port_list_id, const char *type,
        port_list, port_type, first, last, quoted_comment);
   g_free (quoted_comment);
 
+  sql ("DELETE FROM port_list_range_cache WHERE port_list = %llu;",
+       port_list);
+
   if (port_range_return)
     *port_range_return = sql_last_insert_id ();
 
@@ -1742,6 +1745,8 @@ delete_port_list (const char *port_list_id, int ultimate)
       tags_remove_resource ("port_list", port_list, LOCATION_TABLE);
     }
 
+  sql ("DELETE FROM port_list_range_cache WHERE port_list = %llu;",
+       port_list);
   sql ("DELETE FROM port_ranges WHERE port_list = %llu;", port_list);
   sql ("DELETE FROM port_lists WHERE id = %llu;", port_list);
 
@@ -1806,6 +1811,10 @@ delete_port_range (const char *port_range_id, int dummy)
       return 2;
     }
 
+  sql ("DELETE FROM port_list_range_cache"
+       " WHERE port_list = (SELECT port_list FROM port_ranges"
+       "                    WHERE id = %llu);",
+       port_range);
   sql ("DELETE FROM port_ranges WHERE id = %llu;", port_range);
 
   sql_commit ();
@@ -2485,6 +2494,9 @@ inherit_port_lists (user_t user, user_t inheritor)
 void
 delete_port_lists_user (user_t user)
 {
+  sql ("DELETE FROM port_list_range_cache"
+       " WHERE port_list IN (SELECT id FROM port_lists WHERE owner = %llu);",
+       user);
   sql ("DELETE FROM port_ranges"
        " WHERE port_list IN (SELECT id FROM port_lists WHERE owner = %llu);",
        user);
@@ -2617,6 +2629,8 @@ update_port_list (port_list_t port_list, const gchar *name,
 
   /* Replace the preferences. */
 
+  sql ("DELETE FROM port_list_range_cache WHERE port_list = %llu;",
+       port_list);
   sql ("DELETE FROM port_ranges WHERE port_list = %llu;", port_list);
   ranges_sort_merge (ranges);
   array_terminate (ranges);
@@ -763,24 +763,26 @@ add_report_format_params (report_format_t report_format, array_t *params,
       quoted_param_value = sql_quote (param->value);
       quoted_param_fallback = sql_quote (param->fallback);
 
-      sql ("INSERT INTO report_format_params"
-           " (report_format, name, type, value, type_min, type_max, type_regex,"
-           "  fallback)"
-           " VALUES (%llu, '%s', %u, '%s', %lli, %lli, '', '%s');",
-           report_format,
-           quoted_param_name,
-           report_format_param_type_from_name (param->type),
-           quoted_param_value,
-           min,
-           max,
-           quoted_param_fallback);
+      param_rowid = sql_insert_id ("INSERT INTO report_format_params"
+                                   " (report_format, name, type, value,"
+                                   "  type_min, type_max, type_regex,"
+                                   "  fallback)"
+                                   " VALUES (%llu, '%s', %u, '%s', %lli, %lli,"
+                                   "  '', '%s')"
+                                   " RETURNING id;",
+                                   report_format,
+                                   quoted_param_name,
+                                   report_format_param_type_from_name
+                                    (param->type),
+                                   quoted_param_value,
+                                   min,
+                                   max,
+                                   quoted_param_fallback);
 
       g_free (quoted_param_name);
       g_free (quoted_param_value);
       g_free (quoted_param_fallback);
 
-      param_rowid = sql_last_insert_id ();
-
       {
         array_t *options;
         int option_index;
@@ -1128,25 +1130,28 @@ create_report_format_internal (int check_access, int may_exist, int active,
   quoted_signature = signature ? sql_quote (signature) : NULL;
   g_free (format_signature);
 
-  sql ("INSERT INTO report_formats"
-       " (uuid, name, owner, summary, description, extension, content_type,"
-       "  signature, trust, trust_time, flags, predefined, creation_time,"
-       "  modification_time)"
-       " VALUES ('%s', '%s',"
-       " (SELECT id FROM users WHERE users.uuid = '%s'),"
-       " '%s', '%s', '%s', '%s', '%s', %i, %i, %i, %i, m_now (), m_now ());",
-       new_uuid ? new_uuid : uuid,
-       quoted_name,
-       current_credentials.uuid,
-       quoted_summary ? quoted_summary : "",
-       quoted_description ? quoted_description : "",
-       quoted_extension ? quoted_extension : "",
-       quoted_content_type ? quoted_content_type : "",
-       quoted_signature ? quoted_signature : "",
-       format_trust,
-       time (NULL),
-       active ? REPORT_FORMAT_FLAG_ACTIVE : 0,
-       predefined ? 1 : 0);
+  report_format_rowid
+    = sql_insert_id ("INSERT INTO report_formats"
+                     " (uuid, name, owner, summary, description, extension,"
+                     "  content_type, signature, trust, trust_time, flags,"
+                     "  predefined, creation_time, modification_time)"
+                     " VALUES ('%s', '%s',"
+                     " (SELECT id FROM users WHERE users.uuid = '%s'),"
+                     " '%s', '%s', '%s', '%s', '%s', %i, %i, %i, %i, m_now (),"
+                     " m_now ())"
+                     " RETURNING id;",
+                     new_uuid ? new_uuid : uuid,
+                     quoted_name,
+                     current_credentials.uuid,
+                     quoted_summary ? quoted_summary : "",
+                     quoted_description ? quoted_description : "",
+                     quoted_extension ? quoted_extension : "",
+                     quoted_content_type ? quoted_content_type : "",
+                     quoted_signature ? quoted_signature : "",
+                     format_trust,
+                     time (NULL),
+                     active ? REPORT_FORMAT_FLAG_ACTIVE : 0,
+                     predefined ? 1 : 0);
 
   g_free (new_uuid);
   g_free (quoted_summary);
@@ -1158,7 +1163,6 @@ create_report_format_internal (int check_access, int may_exist, int active,
 
   /* Add params to database. */
 
-  report_format_rowid = sql_last_insert_id ();
   ret = add_report_format_params (report_format_rowid, params, params_options);
   if (ret)
     {
@@ -3842,37 +3846,24 @@ run_report_format_script (gchar *report_format_id,
 }
 
 /**
- * @brief Completes a report by adding report format info.
+ * @brief Print the closing part of a report to a stream.
  *
- * @param[in]   xml_start      Path of file containing start of report.
- * @param[in]   xml_full       Path to file to print full report to.
+ * This is the report format info and the closing report tag, which
+ * \ref print_report_xml_end appends to the file written by
+ * print_report_xml_start.
+ *
+ * On error the stream is closed.
+ *
+ * @param[in]   out            Stream to print to.  Kept open on success.
  * @param[in]   report_format  Format of report that will be created from XML.
  * @param[in]   report_config  Report config for report format param.
  *
  * @return 0 success, -1 error.
  */
 int
-print_report_xml_end (gchar *xml_start, gchar *xml_full,
-                      report_format_t report_format,
-                      report_config_t report_config)
+print_report_xml_close (FILE *out, report_format_t report_format,
+                        report_config_t report_config)
 {
-  FILE *out;
-
-  if (gvm_file_copy (xml_start, xml_full) == FALSE)
-    {
-      g_warning ("%s: failed to copy xml_start file", __func__);
-      return -1;
-    }
-
-  out = fopen (xml_full, "a");
-  if (out == NULL)
-    {
-      g_warning ("%s: fopen failed: %s",
-                 __func__,
-                 strerror (errno));
-      return -1;
-    }
-
   /* A bit messy having report XML here, but simplest for now. */
 
   if (report_format > 0)
@@ -3918,6 +3909,44 @@ print_report_xml_end (gchar *xml_start, gchar *xml_full,
 
   PRINT (out, "</report>");
 
+  return 0;
+}
+
+/**
+ * @brief Completes a report by adding report format info.
+ *
+ * @param[in]   xml_start      Path of file containing start of report.
+ * @param[in]   xml_full       Path to file to print full report to.
+ * @param[in]   report_format  Format of report that will be created from XML.
+ * @param[in]   report_config  Report config for report format param.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+print_report_xml_end (gchar *xml_start, gchar *xml_full,
+                      report_format_t report_format,
+                      report_config_t report_config)
+{
+  FILE *out;
+
+  if (gvm_file_copy (xml_start, xml_full) == FALSE)
+    {
+      g_warning ("%s: failed to copy xml_start file", __func__);
+      return -1;
+    }
+
+  out = fopen (xml_full, "a");
+  if (out == NULL)
+    {
+      g_warning ("%s: fopen failed: %s",
+                 __func__,
+                 strerror (errno));
+      return -1;
+    }
+
+  if (print_report_xml_close (out, report_format, report_config))
+    return -1;
+
   if (fclose (out))
     {
       g_warning ("%s: fclose failed: %s",
@@ -23,6 +23,7 @@
 #include "manage_sql.h"
 
 #include <glib.h>
+#include <stdio.h>
 
 gboolean
 lookup_report_format (const char*, report_format_t*);
@@ -88,6 +89,9 @@ check_db_report_formats ();
 int
 check_db_report_formats_trash ();
 
+int
+print_report_xml_close (FILE *, report_format_t, report_config_t);
+
 int
 print_report_xml_end (gchar *, gchar *, report_format_t, report_config_t);
 
@@ -46,6 +46,7 @@
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include <cjson/cJSON.h>
@@ -76,11 +77,44 @@
  */
 static int secinfo_commit_size = SECINFO_COMMIT_SIZE_DEFAULT;
 
+/**
+ * @brief Number of worker processes for the SCAP update.
+ */
+static int secinfo_parallel_workers = SECINFO_PARALLEL_WORKERS_DEFAULT;
+
+/**
+ * @brief Cutoff time for incremental SCAP updates.
+ *
+ * While non-zero the SCAP update works in place on a copy of the old
+ * SCAP schema, and feed records modified before this time are skipped.
+ */
+static time_t scap_incremental_cutoff = 0;
+
 /**
  * @brief Maximum number of rows in a EPSS INSERT.
  */
 #define EPSS_MAX_CHUNK_SIZE 10000
 
+/**
+ * @brief Exit status of a CERT worker process whose shard updated anything.
+ */
+#define CERT_WORKER_EXIT_UPDATED 2
+
+/**
+ * @brief Number of flushes during which the SQL buffer threshold is tuned.
+ */
+#define INSERTS_ADAPT_FLUSHES 8
+
+/**
+ * @brief Lower bound of the adaptive SQL buffer threshold, in bytes.
+ */
+#define INSERTS_MIN_STATEMENTS_SIZE 1048576
+
+/**
+ * @brief Upper bound of the adaptive SQL buffer threshold, in bytes.
+ */
+#define INSERTS_MAX_STATEMENTS_SIZE (64 * 1048576)
+
 
 /* Headers. */
 
@@ -93,6 +127,9 @@ manage_db_init (const gchar *);
 int
 manage_db_init_indexes (const gchar *);
 
+int
+manage_db_copy (const gchar *);
+
 int
 manage_db_add_constraints (const gchar *);
 
@@ -102,6 +139,9 @@ sync_cert ();
 static int
 update_scap (gboolean);
 
+static int
+update_scap_tables ();
+
 
 /* Helpers. */
 
@@ -195,6 +235,49 @@ increment_transaction_size (int* current_size)
     }
 }
 
+/**
+ * @brief Record that a phase of the SCAP update completed, in scap2.meta.
+ *
+ * The records let an update that was interrupted, for example by a daemon
+ * or database restart, resume at the last completed phase instead of
+ * rebuilding from scratch.
+ *
+ * @param[in]  phase  Name of the phase, e.g. "cpes" or a CVE file name.
+ */
+static void
+set_scap_checkpoint (const gchar *phase)
+{
+  gchar *quoted_phase;
+
+  quoted_phase = sql_quote (phase);
+  sql ("INSERT INTO scap2.meta (name, value)"
+       " VALUES ('checkpoint:%s', '1')"
+       " ON CONFLICT (name) DO UPDATE SET value = '1';",
+       quoted_phase);
+  g_free (quoted_phase);
+}
+
+/**
+ * @brief Check whether a phase of the SCAP update already completed.
+ *
+ * @param[in]  phase  Name of the phase, e.g. "cpes" or a CVE file name.
+ *
+ * @return 1 if the phase completed in an earlier, interrupted update, else 0.
+ */
+static int
+scap_checkpoint_reached (const gchar *phase)
+{
+  gchar *quoted_phase;
+  int ret;
+
+  quoted_phase = sql_quote (phase);
+  ret = sql_int ("SELECT EXISTS (SELECT * FROM scap2.meta"
+                 "               WHERE name = 'checkpoint:%s');",
+                 quoted_phase);
+  g_free (quoted_phase);
+  return ret;
+}
+
 /* Helper: buffer structure for INSERTs. */
 
 /**
@@ -225,6 +308,13 @@ typedef struct
   int max_chunk_size;      ///< Max number of rows per INSERT.
   gchar *open_sql;         ///< SQL to open each statement.
   gchar *close_sql;        ///< SQL to close each statement.
+  gchar *name;             ///< Name of the target table, for logging.
+  int flush_rows;          ///< Number of rows added since the last flush.
+  int total_rows;          ///< Total number of rows added.
+  double total_time;       ///< Total time spent running statements.
+  double last_rate;        ///< Rows per second of the previous flush.
+  int adapt_flushes;       ///< Number of flushes left for threshold tuning.
+  int adapt_growing;       ///< Whether tuning is increasing the threshold.
 } inserts_t;
 
 static void
@@ -234,14 +324,16 @@ inserts_run (inserts_t *, gboolean);
  * @brief Check size of current statement.
  *
  * @param[in]  inserts         Insert buffer.
+ * @param[in]  name            Name of the target table, for logging.
  * @param[in]  max_chunk_size  Max chunk size per statement.
  * @param[in]  max_statements_size Automatically run at this statements size.
  * @param[in]  open_sql        SQL to to start each statement.
  * @param[in]  close_sql       SQL to append to the end of each statement.
  */
 static void
-inserts_init (inserts_t *inserts, int max_chunk_size, int max_statements_size,
-              const gchar *open_sql, const gchar *close_sql)
+inserts_init (inserts_t *inserts, const gchar *name, int max_chunk_size,
+              int max_statements_size, const gchar *open_sql,
+              const gchar *close_sql)
 {
   inserts->statements = make_array ();
   inserts->statement = NULL;
@@ -251,6 +343,13 @@ inserts_init (inserts_t *inserts, int max_chunk_size, int max_statements_size,
   inserts->max_chunk_size = max_chunk_size;
   inserts->open_sql = open_sql ? g_strdup (open_sql) : NULL;
   inserts->close_sql = close_sql ? g_strdup (close_sql) : NULL;
+  inserts->name = name ? g_strdup (name) : NULL;
+  inserts->flush_rows = 0;
+  inserts->total_rows = 0;
+  inserts->total_time = 0;
+  inserts->last_rate = 0;
+  inserts->adapt_flushes = max_statements_size ? INSERTS_ADAPT_FLUSHES : 0;
+  inserts->adapt_growing = 1;
 }
 
 /**
@@ -306,6 +405,9 @@ inserts_check_size (inserts_t *inserts)
       first = 1;
     }
 
+  inserts->flush_rows++;
+  inserts->total_rows++;
+
   return first;
 }
 
@@ -343,9 +445,58 @@ inserts_free (inserts_t *inserts)
   g_ptr_array_free (inserts->statements, TRUE);
   g_free (inserts->open_sql);
   g_free (inserts->close_sql);
+  g_free (inserts->name);
   bzero (inserts, sizeof (*inserts));
 }
 
+/**
+ * @brief Adapt the statements size threshold to the measured throughput.
+ *
+ * During the first flushes of an ingest the threshold is doubled or halved
+ * between flushes, keeping any change that improved the rows per second, so
+ * that the buffer converges on the fastest size for the host.
+ *
+ * @param[in]  inserts  Insert buffer.
+ * @param[in]  rows     Number of rows in the flush.
+ * @param[in]  elapsed  Time the flush took, in seconds.
+ */
+static void
+inserts_adapt_threshold (inserts_t *inserts, int rows, double elapsed)
+{
+  double rate;
+  int size;
+
+  if (inserts->adapt_flushes <= 0
+      || inserts->max_statements_size == 0
+      || rows == 0
+      || elapsed <= 0)
+    return;
+
+  inserts->adapt_flushes--;
+
+  rate = rows / elapsed;
+  if (inserts->last_rate > 0 && rate < inserts->last_rate)
+    /* Slower than the previous size, so try the other direction. */
+    inserts->adapt_growing = !inserts->adapt_growing;
+  inserts->last_rate = rate;
+
+  if (inserts->adapt_growing)
+    size = inserts->max_statements_size * 2;
+  else
+    size = inserts->max_statements_size / 2;
+
+  if (size < INSERTS_MIN_STATEMENTS_SIZE
+      || size > INSERTS_MAX_STATEMENTS_SIZE)
+    {
+      inserts->adapt_flushes = 0;
+      return;
+    }
+
+  inserts->max_statements_size = size;
+  g_debug ("%s: %s: flush threshold now %i bytes (%.0f rows/s)",
+           __func__, inserts->name ? inserts->name : "inserts", size, rate);
+}
+
 /**
  * @brief Run the INSERT SQL, freeing the buffers.
  *
@@ -356,6 +507,9 @@ static void
 inserts_run (inserts_t *inserts, gboolean finalize)
 {
   guint index;
+  gint64 started;
+  double elapsed;
+  int rows;
 
   if (inserts->statement)
     {
@@ -365,6 +519,8 @@ inserts_run (inserts_t *inserts, gboolean finalize)
       inserts->current_chunk_size = 0;
     }
 
+  started = g_get_monotonic_time ();
+
   for (index = 0; index < inserts->statements->len; index++)
     {
       GString *statement;
@@ -373,10 +529,25 @@ inserts_run (inserts_t *inserts, gboolean finalize)
       sql ("%s", statement->str);
     }
 
+  elapsed = (g_get_monotonic_time () - started) / 1000000.0;
+  rows = inserts->flush_rows;
+  inserts->total_time += elapsed;
+  inserts->flush_rows = 0;
+
   if (finalize)
-    inserts_free (inserts);
+    {
+      if (inserts->name && inserts->total_rows && inserts->total_time > 0)
+        g_info ("%s: %s: %i rows in %.1fs (%.0f rows/s)",
+                __func__, inserts->name, inserts->total_rows,
+                inserts->total_time,
+                inserts->total_rows / inserts->total_time);
+      inserts_free (inserts);
+    }
   else
-    inserts_free_statements (inserts);
+    {
+      inserts_adapt_threshold (inserts, rows, elapsed);
+      inserts_free_statements (inserts);
+    }
 }
 
 /**
@@ -602,9 +773,23 @@ DEF_ACCESS (cpe_info_iterator_cve_refs, GET_ITERATOR_COLUMN_COUNT + 3);
  */
 DEF_ACCESS (cpe_info_iterator_cpe_name_id, GET_ITERATOR_COLUMN_COUNT + 4);
 
+/**
+ * @brief Cache of rendered CPE details XML, keyed by CPE ID.
+ */
+static GHashTable *cpe_details_cache = NULL;
+
+/**
+ * @brief SCAP feed timestamp that the CPE details cache was filled from.
+ */
+static int cpe_details_cache_timestamp = -1;
+
 /**
  * @brief Get the XML details / raw data for a given CPE ID.
  *
+ * Details of popular CPEs are requested repeatedly, so the fragments are
+ * cached per process.  The cache is keyed on the SCAP feed timestamp and
+ * emptied when an update_scap swap changes the feed.
+ *
  * @param[in]  cpe_id  ID of the CPE to get the raw XML of.
  *
  * @return newly allocated XML details string
@@ -612,12 +797,35 @@ DEF_ACCESS (cpe_info_iterator_cpe_name_id, GET_ITERATOR_COLUMN_COUNT + 4);
 char *
 cpe_details_xml (const char *cpe_id) {
   gchar *quoted_cpe_id, *details_xml;
+  int scap_timestamp;
+
+  scap_timestamp = sql_int ("SELECT coalesce ((SELECT value FROM scap.meta"
+                            "                  WHERE name = 'last_update'),"
+                            "                 '0');");
+  if (cpe_details_cache == NULL
+      || scap_timestamp != cpe_details_cache_timestamp)
+    {
+      if (cpe_details_cache)
+        g_hash_table_remove_all (cpe_details_cache);
+      else
+        cpe_details_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   g_free, g_free);
+      cpe_details_cache_timestamp = scap_timestamp;
+    }
+
+  details_xml = g_hash_table_lookup (cpe_details_cache, cpe_id);
+  if (details_xml)
+    return g_strdup (details_xml);
+
   quoted_cpe_id = sql_quote (cpe_id);
   details_xml = sql_string ("SELECT details_xml"
                             " FROM scap.cpe_details"
                             " WHERE cpe_id = '%s'",
-                            cpe_id);
+                            quoted_cpe_id);
   g_free (quoted_cpe_id);
+  if (details_xml)
+    g_hash_table_insert (cpe_details_cache, g_strdup (cpe_id),
+                         g_strdup (details_xml));
   return details_xml;
 }
 
@@ -756,22 +964,52 @@ DEF_ACCESS (cve_iterator_name, 1);
  */
 DEF_ACCESS (cve_iterator_cvss_score, 2);
 
+/**
+ * @brief Cache of CVE severities for cve_cvss_base.
+ *
+ * Maps CVE-ID to the severity string, or to "" for CVEs that are not in
+ * the database, so repeated lookups of the same CVE do not query again.
+ */
+static GHashTable *cve_cvss_base_cache = NULL;
+
 /**
  * @brief Get the CVSS score for a CVE.
  *
+ * The score is cached for the lifetime of the process, so result
+ * buffering does a single query per distinct CVE instead of one per
+ * reference.
+ *
  * @param[in]  cve  CVE-ID of the CVE to get the score of.
  *
- * @return The CVSS score of the CVE.
+ * @return The CVSS score of the CVE.  Caller must free.
  */
 gchar *
 cve_cvss_base (const gchar *cve)
 {
-  gchar *quoted_cve, *ret;
+  gchar *quoted_cve, *severity;
+
+  if (cve_cvss_base_cache == NULL)
+    cve_cvss_base_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, g_free);
+  else
+    {
+      gpointer cached;
+
+      if (g_hash_table_lookup_extended (cve_cvss_base_cache, cve, NULL,
+                                        &cached))
+        return ((gchar *) cached)[0] ? g_strdup (cached) : NULL;
+    }
+
   quoted_cve = sql_quote (cve);
-  ret = sql_string ("SELECT severity FROM cves WHERE name = '%s'",
-                    quoted_cve);
+  severity = sql_string ("SELECT severity FROM cves WHERE name = '%s'",
+                         quoted_cve);
   g_free (quoted_cve);
-  return ret;
+
+  g_hash_table_insert (cve_cvss_base_cache,
+                       g_strdup (cve),
+                       severity ? g_strdup (severity) : g_strdup (""));
+
+  return severity;
 }
 
 /**
@@ -838,6 +1076,15 @@ init_cve_info_iterator (iterator_t* iterator, get_data_t *get, const char *name)
                            clause,
                            FALSE);
   g_free (clause);
+  if (ret == 0)
+    {
+      /* The EPSS columns are each read twice when sending a CVE, once to
+       * check for presence and once to print. */
+      iterator_typed_column (iterator, GET_ITERATOR_COLUMN_COUNT + 5,
+                             ITERATOR_COLUMN_DOUBLE);
+      iterator_typed_column (iterator, GET_ITERATOR_COLUMN_COUNT + 6,
+                             ITERATOR_COLUMN_DOUBLE);
+    }
   return ret;
 }
 
@@ -1588,7 +1835,7 @@ update_dfn_xml (const gchar *xml_path, int last_cert_update,
               quoted_refnum = sql_quote_element_text (refnum);
               quoted_title = sql_quote_element_text (title);
               quoted_summary = sql_quote_element_text (summary);
-              sql ("INSERT INTO cert.dfn_cert_advs"
+              sql ("INSERT INTO cert2.dfn_cert_advs"
                    " (uuid, name, comment, creation_time,"
                    "  modification_time, title, summary, cve_refs)"
                    " VALUES"
@@ -1639,10 +1886,10 @@ update_dfn_xml (const gchar *xml_path, int last_cert_update,
                               quoted_point = sql_quote (*point);
                               /* There's no primary key, so just INSERT, even
                                * for Postgres. */
-                              sql ("INSERT INTO dfn_cert_cves"
+                              sql ("INSERT INTO cert2.dfn_cert_cves"
                                    " (adv_id, cve_name)"
                                    " VALUES"
-                                   " ((SELECT id FROM dfn_cert_advs"
+                                   " ((SELECT id FROM cert2.dfn_cert_advs"
                                    "   WHERE name = '%s'),"
                                    "  '%s')",
                                    quoted_refnum,
@@ -1680,6 +1927,140 @@ update_dfn_xml (const gchar *xml_path, int last_cert_update,
   return -1;
 }
 
+/**
+ * @brief Update a shard of the CERT advisory files.
+ *
+ * @param[in]  files             Paths of the advisory files, relative to the
+ *                               feed directory.
+ * @param[in]  update_file       Function that updates a single file.
+ * @param[in]  offset            Index of the first file of the shard.
+ * @param[in]  step              Number of files to advance within the shard.
+ * @param[in]  last_cert_update  Time of last CERT update.
+ * @param[in]  last_update       Time of last update of the advisory type.
+ *
+ * @return 0 nothing to do, 1 updated, -1 error.
+ */
+static int
+update_cert_file_shard (GPtrArray *files,
+                        int (*update_file) (const gchar *, int, int),
+                        guint offset, guint step, int last_cert_update,
+                        int last_update)
+{
+  guint index;
+  int updated;
+
+  updated = 0;
+  for (index = offset; index < files->len; index += step)
+    switch (update_file (g_ptr_array_index (files, index), last_cert_update,
+                         last_update))
+      {
+        case 0:
+          break;
+        case 1:
+          updated = 1;
+          break;
+        default:
+          return -1;
+      }
+
+  return updated;
+}
+
+/**
+ * @brief Update CERT advisory files with a pool of worker processes.
+ *
+ * @param[in]  files             Paths of the advisory files, relative to the
+ *                               feed directory.
+ * @param[in]  update_file       Function that updates a single file.
+ * @param[in]  last_cert_update  Time of last CERT update.
+ * @param[in]  last_update       Time of last update of the advisory type.
+ *
+ * @return 0 nothing to do, 1 updated, -1 error.
+ */
+static int
+update_cert_files (GPtrArray *files,
+                   int (*update_file) (const gchar *, int, int),
+                   int last_cert_update, int last_update)
+{
+  int n_workers, worker, fail, updated;
+
+  n_workers = secinfo_parallel_workers;
+  if (n_workers > (int) files->len)
+    n_workers = files->len;
+
+  g_info ("Updating CERT advisories with %i worker processes", n_workers);
+
+  fail = 0;
+  for (worker = 0; worker < n_workers; worker++)
+    {
+      pid_t pid;
+
+      pid = fork_with_handlers ();
+      switch (pid)
+        {
+          case 0:
+            /* Child.  Reopen the database (required after fork) and
+             * process every n_workers'th file, starting at worker. */
+            init_sentry ();
+            cleanup_manage_process (FALSE);
+            reinit_manage_process ();
+            manage_session_init (current_credentials.uuid);
+            setproctitle ("Syncing CERT (worker %i)", worker);
+
+            switch (update_cert_file_shard (files, update_file, worker,
+                                            n_workers, last_cert_update,
+                                            last_update))
+              {
+                case 0:
+                  gvm_close_sentry ();
+                  exit (EXIT_SUCCESS);
+                case 1:
+                  gvm_close_sentry ();
+                  exit (CERT_WORKER_EXIT_UPDATED);
+                default:
+                  gvm_close_sentry ();
+                  exit (EXIT_FAILURE);
+              }
+
+          case -1:
+            /* The files of this shard will not be processed by anyone. */
+            g_warning ("%s: fork failed", __func__);
+            fail = 1;
+            break;
+
+          default:
+            break;
+        }
+    }
+
+  updated = 0;
+  while (1)
+    {
+      int status;
+      pid_t pid;
+
+      pid = waitpid (-1, &status, 0);
+      if (pid == -1)
+        {
+          if (errno == ECHILD)
+            break;
+          if (errno == EINTR)
+            continue;
+          g_warning ("%s: waitpid: %s", __func__, strerror (errno));
+          fail = 1;
+          break;
+        }
+      if (WIFSIGNALED (status))
+        fail = 1;
+      else if (WIFEXITED (status) && WEXITSTATUS (status) == CERT_WORKER_EXIT_UPDATED)
+        updated = 1;
+      else if (WIFEXITED (status) && WEXITSTATUS (status) != EXIT_SUCCESS)
+        fail = 1;
+    }
+
+  return fail ? -1 : updated;
+}
+
 /**
  * @brief Update DFN-CERTs.
  *
@@ -1708,27 +2089,50 @@ update_dfn_cert_advisories (int last_cert_update)
     }
 
   last_dfn_update = sql_int ("SELECT max (modification_time)"
-                             " FROM cert.dfn_cert_advs;");
+                             " FROM cert2.dfn_cert_advs;");
 
   g_debug ("%s: VS: " GVM_CERT_DATA_DIR "/dfn-cert-*.xml", __func__);
   count = 0;
   updated_dfn_cert = 0;
-  while ((xml_path = g_dir_read_name (dir)))
-    if (fnmatch ("dfn-cert-*.xml", xml_path, 0) == 0)
-      {
-        switch (update_dfn_xml (xml_path, last_cert_update, last_dfn_update))
-          {
-            case 0:
-              break;
-            case 1:
-              updated_dfn_cert = 1;
-              break;
-            default:
-              g_dir_close (dir);
-              return -1;
-          }
-        count++;
-      }
+  if (secinfo_parallel_workers > 1)
+    {
+      GPtrArray *files;
+
+      files = g_ptr_array_new_with_free_func (g_free);
+      while ((xml_path = g_dir_read_name (dir)))
+        if (fnmatch ("dfn-cert-*.xml", xml_path, 0) == 0)
+          g_ptr_array_add (files, g_strdup (xml_path));
+      count = files->len;
+
+      if (count)
+        updated_dfn_cert = update_cert_files (files, update_dfn_xml,
+                                              last_cert_update,
+                                              last_dfn_update);
+      g_ptr_array_free (files, TRUE);
+      if (updated_dfn_cert == -1)
+        {
+          g_dir_close (dir);
+          return -1;
+        }
+    }
+  else
+    while ((xml_path = g_dir_read_name (dir)))
+      if (fnmatch ("dfn-cert-*.xml", xml_path, 0) == 0)
+        {
+          switch (update_dfn_xml (xml_path, last_cert_update,
+                                  last_dfn_update))
+            {
+              case 0:
+                break;
+              case 1:
+                updated_dfn_cert = 1;
+                break;
+              default:
+                g_dir_close (dir);
+                return -1;
+            }
+          count++;
+        }
 
   if (count == 0)
     g_warning ("No DFN-CERT advisories found in %s", GVM_CERT_DATA_DIR);
@@ -1884,7 +2288,7 @@ update_bund_xml (const gchar *xml_path, int last_cert_update,
               quoted_title = sql_quote_element_text (title);
               quoted_summary = sql_quote (summary->str);
               g_string_free (summary, TRUE);
-              sql ("INSERT INTO cert.cert_bund_advs"
+              sql ("INSERT INTO cert2.cert_bund_advs"
                    " (uuid, name, comment, creation_time,"
                    "  modification_time, title, summary, cve_refs)"
                    " VALUES"
@@ -1926,10 +2330,10 @@ update_bund_xml (const gchar *xml_path, int last_cert_update,
                               quoted_cve = sql_quote (cve_text);
                               /* There's no primary key, so just INSERT, even
                                * for Postgres. */
-                              sql ("INSERT INTO cert_bund_cves"
+                              sql ("INSERT INTO cert2.cert_bund_cves"
                                    " (adv_id, cve_name)"
                                    " VALUES"
-                                   " ((SELECT id FROM cert_bund_advs"
+                                   " ((SELECT id FROM cert2.cert_bund_advs"
                                    "   WHERE name = '%s'),"
                                    "  '%s')",
                                    quoted_refnum,
@@ -1992,26 +2396,49 @@ update_cert_bund_advisories (int last_cert_update)
     }
 
   last_bund_update = sql_int ("SELECT max (modification_time)"
-                              " FROM cert.cert_bund_advs;");
+                              " FROM cert2.cert_bund_advs;");
 
   count = 0;
   updated_cert_bund = 0;
-  while ((xml_path = g_dir_read_name (dir)))
-    if (fnmatch ("CB-K*.xml", xml_path, 0) == 0)
-      {
-        switch (update_bund_xml (xml_path, last_cert_update, last_bund_update))
-          {
-            case 0:
-              break;
-            case 1:
-              updated_cert_bund = 1;
-              break;
-            default:
-              g_dir_close (dir);
-              return -1;
-          }
-        count++;
-      }
+  if (secinfo_parallel_workers > 1)
+    {
+      GPtrArray *files;
+
+      files = g_ptr_array_new_with_free_func (g_free);
+      while ((xml_path = g_dir_read_name (dir)))
+        if (fnmatch ("CB-K*.xml", xml_path, 0) == 0)
+          g_ptr_array_add (files, g_strdup (xml_path));
+      count = files->len;
+
+      if (count)
+        updated_cert_bund = update_cert_files (files, update_bund_xml,
+                                               last_cert_update,
+                                               last_bund_update);
+      g_ptr_array_free (files, TRUE);
+      if (updated_cert_bund == -1)
+        {
+          g_dir_close (dir);
+          return -1;
+        }
+    }
+  else
+    while ((xml_path = g_dir_read_name (dir)))
+      if (fnmatch ("CB-K*.xml", xml_path, 0) == 0)
+        {
+          switch (update_bund_xml (xml_path, last_cert_update,
+                                   last_bund_update))
+            {
+              case 0:
+                break;
+              case 1:
+                updated_cert_bund = 1;
+                break;
+              default:
+                g_dir_close (dir);
+                return -1;
+            }
+          count++;
+        }
 
   if (count == 0)
     g_warning ("No CERT-Bund advisories found in %s", GVM_CERT_DATA_DIR);
@@ -2024,16 +2451,16 @@ update_cert_bund_advisories (int last_cert_update)
 /* SCAP update: CPEs. */
 
 /**
- * @brief Convert a CPE name from formatted string to URI and SQL quote it.
+ * @brief Convert a CPE name from formatted string to URI.
  *
  * @param[in]  name  Name.
  *
- * @return URI converted uoted name.
+ * @return URI converted name.
  */
 static gchar *
-fs_to_uri_convert_and_quote_cpe_name (const char *name)
+fs_to_uri_convert_cpe_name (const char *name)
 {
-  gchar *name_converted, *name_decoded, *name_tilde, *quoted_name;
+  gchar *name_converted, *name_decoded, *name_tilde;
 
   name_converted = fs_cpe_to_uri_cpe (name);
   name_decoded = g_uri_unescape_string (name_converted, NULL);
@@ -2041,11 +2468,45 @@ fs_to_uri_convert_and_quote_cpe_name (const char *name)
                                "~", "%7E", "%7e", NULL);
   g_free (name_decoded);
   g_free (name_converted);
+  return name_tilde;
+}
+
+/**
+ * @brief Convert a CPE name from formatted string to URI and SQL quote it.
+ *
+ * @param[in]  name  Name.
+ *
+ * @return URI converted uoted name.
+ */
+static gchar *
+fs_to_uri_convert_and_quote_cpe_name (const char *name)
+{
+  gchar *name_tilde, *quoted_name;
+
+  name_tilde = fs_to_uri_convert_cpe_name (name);
   quoted_name = sql_quote (name_tilde);
   g_free (name_tilde);
   return quoted_name;
 }
 
+/**
+ * @brief Convert a CPE name from formatted string to URI and COPY escape it.
+ *
+ * @param[in]  name  Name.
+ *
+ * @return URI converted, COPY escaped name.
+ */
+static gchar *
+fs_to_uri_convert_and_copy_escape_cpe_name (const char *name)
+{
+  gchar *name_tilde, *escaped_name;
+
+  name_tilde = fs_to_uri_convert_cpe_name (name);
+  escaped_name = sql_copy_escape (name_tilde);
+  g_free (name_tilde);
+  return escaped_name;
+}
+
 /**
  * @brief Decode and SQL quote a CPE name.
  *
@@ -2317,6 +2778,10 @@ handle_json_cpe_item (inserts_t *inserts, inserts_t *deprecated_by_inserts,
     }
   modification_time = parse_iso_time (last_modified);
 
+  if (scap_incremental_cutoff && modification_time < scap_incremental_cutoff)
+    /* CPE not modified since the last update. */
+    return 0;
+
   titles = cJSON_GetObjectItemCaseSensitive (cpe_item, "titles");
   if (! cJSON_IsArray (titles))
     {
@@ -2343,6 +2808,12 @@ handle_json_cpe_item (inserts_t *inserts, inserts_t *deprecated_by_inserts,
     }
 
   quoted_name = fs_to_uri_convert_and_quote_cpe_name (name);
+
+  if (scap_incremental_cutoff)
+    /* Remove the old deprecation entries of the updated CPE. */
+    sql ("DELETE FROM scap2.cpes_deprecated_by WHERE cpe = '%s';",
+         quoted_name);
+
   if (deprecated)
     {
       cJSON *deprecated_by_array, *deprecated_by_item;
@@ -2450,6 +2921,17 @@ handle_json_cpe_refs (inserts_t *inserts, cJSON *product_item)
       return -1;
     }
 
+  if (scap_incremental_cutoff)
+    {
+      char *last_modified;
+
+      last_modified = json_object_item_string (cpe_item, "lastModified");
+      if (last_modified
+          && parse_iso_time (last_modified) < scap_incremental_cutoff)
+        /* CPE not modified since the last update. */
+        return 0;
+    }
+
   refs = cJSON_GetObjectItemCaseSensitive (cpe_item, "refs");
   if (! cJSON_IsArray (refs))
     {
@@ -2458,6 +2940,13 @@ handle_json_cpe_refs (inserts_t *inserts, cJSON *product_item)
     }
 
   quoted_name = fs_to_uri_convert_and_quote_cpe_name (name);
+
+  if (scap_incremental_cutoff)
+    /* Remove the old references of the updated CPE. */
+    sql ("DELETE FROM scap2.cpe_refs"
+         " WHERE cpe = (SELECT id FROM scap2.cpes WHERE name = '%s');",
+         quoted_name);
+
   cJSON_ArrayForEach (refs_item, refs)
     {
       int first;
@@ -2539,6 +3028,7 @@ update_scap_cpes_from_json_file (const gchar *path)
 
   sql_begin_immediate ();
   inserts_init (&inserts,
+                "scap2.cpes",
                 CPE_MAX_CHUNK_SIZE,
                 setting_secinfo_sql_buffer_threshold_bytes (),
                 "INSERT INTO scap2.cpes"
@@ -2554,7 +3044,8 @@ update_scap_cpes_from_json_file (const gchar *path)
                 "     deprecated = EXCLUDED.deprecated,"
                 "     cpe_name_id = EXCLUDED.cpe_name_id");
 
-  inserts_init (&deprecated_by_inserts, 10,
+  inserts_init (&deprecated_by_inserts,
+                "scap2.cpes_deprecated_by", 10,
                 setting_secinfo_sql_buffer_threshold_bytes (),
                 "INSERT INTO scap2.cpes_deprecated_by (cpe, deprecated_by)"
                 " VALUES ",
@@ -2621,7 +3112,8 @@ update_scap_cpes_from_json_file (const gchar *path)
     }
 
   sql_begin_immediate ();
-  inserts_init (&inserts, 10,
+  inserts_init (&inserts,
+                "scap2.cpe_refs", 10,
                 setting_secinfo_sql_buffer_threshold_bytes (),
                 "INSERT INTO scap2.cpe_refs (cpe, ref, type)"
                 " SELECT scap2.cpes.id, new_refs.ref, new_refs.type"
@@ -2705,6 +3197,7 @@ update_scap_cpes_from_xml_file (const gchar *path)
   sql_begin_immediate ();
 
   inserts_init (&inserts,
+                "scap2.cpes",
                 CPE_MAX_CHUNK_SIZE,
                 setting_secinfo_sql_buffer_threshold_bytes (),
                 "INSERT INTO scap2.cpes"
@@ -2796,6 +3289,7 @@ update_scap_cpes_from_xml_file (const gchar *path)
 
   // Extract and save details XML.
   inserts_init (&inserts,
+                "scap2.cpe_details",
                 CPE_MAX_CHUNK_SIZE,
                 setting_secinfo_sql_buffer_threshold_bytes (),
                 "INSERT INTO scap2.cpe_details"
@@ -3572,6 +4066,10 @@ handle_json_cve_item (cJSON *item)
     }
   modified_time = parse_iso_time (modified);
 
+  if (scap_incremental_cutoff && modified_time < scap_incremental_cutoff)
+    /* CVE not modified since the last update. */
+    return 0;
+
   cJSON *metrics_json;
   cJSON *cvss_metric_array;
 
@@ -3700,6 +4198,21 @@ handle_json_cve_item (cJSON *item)
 
   g_free (quoted_description);
 
+  if (scap_incremental_cutoff)
+    {
+      /* Remove the old dependent rows of the updated CVE. */
+      sql ("DELETE FROM scap2.cpe_nodes_match_criteria"
+           " WHERE node_id IN (SELECT id FROM scap2.cpe_match_nodes"
+           "                   WHERE cve_id = %llu);",
+           cve_db_id);
+      sql ("DELETE FROM scap2.cpe_match_nodes WHERE cve_id = %llu;",
+           cve_db_id);
+      sql ("DELETE FROM scap2.cve_references WHERE cve_id = %llu;",
+           cve_db_id);
+      sql ("DELETE FROM scap2.affected_products WHERE cve = %llu;",
+           cve_db_id);
+    }
+
   cJSON *configurations_array;
   configurations_array = cJSON_GetObjectItemCaseSensitive (cve_json,
                                                            "configurations");
@@ -3962,6 +4475,131 @@ update_cve_xml (const gchar *xml_path, GHashTable *hashed_cpes)
   return -1;
 }
 
+/**
+ * @brief Update CVE info from a shard of the JSON feed files.
+ *
+ * @param[in]  cve_files    CVE feed file names.
+ * @param[in]  offset       Index of the first file of the shard.
+ * @param[in]  step         Distance between the files of the shard.
+ * @param[in]  hashed_cpes  Hashed CPEs.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+update_cve_files (GPtrArray *cve_files, guint offset, guint step,
+                  GHashTable *hashed_cpes)
+{
+  guint index;
+
+  for (index = offset; index < cve_files->len; index += step)
+    {
+      const gchar *cve_path;
+
+      cve_path = g_ptr_array_index (cve_files, index);
+      if (scap_checkpoint_reached (cve_path))
+        {
+          g_info ("Skipping %s, done in interrupted update", cve_path);
+          continue;
+        }
+      if (update_cve_json (cve_path, hashed_cpes))
+        return -1;
+      set_scap_checkpoint (cve_path);
+    }
+
+  return 0;
+}
+
+/**
+ * @brief Update SCAP CVEs with multiple worker processes.
+ *
+ * The feed files are sharded across the workers.  Each worker inherits
+ * the CPE lookup table from the fork, opens its own database connection
+ * and commits its inserts into the scap2 schema independently of the
+ * others.  The schema swap stays with the caller.
+ *
+ * @param[in]  cve_files    CVE feed file names.
+ * @param[in]  hashed_cpes  Hashed CPEs.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+update_scap_cves_parallel (GPtrArray *cve_files, GHashTable *hashed_cpes)
+{
+  int n_workers, worker, fail;
+
+  if (cve_files->len == 0)
+    {
+      g_warning ("No CVEs found in %s", GVM_SCAP_DATA_DIR);
+      return 0;
+    }
+
+  n_workers = secinfo_parallel_workers;
+  if (n_workers > (int) cve_files->len)
+    n_workers = cve_files->len;
+
+  g_info ("Updating CVEs with %i worker processes", n_workers);
+
+  fail = 0;
+  for (worker = 0; worker < n_workers; worker++)
+    {
+      pid_t pid;
+
+      pid = fork_with_handlers ();
+      switch (pid)
+        {
+          case 0:
+            /* Child.  Reopen the database (required after fork) and
+             * process every n_workers'th file, starting at worker. */
+            init_sentry ();
+            cleanup_manage_process (FALSE);
+            reinit_manage_process ();
+            manage_session_init (current_credentials.uuid);
+            setproctitle ("Syncing SCAP: Updating CVEs (worker %i)", worker);
+
+            if (update_cve_files (cve_files, worker, n_workers, hashed_cpes))
+              {
+                gvm_close_sentry ();
+                exit (EXIT_FAILURE);
+              }
+
+            gvm_close_sentry ();
+            exit (EXIT_SUCCESS);
+
+          case -1:
+            /* The files of this shard will not be processed by anyone. */
+            g_warning ("%s: fork failed", __func__);
+            fail = 1;
+            break;
+
+          default:
+            break;
+        }
+    }
+
+  while (1)
+    {
+      int status;
+      pid_t pid;
+
+      pid = waitpid (-1, &status, 0);
+      if (pid == -1)
+        {
+          if (errno == ECHILD)
+            break;
+          if (errno == EINTR)
+            continue;
+          g_warning ("%s: waitpid: %s", __func__, strerror (errno));
+          fail = 1;
+          break;
+        }
+      if ((WIFEXITED (status) && WEXITSTATUS (status) != EXIT_SUCCESS)
+          || WIFSIGNALED (status))
+        fail = 1;
+    }
+
+  return fail ? -1 : 0;
+}
+
 /**
  * @brief Update SCAP CVEs.
  *
@@ -4008,6 +4646,26 @@ update_scap_cves ()
     }
   g_dir_rewind (dir);
 
+  if (read_json && secinfo_parallel_workers > 1)
+    {
+      int ret;
+      GPtrArray *cve_files;
+
+      cve_files = g_ptr_array_new_with_free_func (g_free);
+      while ((cve_path = g_dir_read_name (dir)))
+        if (fnmatch ("nvdcve-2.0-*.json.gz", cve_path, 0) == 0
+            || fnmatch ("nvdcve-2.0-*.json", cve_path, 0) == 0)
+          g_ptr_array_add (cve_files, g_strdup (cve_path));
+
+      ret = update_scap_cves_parallel (cve_files, hashed_cpes);
+
+      g_ptr_array_free (cve_files, TRUE);
+      g_dir_close (dir);
+      g_hash_table_destroy (hashed_cpes);
+      cleanup_iterator (&cpes);
+      return ret;
+    }
+
   count = 0;
   while ((cve_path = g_dir_read_name (dir)))
     {
@@ -4015,24 +4673,32 @@ update_scap_cves ()
            fnmatch ("nvdcve-2.0-*.json", cve_path, 0) == 0)
           && read_json)
         {
-          if (update_cve_json (cve_path, hashed_cpes))
+          if (scap_checkpoint_reached (cve_path))
+            g_info ("Skipping %s, done in interrupted update", cve_path);
+          else if (update_cve_json (cve_path, hashed_cpes))
             {
               g_dir_close (dir);
               g_hash_table_destroy (hashed_cpes);
               cleanup_iterator (&cpes);
               return -1;
             }
+          else
+            set_scap_checkpoint (cve_path);
           count++;
         }
       else if ((fnmatch ("nvdcve-2.0-*.xml", cve_path, 0) == 0) && !read_json)
         {
-          if (update_cve_xml (cve_path, hashed_cpes))
+          if (scap_checkpoint_reached (cve_path))
+            g_info ("Skipping %s, done in interrupted update", cve_path);
+          else if (update_cve_xml (cve_path, hashed_cpes))
             {
               g_dir_close (dir);
               g_hash_table_destroy (hashed_cpes);
               cleanup_iterator (&cpes);
               return -1;
             }
+          else
+            set_scap_checkpoint (cve_path);
           count++;
         }
     }
@@ -4064,20 +4730,22 @@ update_scap_affected_products ()
        "      AND scap2.cpe_nodes_match_criteria.vulnerable = 1"
        "      AND scap2.cpe_nodes_match_criteria.match_criteria_id ="
        "            scap2.cpe_matches.match_criteria_id"
-       "      AND scap2.cpe_matches.cpe_name_id = scap2.cpes.cpe_name_id;");
+       "      AND scap2.cpe_matches.cpe_name_id = scap2.cpes.cpe_name_id"
+       "    ON CONFLICT (cve, cpe) DO NOTHING;");
 }
 
 /**
  * @brief Insert a SCAP CPE match string from JSON.
  *
  * @param[in]  inserts          Pointer to SQL buffer for match string entries.
- * @param[in]  matches_inserts  Pointer to SQL buffer for match string matches.
+ * @param[in]  matches_buffer   Pointer to COPY buffer for match string matches.
  * @param[in]  match_string_item   JSON object from the matchStrings list.
  *
  * @return 0 success, -1 error.
  */
 static int
-handle_json_cpe_match_string (inserts_t *inserts, inserts_t *matches_inserts,
+handle_json_cpe_match_string (inserts_t *inserts,
+                              copy_buffer_t *matches_buffer,
                               cJSON *match_string_item)
 {
   cJSON *match_string, *matches_array;
@@ -4085,10 +4753,11 @@ handle_json_cpe_match_string (inserts_t *inserts, inserts_t *matches_inserts,
   gchar *quoted_version_start_incl, *quoted_version_start_excl;
   gchar *quoted_version_end_incl, *quoted_version_end_excl;
   gchar *quoted_criteria, *quoted_match_criteria_id;
+  gchar *escaped_match_criteria_id;
   int first;
 
   assert (inserts);
-  assert (matches_inserts);
+  assert (matches_buffer);
 
   match_string = cJSON_GetObjectItemCaseSensitive (match_string_item,
                                                    "matchString");
@@ -4122,6 +4791,17 @@ handle_json_cpe_match_string (inserts_t *inserts, inserts_t *matches_inserts,
       return -1;
     }
 
+  if (scap_incremental_cutoff)
+    {
+      char *last_modified;
+
+      last_modified = json_object_item_string (match_string, "lastModified");
+      if (last_modified
+          && parse_iso_time (last_modified) < scap_incremental_cutoff)
+        /* Match string not modified since the last update. */
+        return 0;
+    }
+
   ver_se = json_object_item_string (match_string, "versionStartIncluding");
   if (ver_se == NULL)
     quoted_version_start_incl = g_strdup ("NULL");
@@ -4149,6 +4829,12 @@ handle_json_cpe_match_string (inserts_t *inserts, inserts_t *matches_inserts,
   quoted_match_criteria_id = sql_quote (match_criteria_id);
   quoted_criteria = fs_to_uri_convert_and_quote_cpe_name (criteria);
 
+  if (scap_incremental_cutoff)
+    /* Remove the old matches of the updated match string, so the COPY
+     * below cannot collide with rows copied from the old schema. */
+    sql ("DELETE FROM scap2.cpe_matches WHERE match_criteria_id = '%s';",
+         quoted_match_criteria_id);
+
   first = inserts_check_size (inserts);
 
   g_string_append_printf (inserts->statement,
@@ -4175,16 +4861,18 @@ handle_json_cpe_match_string (inserts_t *inserts, inserts_t *matches_inserts,
   if (cJSON_IsArray (matches_array) && cJSON_GetArraySize (matches_array) > 0)
     {
       cJSON *match_item;
+      escaped_match_criteria_id = sql_copy_escape (match_criteria_id);
       cJSON_ArrayForEach (match_item, matches_array)
         {
           char *cpe_name_id, *cpe_name;
-          gchar *quoted_cpe_name_id, *quoted_cpe_name;
+          gchar *escaped_cpe_name_id, *escaped_cpe_name;
 
           cpe_name_id = json_object_item_string (match_item, "cpeNameId");
           if (cpe_name_id == NULL)
             {
               g_warning ("%s: 'cpeNameId' field missing or not a string",
                          __func__);
+              g_free (escaped_match_criteria_id);
               g_free (quoted_match_criteria_id);
               return -1;
             }
@@ -4194,27 +4882,32 @@ handle_json_cpe_match_string (inserts_t *inserts, inserts_t *matches_inserts,
             {
               g_warning ("%s: 'cpe_name' field missing or not a string",
                          __func__);
+              g_free (escaped_match_criteria_id);
               g_free (quoted_match_criteria_id);
               return -1;
             }
 
-          quoted_cpe_name_id = sql_quote (cpe_name_id);
-          quoted_cpe_name = fs_to_uri_convert_and_quote_cpe_name (cpe_name);
-
-          first = inserts_check_size (matches_inserts);
+          escaped_cpe_name_id = sql_copy_escape (cpe_name_id);
+          escaped_cpe_name = fs_to_uri_convert_and_copy_escape_cpe_name
+                              (cpe_name);
 
-          g_string_append_printf (matches_inserts->statement,
-                                "%s ('%s', '%s', '%s')",
-                                first ? "" : ",",
-                                quoted_match_criteria_id,
-                                quoted_cpe_name_id,
-                                quoted_cpe_name);
+          g_string_append_printf (matches_buffer->buffer,
+                                  "%s\t%s\t%s\n",
+                                  escaped_match_criteria_id,
+                                  escaped_cpe_name_id,
+                                  escaped_cpe_name);
 
-          matches_inserts->current_chunk_size++;
+          g_free (escaped_cpe_name_id);
+          g_free (escaped_cpe_name);
 
-          g_free (quoted_cpe_name_id);
-          g_free (quoted_cpe_name);
+          if (copy_buffer_check_size (matches_buffer))
+            {
+              g_free (escaped_match_criteria_id);
+              g_free (quoted_match_criteria_id);
+              return -1;
+            }
         }
+      g_free (escaped_match_criteria_id);
     }
 
   g_free (quoted_match_criteria_id);
@@ -4233,7 +4926,8 @@ update_scap_cpe_match_strings ()
   FILE *cpe_match_strings_file;
   gvm_json_pull_event_t event;
   gvm_json_pull_parser_t parser;
-  inserts_t inserts, matches_inserts;
+  inserts_t inserts;
+  copy_buffer_t matches_buffer;
 
   current_json_path = g_build_filename (GVM_SCAP_DATA_DIR,
                                         "cpe_match_strings.json.gz",
@@ -4322,6 +5016,7 @@ update_scap_cpe_match_strings ()
 
       sql_begin_immediate ();
       inserts_init (&inserts,
+                "scap2.cpe_match_strings",
                 CPE_MAX_CHUNK_SIZE,
                 setting_secinfo_sql_buffer_threshold_bytes (),
                 "INSERT INTO scap2.cpe_match_strings"
@@ -4337,12 +5032,11 @@ update_scap_cpe_match_strings ()
                 "     version_end_excl = EXCLUDED.version_end_excl,"
                 "     status = EXCLUDED.status");
 
-      inserts_init (&matches_inserts, 10,
+      copy_buffer_init (&matches_buffer,
                 setting_secinfo_sql_buffer_threshold_bytes (),
-                "INSERT INTO scap2.cpe_matches" 
+                "COPY scap2.cpe_matches"
                 "  (match_criteria_id, cpe_name_id, cpe_name)"
-                "  VALUES ",              
-                "");
+                "  FROM STDIN");
 
       gvm_json_pull_parser_next (&parser, &event);
       while (event.type == GVM_JSON_PULL_EVENT_OBJECT_START)
@@ -4356,7 +5050,7 @@ update_scap_cpe_match_strings ()
                          __func__, error_message);
               cJSON_Delete (cpe_match_string_item);
               inserts_free (&inserts);
-              inserts_free (&matches_inserts);
+              copy_buffer_free (&matches_buffer);
               sql_commit ();
               g_warning ("Update of CPE match strings failed");
               gvm_json_pull_event_cleanup (&event);
@@ -4365,12 +5059,12 @@ update_scap_cpe_match_strings ()
               return -1;
             }
           if (handle_json_cpe_match_string (&inserts,
-                                            &matches_inserts,
+                                            &matches_buffer,
                                             cpe_match_string_item))
             {
               cJSON_Delete (cpe_match_string_item);
               inserts_free (&inserts);
-              inserts_free (&matches_inserts);
+              copy_buffer_free (&matches_buffer);
               sql_commit ();
               g_warning ("Update of CPE match strings failed");
               gvm_json_pull_event_cleanup (&event);
@@ -4401,7 +5095,15 @@ update_scap_cpe_match_strings ()
     }
 
   inserts_run (&inserts, TRUE);
-  inserts_run (&matches_inserts, TRUE);
+  if (copy_buffer_run (&matches_buffer, TRUE))
+    {
+      sql_commit ();
+      g_warning ("Update of CPE match strings failed");
+      gvm_json_pull_event_cleanup (&event);
+      gvm_json_pull_parser_cleanup (&parser);
+      fclose (cpe_match_strings_file);
+      return -1;
+    }
   sql_commit ();
   gvm_json_pull_event_cleanup (&event);
   gvm_json_pull_parser_cleanup (&parser);
@@ -4436,15 +5138,6 @@ insert_epss_score_entry (inserts_t *inserts, const char *cve,
   inserts->current_chunk_size++;
 }
 
-/**
- * @brief Checks a failure condition for validating EPSS JSON.
- */
-#define EPSS_JSON_FAIL_IF(failure_condition, error_message)       \
-if (failure_condition) {                                          \
-  g_warning ("%s: %s", __func__, error_message);                  \
-  goto fail_insert;                                                 \
-}
-
 /**
  * @brief Updates the base EPSS scores table in the SCAP database.
  * 
@@ -4454,9 +5147,7 @@ static int
 update_epss_scores ()
 {
   gchar *current_json_path;
-  gchar *error_message = NULL;
   FILE *epss_scores_file;
-  cJSON *epss_entry;
   gvm_json_pull_event_t event;
   gvm_json_pull_parser_t parser;
   inserts_t inserts;
@@ -4545,7 +5236,14 @@ update_epss_scores ()
         }
 
       sql_begin_immediate ();
+
+      if (scap_incremental_cutoff)
+        /* The scores file has no per-entry timestamps and scores shift
+         * daily, so always reload the whole table. */
+        sql ("DELETE FROM scap2.epss_scores;");
+
       inserts_init (&inserts,
+                "scap2.epss_scores",
                 EPSS_MAX_CHUNK_SIZE,
                 setting_secinfo_sql_buffer_threshold_bytes (),
                 "INSERT INTO scap2.epss_scores"
@@ -4556,46 +5254,101 @@ update_epss_scores ()
       gvm_json_pull_parser_next (&parser, &event);
       while (event.type == GVM_JSON_PULL_EVENT_OBJECT_START)
         {
-          cJSON *cve_json, *epss_json, *percentile_json;
-
-          epss_entry = gvm_json_pull_expand_container (&parser, &error_message);
+          gchar *cve = NULL;
+          double epss = 0.0, percentile = 0.0;
+          gboolean has_epss = FALSE, has_percentile = FALSE;
+          int depth = 0;
 
-          if (error_message)
+          /* Read the flat score entry straight from the parser events,
+           * without building a cJSON tree for it. */
+          gvm_json_pull_parser_next (&parser, &event);
+          while (event.type != GVM_JSON_PULL_EVENT_OBJECT_END || depth > 0)
             {
-              g_warning ("%s: Error expanding EPSS item: %s", __func__, error_message);
-              g_free (error_message);
-              goto fail_insert;
-            }
-
-          cve_json = cJSON_GetObjectItemCaseSensitive (epss_entry, "cve");
-          epss_json = cJSON_GetObjectItemCaseSensitive (epss_entry, "epss");
-          percentile_json = cJSON_GetObjectItemCaseSensitive (epss_entry, "percentile");
-
-          EPSS_JSON_FAIL_IF (cve_json == NULL,
-                            "Item missing mandatory 'cve' field");
-
-          EPSS_JSON_FAIL_IF (epss_json == NULL,
-                            "Item missing mandatory 'epss' field");
+              gvm_json_path_elem_t *path_tail;
 
-          EPSS_JSON_FAIL_IF (percentile_json == NULL,
-                            "Item missing mandatory 'percentile' field");
+              if (event.type == GVM_JSON_PULL_EVENT_ERROR)
+                {
+                  g_warning ("%s: Parser error: %s", __func__,
+                             event.error_message);
+                  g_free (cve);
+                  goto fail_insert;
+                }
 
-          EPSS_JSON_FAIL_IF (! cJSON_IsString (cve_json),
-                            "Field 'cve' in item is not a string");
+              if (event.type == GVM_JSON_PULL_EVENT_OBJECT_START
+                  || event.type == GVM_JSON_PULL_EVENT_ARRAY_START)
+                depth++;
+              else if (event.type == GVM_JSON_PULL_EVENT_OBJECT_END
+                       || event.type == GVM_JSON_PULL_EVENT_ARRAY_END)
+                depth--;
+              else if (depth == 0
+                       && (path_tail = g_queue_peek_tail (event.path))
+                       && path_tail->key)
+                {
+                  if (strcmp (path_tail->key, "cve") == 0)
+                    {
+                      if (event.type != GVM_JSON_PULL_EVENT_STRING)
+                        {
+                          g_warning ("%s: Field 'cve' in item is not a string",
+                                     __func__);
+                          g_free (cve);
+                          goto fail_insert;
+                        }
+                      g_free (cve);
+                      cve = g_strdup (event.value->valuestring);
+                    }
+                  else if (strcmp (path_tail->key, "epss") == 0)
+                    {
+                      if (event.type != GVM_JSON_PULL_EVENT_NUMBER)
+                        {
+                          g_warning ("%s: Field 'epss' in item is not a number",
+                                     __func__);
+                          g_free (cve);
+                          goto fail_insert;
+                        }
+                      epss = event.value->valuedouble;
+                      has_epss = TRUE;
+                    }
+                  else if (strcmp (path_tail->key, "percentile") == 0)
+                    {
+                      if (event.type != GVM_JSON_PULL_EVENT_NUMBER)
+                        {
+                          g_warning ("%s: Field 'percentile' in item is not"
+                                     " a number",
+                                     __func__);
+                          g_free (cve);
+                          goto fail_insert;
+                        }
+                      percentile = event.value->valuedouble;
+                      has_percentile = TRUE;
+                    }
+                }
 
-          EPSS_JSON_FAIL_IF (! cJSON_IsNumber(epss_json),
-                            "Field 'epss' in item is not a number");
+              gvm_json_pull_parser_next (&parser, &event);
+            }
 
-          EPSS_JSON_FAIL_IF (! cJSON_IsNumber(percentile_json),
-                            "Field 'percentile' in item is not a number");
+          if (cve == NULL)
+            {
+              g_warning ("%s: Item missing mandatory 'cve' field", __func__);
+              goto fail_insert;
+            }
+          if (has_epss == FALSE)
+            {
+              g_warning ("%s: Item missing mandatory 'epss' field", __func__);
+              g_free (cve);
+              goto fail_insert;
+            }
+          if (has_percentile == FALSE)
+            {
+              g_warning ("%s: Item missing mandatory 'percentile' field",
+                         __func__);
+              g_free (cve);
+              goto fail_insert;
+            }
 
-          insert_epss_score_entry (&inserts,
-                                  cve_json->valuestring,
-                                  epss_json->valuedouble,
-                                  percentile_json->valuedouble);
+          insert_epss_score_entry (&inserts, cve, epss, percentile);
 
+          g_free (cve);
           gvm_json_pull_parser_next (&parser, &event);
-          cJSON_Delete (epss_entry);
 	      }
     }
   else if (event.type == GVM_JSON_PULL_EVENT_ERROR)
@@ -4625,10 +5378,6 @@ update_epss_scores ()
 fail_insert:
   inserts_free (&inserts);
   sql_rollback ();
-  char *printed_item = cJSON_Print (epss_entry);
-  g_message ("%s: invalid item: %s", __func__, printed_item);
-  cJSON_Delete (epss_entry);
-  free (printed_item);
   gvm_json_pull_event_cleanup (&event);
   gvm_json_pull_parser_cleanup (&parser);
   fclose (epss_scores_file);
@@ -4936,7 +5685,7 @@ update_cert_timestamp ()
     }
 
   g_debug ("%s: setting last_update: %lld", __func__, (long long) stamp);
-  sql ("UPDATE cert.meta SET value = '%lld' WHERE name = 'last_update';",
+  sql ("UPDATE cert2.meta SET value = '%lld' WHERE name = 'last_update';",
        (long long) stamp);
 }
 
@@ -5002,6 +5751,43 @@ update_cvss_cert_bund (int updated_cert_bund, int last_cert_update,
     g_info ("Updating CERT-Bund CVSS max succeeded (nothing to do).");
 }
 
+/**
+ * @brief Abort the CERT update, removing the cert2 schema.
+ */
+static void
+abort_cert_update ()
+{
+  g_debug ("%s: update timestamp", __func__);
+
+  if (sql_int ("SELECT EXISTS (SELECT schema_name FROM"
+               "               information_schema.schemata"
+               "               WHERE schema_name = 'cert');"))
+    {
+      update_cert_timestamp ();
+      sql ("UPDATE cert.meta SET value = "
+           "    (SELECT value from cert2.meta WHERE name = 'last_update')"
+           "  WHERE name = 'last_update';");
+      sql ("DROP SCHEMA cert2 CASCADE;");
+    }
+  else
+    {
+      /* reset cert2 schema */
+      if (manage_db_init ("cert"))
+        g_warning ("%s: could not reset cert2 schema, db init failed",
+                   __func__);
+
+      if (sql_int ("SELECT EXISTS (SELECT schema_name FROM"
+                   "               information_schema.schemata"
+                   "               WHERE schema_name = 'cert2');"))
+        {
+          update_cert_timestamp ();
+          sql ("ALTER SCHEMA cert2 RENAME TO cert;");
+        }
+    }
+
+  g_info ("%s: Updating CERT info aborted", __func__);
+}
+
 /**
  * @brief Sync the CERT DB.
  *
@@ -5019,15 +5805,6 @@ sync_cert ()
       if (check_cert_db_version ())
         return -1;
     }
-  else
-    {
-      g_info ("Initializing CERT database");
-      if (manage_db_init ("cert"))
-        {
-          g_warning ("%s: Could not initialize CERT database", __func__);
-          return -1;
-        }
-    }
 
   last_cert_update = 0;
   if (manage_cert_loaded ())
@@ -5039,11 +5816,6 @@ sync_cert ()
     {
       g_warning ("%s: Inconsistent data. Resetting CERT database.",
                  __func__);
-      if (manage_db_reinit ("cert"))
-        {
-          g_warning ("%s: could not reinitialize CERT database", __func__);
-          return -1;
-        }
       last_cert_update = 0;
     }
 
@@ -5058,6 +5830,30 @@ sync_cert ()
 
   g_info ("%s: Updating data from feed", __func__);
 
+  /* Build the new CERT data in the cert2 schema and only swap the schemas
+   * over once the update has fully succeeded, so that readers never see
+   * the update in progress. */
+
+  if (manage_cert_loaded () && last_cert_update > 0)
+    {
+      if (manage_db_copy ("cert"))
+        {
+          g_warning ("%s: Could not copy CERT database, rebuilding it",
+                     __func__);
+          last_cert_update = 0;
+        }
+    }
+
+  if (last_cert_update == 0)
+    {
+      g_info ("Initializing CERT database");
+      if (manage_db_init ("cert"))
+        {
+          g_warning ("%s: Could not initialize CERT database", __func__);
+          return -1;
+        }
+    }
+
   g_debug ("%s: update dfn", __func__);
 
   updated_dfn_cert = update_dfn_cert_advisories (last_cert_update);
@@ -5070,6 +5866,23 @@ sync_cert ()
   if (updated_cert_bund == -1)
     goto fail;
 
+  g_debug ("%s: update timestamp", __func__);
+
+  update_cert_timestamp ();
+
+  /* Replace the real cert schema with the new one. */
+
+  if (sql_int ("SELECT EXISTS (SELECT schema_name FROM"
+               "               information_schema.schemata"
+               "               WHERE schema_name = 'cert');"))
+    {
+      sql ("ALTER SCHEMA cert RENAME TO cert3;");
+      sql ("ALTER SCHEMA cert2 RENAME TO cert;");
+      sql ("DROP SCHEMA cert3 CASCADE;");
+    }
+  else
+    sql ("ALTER SCHEMA cert2 RENAME TO cert;");
+
   g_debug ("%s: update cvss", __func__);
 
   /* Update CERT data that depends on SCAP. */
@@ -5103,16 +5916,12 @@ sync_cert ()
                              last_scap_update);
     }
 
-  g_debug ("%s: update timestamp", __func__);
-
-  update_cert_timestamp ();
-
   g_info ("%s: Updating CERT info succeeded.", __func__);
 
   return 0;
 
  fail:
-  update_cert_timestamp ();
+  abort_cert_update ();
   return -1;
 }
 
@@ -5255,6 +6064,9 @@ update_scap_placeholders ()
 
 /**
  * @brief Update extra data for VTs based on SCAP and SCAP supplement data.
+ *
+ * Only rows whose EPSS data actually changed are written, so the update
+ * does not rewrite the whole nvts table on every sync.
  */
 static void
 update_vt_scap_extra_data ()
@@ -5269,7 +6081,13 @@ update_vt_scap_extra_data ()
        "     max_epss_cve = NULL,"
        "     max_epss_score = NULL,"
        "     max_epss_percentile = NULL,"
-       "     max_epss_severity = NULL;");
+       "     max_epss_severity = NULL"
+       " WHERE (epss_cve IS NOT NULL OR max_epss_cve IS NOT NULL)"
+       "   AND NOT EXISTS (SELECT * FROM vt_refs"
+       "                   WHERE vt_refs.vt_oid = nvts.oid"
+       "                   AND vt_refs.type = 'cve'"
+       "                   AND EXISTS (SELECT * FROM scap.epss_scores"
+       "                               WHERE cve = vt_refs.ref_id));");
 
   sql ("WITH epss_candidates AS ("
        " SELECT vt_oid, cve, severity, epss, percentile,"
@@ -5289,7 +6107,13 @@ update_vt_scap_extra_data ()
        "     epss_severity = epss_candidates.severity"
        " FROM epss_candidates"
        " WHERE epss_candidates.vt_oid = nvts.oid"
-       "   AND epss_candidates.rank = 1;");
+       "   AND epss_candidates.rank = 1"
+       "   AND (nvts.epss_cve IS DISTINCT FROM epss_candidates.cve"
+       "        OR nvts.epss_score IS DISTINCT FROM epss_candidates.epss"
+       "        OR nvts.epss_percentile"
+       "           IS DISTINCT FROM epss_candidates.percentile"
+       "        OR nvts.epss_severity"
+       "           IS DISTINCT FROM epss_candidates.severity);");
 
   sql ("WITH epss_candidates AS ("
        " SELECT vt_oid, cve, severity, epss, percentile,"
@@ -5309,7 +6133,13 @@ update_vt_scap_extra_data ()
        "     max_epss_severity = epss_candidates.severity"
        " FROM epss_candidates"
        " WHERE epss_candidates.vt_oid = nvts.oid"
-       "   AND epss_candidates.rank = 1;");
+       "   AND epss_candidates.rank = 1"
+       "   AND (nvts.max_epss_cve IS DISTINCT FROM epss_candidates.cve"
+       "        OR nvts.max_epss_score IS DISTINCT FROM epss_candidates.epss"
+       "        OR nvts.max_epss_percentile"
+       "           IS DISTINCT FROM epss_candidates.percentile"
+       "        OR nvts.max_epss_severity"
+       "           IS DISTINCT FROM epss_candidates.severity);");
 }
  
 /**
@@ -5363,6 +6193,9 @@ update_scap_end ()
 
   update_scap_timestamp ();
 
+  sql ("DELETE FROM scap2.meta"
+       " WHERE name LIKE 'checkpoint:%%' OR name = 'incremental_cutoff';");
+
   /* Replace the real scap schema with the new one. */
 
   if (sql_int ("SELECT EXISTS (SELECT schema_name FROM"
@@ -5524,6 +6357,9 @@ try_load_csv ()
 static int
 update_scap (gboolean reset_scap_db)
 {
+  gboolean incremental = FALSE;
+  int last_scap_update = 0;
+
   if (reset_scap_db)
     g_warning ("%s: Full rebuild requested, resetting SCAP db",
                __func__);
@@ -5532,8 +6368,6 @@ update_scap (gboolean reset_scap_db)
                __func__);
   else
     {
-      int last_scap_update;
-
       last_scap_update = sql_int ("SELECT coalesce ((SELECT value FROM scap.meta"
                                   "                  WHERE name = 'last_update'),"
                                   "                 '-3');");
@@ -5564,6 +6398,10 @@ update_scap (gboolean reset_scap_db)
                          __func__);
               return -1;
             }
+
+          /* The old data is usable, so only records modified since the
+           * last update have to be applied. */
+          incremental = TRUE;
         }
     }
 
@@ -5572,6 +6410,67 @@ update_scap (gboolean reset_scap_db)
   if (try_load_csv () == 0)
     return 0;
 
+  /* If the staging schema of an interrupted update is still around, for
+   * example after a daemon or database restart, resume at the last
+   * checkpoint instead of starting over. */
+
+  if (reset_scap_db == FALSE
+      && sql_int ("SELECT EXISTS (SELECT schema_name FROM"
+                  "               information_schema.schemata"
+                  "               WHERE schema_name = 'scap2');")
+      && sql_int ("SELECT EXISTS (SELECT * FROM scap2.meta"
+                  "               WHERE name LIKE 'checkpoint:%%');")
+      && sql_int ("SELECT coalesce ((SELECT value FROM scap2.meta"
+                  "                  WHERE name = 'database_version'),"
+                  "                 '-1');")
+         == GVMD_SCAP_DATABASE_VERSION)
+    {
+      int ret;
+
+      g_info ("%s: Resuming interrupted SCAP update", __func__);
+
+      scap_incremental_cutoff
+        = sql_int ("SELECT coalesce ((SELECT value FROM scap2.meta"
+                   "                  WHERE name = 'incremental_cutoff'),"
+                   "                 '0');");
+      ret = update_scap_tables ();
+      scap_incremental_cutoff = 0;
+      return ret;
+    }
+
+  if (incremental)
+    {
+      /* Copy the old schema to "scap2" and update it in place, skipping
+       * feed records that were not modified since the last update. */
+
+      g_debug ("%s: copy schema", __func__);
+      setproctitle ("Syncing SCAP: Copying schema");
+
+      if (manage_db_copy ("scap"))
+        {
+          g_warning ("%s: could not copy SCAP database,"
+                     " falling back to full rebuild",
+                     __func__);
+          incremental = FALSE;
+        }
+      else
+        {
+          int ret;
+
+          g_info ("%s: Updating data from feed (incremental)", __func__);
+
+          sql ("INSERT INTO scap2.meta (name, value)"
+               " VALUES ('incremental_cutoff', '%i')"
+               " ON CONFLICT (name) DO UPDATE SET value = '%i';",
+               last_scap_update, last_scap_update);
+
+          scap_incremental_cutoff = last_scap_update;
+          ret = update_scap_tables ();
+          scap_incremental_cutoff = 0;
+          return ret;
+        }
+    }
+
   /* Create a new schema, "scap2". */
 
   if (manage_db_init ("scap"))
@@ -5603,22 +6502,49 @@ update_scap (gboolean reset_scap_db)
 
   g_info ("%s: Updating data from feed", __func__);
 
+  return update_scap_tables ();
+}
+
+/**
+ * @brief Update all data in the scap2 schema from the feed files.
+ *
+ * Assume that the scap2 schema is ready: either freshly created for a
+ * full rebuild or, for an incremental update, copied from the old SCAP
+ * schema with scap_incremental_cutoff set.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+update_scap_tables ()
+{
   g_debug ("%s: update cpes", __func__);
   setproctitle ("Syncing SCAP: Updating CPEs");
 
-  if (update_scap_cpes () == -1)
+  if (scap_checkpoint_reached ("cpes"))
+    g_info ("%s: CPEs already updated, resuming", __func__);
+  else
     {
-      abort_scap_update ();
-      return -1;
+      if (update_scap_cpes () == -1)
+        {
+          abort_scap_update ();
+          return -1;
+        }
+      set_scap_checkpoint ("cpes");
     }
 
   g_debug ("%s: update cpe match strings", __func__);
   setproctitle ("Syncing SCAP: Updating CPE Match Strings");
 
-  if (update_scap_cpe_match_strings () == -1)
+  if (scap_checkpoint_reached ("cpe_match_strings"))
+    g_info ("%s: CPE match strings already updated, resuming", __func__);
+  else
     {
-      abort_scap_update ();
-      return -1;
+      if (update_scap_cpe_match_strings () == -1)
+        {
+          abort_scap_update ();
+          return -1;
+        }
+      set_scap_checkpoint ("cpe_match_strings");
     }
 
   g_debug ("%s: update cves", __func__);
@@ -5640,10 +6566,16 @@ update_scap (gboolean reset_scap_db)
   g_debug ("%s: update epss", __func__);
   setproctitle ("Syncing SCAP: Updating EPSS scores");
 
-  if (update_scap_epss () == -1)
+  if (scap_checkpoint_reached ("epss"))
+    g_info ("%s: EPSS scores already updated, resuming", __func__);
+  else
     {
-      abort_scap_update ();
-      return -1;
+      if (update_scap_epss () == -1)
+        {
+          abort_scap_update ();
+          return -1;
+        }
+      set_scap_checkpoint ("epss");
     }
 
   /* Do calculations that need all data. */
@@ -5716,9 +6648,10 @@ static int
 rebuild_scap ()
 {
   int ret = -1;
-  lockfile_t lockfile;
+  lockfile_t main_lockfile, feed_lockfile;
 
-  ret = feed_lockfile_lock_timeout (&lockfile);
+  ret = feed_type_lockfile_lock_timeout (&main_lockfile, &feed_lockfile,
+                                         SCAP_FEED);
   if (ret == 1)
     return 2;
   else if (ret)
@@ -5729,7 +6662,7 @@ rebuild_scap ()
   if (ret == 0)
     update_scap_extra ();
 
-  if (feed_lockfile_unlock (&lockfile))
+  if (feed_type_lockfile_unlock (&main_lockfile, &feed_lockfile))
     {
       g_warning (
         "%s: failed to close lock file: %s", __func__, strerror (errno));
@@ -5788,3 +6721,28 @@ set_secinfo_commit_size (int new_commit_size)
   else
     secinfo_commit_size = new_commit_size;
 }
+
+/**
+ * @brief Get the number of SCAP update worker processes.
+ *
+ * @return The number of worker processes.
+ */
+int
+get_secinfo_parallel_workers ()
+{
+  return secinfo_parallel_workers;
+}
+
+/**
+ * @brief Set the number of SCAP update worker processes.
+ *
+ * @param new_n_workers The new number of worker processes.
+ */
+void
+set_secinfo_parallel_workers (int new_n_workers)
+{
+  if (new_n_workers < 1)
+    secinfo_parallel_workers = 1;
+  else
+    secinfo_parallel_workers = new_n_workers;
+}
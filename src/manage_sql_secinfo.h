@@ -170,6 +170,11 @@
  */
 #define SECINFO_COMMIT_SIZE_DEFAULT 0
 
+/**
+ * @brief Default for secinfo_parallel_workers.
+ */
+#define SECINFO_PARALLEL_WORKERS_DEFAULT 1
+
 int
 secinfo_feed_version_status ();
 
@@ -194,6 +199,12 @@ get_secinfo_commit_size ();
 void
 set_secinfo_commit_size (int);
 
+int
+get_secinfo_parallel_workers ();
+
+void
+set_secinfo_parallel_workers (int);
+
 void
 update_scap_extra ();
 
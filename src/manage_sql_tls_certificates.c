@@ -1212,6 +1212,103 @@ DEF_ACCESS (tls_certificate_source_iterator_origin_id, 8);
  */
 DEF_ACCESS (tls_certificate_source_iterator_origin_data, 9);
 
+/**
+ * @brief Cache of tls_certificate_locations row ids, keyed by host and port.
+ *
+ * Used while the TLS certificates of one report are ingested, so
+ * certificate heavy scans do not repeat the row lookups for every
+ * certificate and port.  Cleared when the ingest moves to another report.
+ */
+static GHashTable *tls_locations_cache = NULL;
+
+/**
+ * @brief Cache of tls_certificate_origins row ids, keyed by the origin.
+ *
+ * See tls_locations_cache.
+ */
+static GHashTable *tls_origins_cache = NULL;
+
+/**
+ * @brief The report the location and origin caches apply to.
+ */
+static gchar *tls_caches_report_id = NULL;
+
+/**
+ * @brief Start using the location and origin caches for a report.
+ *
+ * Clears the caches when the report changes.
+ *
+ * @param[in]  report_id  UUID of the report being ingested.
+ */
+static void
+tls_caches_set_report (const char *report_id)
+{
+  if (tls_caches_report_id
+      && strcmp (tls_caches_report_id, report_id) == 0)
+    return;
+
+  g_free (tls_caches_report_id);
+  tls_caches_report_id = g_strdup (report_id);
+
+  if (tls_locations_cache)
+    g_hash_table_remove_all (tls_locations_cache);
+  else
+    tls_locations_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, g_free);
+
+  if (tls_origins_cache)
+    g_hash_table_remove_all (tls_origins_cache);
+  else
+    tls_origins_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, g_free);
+}
+
+/**
+ * @brief Get a row id from a TLS ingest cache.
+ *
+ * @param[in]  cache  The cache.
+ * @param[in]  key    Cache key.
+ *
+ * @return The row id, or 0 if there is no entry for the key.
+ */
+static resource_t
+tls_cache_get (GHashTable *cache, const gchar *key)
+{
+  resource_t *value;
+
+  if (cache == NULL)
+    return 0;
+
+  value = g_hash_table_lookup (cache, key);
+  if (value == NULL)
+    return 0;
+
+  return *value;
+}
+
+/**
+ * @brief Add a row id to a TLS ingest cache.
+ *
+ * @param[in]  cache  The cache.
+ * @param[in]  key    Cache key.  Consumed.
+ * @param[in]  id     Row id.
+ */
+static void
+tls_cache_add (GHashTable *cache, gchar *key, resource_t id)
+{
+  resource_t *value;
+
+  if (cache == NULL)
+    {
+      g_free (key);
+      return;
+    }
+
+  value = g_malloc (sizeof (resource_t));
+  *value = id;
+  g_hash_table_replace (cache, key, value);
+}
+
 /**
  * @brief Gets or creates a tls_certificate_location.
  *
@@ -1229,6 +1326,17 @@ get_or_make_tls_certificate_location (const char *host_ip,
 {
   resource_t location = 0;
   char *quoted_host_ip, *quoted_port;
+  gchar *cache_key;
+
+  cache_key = g_strdup_printf ("%s:%s", host_ip ? host_ip : "",
+                               port ? port : "");
+  location = tls_cache_get (tls_locations_cache, cache_key);
+  if (location)
+    {
+      g_free (cache_key);
+      return location;
+    }
+
   quoted_host_ip = host_ip ? sql_quote (host_ip) : g_strdup ("");
   quoted_port = port ? sql_quote (port) : g_strdup ("");
 
@@ -1242,6 +1350,7 @@ get_or_make_tls_certificate_location (const char *host_ip,
 
   if (location)
     {
+      tls_cache_add (tls_locations_cache, cache_key, location);
       g_free (quoted_host_ip);
       g_free (quoted_port);
       return location;
@@ -1255,6 +1364,7 @@ get_or_make_tls_certificate_location (const char *host_ip,
 
   location = sql_last_insert_id ();
 
+  tls_cache_add (tls_locations_cache, cache_key, location);
   g_free (quoted_host_ip);
   g_free (quoted_port);
 
@@ -1280,6 +1390,19 @@ get_or_make_tls_certificate_origin (const char *origin_type,
 {
   resource_t origin = 0;
   char *quoted_origin_type, *quoted_origin_id, *quoted_origin_data;
+  gchar *cache_key;
+
+  cache_key = g_strdup_printf ("%s|%s|%s",
+                               origin_type ? origin_type : "",
+                               origin_id ? origin_id : "",
+                               origin_data ? origin_data : "");
+  origin = tls_cache_get (tls_origins_cache, cache_key);
+  if (origin)
+    {
+      g_free (cache_key);
+      return origin;
+    }
+
   quoted_origin_type = origin_type ? sql_quote (origin_type) : g_strdup ("");
   quoted_origin_id = origin_id ? sql_quote (origin_id) : g_strdup ("");
   quoted_origin_data = origin_data ? sql_quote (origin_data) : g_strdup ("");
@@ -1296,6 +1419,7 @@ get_or_make_tls_certificate_origin (const char *origin_type,
 
   if (origin)
     {
+      tls_cache_add (tls_origins_cache, cache_key, origin);
       g_free (quoted_origin_type);
       g_free (quoted_origin_id);
       g_free (quoted_origin_data);
@@ -1311,6 +1435,7 @@ get_or_make_tls_certificate_origin (const char *origin_type,
 
   origin = sql_last_insert_id ();
 
+  tls_cache_add (tls_origins_cache, cache_key, origin);
   g_free (quoted_origin_type);
   g_free (quoted_origin_id);
   g_free (quoted_origin_data);
@@ -1510,6 +1635,8 @@ add_tls_certificates_from_report_host (report_host_t report_host,
       || strcmp (report_id, "") == 0)
     return -1;
 
+  tls_caches_set_report (report_id);
+
   init_iterator (&tls_certs,
                  "SELECT rhd.value, rhd.name, rhd.source_name"
                  " FROM report_host_details AS rhd"
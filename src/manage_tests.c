@@ -136,6 +136,39 @@ Ensure (manage, truncate_text_preserves_xml)
   g_free (given);
 }
 
+/* xml_escape_text_append */
+
+Ensure (manage, xml_escape_text_append_escapes)
+{
+  GString *buffer;
+
+  buffer = g_string_new ("");
+  xml_escape_text_append (buffer, "a<b>&'\"c", -1);
+  assert_that (buffer->str,
+               is_equal_to_string ("a&lt;b&gt;&amp;&apos;&quot;c"));
+  g_string_free (buffer, TRUE);
+}
+
+Ensure (manage, xml_escape_text_append_leaves_clean_text)
+{
+  GString *buffer;
+
+  buffer = g_string_new ("");
+  xml_escape_text_append (buffer, "plain text", -1);
+  assert_that (buffer->str, is_equal_to_string ("plain text"));
+  g_string_free (buffer, TRUE);
+}
+
+Ensure (manage, xml_escape_text_append_respects_length)
+{
+  GString *buffer;
+
+  buffer = g_string_new ("");
+  xml_escape_text_append (buffer, "a&b&c", 3);
+  assert_that (buffer->str, is_equal_to_string ("a&amp;b"));
+  g_string_free (buffer, TRUE);
+}
+
 /* delete_reports */
 
 // TODO
@@ -167,6 +200,10 @@ main (int argc, char **argv)
   add_test_with_context (suite, manage, truncate_text_skips_suffix);
   add_test_with_context (suite, manage, truncate_text_preserves_xml);
 
+  add_test_with_context (suite, manage, xml_escape_text_append_escapes);
+  add_test_with_context (suite, manage, xml_escape_text_append_leaves_clean_text);
+  add_test_with_context (suite, manage, xml_escape_text_append_respects_length);
+
   if (argc > 1)
     return run_single_test (suite, argv[1], create_text_reporter ());
 
@@ -27,12 +27,14 @@
  * implemented for that database.
  */
 
+#include "ipc.h"
 #include "sql.h"
 
 #include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 #undef G_LOG_DOMAIN
 /**
@@ -49,12 +51,32 @@
  */
 #define DEADLOCK_THRESHOLD 25
 
+/**
+ * @brief Number of deadlock retries after which a statement is given up on.
+ */
+#define DEADLOCK_RETRIES_MAX 50
+
+/**
+ * @brief Maximum number of doublings of DEADLOCK_SLEEP when backing off.
+ */
+#define DEADLOCK_BACKOFF_MAX_SHIFT 10
+
 
 /* Headers of internal symbols defined in backend files. */
 
 int
 sql_prepare_internal (int, int, const char*, va_list, sql_stmt_t **);
 
+int
+sql_prepare_params_internal (int, const char *, int, const char *const *,
+                             sql_stmt_t **);
+
+int
+sql_prepare_cursor_internal (int, int, const char*, va_list, sql_stmt_t **);
+
+int
+sql_send_internal (sql_stmt_t *);
+
 int
 sql_exec_internal (int, sql_stmt_t *);
 
@@ -86,6 +108,56 @@ sql_column_array (sql_stmt_t *, int);
  */
 int log_errors = 1;
 
+/**
+ * @brief Number of SQL statements sent to the server by this process.
+ *
+ * Incremented in the backend when a statement goes to the server, for the
+ * performance counters.  Only ever increases.
+ */
+unsigned long long int sql_statements_sent = 0;
+
+/**
+ * @brief Number of rows stepped over by \ref next in this process.
+ *
+ * For the performance counters.  Only ever increases.
+ */
+unsigned long long int sql_rows_stepped = 0;
+
+/**
+ * @brief Duration in milliseconds above which a statement is logged as slow.
+ *
+ * 0 disables the slow statement log.
+ */
+int sql_slow_statement_ms = SQL_SLOW_STATEMENT_MS_DEFAULT;
+
+/**
+ * @brief Context logged with slow statements, usually the GMP command.
+ */
+static gchar *statement_context = NULL;
+
+/**
+ * @brief Set the context logged with slow statements.
+ *
+ * @param[in]  context  New context, or NULL to clear.  Copied.
+ */
+void
+sql_set_statement_context (const char *context)
+{
+  g_free (statement_context);
+  statement_context = context ? g_strdup (context) : NULL;
+}
+
+/**
+ * @brief Get the context logged with slow statements.
+ *
+ * @return The context, or NULL if none is set.
+ */
+const char *
+sql_statement_context ()
+{
+  return statement_context;
+}
+
 
 /* Helpers. */
 
@@ -149,6 +221,119 @@ sql_quote (const char* string)
   return sql_nquote (string, strlen (string));
 }
 
+/**
+ * @brief Escape a string for use as a column in COPY text format data.
+ *
+ * @param[in]  string  String to escape.  NULL for an SQL NULL.
+ *
+ * @return Freshly allocated, escaped string. Free with g_free.
+ */
+gchar*
+sql_copy_escape (const char* string)
+{
+  GString *escaped;
+
+  if (string == NULL)
+    /* COPY text format notation for NULL. */
+    return g_strdup ("\\N");
+
+  escaped = g_string_sized_new (strlen (string) + 1);
+  for (; *string; string++)
+    switch (*string)
+      {
+        case '\\':
+          g_string_append (escaped, "\\\\");
+          break;
+        case '\t':
+          g_string_append (escaped, "\\t");
+          break;
+        case '\n':
+          g_string_append (escaped, "\\n");
+          break;
+        case '\r':
+          g_string_append (escaped, "\\r");
+          break;
+        default:
+          g_string_append_c (escaped, *string);
+      }
+  return g_string_free (escaped, FALSE);
+}
+
+/**
+ * @brief Initialise a COPY buffer.
+ *
+ * @param[in]  copy_buffer      COPY buffer.
+ * @param[in]  max_buffer_size  Automatically run at this buffer size.
+ * @param[in]  copy_sql         COPY ... FROM STDIN statement for each load.
+ */
+void
+copy_buffer_init (copy_buffer_t *copy_buffer, int max_buffer_size,
+                  const gchar *copy_sql)
+{
+  copy_buffer->buffer = g_string_new ("");
+  copy_buffer->max_buffer_size = max_buffer_size;
+  copy_buffer->copy_sql = g_strdup (copy_sql);
+}
+
+/**
+ * @brief Free all fields in a COPY buffer.
+ *
+ * @param[in]  copy_buffer  COPY buffer.
+ */
+void
+copy_buffer_free (copy_buffer_t *copy_buffer)
+{
+  g_string_free (copy_buffer->buffer, TRUE);
+  g_free (copy_buffer->copy_sql);
+  bzero (copy_buffer, sizeof (*copy_buffer));
+}
+
+/**
+ * @brief Run the COPY load, sending the buffered rows.
+ *
+ * @param[in]  copy_buffer  COPY buffer.
+ * @param[in]  finalize     Whether to free the whole buffer afterwards.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+copy_buffer_run (copy_buffer_t *copy_buffer, gboolean finalize)
+{
+  int ret;
+
+  ret = 0;
+  if (copy_buffer->buffer->len)
+    {
+      if (sql_copy_start ("%s", copy_buffer->copy_sql)
+          || sql_copy_write (copy_buffer->buffer->str,
+                             copy_buffer->buffer->len)
+          || sql_copy_end ())
+        ret = -1;
+      g_string_truncate (copy_buffer->buffer, 0);
+    }
+
+  if (finalize)
+    copy_buffer_free (copy_buffer);
+
+  return ret;
+}
+
+/**
+ * @brief Check size of the COPY buffer, running the load when full.
+ *
+ * @param[in]  copy_buffer  COPY buffer.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+copy_buffer_check_size (copy_buffer_t *copy_buffer)
+{
+  if (copy_buffer->max_buffer_size
+      && copy_buffer->buffer->len >= copy_buffer->max_buffer_size)
+    return copy_buffer_run (copy_buffer, FALSE);
+  return 0;
+}
+
 /**
  * @brief Quotes a string for use in SQL statements, also ASCII escaping it.
  *
@@ -199,6 +384,64 @@ sql_insert (const char *string)
   return g_strdup ("NULL");
 }
 
+/**
+ * @brief Sleep before retrying a deadlocked statement.
+ *
+ * The sleep doubles with every attempt, up to a couple of seconds, and is
+ * jittered so that the statements that deadlocked against each other do
+ * not retry in lockstep and deadlock again.
+ *
+ * @param[in]  attempt  Number of retries of the statement so far.
+ */
+static void
+deadlock_backoff (unsigned int attempt)
+{
+  unsigned int shift;
+
+  shift = MIN (attempt, DEADLOCK_BACKOFF_MAX_SHIFT);
+  gvm_usleep (g_random_int_range (DEADLOCK_SLEEP,
+                                  DEADLOCK_SLEEP * (2 << shift)));
+}
+
+/**
+ * @brief Record a deadlocked statement in the performance counters.
+ *
+ * The statement is classed by its leading keywords and target table, so
+ * the counters show which operations fight over locks.  The GMP command
+ * being served, when there is one, gets a deadlock counted as well.
+ *
+ * @param[in]  sql  The statement.
+ */
+static void
+count_deadlock (const char *sql)
+{
+  GString *class;
+  gchar **tokens;
+  int index, words, wanted;
+
+  class = g_string_new ("DEADLOCK");
+  tokens = g_strsplit_set (sql, " \t\n(", -1);
+  wanted = 2;
+  words = 0;
+  for (index = 0; tokens[index] && words < wanted; index++)
+    {
+      if (tokens[index][0] == '\0')
+        continue;
+      g_string_append_printf (class, " %s", tokens[index]);
+      words++;
+      if (words == 1 && strcasecmp (tokens[index], "INSERT") == 0)
+        /* Take the table name after INTO too. */
+        wanted = 3;
+    }
+  g_strfreev (tokens);
+
+  perf_counters_deadlock (class->str);
+  if (sql_statement_context ())
+    perf_counters_deadlock (sql_statement_context ());
+
+  g_string_free (class, TRUE);
+}
+
 /**
  * @brief Perform an SQL statement.
  *
@@ -274,12 +517,20 @@ sql (char* sql, ...)
         continue;
       else if (ret == 4)
         {
-          if (deadlock_amount++ > DEADLOCK_THRESHOLD)
+          deadlock_amount++;
+          count_deadlock (sql);
+          if (deadlock_amount > DEADLOCK_RETRIES_MAX)
+            {
+              g_warning ("%s: giving up after %d deadlocks: %s",
+                         __func__, deadlock_amount, sql);
+              abort ();
+            }
+          if (deadlock_amount > DEADLOCK_THRESHOLD)
             {
               g_warning("%s: %d deadlocks detected, waiting and retrying %s",
                         __func__, deadlock_amount, sql);
             }
-          gvm_usleep (DEADLOCK_SLEEP);
+          deadlock_backoff (deadlock_amount);
           continue;
         }
       else if (ret)
@@ -288,6 +539,143 @@ sql (char* sql, ...)
     }
 }
 
+/**
+ * @brief Perform an SQL statement with bound text parameters.
+ *
+ * The statement refers to the parameters as $1, $2, ... so the values
+ * skip quoting entirely and the statement text stays constant, which
+ * also makes it a candidate for the prepared statement cache.  Retries
+ * while the database is busy or locked, like \ref sql.
+ *
+ * @param[in]  sql           SQL statement, taken literally.
+ * @param[in]  n_params      Number of parameters.
+ * @param[in]  param_values  Parameter values, $1 first.  NULL entries
+ *                           become SQL NULLs.
+ */
+void
+sql_params (const char *sql, int n_params, const char **param_values)
+{
+  unsigned int deadlock_amount = 0;
+
+  while (1)
+    {
+      sql_stmt_t *stmt;
+      int ret;
+
+      if (sql_prepare_params_internal (1, sql, n_params,
+                                       (const char *const *) param_values,
+                                       &stmt))
+        {
+          g_warning ("%s: sql_prepare_params_internal failed", __func__);
+          abort ();
+        }
+
+      while ((ret = sql_exec_internal (1, stmt)) == 1);
+      sql_finalize (stmt);
+      if (ret == 2 || ret == -2)
+        /* Schema changed or gave up with statement reset. */
+        continue;
+      if (ret == -5)
+        {
+          deadlock_amount++;
+          count_deadlock (sql);
+          if (deadlock_amount > DEADLOCK_RETRIES_MAX)
+            {
+              g_warning ("%s: giving up after %d deadlocks: %s",
+                         __func__, deadlock_amount, sql);
+              abort ();
+            }
+          if (deadlock_amount > DEADLOCK_THRESHOLD)
+            {
+              g_warning ("%s: %d deadlocks detected, waiting and retrying %s",
+                         __func__, deadlock_amount, sql);
+            }
+          deadlock_backoff (deadlock_amount);
+          continue;
+        }
+      if (ret)
+        {
+          if (log_errors)
+            g_warning ("%s: sql_exec_internal failed", __func__);
+          abort ();
+        }
+      break;
+    }
+}
+
+/**
+ * @brief Perform an INSERT with bound parameters, returning the new id.
+ *
+ * Like \ref sql_params, but the statement must end in a "RETURNING id"
+ * clause, whose value is returned.  This delivers the id with the insert
+ * itself, instead of fetching LASTVAL in a second round trip.
+ *
+ * @param[in]  sql           SQL statement, taken literally.
+ * @param[in]  n_params      Number of parameters.
+ * @param[in]  param_values  Parameter values, $1 first.  NULL entries
+ *                           become SQL NULLs.
+ *
+ * @return The returned id.  0 if the insert did not add a row.
+ */
+resource_t
+sql_params_insert_id (const char *sql, int n_params,
+                      const char **param_values)
+{
+  unsigned int deadlock_amount = 0;
+
+  while (1)
+    {
+      sql_stmt_t *stmt;
+      resource_t id;
+      int ret;
+
+      if (sql_prepare_params_internal (1, sql, n_params,
+                                       (const char *const *) param_values,
+                                       &stmt))
+        {
+          g_warning ("%s: sql_prepare_params_internal failed", __func__);
+          abort ();
+        }
+
+      ret = sql_exec_internal (1, stmt);
+      if (ret == 1)
+        {
+          id = sql_column_int64 (stmt, 0);
+          sql_finalize (stmt);
+          return id;
+        }
+      sql_finalize (stmt);
+      if (ret == 2 || ret == -2)
+        /* Schema changed or gave up with statement reset. */
+        continue;
+      if (ret == -5)
+        {
+          deadlock_amount++;
+          count_deadlock (sql);
+          if (deadlock_amount > DEADLOCK_RETRIES_MAX)
+            {
+              g_warning ("%s: giving up after %d deadlocks: %s",
+                         __func__, deadlock_amount, sql);
+              abort ();
+            }
+          if (deadlock_amount > DEADLOCK_THRESHOLD)
+            {
+              g_warning ("%s: %d deadlocks detected, waiting and retrying %s",
+                         __func__, deadlock_amount, sql);
+            }
+          deadlock_backoff (deadlock_amount);
+          continue;
+        }
+      if (ret)
+        {
+          if (log_errors)
+            g_warning ("%s: sql_exec_internal failed", __func__);
+          abort ();
+        }
+      return 0;
+    }
+}
+
 /**
  * @brief Perform an SQL statement, retrying if database is busy or locked.
  *
@@ -396,12 +784,20 @@ sql_x (char* sql, va_list args, sql_stmt_t** stmt_return)
         }
       if (ret == -5)
         {
-          if (deadlock_amount++ > DEADLOCK_THRESHOLD)
+          deadlock_amount++;
+          count_deadlock (sql);
+          if (deadlock_amount > DEADLOCK_RETRIES_MAX)
+            {
+              g_warning ("%s: giving up after %d deadlocks: %s",
+                         __func__, deadlock_amount, sql);
+              return -1;
+            }
+          if (deadlock_amount > DEADLOCK_THRESHOLD)
             {
               g_warning("%s: %d deadlocks detected, waiting and retrying %s",
                         __func__, deadlock_amount, sql);
             }
-          gvm_usleep (DEADLOCK_SLEEP);
+          deadlock_backoff (deadlock_amount);
           continue;
         }
       break;
@@ -583,6 +979,39 @@ sql_int64_0 (char* sql, ...)
   return ret;
 }
 
+/**
+ * @brief Perform an INSERT that returns the id of the new row.
+ *
+ * The statement must end in a "RETURNING id" clause, so that the id
+ * arrives with the insert itself, instead of being fetched with LASTVAL
+ * in a second round trip.
+ *
+ * @param[in]  sql    Format string for SQL statement.
+ * @param[in]  ...    Arguments for format string.
+ *
+ * @return The returned id.  0 if the insert did not add a row.
+ */
+resource_t
+sql_insert_id (char* sql, ...)
+{
+  sql_stmt_t* stmt;
+  int sql_x_ret;
+  resource_t ret;
+  va_list args;
+
+  va_start (args, sql);
+  sql_x_ret = sql_x (sql, args, &stmt);
+  va_end (args);
+  if (sql_x_ret)
+    {
+      sql_finalize (stmt);
+      return 0;
+    }
+  ret = sql_column_int64 (stmt, 0);
+  sql_finalize (stmt);
+  return ret;
+}
+
 
 /* Iterators. */
 
@@ -590,21 +1019,27 @@ sql_int64_0 (char* sql, ...)
  * @brief Initialise an iterator.
  *
  * @param[in]  iterator  Iterator.
+ * @param[in]  cursor    Whether to execute the query via a server side cursor.
  * @param[in]  sql       Format string for SQL.
+ * @param[in]  args      Arguments for format string.
  */
-void
-init_iterator (iterator_t* iterator, const char* sql, ...)
+static void
+init_iterator_internal (iterator_t* iterator, int cursor, const char* sql,
+                        va_list args)
 {
   int ret;
   sql_stmt_t* stmt;
-  va_list args;
 
   iterator->done = FALSE;
   iterator->crypt_ctx = NULL;
-
-  va_start (args, sql);
-  ret = sql_prepare_internal (1, 1, sql, args, &stmt);
-  va_end (args);
+  iterator->column_types = NULL;
+  iterator->column_types_size = 0;
+  iterator->row = NULL;
+
+  if (cursor)
+    ret = sql_prepare_cursor_internal (1, 1, sql, args, &stmt);
+  else
+    ret = sql_prepare_internal (1, 1, sql, args, &stmt);
   if (ret)
     {
       g_warning ("%s: sql_prepare failed", __func__);
@@ -613,6 +1048,101 @@ init_iterator (iterator_t* iterator, const char* sql, ...)
   iterator->stmt = stmt;
 }
 
+/**
+ * @brief Initialise an iterator.
+ *
+ * @param[in]  iterator  Iterator.
+ * @param[in]  sql       Format string for SQL.
+ */
+void
+init_iterator (iterator_t* iterator, const char* sql, ...)
+{
+  va_list args;
+
+  va_start (args, sql);
+  init_iterator_internal (iterator, 0, sql, args);
+  va_end (args);
+}
+
+/**
+ * @brief Initialise an iterator backed by a server side cursor.
+ *
+ * The rows are fetched from the database in batches as the iterator
+ * advances, so memory use stays bounded however large the result set
+ * is.  Use this for iterators that can visit very large numbers of
+ * rows, like results or report hosts.
+ *
+ * @param[in]  iterator  Iterator.
+ * @param[in]  sql       Format string for SQL.
+ */
+void
+init_cursor_iterator (iterator_t* iterator, const char* sql, ...)
+{
+  va_list args;
+
+  va_start (args, sql);
+  init_iterator_internal (iterator, 1, sql, args);
+  va_end (args);
+}
+
+/**
+ * @brief Initialise an iterator, sending the query without waiting for it.
+ *
+ * The query goes to the server immediately, but the result is only
+ * collected when the iterator is first advanced.  Several async
+ * iterators initialised in a row therefore overlap in flight, which
+ * saves a network round trip per query on remote databases.
+ *
+ * @param[in]  iterator  Iterator.
+ * @param[in]  sql       Format string for SQL.
+ */
+void
+init_async_iterator (iterator_t* iterator, const char* sql, ...)
+{
+  va_list args;
+
+  va_start (args, sql);
+  init_iterator_internal (iterator, 0, sql, args);
+  va_end (args);
+
+  /* On failure the statement simply executes synchronously on the
+   * first next. */
+  sql_send_internal (iterator->stmt);
+}
+
+/**
+ * @brief Declare the type of an iterator column.
+ *
+ * Each successful next then decodes the declared columns once into stored
+ * values, and the accessors return the stored values instead of converting
+ * the column text on every call.  Declare the types right after initialising
+ * the iterator, for numeric columns that are read more than once per row.
+ *
+ * Accessing a column with an accessor of a different type falls back to
+ * the usual per-access conversion.
+ *
+ * @param[in]  iterator  Iterator.
+ * @param[in]  col       Column offset.
+ * @param[in]  type      Type to decode the column as.
+ */
+void
+iterator_typed_column (iterator_t *iterator, int col,
+                       iterator_column_type_t type)
+{
+  if (col >= iterator->column_types_size)
+    {
+      int index;
+
+      iterator->column_types = g_renew (iterator_column_type_t,
+                                        iterator->column_types, col + 1);
+      iterator->row = g_renew (iterator_value_t, iterator->row, col + 1);
+      for (index = iterator->column_types_size; index <= col; index++)
+        iterator->column_types[index] = ITERATOR_COLUMN_UNTYPED;
+      iterator->column_types_size = col + 1;
+    }
+  iterator->column_types[col] = type;
+}
+
 /**
  * @brief Get a double column from an iterator.
  *
@@ -625,6 +1155,9 @@ double
 iterator_double (iterator_t* iterator, int col)
 {
   if (iterator->done) abort ();
+  if (col < iterator->column_types_size
+      && iterator->column_types[col] == ITERATOR_COLUMN_DOUBLE)
+    return iterator->row[col].value_double;
   return sql_column_double (iterator->stmt, col);
 }
 
@@ -640,6 +1173,9 @@ int
 iterator_int (iterator_t* iterator, int col)
 {
   if (iterator->done) abort ();
+  if (col < iterator->column_types_size
+      && iterator->column_types[col] == ITERATOR_COLUMN_INT64)
+    return iterator->row[col].value_int64;
   return sql_column_int (iterator->stmt, col);
 }
 
@@ -655,6 +1191,9 @@ long long int
 iterator_int64 (iterator_t* iterator, int col)
 {
   if (iterator->done) abort ();
+  if (col < iterator->column_types_size
+      && iterator->column_types[col] == ITERATOR_COLUMN_INT64)
+    return iterator->row[col].value_int64;
   return sql_column_int64 (iterator->stmt, col);
 }
 
@@ -670,6 +1209,9 @@ const char*
 iterator_string (iterator_t* iterator, int col)
 {
   if (iterator->done) abort ();
+  if (col < iterator->column_types_size
+      && iterator->column_types[col] == ITERATOR_COLUMN_TEXT)
+    return iterator->row[col].value_text;
   return sql_column_text (iterator->stmt, col);
 }
 
@@ -712,6 +1254,11 @@ cleanup_iterator (iterator_t* iterator)
       lsc_crypt_release (iterator->crypt_ctx);
       iterator->crypt_ctx = NULL;
     }
+  g_free (iterator->column_types);
+  iterator->column_types = NULL;
+  iterator->column_types_size = 0;
+  g_free (iterator->row);
+  iterator->row = NULL;
 }
 
 /**
@@ -754,5 +1301,29 @@ next (iterator_t* iterator)
       break;
     }
   assert (ret == 1);
+  sql_rows_stepped++;
+  if (iterator->column_types)
+    {
+      int col;
+
+      for (col = 0; col < iterator->column_types_size; col++)
+        switch (iterator->column_types[col])
+          {
+            case ITERATOR_COLUMN_UNTYPED:
+              break;
+            case ITERATOR_COLUMN_INT64:
+              iterator->row[col].value_int64
+                = sql_column_int64 (iterator->stmt, col);
+              break;
+            case ITERATOR_COLUMN_DOUBLE:
+              iterator->row[col].value_double
+                = sql_column_double (iterator->stmt, col);
+              break;
+            case ITERATOR_COLUMN_TEXT:
+              iterator->row[col].value_text
+                = sql_column_text (iterator->stmt, col);
+              break;
+          }
+    }
   return TRUE;
 }
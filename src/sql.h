@@ -29,6 +29,26 @@
 
 #include <glib.h>
 
+/**
+ * @brief Default duration in milliseconds above which a statement is logged
+ *        as slow.
+ */
+#define SQL_SLOW_STATEMENT_MS_DEFAULT 5000
+
+/* Variables. */
+
+extern unsigned long long int sql_statements_sent;
+
+extern unsigned long long int sql_rows_stepped;
+
+extern int sql_slow_statement_ms;
+
+void
+sql_set_statement_context (const char *);
+
+const char *
+sql_statement_context ();
+
 /* Helpers. */
 
 const char *
@@ -67,18 +87,70 @@ sql_close ();
 void
 sql_close_fork ();
 
+void
+sql_pool_size (int);
+
+void
+sql_replica_mode (int);
+
+void
+sql_replica_lag_limit (int);
+
+void
+sql_prepare_cache_stats (int *, int *);
+
+int
+sql_copy_start (const char *, ...);
+
+int
+sql_copy_write (const char *, size_t);
+
+int
+sql_copy_end ();
+
 int
 sql_changes ();
 
 resource_t
 sql_last_insert_id ();
 
+resource_t
+sql_insert_id (char *, ...);
+
+resource_t
+sql_params_insert_id (const char *, int, const char **);
+
 gchar *
 sql_nquote (const char *, size_t);
 
 gchar *
 sql_quote (const char *);
 
+gchar *
+sql_copy_escape (const char *);
+
+/**
+ * @brief Buffer for COPY data loads.
+ */
+typedef struct
+{
+  GString *buffer;     ///< Buffered rows in COPY text format.
+  int max_buffer_size; ///< Auto-run at this buffer size, 0 for never.
+  gchar *copy_sql;     ///< COPY statement that starts each load.
+} copy_buffer_t;
+
+void
+copy_buffer_init (copy_buffer_t *, int, const gchar *);
+
+void
+copy_buffer_free (copy_buffer_t *);
+
+int
+copy_buffer_run (copy_buffer_t *, gboolean);
+
+int
+copy_buffer_check_size (copy_buffer_t *);
+
 gchar *
 sql_ascii_escape_and_quote (const char *, const char *);
 
@@ -88,6 +160,9 @@ sql_insert (const char *);
 void
 sql (char *sql, ...);
 
+void
+sql_params (const char *, int, const char **);
+
 int
 sql_error (char *sql, ...);
 
@@ -140,6 +215,15 @@ sql_table_lock_wait (const char *, int);
 void
 init_iterator (iterator_t *, const char *, ...);
 
+void
+init_cursor_iterator (iterator_t *, const char *, ...);
+
+void
+init_async_iterator (iterator_t *, const char *, ...);
+
+void
+iterator_typed_column (iterator_t *, int, iterator_column_type_t);
+
 void
 iterator_rewind (iterator_t *iterator);
 
@@ -35,6 +35,7 @@
 #include <postgresql/libpq-fe.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <gvm/base/array.h>
 
@@ -65,8 +66,16 @@ struct sql_stmt
   array_t *param_values;  ///< Parameter values.
   GArray *param_lengths;  ///< Parameter lengths (int's).
   GArray *param_formats;  ///< Parameter formats (int's).
+  gchar *cursor_name;     ///< Cursor name, if executing via a cursor.
+  int async;              ///< Whether sent asynchronously, result pending.
 };
 
+
+/* Forward declarations. */
+
+static void
+log_slow_statement (sql_stmt_t *, gint64);
+
 
 /* Variables. */
 
@@ -83,6 +92,221 @@ extern int log_errors;
  */
 static PGconn *conn = NULL;
 
+/**
+ * @brief Maximum number of idle connections kept for reuse.  0 for none.
+ */
+static int pool_size = 0;
+
+/**
+ * @brief Idle connections available for reuse by sql_open.
+ */
+static GPtrArray *pool_conns = NULL;
+
+/**
+ * @brief Connection info of each connection in pool_conns.
+ */
+static GPtrArray *pool_conn_infos = NULL;
+
+/**
+ * @brief Connection info that the current connection was opened with.
+ */
+static gchar *conn_info_current = NULL;
+
+/**
+ * @brief Connection info of the read replica.  NULL when none is configured.
+ */
+static gchar *replica_conn_info = NULL;
+
+/**
+ * @brief Handle on the read replica.  Connected on first use.
+ */
+static PGconn *replica_conn = NULL;
+
+/**
+ * @brief Whether read only statements may currently go to the replica.
+ */
+static int replica_mode = 0;
+
+/**
+ * @brief Replication lag in seconds above which the replica is not used.
+ */
+static int replica_lag_limit = 60;
+
+/**
+ * @brief Whether the replica was within the lag limit at the last check.
+ */
+static int replica_fresh = 0;
+
+/**
+ * @brief Time of the last replica lag check.
+ */
+static time_t replica_checked = 0;
+
+/**
+ * @brief Time before which connecting to the replica is not retried.
+ */
+static time_t replica_retry = 0;
+
+/**
+ * @brief Session level SET statements to replay on the replica.
+ *
+ * The session settings, like the user id and timezone that the
+ * permission and time functions read, have to be the same on both
+ * sessions for the replica to return the same rows as the primary.
+ * Maps the statement text up to the value to the full statement, so a
+ * later SET of a setting replaces the earlier one.
+ */
+static GHashTable *replica_session_sets = NULL;
+
+/**
+ * @brief Seconds between checks of the replication lag.
+ */
+#define REPLICA_CHECK_INTERVAL 15
+
+/**
+ * @brief Seconds to wait before reconnecting after the replica went away.
+ */
+#define REPLICA_RETRY_INTERVAL 60
+
+/**
+ * @brief Maximum number of entries in the prepared statement cache.
+ */
+#define PREPARE_CACHE_MAX 1000
+
+/**
+ * @brief Cache of prepared statements on the current connection.
+ *
+ * Maps the SQL text to the server side statement name.
+ */
+static GHashTable *prepare_cache = NULL;
+
+/**
+ * @brief Serial for unique prepared statement names.
+ */
+static int prepare_serial = 0;
+
+/**
+ * @brief Number of statement executions served from the prepared cache.
+ */
+static int prepare_cache_hits = 0;
+
+/**
+ * @brief Number of statement executions that had to parse the statement.
+ */
+static int prepare_cache_misses = 0;
+
+/**
+ * @brief Drop the prepared statement cache.
+ *
+ * Required whenever the connection changes, because prepared statements
+ * are per session.
+ */
+static void
+prepare_cache_clear ()
+{
+  if (prepare_cache)
+    {
+      g_hash_table_destroy (prepare_cache);
+      prepare_cache = NULL;
+    }
+}
+
+/**
+ * @brief Get the prepared statement cache hit counters.
+ *
+ * @param[out]  hits    Number of executions that reused a prepared statement.
+ * @param[out]  misses  Number of executions that parsed the statement.
+ */
+void
+sql_prepare_cache_stats (int *hits, int *misses)
+{
+  if (hits)
+    *hits = prepare_cache_hits;
+  if (misses)
+    *misses = prepare_cache_misses;
+}
+
+/**
+ * @brief Check whether a statement may go in the prepared statement cache.
+ *
+ * Only row returning statements are cached, because PREPARE does not
+ * support utility and DDL statements.  Writes are cached too when they
+ * carry bound parameters, because bound parameters are a good sign that
+ * the statement text is constant across calls.
+ *
+ * @param[in]  sql       The SQL text.
+ * @param[in]  n_params  Number of bound parameters.
+ *
+ * @return 1 cacheable, else 0.
+ */
+static int
+prepare_cache_candidate (const char *sql, int n_params)
+{
+  while (*sql && g_ascii_isspace (*sql))
+    sql++;
+  if (n_params
+      && ((g_ascii_strncasecmp (sql, "INSERT", 6) == 0)
+          || (g_ascii_strncasecmp (sql, "UPDATE", 6) == 0)
+          || (g_ascii_strncasecmp (sql, "DELETE", 6) == 0)))
+    return 1;
+  return (g_ascii_strncasecmp (sql, "SELECT", 6) == 0)
+         || (g_ascii_strncasecmp (sql, "WITH", 4) == 0);
+}
+
+/**
+ * @brief Get the server side prepared statement name for some SQL.
+ *
+ * Prepares the statement and adds it to the cache on the first use.
+ *
+ * @param[in]  sql       The SQL text.
+ * @param[in]  n_params  Number of bound parameters.
+ *
+ * @return Statement name, or NULL if the statement is not cacheable or
+ *         preparing failed.
+ */
+static const char *
+prepare_cache_name (const char *sql, int n_params)
+{
+  const char *name;
+  gchar *new_name;
+  PGresult *result;
+
+  if (prepare_cache_candidate (sql, n_params) == 0)
+    return NULL;
+
+  if (prepare_cache == NULL)
+    prepare_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, g_free);
+
+  name = g_hash_table_lookup (prepare_cache, sql);
+  if (name)
+    {
+      prepare_cache_hits++;
+      return name;
+    }
+
+  if (g_hash_table_size (prepare_cache) >= PREPARE_CACHE_MAX)
+    return NULL;
+
+  new_name = g_strdup_printf ("gvmd_stmt_%i", ++prepare_serial);
+  result = PQprepare (conn, new_name, sql, 0, NULL);
+  if (PQresultStatus (result) != PGRES_COMMAND_OK)
+    {
+      /* Just execute unprepared, the caller reports any real error. */
+      g_debug ("%s: PQprepare failed: %s",
+               __func__,
+               PQresultErrorMessage (result));
+      PQclear (result);
+      g_free (new_name);
+      return NULL;
+    }
+  PQclear (result);
+
+  prepare_cache_misses++;
+  g_hash_table_insert (prepare_cache, g_strdup (sql), new_name);
+  return new_name;
+}
+
 
 /* Helpers. */
 
@@ -264,49 +488,86 @@ sql_default_database ()
 }
 
 /**
- * @brief Open the database.
+ * @brief Set the maximum number of idle connections kept for reuse.
  *
- * @param[in]  database  Database, or NULL for default.
+ * When set, sql_close returns the connection to a pool instead of
+ * closing it, and sql_open hands out a pooled connection when one
+ * matching the connection info is available.
  *
- * @return 0 success, -1 error.
+ * @param[in]  size  Maximum number of idle connections.  0 for none.
  */
-int
-sql_open (const db_conn_info_t *database)
+void
+sql_pool_size (int size)
 {
-  gchar *conn_info;
+  pool_size = size;
+}
+
+/**
+ * @brief Take an idle connection matching given connection info from the pool.
+ *
+ * @param[in]  conn_info  Connection info the connection must match.
+ *
+ * @return Connection on success, else NULL.
+ */
+static PGconn *
+pool_take (const gchar *conn_info)
+{
+  guint index;
+
+  if (pool_conns == NULL)
+    return NULL;
+
+  for (index = 0; index < pool_conns->len; index++)
+    if (strcmp (g_ptr_array_index (pool_conn_infos, index), conn_info)
+        == 0)
+      {
+        PGconn *pooled;
+
+        pooled = g_ptr_array_index (pool_conns, index);
+        g_ptr_array_remove_index_fast (pool_conns, index);
+        g_free (g_ptr_array_index (pool_conn_infos, index));
+        g_ptr_array_remove_index_fast (pool_conn_infos, index);
+
+        if (PQstatus (pooled) == CONNECTION_OK)
+          return pooled;
+
+        /* Connection went away while idle, drop it and check the rest. */
+        PQfinish (pooled);
+        return pool_take (conn_info);
+      }
+  return NULL;
+}
+
+/**
+ * @brief Open a connection to the database given by some connection info.
+ *
+ * @param[in]  conn_info  libpq connection info string.
+ *
+ * @return Connection on success, else NULL.
+ */
+static PGconn *
+sql_connect (const gchar *conn_info)
+{
+  PGconn *new_conn;
   PostgresPollingStatusType poll_status;
   int socket;
 
-  conn_info = g_strdup_printf ("dbname='%s'"
-                               " host='%s'"
-                               " port='%s'"
-                               " user='%s'"
-                               " application_name='%s'",
-                               database->name
-                                ? database->name
-                                : sql_default_database (),
-                               database->host ? database->host : "",
-                               database->port ? database->port : "",
-                               database->user ? database->user : "",
-                               "gvmd");
-  conn = PQconnectStart (conn_info);
-  g_free (conn_info);
-  if (conn == NULL)
+  new_conn = PQconnectStart (conn_info);
+  if (new_conn == NULL)
     {
       g_warning ("%s: PQconnectStart failed to allocate conn",
                  __func__);
-      return -1;
+      return NULL;
     }
-  if (PQstatus (conn) == CONNECTION_BAD)
+  if (PQstatus (new_conn) == CONNECTION_BAD)
     {
-      g_warning ("%s: PQconnectStart to '%s' failed: %s",
+      g_warning ("%s: PQconnectStart failed: %s",
                  __func__,
-                 database->name ? database->name : sql_default_database (),
-                 PQerrorMessage (conn));
+                 PQerrorMessage (new_conn));
       goto fail;
     }
 
-  socket = PQsocket (conn);
+  socket = PQsocket (new_conn);
   if (socket == 0)
     {
       g_warning ("%s: PQsocket 0", __func__);
@@ -362,177 +623,1035 @@ sql_open (const db_conn_info_t *database)
           g_warning ("%s: PQconnectPoll failed",
                      __func__);
           g_warning ("%s: PQerrorMessage (conn): %s", __func__,
-                     PQerrorMessage (conn));
+                     PQerrorMessage (new_conn));
           goto fail;
         }
       else if (poll_status == PGRES_POLLING_OK)
         /* Connection is ready, exit loop. */
         break;
 
-      poll_status = PQconnectPoll (conn);
+      poll_status = PQconnectPoll (new_conn);
     }
 
-  PQsetNoticeReceiver (conn, log_notice, NULL);
+  PQsetNoticeReceiver (new_conn, log_notice, NULL);
 
-  g_debug ("%s:   db: %s", __func__, PQdb (conn));
-  g_debug ("%s: user: %s", __func__, PQuser (conn));
-  g_debug ("%s: host: %s", __func__, PQhost (conn));
-  g_debug ("%s: port: %s", __func__, PQport (conn));
-  g_debug ("%s: socket: %i", __func__, PQsocket (conn));
-  g_debug ("%s: postgres version: %i", __func__, PQserverVersion (conn));
+  g_debug ("%s:   db: %s", __func__, PQdb (new_conn));
+  g_debug ("%s: user: %s", __func__, PQuser (new_conn));
+  g_debug ("%s: host: %s", __func__, PQhost (new_conn));
+  g_debug ("%s: port: %s", __func__, PQport (new_conn));
+  g_debug ("%s: socket: %i", __func__, PQsocket (new_conn));
+  g_debug ("%s: postgres version: %i", __func__, PQserverVersion (new_conn));
 
-  if (PQserverVersion (conn) < 90600)
+  if (PQserverVersion (new_conn) < 90600)
     {
       g_warning ("%s: PostgreSQL version 9.6 (90600) or higher is required",
                  __func__);
       g_warning ("%s: Current version is %i", __func__,
-                 PQserverVersion (conn));
+                 PQserverVersion (new_conn));
       goto fail;
     }
 
-  return 0;
+  return new_conn;
 
  fail:
-  PQfinish (conn);
-  conn = NULL;
-  return -1;
+  PQfinish (new_conn);
+  return NULL;
 }
 
+
+/* Read replica routing. */
+
 /**
- * @brief Close the database.
+ * @brief Close the connection to the read replica, if one is open.
+ *
+ * @param[in]  retry_wait  Whether to wait before the next connection attempt.
  */
-void
-sql_close ()
+static void
+replica_close (int retry_wait)
 {
-  PQfinish (conn);
-  conn = NULL;
+  if (replica_conn)
+    {
+      PQfinish (replica_conn);
+      replica_conn = NULL;
+    }
+  replica_fresh = 0;
+  replica_checked = 0;
+  replica_retry = retry_wait ? time (NULL) + REPLICA_RETRY_INTERVAL : 0;
 }
 
 /**
- * @brief Close the database in a forked process.
+ * @brief Set whether read only statements may go to the read replica.
+ *
+ * Typically switched on for the duration of a read only GMP command, so
+ * that the listing and dashboard reads run on the replica while
+ * everything else stays on the primary.  Has no effect when no replica
+ * is configured.
+ *
+ * @param[in]  enable  1 to route read only statements to the replica, 0 to
+ *                     keep every statement on the primary.
  */
 void
-sql_close_fork ()
+sql_replica_mode (int enable)
 {
-  conn = NULL;
+  replica_mode = enable;
 }
 
 /**
- * @brief Return 0.
+ * @brief Set the maximum tolerated replication lag of the read replica.
  *
- * @return 0.
+ * @param[in]  seconds  Lag in seconds above which statements stay on the
+ *                      primary.
  */
-int
-sql_changes ()
+void
+sql_replica_lag_limit (int seconds)
 {
-  /* TODO PQcmdTuples needs a PQresult.  Callers use for info only anyway. */
-  return 0;
+  replica_lag_limit = seconds;
 }
 
 /**
- * @brief Get the ID of the last inserted row.
+ * @brief Run a session level SET statement on the replica.
  *
- * @return Resource.
+ * Failure is only logged, because a SET that the replica rejects, like
+ * one naming a role that only exists on the primary, does not affect
+ * the reads that are routed to the replica.
+ *
+ * @param[in]  set_sql  The SET statement.
  */
-resource_t
-sql_last_insert_id ()
+static void
+replica_exec_set (const char *set_sql)
 {
-  return sql_int ("SELECT LASTVAL ();");
+  PGresult *result;
+
+  result = PQexec (replica_conn, set_sql);
+  if (PQresultStatus (result) != PGRES_COMMAND_OK)
+    g_debug ("%s: SET failed on replica: %s",
+             __func__,
+             PQresultErrorMessage (result));
+  PQclear (result);
 }
 
 /**
- * @brief Prepare a statement.
+ * @brief Record a session level SET statement, mirroring it on the replica.
  *
- * @param[in]  retry  Whether to keep retrying while database is busy or locked.
- * @param[in]  log    Whether to keep retrying while database is busy or locked.
- * @param[in]  sql    Format string for SQL statement.
- * @param[in]  args   Arguments for format string.
- * @param[out] stmt   Statement return.
+ * Transaction local SETs are skipped, because a transaction keeps every
+ * statement on the primary anyway.
  *
- * @return 0 success, 1 gave up, -1 error.
+ * @param[in]  sql  The SQL text.
  */
-int
-sql_prepare_internal (int retry, int log, const char* sql, va_list args,
-                      sql_stmt_t **stmt)
+static void
+replica_session_set (const char *sql)
 {
-  assert (stmt);
-
-  *stmt = (sql_stmt_t*) g_malloc (sizeof (sql_stmt_t));
-  sql_stmt_init (*stmt);
-  (*stmt)->sql = g_strdup_vprintf (sql, args);
-
-  if (log)
-    g_debug ("   sql: %s", (*stmt)->sql);
-
-  return 0;
+  const char *value;
+
+  if (replica_conn_info == NULL)
+    return;
+
+  while (*sql && g_ascii_isspace (*sql))
+    sql++;
+  if (g_ascii_strncasecmp (sql, "SET ", 4)
+      || g_ascii_strncasecmp (sql, "SET LOCAL ", 10) == 0)
+    return;
+
+  if (replica_session_sets == NULL)
+    replica_session_sets = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free, g_free);
+
+  /* Key on the text before the value, so a later "SET SESSION TIME ZONE
+   * 'UTC'" replaces an earlier "SET SESSION TIME ZONE 'CET'". */
+  value = strrchr (sql, '=');
+  if (value == NULL)
+    value = strrchr (sql, ' ');
+  g_hash_table_insert (replica_session_sets,
+                       value ? g_strndup (sql, value - sql) : g_strdup (sql),
+                       g_strdup (sql));
+
+  if (replica_conn)
+    replica_exec_set (sql);
 }
 
 /**
- * @brief Execute a statement.
+ * @brief Ensure the replica is connected and within the lag limit.
  *
- * @param[in]  retry  Whether to keep retrying while database is busy or locked.
- * @param[in]  stmt   Statement.
+ * The lag is rechecked at most every REPLICA_CHECK_INTERVAL seconds, so
+ * the staleness bound is approximate, which is fine for the listing and
+ * dashboard reads that are routed to the replica.
  *
- * @return 0 complete, 1 row available in results, -1 error, -2 gave up,
- *         -3 lock unavailable, -4 unique constraint violation.
+ * @return 1 if the replica may be used, else 0.
  */
-int
-sql_exec_internal (int retry, sql_stmt_t *stmt)
+static int
+replica_check ()
 {
+  time_t now;
   PGresult *result;
 
-  assert (stmt->sql);
+  now = time (NULL);
 
-  if (stmt->executed == 0)
+  if (replica_conn == NULL)
     {
-      result = PQexecParams (conn,
-                             stmt->sql,
-                             stmt->param_values->len,
-                             NULL,                 /* Default param types. */
-                             (const char* const*) stmt->param_values->pdata,
-                             (const int*) stmt->param_lengths->data,
-                             (const int*) stmt->param_formats->data,
-                             0);                   /* Results as text. */
-      if (PQresultStatus (result) != PGRES_TUPLES_OK
-          && PQresultStatus (result) != PGRES_COMMAND_OK)
+      if (now < replica_retry)
+        return 0;
+      replica_conn = sql_connect (replica_conn_info);
+      if (replica_conn == NULL)
         {
-          char *sqlstate;
+          g_info ("%s: failed to connect to replica, staying on primary",
+                  __func__);
+          replica_retry = now + REPLICA_RETRY_INTERVAL;
+          return 0;
+        }
+      replica_checked = 0;
 
-          sqlstate = PQresultErrorField (result, PG_DIAG_SQLSTATE);
-          g_debug ("%s: sqlstate: %s", __func__, sqlstate);
-          if (sqlstate && (strcmp (sqlstate, "57014") == 0))
-            {
-              /* query_canceled */
-              log_errors = 0;
-              g_debug ("%s: canceled SQL: %s", __func__, stmt->sql);
-            }
-          else if (sqlstate && (strcmp (sqlstate, "55P03") == 0))
-            {
-              /* lock_not_available */
-              g_debug ("%s: lock unavailable: %s",
-                       __func__,
-                       PQresultErrorMessage(result));
-              return -3;
-            }
-          else if (sqlstate && (strcmp (sqlstate, "23505") == 0))
-            {
-              /* unique_violation */
-              g_warning ("%s: constraint violation: %s",
-                         __func__,
-                         PQresultErrorMessage (result));
-              g_warning ("%s: SQL: %s", __func__, stmt->sql);
-              return -4;
-            }
-            else if (sqlstate && (strcmp (sqlstate, "40P01") == 0))
-              {
-                /* deadlock_detected */
-                g_debug ("%s: deadlock: %s",
-                         __func__,
-                         PQresultErrorMessage (result));
-                g_debug ("%s: SQL: %s", __func__, stmt->sql);
-                return -5;
-              }
-          if (log_errors)
+      /* Mirror the primary's session settings on the fresh session. */
+      if (replica_session_sets)
+        {
+          GHashTableIter iter;
+          gpointer set_sql;
+
+          g_hash_table_iter_init (&iter, replica_session_sets);
+          while (g_hash_table_iter_next (&iter, NULL, &set_sql))
+            replica_exec_set (set_sql);
+        }
+    }
+
+  if (now - replica_checked < REPLICA_CHECK_INTERVAL)
+    return replica_fresh;
+  replica_checked = now;
+
+  /* A replica that replayed everything it received counts as caught up,
+   * even when the last replayed transaction is old, because the primary
+   * may simply have been idle since then. */
+  result = PQexec (replica_conn,
+                   "SELECT CASE"
+                   " WHEN pg_is_in_recovery () = FALSE THEN 0"
+                   " WHEN pg_last_wal_receive_lsn () = pg_last_wal_replay_lsn ()"
+                   " THEN 0"
+                   " ELSE extract (EPOCH FROM now ()"
+                   "               - pg_last_xact_replay_timestamp ())"
+                   " END;");
+  if (PQresultStatus (result) != PGRES_TUPLES_OK)
+    {
+      g_warning ("%s: replica lag check failed: %s",
+                 __func__,
+                 PQresultErrorMessage (result));
+      PQclear (result);
+      replica_close (1);
+      return 0;
+    }
+
+  if (PQgetisnull (result, 0, 0))
+    /* In recovery but nothing replayed yet, assume way behind. */
+    replica_fresh = 0;
+  else
+    {
+      double lag;
+
+      lag = atof (PQgetvalue (result, 0, 0));
+      replica_fresh = (lag <= replica_lag_limit);
+      if (replica_fresh == 0)
+        g_debug ("%s: replica is %0.1fs behind, staying on primary",
+                 __func__, lag);
+    }
+  PQclear (result);
+
+  return replica_fresh;
+}
+
+/**
+ * @brief Choose the connection a statement should execute on.
+ *
+ * A statement goes to the read replica only when replica mode is on, a
+ * replica is configured and keeping up, the statement stands alone
+ * outside any transaction, and it is a plain read.  Everything else
+ * runs on the primary.  A write that slips through, for example in a
+ * data modifying CTE, is rejected by the standby and the caller falls
+ * back to the primary, so the SELECT and WITH check may err towards the
+ * replica.
+ *
+ * @param[in]  sql  The SQL text.
+ *
+ * @return Connection to execute the statement on.
+ */
+static PGconn *
+replica_route (const char *sql)
+{
+  if (replica_mode == 0 || replica_conn_info == NULL)
+    return conn;
+
+  /* A transaction's reads have to see the transaction's own writes. */
+  if (PQtransactionStatus (conn) != PQTRANS_IDLE)
+    return conn;
+
+  while (*sql && g_ascii_isspace (*sql))
+    sql++;
+  if (g_ascii_strncasecmp (sql, "SELECT", 6)
+      && g_ascii_strncasecmp (sql, "WITH", 4))
+    return conn;
+
+  if (replica_check ())
+    return replica_conn;
+  return conn;
+}
+
+/**
+ * @brief Open the database.
+ *
+ * @param[in]  database  Database, or NULL for default.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+sql_open (const db_conn_info_t *database)
+{
+  gchar *conn_info;
+
+  conn_info = g_strdup_printf ("dbname='%s'"
+                               " host='%s'"
+                               " port='%s'"
+                               " user='%s'"
+                               " application_name='%s'",
+                               database->name
+                                ? database->name
+                                : sql_default_database (),
+                               database->host ? database->host : "",
+                               database->port ? database->port : "",
+                               database->user ? database->user : "",
+                               "gvmd");
+
+  g_free (conn_info_current);
+  conn_info_current = conn_info;
+
+  /* Prepared statements are per session, so start a fresh cache. */
+  prepare_cache_clear ();
+
+  /* Any open replica connection refers to the old database, so drop it
+   * and remember where the new replica is.  The session settings belong
+   * to the old primary session, so forget them too. */
+  replica_close (0);
+  if (replica_session_sets)
+    {
+      g_hash_table_destroy (replica_session_sets);
+      replica_session_sets = NULL;
+    }
+  g_free (replica_conn_info);
+  if (database->replica_host && strlen (database->replica_host))
+    replica_conn_info = g_strdup_printf ("dbname='%s'"
+                                         " host='%s'"
+                                         " port='%s'"
+                                         " user='%s'"
+                                         " application_name='%s'",
+                                         database->name
+                                          ? database->name
+                                          : sql_default_database (),
+                                         database->replica_host,
+                                         database->replica_port
+                                          ? database->replica_port
+                                          : (database->port
+                                              ? database->port
+                                              : ""),
+                                         database->user ? database->user : "",
+                                         "gvmd");
+  else
+    replica_conn_info = NULL;
+
+  conn = pool_take (conn_info);
+  if (conn)
+    {
+      g_debug ("%s: reusing pooled connection", __func__);
+      return 0;
+    }
+
+  conn = sql_connect (conn_info);
+  if (conn == NULL)
+    return -1;
+  return 0;
+}
+
+/**
+ * @brief Close the database.
+ *
+ * When a pool size is set with sql_pool_size, keep the connection for
+ * reuse by a later sql_open instead of closing it.
+ */
+void
+sql_close ()
+{
+  /* The replica reconnects lazily, so it is not worth pooling. */
+  replica_close (0);
+
+  if (conn
+      && pool_size > 0
+      && PQstatus (conn) == CONNECTION_OK
+      && (pool_conns == NULL || pool_conns->len < (guint) pool_size))
+    {
+      PGresult *result;
+
+      /* Reset the session before pooling it.  Roll back any transaction
+       * that was left open, and discard the session state, especially
+       * the prepared statements, which the next user of the connection
+       * cannot reach because sql_open starts a fresh statement cache and
+       * would otherwise pile up in the backend without bound. */
+      if (PQtransactionStatus (conn) != PQTRANS_IDLE)
+        {
+          result = PQexec (conn, "ROLLBACK;");
+          PQclear (result);
+        }
+      result = PQexec (conn, "DISCARD ALL;");
+      if (PQresultStatus (result) == PGRES_COMMAND_OK)
+        {
+          PQclear (result);
+          if (pool_conns == NULL)
+            {
+              pool_conns = g_ptr_array_new ();
+              pool_conn_infos = g_ptr_array_new ();
+            }
+          g_ptr_array_add (pool_conns, conn);
+          g_ptr_array_add (pool_conn_infos, g_strdup (conn_info_current));
+          conn = NULL;
+          prepare_cache_clear ();
+          return;
+        }
+      /* Reset failed, so fall through and close the connection. */
+      PQclear (result);
+    }
+  PQfinish (conn);
+  conn = NULL;
+  prepare_cache_clear ();
+}
+
+/**
+ * @brief Close the database in a forked process.
+ */
+void
+sql_close_fork ()
+{
+  conn = NULL;
+  prepare_cache_clear ();
+
+  /* As with the primary, the replica socket belongs to the parent. */
+  replica_conn = NULL;
+  replica_fresh = 0;
+  replica_checked = 0;
+  replica_retry = 0;
+
+  /* Any pooled connections belong to the parent, so just forget them. */
+  if (pool_conns)
+    {
+      g_ptr_array_set_size (pool_conns, 0);
+      g_ptr_array_set_size (pool_conn_infos, 0);
+    }
+}
+
+/**
+ * @brief Return 0.
+ *
+ * @return 0.
+ */
+int
+sql_changes ()
+{
+  /* TODO PQcmdTuples needs a PQresult.  Callers use for info only anyway. */
+  return 0;
+}
+
+/**
+ * @brief Get the ID of the last inserted row.
+ *
+ * @return Resource.
+ */
+resource_t
+sql_last_insert_id ()
+{
+  return sql_int ("SELECT LASTVAL ();");
+}
+
+/**
+ * @brief Prepare a statement.
+ *
+ * @param[in]  retry  Whether to keep retrying while database is busy or locked.
+ * @param[in]  log    Whether to keep retrying while database is busy or locked.
+ * @param[in]  sql    Format string for SQL statement.
+ * @param[in]  args   Arguments for format string.
+ * @param[out] stmt   Statement return.
+ *
+ * @return 0 success, 1 gave up, -1 error.
+ */
+int
+sql_prepare_internal (int retry, int log, const char* sql, va_list args,
+                      sql_stmt_t **stmt)
+{
+  assert (stmt);
+
+  *stmt = (sql_stmt_t*) g_malloc (sizeof (sql_stmt_t));
+  sql_stmt_init (*stmt);
+  (*stmt)->sql = g_strdup_vprintf (sql, args);
+
+  if (log)
+    g_debug ("   sql: %s", (*stmt)->sql);
+
+  return 0;
+}
+
+/**
+ * @brief Append a text parameter to a statement.
+ *
+ * @param[in]  stmt   Statement.
+ * @param[in]  value  Parameter value.  NULL for an SQL NULL.
+ */
+static void
+sql_param_append (sql_stmt_t *stmt, const char *value)
+{
+  int length, format;
+
+  array_add (stmt->param_values, g_strdup (value));
+  length = value ? strlen (value) : 0;
+  format = 0;   /* Text. */
+  g_array_append_val (stmt->param_lengths, length);
+  g_array_append_val (stmt->param_formats, format);
+}
+
+/**
+ * @brief Prepare a statement with bound text parameters.
+ *
+ * The statement refers to the parameters as $1, $2, ... and the values
+ * travel to the server out of band, so they need no quoting and the
+ * statement text stays constant for the prepared statement cache.
+ *
+ * @param[in]  log           Whether to log the statement.
+ * @param[in]  sql           SQL statement, taken literally.
+ * @param[in]  n_params      Number of parameters.
+ * @param[in]  param_values  Parameter values, $1 first.  NULL entries
+ *                           become SQL NULLs.
+ * @param[out] stmt          Statement return.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+sql_prepare_params_internal (int log, const char *sql, int n_params,
+                             const char *const *param_values,
+                             sql_stmt_t **stmt)
+{
+  int index;
+
+  assert (stmt);
+
+  *stmt = (sql_stmt_t*) g_malloc (sizeof (sql_stmt_t));
+  sql_stmt_init (*stmt);
+  (*stmt)->sql = g_strdup (sql);
+
+  for (index = 0; index < n_params; index++)
+    sql_param_append (*stmt, param_values[index]);
+
+  if (log)
+    g_debug ("   sql: %s", (*stmt)->sql);
+
+  return 0;
+}
+
+/**
+ * @brief Statements sent asynchronously, in send order, awaiting results.
+ */
+static GQueue *async_queue = NULL;
+
+/**
+ * @brief Send a statement to the server without waiting for the result.
+ *
+ * Statements sent this way run in libpq pipeline mode, so several
+ * independent queries can be in flight at once and share network round
+ * trips.  The results are collected, in send order, when any of the
+ * statements is first executed.
+ *
+ * When libpq lacks pipeline support this does nothing and the statement
+ * simply executes synchronously on first use.
+ *
+ * @param[in]  stmt  Statement.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+sql_send_internal (sql_stmt_t *stmt)
+{
+#ifdef LIBPQ_HAS_PIPELINING
+  if (async_queue == NULL)
+    async_queue = g_queue_new ();
+
+  if (g_queue_is_empty (async_queue)
+      && PQenterPipelineMode (conn) == 0)
+    {
+      g_warning ("%s: PQenterPipelineMode failed: %s",
+                 __func__,
+                 PQerrorMessage (conn));
+      return -1;
+    }
+
+  sql_statements_sent++;
+  if (PQsendQueryParams (conn,
+                         stmt->sql,
+                         stmt->param_values->len,
+                         NULL,                 /* Default param types. */
+                         (const char* const*) stmt->param_values->pdata,
+                         (const int*) stmt->param_lengths->data,
+                         (const int*) stmt->param_formats->data,
+                         0)                    /* Results as text. */
+      == 0)
+    {
+      g_warning ("%s: PQsendQueryParams failed: %s",
+                 __func__,
+                 PQerrorMessage (conn));
+      if (g_queue_is_empty (async_queue))
+        PQexitPipelineMode (conn);
+      return -1;
+    }
+
+  stmt->async = 1;
+  g_queue_push_tail (async_queue, stmt);
+#endif
+  return 0;
+}
+
+/**
+ * @brief Collect the results of all statements sent asynchronously.
+ *
+ * The results arrive in send order, so collect every outstanding
+ * statement, storing each result on its statement for later row
+ * stepping.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+sql_async_drain ()
+{
+#ifdef LIBPQ_HAS_PIPELINING
+  PGresult *result;
+
+  if (async_queue == NULL || g_queue_is_empty (async_queue))
+    return 0;
+
+  if (PQpipelineSync (conn) == 0)
+    {
+      g_warning ("%s: PQpipelineSync failed: %s",
+                 __func__,
+                 PQerrorMessage (conn));
+      return -1;
+    }
+
+  while (g_queue_is_empty (async_queue) == FALSE)
+    {
+      sql_stmt_t *head;
+
+      head = (sql_stmt_t *) g_queue_pop_head (async_queue);
+
+      result = PQgetResult (conn);
+      if (result == NULL)
+        {
+          g_warning ("%s: unexpected end of pipeline results", __func__);
+          return -1;
+        }
+      if (PQresultStatus (result) != PGRES_TUPLES_OK
+          && PQresultStatus (result) != PGRES_COMMAND_OK
+          && log_errors)
+        {
+          g_warning ("%s: async statement failed: %s",
+                     __func__,
+                     PQresultErrorMessage (result));
+          g_warning ("%s: SQL: %s", __func__, head->sql);
+        }
+      head->result = result;
+      head->executed = 1;
+      head->async = 0;
+
+      /* Consume the NULL that ends this statement's results. */
+      result = PQgetResult (conn);
+      if (result)
+        PQclear (result);
+    }
+
+  /* Read up to and including the sync point. */
+  while ((result = PQgetResult (conn)))
+    {
+      int status;
+
+      status = PQresultStatus (result);
+      PQclear (result);
+      if (status == PGRES_PIPELINE_SYNC)
+        break;
+    }
+
+  if (PQexitPipelineMode (conn) == 0)
+    g_warning ("%s: PQexitPipelineMode failed: %s",
+               __func__,
+               PQerrorMessage (conn));
+#endif
+  return 0;
+}
+
+/**
+ * @brief Number of rows fetched per batch from a cursor backed statement.
+ */
+#define SQL_CURSOR_FETCH_SIZE 4096
+
+/**
+ * @brief Serial for unique cursor names.
+ */
+static int cursor_serial = 0;
+
+/**
+ * @brief Prepare a statement that will be executed via a cursor.
+ *
+ * The query is executed with DECLARE/FETCH in batches of
+ * SQL_CURSOR_FETCH_SIZE rows, so only a bounded number of rows is held
+ * in memory at a time.
+ *
+ * @param[in]  retry  Whether to keep retrying while database is busy or locked.
+ * @param[in]  log    Whether to log the statement.
+ * @param[in]  sql    Format string for SQL statement.
+ * @param[in]  args   Arguments for format string.
+ * @param[out] stmt   Statement return.
+ *
+ * @return 0 success, 1 gave up, -1 error.
+ */
+int
+sql_prepare_cursor_internal (int retry, int log, const char *sql,
+                             va_list args, sql_stmt_t **stmt)
+{
+  int ret;
+
+  ret = sql_prepare_internal (retry, log, sql, args, stmt);
+  if (ret)
+    return ret;
+  (*stmt)->cursor_name = g_strdup_printf ("gvmd_cursor_%i", ++cursor_serial);
+  return 0;
+}
+
+/**
+ * @brief Declare the cursor for a cursor backed statement.
+ *
+ * A cursor may only be declared inside a transaction, so when there is
+ * no transaction open, wrap the DECLARE in one.  The cursor is declared
+ * WITH HOLD so that it survives the commit and any transactions the
+ * caller runs while iterating.
+ *
+ * @param[in]  stmt  Statement.
+ *
+ * @return 0 success, -1 error.
+ */
+static int
+sql_cursor_declare (sql_stmt_t *stmt)
+{
+  PGresult *result;
+  gchar *declare;
+  int own_transaction;
+
+  own_transaction = (PQtransactionStatus (conn) != PQTRANS_INTRANS);
+  if (own_transaction)
+    {
+      result = PQexec (conn, "BEGIN;");
+      if (PQresultStatus (result) != PGRES_COMMAND_OK)
+        {
+          if (log_errors)
+            g_warning ("%s: BEGIN failed: %s",
+                       __func__,
+                       PQresultErrorMessage (result));
+          PQclear (result);
+          return -1;
+        }
+      PQclear (result);
+    }
+
+  declare = g_strdup_printf ("DECLARE %s NO SCROLL CURSOR WITH HOLD FOR %s",
+                             stmt->cursor_name,
+                             stmt->sql);
+  result = PQexecParams (conn,
+                         declare,
+                         stmt->param_values->len,
+                         NULL,                 /* Default param types. */
+                         (const char* const*) stmt->param_values->pdata,
+                         (const int*) stmt->param_lengths->data,
+                         (const int*) stmt->param_formats->data,
+                         0);                   /* Results as text. */
+  g_free (declare);
+  if (PQresultStatus (result) != PGRES_COMMAND_OK)
+    {
+      if (log_errors)
+        {
+          g_warning ("%s: DECLARE failed: %s",
+                     __func__,
+                     PQresultErrorMessage (result));
+          g_warning ("%s: SQL: %s", __func__, stmt->sql);
+        }
+      PQclear (result);
+      if (own_transaction)
+        {
+          result = PQexec (conn, "ROLLBACK;");
+          PQclear (result);
+        }
+      return -1;
+    }
+  PQclear (result);
+
+  if (own_transaction)
+    {
+      result = PQexec (conn, "COMMIT;");
+      if (PQresultStatus (result) != PGRES_COMMAND_OK)
+        {
+          if (log_errors)
+            g_warning ("%s: COMMIT failed: %s",
+                       __func__,
+                       PQresultErrorMessage (result));
+          PQclear (result);
+          return -1;
+        }
+      PQclear (result);
+    }
+
+  return 0;
+}
+
+/**
+ * @brief Execute a cursor backed statement, fetching rows in batches.
+ *
+ * @param[in]  stmt  Statement.
+ *
+ * @return 1 row available, 0 no more rows, -1 error.
+ */
+static int
+sql_exec_cursor (sql_stmt_t *stmt)
+{
+  if (stmt->executed == 0)
+    {
+      if (sql_cursor_declare (stmt))
+        return -1;
+      stmt->executed = 1;
+    }
+
+  if (stmt->result == NULL
+      || stmt->current_row >= PQntuples (stmt->result) - 1)
+    {
+      PGresult *result;
+      gchar *fetch;
+      gint64 started;
+
+      if (stmt->result)
+        {
+          /* A batch shorter than the fetch size was the last one. */
+          if (PQntuples (stmt->result) < SQL_CURSOR_FETCH_SIZE)
+            return 0;
+          PQclear (stmt->result);
+          stmt->result = NULL;
+        }
+
+      fetch = g_strdup_printf ("FETCH FORWARD %i FROM %s;",
+                               SQL_CURSOR_FETCH_SIZE,
+                               stmt->cursor_name);
+      sql_statements_sent++;
+      started = g_get_monotonic_time ();
+      result = PQexec (conn, fetch);
+      g_free (fetch);
+      if (sql_slow_statement_ms > 0
+          && (g_get_monotonic_time () - started
+              >= ((gint64) sql_slow_statement_ms) * 1000))
+        log_slow_statement (stmt, g_get_monotonic_time () - started);
+      if (PQresultStatus (result) != PGRES_TUPLES_OK)
+        {
+          if (log_errors)
+            {
+              g_warning ("%s: FETCH failed: %s",
+                         __func__,
+                         PQresultErrorMessage (result));
+              g_warning ("%s: SQL: %s", __func__, stmt->sql);
+            }
+          PQclear (result);
+          return -1;
+        }
+
+      stmt->result = result;
+      stmt->current_row = -1;
+
+      if (PQntuples (stmt->result) == 0)
+        return 0;
+    }
+
+  stmt->current_row++;
+  return 1;
+}
+
+/**
+ * @brief Log a statement that took longer than the slow statement threshold.
+ *
+ * Captures the plan of the statement with a plain EXPLAIN, so the log
+ * shows what the server chose to do without running the statement again.
+ * The plan is left out silently when the EXPLAIN fails, for example for
+ * utility statements or when the transaction is already aborted.
+ *
+ * @param[in]  stmt         Statement.
+ * @param[in]  duration_us  Duration of the statement, in microseconds.
+ */
+static void
+log_slow_statement (sql_stmt_t *stmt, gint64 duration_us)
+{
+  PGresult *explain;
+  GString *plan;
+  gchar *explain_sql;
+  int row;
+
+  explain_sql = g_strconcat ("EXPLAIN ", stmt->sql, NULL);
+  explain = PQexecParams (conn,
+                          explain_sql,
+                          stmt->param_values->len,
+                          NULL,               /* Default param types. */
+                          (const char* const*) stmt->param_values->pdata,
+                          (const int*) stmt->param_lengths->data,
+                          (const int*) stmt->param_formats->data,
+                          0);                 /* Results as text. */
+  g_free (explain_sql);
+
+  plan = g_string_new ("");
+  if (PQresultStatus (explain) == PGRES_TUPLES_OK)
+    for (row = 0; row < PQntuples (explain); row++)
+      g_string_append_printf (plan, "\n  %s", PQgetvalue (explain, row, 0));
+  PQclear (explain);
+
+  g_warning ("%s: slow statement: %0.1f ms, %u parameters, command %s:"
+             " %s%s",
+             __func__,
+             duration_us / 1000.0,
+             stmt->param_values->len,
+             sql_statement_context () ? sql_statement_context () : "none",
+             stmt->sql,
+             plan->str);
+  g_string_free (plan, TRUE);
+}
+
+/**
+ * @brief Run a statement's SQL on a connection.
+ *
+ * Uses the prepared statement cache when the statement runs on the
+ * primary, because the cached statement names belong to the primary
+ * session.
+ *
+ * @param[in]  exec_conn  Connection to execute on.
+ * @param[in]  stmt       Statement.
+ *
+ * @return Result.
+ */
+static PGresult *
+exec_statement (PGconn *exec_conn, sql_stmt_t *stmt)
+{
+  const char *prepared;
+
+  prepared = exec_conn == conn
+              ? prepare_cache_name (stmt->sql, stmt->param_values->len)
+              : NULL;
+  if (prepared)
+    return PQexecPrepared (exec_conn,
+                           prepared,
+                           stmt->param_values->len,
+                           (const char* const*) stmt->param_values->pdata,
+                           (const int*) stmt->param_lengths->data,
+                           (const int*) stmt->param_formats->data,
+                           0);                 /* Results as text. */
+  return PQexecParams (exec_conn,
+                       stmt->sql,
+                       stmt->param_values->len,
+                       NULL,                   /* Default param types. */
+                       (const char* const*) stmt->param_values->pdata,
+                       (const int*) stmt->param_lengths->data,
+                       (const int*) stmt->param_formats->data,
+                       0);                     /* Results as text. */
+}
+
+/**
+ * @brief Execute a statement.
+ *
+ * @param[in]  retry  Whether to keep retrying while database is busy or locked.
+ * @param[in]  stmt   Statement.
+ *
+ * @return 0 complete, 1 row available in results, -1 error, -2 gave up,
+ *         -3 lock unavailable, -4 unique constraint violation.
+ */
+int
+sql_exec_internal (int retry, sql_stmt_t *stmt)
+{
+  PGresult *result;
+
+  assert (stmt->sql);
+
+  /* The pipeline has exclusive use of the connection, so any statements
+   * that were sent asynchronously have to be collected before another
+   * statement can run. */
+  if (async_queue
+      && g_queue_is_empty (async_queue) == FALSE
+      && sql_async_drain ())
+    return -1;
+
+  if (stmt->cursor_name)
+    return sql_exec_cursor (stmt);
+
+  if (stmt->executed == 0)
+    {
+      PGconn *exec_conn;
+      gint64 started;
+
+      exec_conn = replica_route (stmt->sql);
+      sql_statements_sent++;
+      started = g_get_monotonic_time ();
+      result = exec_statement (exec_conn, stmt);
+      if (sql_slow_statement_ms > 0
+          && (g_get_monotonic_time () - started
+              >= ((gint64) sql_slow_statement_ms) * 1000))
+        log_slow_statement (stmt, g_get_monotonic_time () - started);
+      if (exec_conn != conn
+          && PQresultStatus (result) != PGRES_TUPLES_OK
+          && PQresultStatus (result) != PGRES_COMMAND_OK)
+        {
+          /* The replica may be gone or may have rejected the statement
+           * as a standby, either way the primary can still serve it. */
+          g_debug ("%s: retrying on primary after replica error: %s",
+                   __func__,
+                   PQresultErrorMessage (result));
+          PQclear (result);
+          if (PQstatus (replica_conn) != CONNECTION_OK)
+            replica_close (1);
+          result = exec_statement (conn, stmt);
+        }
+      if (PQresultStatus (result) != PGRES_TUPLES_OK
+          && PQresultStatus (result) != PGRES_COMMAND_OK)
+        {
+          char *sqlstate;
+
+          sqlstate = PQresultErrorField (result, PG_DIAG_SQLSTATE);
+          g_debug ("%s: sqlstate: %s", __func__, sqlstate);
+          if (sqlstate && (strcmp (sqlstate, "57014") == 0))
+            {
+              /* query_canceled */
+              log_errors = 0;
+              g_debug ("%s: canceled SQL: %s", __func__, stmt->sql);
+            }
+          else if (sqlstate && (strcmp (sqlstate, "55P03") == 0))
+            {
+              /* lock_not_available */
+              g_debug ("%s: lock unavailable: %s",
+                       __func__,
+                       PQresultErrorMessage(result));
+              return -3;
+            }
+          else if (sqlstate && (strcmp (sqlstate, "23505") == 0))
+            {
+              /* unique_violation */
+              g_warning ("%s: constraint violation: %s",
+                         __func__,
+                         PQresultErrorMessage (result));
+              g_warning ("%s: SQL: %s", __func__, stmt->sql);
+              return -4;
+            }
+            else if (sqlstate && (strcmp (sqlstate, "40P01") == 0))
+              {
+                /* deadlock_detected */
+                g_debug ("%s: deadlock: %s",
+                         __func__,
+                         PQresultErrorMessage (result));
+                g_debug ("%s: SQL: %s", __func__, stmt->sql);
+                return -5;
+              }
+          if (log_errors)
             {
               g_warning ("%s: PQexec failed: %s (%i)",
                          __func__,
@@ -543,6 +1662,10 @@ sql_exec_internal (int retry, sql_stmt_t *stmt)
           return -1;
         }
 
+      if (exec_conn == conn)
+        /* Keep any session settings mirrored on the replica. */
+        replica_session_set (stmt->sql);
+
       stmt->result = result;
       stmt->executed = 1;
     }
@@ -556,6 +1679,106 @@ sql_exec_internal (int retry, sql_stmt_t *stmt)
   return 0;
 }
 
+
+
+/* COPY data loads. */
+
+/**
+ * @brief Start a COPY ... FROM STDIN data load.
+ *
+ * Feed the rows in with \ref sql_copy_write and finish the load with
+ * \ref sql_copy_end.  No other statements may run on the connection
+ * until the load is finished.
+ *
+ * @param[in]  sql  Format string for the COPY statement.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+sql_copy_start (const char *sql, ...)
+{
+  va_list args;
+  gchar *statement;
+  PGresult *result;
+
+  va_start (args, sql);
+  statement = g_strdup_vprintf (sql, args);
+  va_end (args);
+
+  result = PQexec (conn, statement);
+  if (PQresultStatus (result) != PGRES_COPY_IN)
+    {
+      g_warning ("%s: PQexec failed: %s",
+                 __func__,
+                 PQresultErrorMessage (result));
+      g_warning ("%s: SQL: %s", __func__, statement);
+      PQclear (result);
+      g_free (statement);
+      return -1;
+    }
+  PQclear (result);
+  g_free (statement);
+  return 0;
+}
+
+/**
+ * @brief Send data for a COPY load started with \ref sql_copy_start.
+ *
+ * The data is rows in COPY text format: tab separated columns, one row
+ * per newline, with backslash escaping applied by \ref sql_copy_escape.
+ *
+ * @param[in]  data    Data to send.
+ * @param[in]  length  Length of data in bytes.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+sql_copy_write (const char *data, size_t length)
+{
+  if (PQputCopyData (conn, data, length) != 1)
+    {
+      g_warning ("%s: PQputCopyData failed: %s",
+                 __func__,
+                 PQerrorMessage (conn));
+      return -1;
+    }
+  return 0;
+}
+
+/**
+ * @brief Finish a COPY load started with \ref sql_copy_start.
+ *
+ * @return 0 success, -1 error.
+ */
+int
+sql_copy_end ()
+{
+  PGresult *result;
+  int ret;
+
+  if (PQputCopyEnd (conn, NULL) != 1)
+    {
+      g_warning ("%s: PQputCopyEnd failed: %s",
+                 __func__,
+                 PQerrorMessage (conn));
+      return -1;
+    }
+
+  ret = 0;
+  while ((result = PQgetResult (conn)))
+    {
+      if (PQresultStatus (result) != PGRES_COMMAND_OK)
+        {
+          g_warning ("%s: COPY failed: %s",
+                     __func__,
+                     PQresultErrorMessage (result));
+          ret = -1;
+        }
+      PQclear (result);
+    }
+  return ret;
+}
+
 
 /* Transactions. */
 
@@ -667,6 +1890,24 @@ iterator_rewind (iterator_t* iterator)
 void
 sql_finalize (sql_stmt_t *stmt)
 {
+  /* If the statement is awaiting a pipelined result, the result has to
+   * come off the wire before the statement can go away. */
+  if (stmt->async)
+    sql_async_drain ();
+  if (stmt->cursor_name)
+    {
+      if (stmt->executed)
+        {
+          PGresult *result;
+          gchar *close_sql;
+
+          close_sql = g_strdup_printf ("CLOSE %s;", stmt->cursor_name);
+          result = PQexec (conn, close_sql);
+          g_free (close_sql);
+          PQclear (result);
+        }
+      g_free (stmt->cursor_name);
+    }
   PQclear (stmt->result);
   g_free (stmt->sql);
   array_free (stmt->param_values);
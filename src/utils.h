@@ -79,6 +79,9 @@ lockfile_lock_path_nb (lockfile_t *, const gchar *);
 int
 lockfile_lock_shared_nb (lockfile_t *, const gchar *);
 
+int
+lockfile_lock_path_shared_nb (lockfile_t *, const gchar *);
+
 int
 lockfile_unlock (lockfile_t *);
 
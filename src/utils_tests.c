@@ -78,6 +78,19 @@ Ensure (utils, parse_iso_time_tz_with_fallback_tz)
                is_equal_to (1577840523));
 }
 
+Ensure (utils, parse_iso_time_tz_with_current_tz)
+{
+  assert_that (setenv ("TZ", "Australia/Sydney", 1), is_equal_to (0));
+  tzset ();
+
+  assert_that (parse_iso_time_tz ("2020-06-01T01:02:03",
+                                  "Australia/Sydney"),
+               is_equal_to (1590937323));
+
+  unsetenv ("TZ");
+  tzset ();
+}
+
 Ensure (utils, parse_iso_time_tz_variants)
 {
   assert_that (parse_iso_time_tz ("2020-06-01T01:02Z",
@@ -89,6 +102,21 @@ Ensure (utils, parse_iso_time_tz_variants)
                is_equal_to (1590973323));
 }
 
+/* is_uuid */
+
+Ensure (utils, is_uuid_accepts_uuid)
+{
+  assert_that (is_uuid ("814cd30f-dee6-4d3c-9eaa-ba4badcd6caa"),
+               is_equal_to (1));
+}
+
+Ensure (utils, is_uuid_rejects_other_text)
+{
+  assert_that (is_uuid ("814cd30f-dee6-4d3c-9eaa-ba4badcd6cag"),
+               is_equal_to (0));
+  assert_that (is_uuid ("'; DROP TABLE tasks; --"), is_equal_to (0));
+}
+
 /* Number of nanoseconds in a second. */
 #define NANOSECONDS 1000000000
 
@@ -163,7 +191,11 @@ main (int argc, char **argv)
   add_test_with_context (suite, utils, parse_iso_time_tz_with_offset);
   add_test_with_context (suite, utils, parse_iso_time_tz_with_z);
   add_test_with_context (suite, utils, parse_iso_time_tz_with_fallback_tz);
+  add_test_with_context (suite, utils, parse_iso_time_tz_with_current_tz);
   add_test_with_context (suite, utils, parse_iso_time_tz_variants);
+
+  add_test_with_context (suite, utils, is_uuid_accepts_uuid);
+  add_test_with_context (suite, utils, is_uuid_rejects_other_text);
   
   add_test_with_context (suite, utils, strescape_check_utf_8_no_exceptions);
   add_test_with_context (suite, utils, strescape_check_utf_8_with_exceptions);